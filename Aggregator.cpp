@@ -0,0 +1,159 @@
+#include "Aggregator.h"
+
+#include <string.h>
+
+
+namespace
+{
+    bool IsDigit(const char ch)
+    {
+        return ch >= '0' && ch <= '9';
+    }
+
+    std::string_view TrimEndOfLine(std::string_view line)
+    {
+        if (!line.empty() && line.back() == '\n')
+        {
+            line.remove_suffix(1);
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.remove_suffix(1);
+            }
+        }
+        return line;
+    }
+}
+
+
+bool CAggregator::Init(const Options& options)
+{
+    if (options.keyField > CFieldFilter::MaxField || options.timeField > CFieldFilter::MaxField ||
+        options.topCount == 0 || options.topCount > MaxTopCount)
+    {
+        return false;
+    }
+
+    this->_options = options;
+    if (!options.keyPattern.empty())
+    {
+        // the matcher refers to the pattern, so it is copied
+        if (!this->_keyPatternText.Allocate(options.keyPattern.size()))
+        {
+            return false;
+        }
+        memcpy(this->_keyPatternText.ptr, options.keyPattern.data(), options.keyPattern.size());
+        this->_options.keyPattern = std::string_view(this->_keyPatternText.ptr, options.keyPattern.size());
+        if (!this->_keyMatcher.Compile(this->_options.keyPattern) || options.keyWildcard == 0 ||
+            options.keyWildcard > this->_keyMatcher.GetCaptureCount() ||
+            !this->_captures.Allocate(this->_keyMatcher.GetCaptureCount() * sizeof(std::string_view), alignof(std::string_view)))
+        {
+            this->_options.keyPattern = {};
+            return false;
+        }
+    }
+    this->_keys.Clear();
+    this->_minutes.Clear();
+    this->_lineCount = 0;
+    this->_missingKeyCount = 0;
+    this->_missingTimeCount = 0;
+    return true;
+}
+
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+bool CAggregator::Add(std::string_view line)
+{
+    line = TrimEndOfLine(line);
+    ++this->_lineCount;
+
+    // the key of the pattern is a span of the line found in the same pass with matching
+    std::string_view key = line;
+    std::string_view* const captures = reinterpret_cast<std::string_view*>(this->_captures.ptr);
+    const bool found = !this->_options.keyPattern.empty() ? this->_keyMatcher.Match(line, captures) :
+        this->_options.keyField == 0 || CFieldFilter::GetField(line, this->_options.layout, this->_options.keyField, key);
+    if (found && !this->_options.keyPattern.empty())
+    {
+        key = captures[this->_options.keyWildcard - 1];
+    }
+
+    if (!found)
+    {
+        ++this->_missingKeyCount;
+    }
+    else if (!this->_keys.Add(key))
+    {
+        return false;
+    }
+
+    if (this->_options.timeField != 0)
+    {
+        std::string_view time;
+        std::string_view minute;
+        if (!CFieldFilter::GetField(line, this->_options.layout, this->_options.timeField, time) || !GetMinute(time, minute))
+        {
+            ++this->_missingTimeCount;
+        }
+        else if (!this->_minutes.Add(minute))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CAggregator::Print(FILE* const stream) const
+{
+    const size_t keyCount = this->_keys.GetSize();
+    const size_t topCount = keyCount < this->_options.topCount ? keyCount : this->_options.topCount;
+    CCharBuffer top;
+    if (topCount != 0 && !top.Allocate(topCount * sizeof(uint32_t), alignof(uint32_t)))
+    {
+        return false;
+    }
+    uint32_t* const indices = reinterpret_cast<uint32_t*>(top.ptr);
+    this->_keys.GetTop(topCount, indices);
+
+    // keys are written as is: they may contain '\0'
+    fprintf(stream, "%llu lines, %llu keys\n", static_cast<unsigned long long>(this->_lineCount), static_cast<unsigned long long>(keyCount));
+    for (size_t i = 0; i < topCount; ++i)
+    {
+        const std::string_view key = this->_keys.GetKey(indices[i]);
+        fprintf(stream, "%12llu ", static_cast<unsigned long long>(this->_keys.GetCount(indices[i])));
+        fwrite(key.data(), key.size(), 1, stream);
+        fputc('\n', stream);
+    }
+    if (this->_missingKeyCount != 0)
+    {
+        fprintf(stream, "%12llu lines without the key\n", static_cast<unsigned long long>(this->_missingKeyCount));
+    }
+
+    if (this->_options.timeField != 0)
+    {
+        fprintf(stream, "lines per minute:\n");
+        for (size_t i = 0; i < this->_minutes.GetSize(); ++i)
+        {
+            const std::string_view minute = this->_minutes.GetKey(i);
+            fwrite(minute.data(), minute.size(), 1, stream);
+            fprintf(stream, " %llu\n", static_cast<unsigned long long>(this->_minutes.GetCount(i)));
+        }
+        if (this->_missingTimeCount != 0)
+        {
+            fprintf(stream, "%llu lines without time in field %zu\n", static_cast<unsigned long long>(this->_missingTimeCount), this->_options.timeField);
+        }
+    }
+    return true;
+}
+
+bool CAggregator::GetMinute(const std::string_view time, std::string_view& minute)
+{
+    // the last match: in "2021:16:01:02" the year and the hour look like a time too
+    for (size_t i = time.size(); i >= 8; --i)
+    {
+        const char* const p = time.data() + i - 8;
+        if (IsDigit(p[0]) && IsDigit(p[1]) && p[2] == ':' && IsDigit(p[3]) && IsDigit(p[4]) && p[5] == ':' && IsDigit(p[6]) && IsDigit(p[7]))
+        {
+            minute = time.substr(0, i - 3);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "CountTable.h"
+#include "FieldFilter.h"
+#include "FnMatch.h"
+
+#include <string_view> // this is STL, but it does not need exceptions
+
+#include <stdint.h>
+#include <stdio.h>
+#include <wchar.h> // for size_t
+
+
+// Group-by counts of matched lines in one pass instead of piping the output to "sort | uniq -c".
+// A key is taken from every line (a field, the text matched by a wildcard of the key pattern or the whole line)
+// and counted in CCountTable; the summary has the top keys by count and the number of lines per minute of the timestamp field.
+class CAggregator
+{
+public:
+    struct Options
+    {
+        size_t               keyField = 0;    // 0: the key is the whole line
+        std::string_view     keyPattern;      // when it is set, the key is the text matched by its keyWildcard instead of a field
+        size_t               keyWildcard = 1; // wildcards are numbered from 1 like fields, see CFnMatch::GetCaptureCount()
+        size_t               timeField = 0;   // field with the timestamp for the per-minute histogram, 0: no histogram
+        size_t               topCount = 10;
+        CFieldFilter::Layout layout;
+    };
+
+    static const size_t MaxTopCount = 100000;
+
+public:
+    // validate options and drop the previous counts; return false on error
+    bool Init(const Options& options);
+
+    // line may end with CRLF or LF; return false when memory can't be allocated
+    bool Add(std::string_view line);
+
+    // print the top keys and the per-minute histogram; return false when memory can't be allocated
+    bool Print(FILE* const stream) const;
+
+    // minute of the timestamp: the text up to the minutes of the last "HH:MM:SS" in it, e.g.
+    // "19/Oct/2021:16:01" for "19/Oct/2021:16:01:02 +0000"; return false when there is no time
+    static bool GetMinute(const std::string_view time, std::string_view& minute);
+
+    const CCountTable& GetKeys() const
+    {
+        return this->_keys;
+    }
+
+    // in the order of the first occurrence, which is chronological for log files
+    const CCountTable& GetMinutes() const
+    {
+        return this->_minutes;
+    }
+
+    uint64_t GetLineCount() const
+    {
+        return this->_lineCount;
+    }
+
+    // lines which have fewer fields than the key field or which don't match the key pattern
+    uint64_t GetMissingKeyCount() const
+    {
+        return this->_missingKeyCount;
+    }
+
+protected:
+    Options     _options;
+    CCharBuffer _keyPatternText; // copy of _options.keyPattern
+    CFnMatch    _keyMatcher;
+    CCharBuffer _captures;       // std::string_view for every wildcard of the key pattern
+    CCountTable _keys;
+    CCountTable _minutes;
+    uint64_t    _lineCount = 0;
+    uint64_t    _missingKeyCount = 0;
+    uint64_t    _missingTimeCount = 0;
+};
@@ -0,0 +1,115 @@
+#include "BufferPool.h"
+
+#include <assert.h>
+
+
+bool CBufferPool::Allocate(const size_t bufferCount, const size_t bufferLength, const size_t alignment, const CCharBuffer::EAllocationPolicy policy)
+{
+    this->Free();
+
+    if (bufferCount == 0 || bufferCount > MaxBuffers)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < bufferCount; ++i)
+    {
+        if (!this->_buffers[i].buffer.Allocate(bufferLength, alignment, policy))
+        {
+            this->Free();
+            return false;
+        }
+        this->_buffers[i].refCount.store(0, std::memory_order_relaxed);
+    }
+
+    this->_bufferCount = bufferCount;
+    return true;
+}
+
+void CBufferPool::Free()
+{
+    for (size_t i = 0; i < MaxBuffers; ++i)
+    {
+        assert(this->_buffers[i].refCount.load(std::memory_order_relaxed) == 0 && "buffer is still referenced");
+        this->_buffers[i].buffer.Free();
+    }
+    this->_bufferCount = 0;
+}
+
+bool CBufferPool::TryAcquire(size_t& index)
+{
+    for (size_t i = 0; i < this->_bufferCount; ++i)
+    {
+        // acquire: data written by the last owner must be complete before the buffer is reused
+        size_t refCount = 0;
+        if (this->_buffers[i].refCount.compare_exchange_strong(refCount, 1, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void CBufferPool::AddRef(const size_t index)
+{
+    assert(index < this->_bufferCount);
+    // the caller already holds a reference, so the buffer can't be reused in the meantime
+    this->_buffers[index].refCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CBufferPool::Release(const size_t index)
+{
+    assert(index < this->_bufferCount);
+    const size_t previousRefCount = this->_buffers[index].refCount.fetch_sub(1, std::memory_order_release);
+    assert(previousRefCount != 0 && "buffer is released too many times");
+    (void)previousRefCount;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CLineRef::CLineRef(CBufferPool& pool, const size_t bufferIndex, const std::string_view line)
+    : _pool(&pool)
+    , _bufferIndex(bufferIndex)
+    , _line(line)
+{
+    this->_pool->AddRef(this->_bufferIndex);
+}
+
+CLineRef::CLineRef(CLineRef&& other)
+    : _pool(other._pool)
+    , _bufferIndex(other._bufferIndex)
+    , _line(other._line)
+{
+    other._pool = nullptr;
+    other._line = {};
+}
+
+CLineRef& CLineRef::operator=(CLineRef&& other)
+{
+    if (this != &other)
+    {
+        this->Release();
+        this->_pool = other._pool;
+        this->_bufferIndex = other._bufferIndex;
+        this->_line = other._line;
+        other._pool = nullptr;
+        other._line = {};
+    }
+    return *this;
+}
+
+CLineRef::~CLineRef()
+{
+    this->Release();
+}
+
+void CLineRef::Release()
+{
+    if (this->_pool != nullptr)
+    {
+        this->_pool->Release(this->_bufferIndex);
+        this->_pool = nullptr;
+    }
+    this->_line = {};
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "CharBuffer.h"
+
+#include <atomic>      // this is STL, but it does not need exceptions
+#include <new>         // for std::hardware_destructive_interference_size
+#include <string_view> // this is STL, but it does not need exceptions
+
+#include <wchar.h> // for size_t
+
+
+// Fixed set of equally sized buffers with reference counters.
+// Line reader holds references to the buffers it reads to and scans, CLineRef holds a reference to the buffer of its line.
+// Buffer is reused only when all references are released, references may be released from any thread.
+class CBufferPool
+{
+public:
+    static const size_t MaxBuffers = 64;
+    static const size_t NoBuffer = static_cast<size_t>(-1); // index value meaning no buffer is held
+
+public:
+    CBufferPool() = default;
+    CBufferPool(const CBufferPool&) = delete;
+    CBufferPool& operator=(const CBufferPool&) = delete;
+
+    // all references must be released before pool is destroyed or allocated again
+    bool Allocate(const size_t bufferCount, const size_t bufferLength, const size_t alignment = 0,
+        const CCharBuffer::EAllocationPolicy policy = CCharBuffer::EAllocationPolicy::Heap);
+    void Free();
+
+    size_t GetBufferCount() const
+    {
+        return this->_bufferCount;
+    }
+
+    char* GetBuffer(const size_t index) const
+    {
+        return this->_buffers[index].buffer.ptr;
+    }
+
+    size_t GetRefCount(const size_t index) const
+    {
+        return this->_buffers[index].refCount.load(std::memory_order_acquire);
+    }
+
+    // take a buffer without references and add the first reference to it; return false if all buffers are referenced
+    bool TryAcquire(size_t& index);
+
+    void AddRef(const size_t index);
+    void Release(const size_t index);
+
+protected:
+    struct Buffer
+    {
+        CCharBuffer         buffer;
+        alignas(std::hardware_destructive_interference_size)
+        std::atomic<size_t> refCount = ATOMIC_VAR_INIT(0);
+    };
+
+    size_t _bufferCount = 0;
+    Buffer _buffers[MaxBuffers];
+};
+
+// Line which stays valid until the reference is released; it does not depend on the reader position.
+// Reference is released by Release() or destructor. It can be moved to another thread, but it must be released
+// before the line reader is destroyed.
+class CLineRef
+{
+public:
+    CLineRef() = default;
+    // adds a reference to the buffer which contains the line
+    CLineRef(CBufferPool& pool, const size_t bufferIndex, const std::string_view line);
+    CLineRef(CLineRef&& other);
+    CLineRef& operator=(CLineRef&& other);
+    CLineRef(const CLineRef&) = delete;
+    CLineRef& operator=(const CLineRef&) = delete;
+    ~CLineRef();
+
+    void Release();
+
+    // empty after Release()
+    std::string_view Line() const
+    {
+        return this->_line;
+    }
+
+protected:
+    CBufferPool*     _pool        = nullptr;
+    size_t           _bufferIndex = 0;
+    std::string_view _line;
+};
@@ -1,28 +1,116 @@
 #include "CharBuffer.h"
 
+#include <malloc.h> // for _aligned_malloc()
 #include <stdlib.h>
 
+#include <windows.h>
+
+
+namespace
+{
+    // VirtualAlloc() returns memory aligned to allocation granularity, it is 64 KB on all Windows versions
+    const size_t VirtualAllocAlignment = 65536;
+    static_assert(CCharBuffer::AnyNumaNode == NUMA_NO_PREFERRED_NODE);
+
+    bool EnableLockMemoryPrivilege()
+    {
+        // Large pages need SeLockMemoryPrivilege: it must be granted by security policy and enabled in the process token
+        static const bool enabled = []() -> bool
+        {
+            HANDLE hToken = nullptr;
+            if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &hToken))
+            {
+                return false;
+            }
+
+            TOKEN_PRIVILEGES privileges = {};
+            privileges.PrivilegeCount = 1;
+            privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+            bool succeeded = !!LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid);
+            if (succeeded)
+            {
+                // AdjustTokenPrivileges() succeeds even if privilege was not granted, so GetLastError() must be checked
+                succeeded = !!AdjustTokenPrivileges(hToken, FALSE, &privileges, 0, nullptr, nullptr) && GetLastError() == ERROR_SUCCESS;
+            }
+
+            CloseHandle(hToken);
+            return succeeded;
+        }();
+        return enabled;
+    }
+
+    char* AllocatePages(const size_t length, const bool largePages, const DWORD numaNode)
+    {
+        DWORD allocationType = MEM_RESERVE | MEM_COMMIT;
+        size_t allocationLength = length;
+
+        if (largePages)
+        {
+            const size_t largePageSize = GetLargePageMinimum();
+            if (largePageSize == 0 || !EnableLockMemoryPrivilege())
+            {
+                return nullptr;
+            }
+            // size of large page allocation must be a multiple of the large page size
+            allocationLength = (length + largePageSize - 1) / largePageSize * largePageSize;
+            allocationType |= MEM_LARGE_PAGES;
+        }
+
+        if (numaNode != NUMA_NO_PREFERRED_NODE)
+        {
+            // physical pages are taken from the node when they are touched for the first time
+            return static_cast<char*>(VirtualAllocExNuma(GetCurrentProcess(), nullptr, allocationLength, allocationType, PAGE_READWRITE, numaNode));
+        }
+        return static_cast<char*>(VirtualAlloc(nullptr, allocationLength, allocationType, PAGE_READWRITE));
+    }
+}
+
 
 CCharBuffer::~CCharBuffer()
 {
     this->Free();
 }
 
-bool CCharBuffer::Allocate(const size_t bufferLength)
+bool CCharBuffer::Allocate(const size_t bufferLength, const size_t alignment, const EAllocationPolicy policy, const unsigned long numaNode)
 {
     this->Free();
 
-    if (bufferLength == 0)
+    if ((alignment & (alignment - 1)) != 0)
     {
-        this->ptr = static_cast<char*>(malloc(1));
-        this->size = 0;
+        // alignment must be a power of 2
+        return false;
+    }
+
+    // empty buffer has valid pointer too
+    const size_t allocationLength = bufferLength != 0 ? bufferLength : 1;
+
+    if (policy == EAllocationPolicy::Heap)
+    {
+        this->_alignedHeap = alignment != 0;
+        this->ptr = static_cast<char*>(this->_alignedHeap ? _aligned_malloc(allocationLength, alignment) : malloc(allocationLength));
+        this->policy = EAllocationPolicy::Heap;
     }
     else
     {
-        this->ptr = static_cast<char*>(malloc(bufferLength));
-        size = this->ptr != nullptr ? bufferLength : 0;
+        if (alignment > VirtualAllocAlignment)
+        {
+            return false;
+        }
+
+        if (policy == EAllocationPolicy::LargePages)
+        {
+            this->ptr = AllocatePages(allocationLength, true, numaNode);
+            this->policy = EAllocationPolicy::LargePages;
+        }
+        if (this->ptr == nullptr)
+        {
+            // Fallback to normal pages if large pages are not available
+            this->ptr = AllocatePages(allocationLength, false, numaNode);
+            this->policy = EAllocationPolicy::Pages;
+        }
     }
 
+    this->size = this->ptr != nullptr ? bufferLength : 0;
     return this->ptr != nullptr;
 }
 
@@ -30,8 +118,21 @@ void CCharBuffer::Free()
 {
     if (this->ptr)
     {
-        free(this->ptr);
+        if (this->policy != EAllocationPolicy::Heap)
+        {
+            VirtualFree(this->ptr, 0, MEM_RELEASE);
+        }
+        else if (this->_alignedHeap)
+        {
+            _aligned_free(this->ptr);
+        }
+        else
+        {
+            free(this->ptr);
+        }
         this->ptr = nullptr;
         this->size = 0;
     }
+    this->policy = EAllocationPolicy::Heap;
+    this->_alignedHeap = false;
 }
@@ -5,13 +5,30 @@
 
 class CCharBuffer
 {
+public:
+    enum class EAllocationPolicy
+    {
+        Heap,       // CRT heap; alignment is supported via _aligned_malloc()
+        Pages,      // VirtualAlloc(); buffer starts at allocation granularity boundary (64 KB)
+        LargePages, // VirtualAlloc(MEM_LARGE_PAGES); needs SeLockMemoryPrivilege, otherwise falls back to Pages
+    };
+
+    static const unsigned long AnyNumaNode = 0xffffffff; // the same as NUMA_NO_PREFERRED_NODE
+
 public:
     ~CCharBuffer();
 
-    bool Allocate(const size_t bufferLength);
+    // alignment is optional, it must be a power of 2; policy of the allocated memory is stored in `policy`
+    // numaNode is a preferred NUMA node for physical pages; it is used by Pages and LargePages policies only
+    bool Allocate(const size_t bufferLength, const size_t alignment = 0, const EAllocationPolicy policy = EAllocationPolicy::Heap,
+        const unsigned long numaNode = AnyNumaNode);
     void Free();
 
 public:
     char* ptr = nullptr;
     size_t size = 0;
+    EAllocationPolicy policy = EAllocationPolicy::Heap; // actually used policy
+
+protected:
+    bool _alignedHeap = false;
 };
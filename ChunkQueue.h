@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic> // this is STL, but it does not need exceptions
+#include <new>    // for std::hardware_destructive_interference_size
+
+#include <stdint.h>
+#include <wchar.h> // for size_t
+
+
+// Bounded lock-free multi-producer multi-consumer queue (Dmitry Vyukov's algorithm).
+// Every cell has a sequence number telling whether it is ready for push or for pop on the current lap,
+// so producers and consumers touch only one shared counter each and never wait for each other.
+// T must be trivially copyable; Capacity must be a power of 2.
+template <typename T, size_t Capacity>
+class CChunkQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+public:
+    CChunkQueue()
+    {
+        for (size_t i = 0; i < Capacity; ++i)
+        {
+            this->_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    CChunkQueue(const CChunkQueue&) = delete;
+    CChunkQueue& operator=(const CChunkQueue&) = delete;
+
+    // return false if queue is full
+    bool TryPush(const T& value)
+    {
+        Cell* cell = nullptr;
+        size_t position = this->_pushPosition.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell = &this->_cells[position & (Capacity - 1)];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0)
+            {
+                if (this->_pushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                // cell still holds a value from the previous lap
+                return false;
+            }
+            else
+            {
+                position = this->_pushPosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = value;
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // return false if queue is empty
+    bool TryPop(T& value)
+    {
+        Cell* cell = nullptr;
+        size_t position = this->_popPosition.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell = &this->_cells[position & (Capacity - 1)];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+            if (difference == 0)
+            {
+                if (this->_popPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                // value is not pushed to the cell yet
+                return false;
+            }
+            else
+            {
+                position = this->_popPosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = cell->value;
+        cell->sequence.store(position + Capacity, std::memory_order_release);
+        return true;
+    }
+
+protected:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T                   value;
+    };
+
+    alignas(std::hardware_destructive_interference_size)
+    Cell                _cells[Capacity];
+    alignas(std::hardware_destructive_interference_size)
+    std::atomic<size_t> _pushPosition = ATOMIC_VAR_INIT(0);
+    alignas(std::hardware_destructive_interference_size)
+    std::atomic<size_t> _popPosition  = ATOMIC_VAR_INIT(0);
+};
@@ -0,0 +1,290 @@
+#include "CoLogReader.h"
+
+#include "SimdSearch.h"
+
+#include <assert.h>
+#include <string.h>
+
+
+namespace
+{
+    // the same values as in LineReader.cpp
+    const size_t MaxLogLineLength = 1024; // including ending LF/CRLF;
+    const size_t ReadChunkSize = 65536 * 4;
+    const size_t PageSize = 4096;
+    const size_t ReadBufferOffset = (MaxLogLineLength + PageSize - 1) / PageSize * PageSize;
+    const size_t ReadBufferSize = ReadBufferOffset + ReadChunkSize;
+    static_assert(ReadChunkSize >= MaxLogLineLength);
+}
+
+
+bool CCoLogReader::NextLineAwaiter::WaitForData()
+{
+    while (true)
+    {
+        if (this->_reader.Suspend(this))
+        {
+            return true;
+        }
+
+        // read operation is already completed
+        this->_result = this->_reader.TryGetNextLine(this->_line);
+        if (this->_result != ETryResult::NeedData)
+        {
+            return false;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CCoLogReader::CCoLogReader()
+{
+    this->_buffer1.Allocate(ReadBufferSize, PageSize, CCharBuffer::EAllocationPolicy::Pages);
+    if (this->_buffer1.ptr != nullptr)
+    {
+        this->_buffer2.Allocate(ReadBufferSize, PageSize, CCharBuffer::EAllocationPolicy::Pages);
+    }
+}
+
+CCoLogReader::~CCoLogReader()
+{
+    // read operation must be finished before buffers are freed
+    this->Close();
+}
+
+bool CCoLogReader::Open(const wchar_t* const filename)
+{
+    if (this->_buffer2.ptr == nullptr || filename == nullptr)
+    {
+        return false;
+    }
+    this->Close();
+
+    const bool bAsyncMode = true;
+    if (!this->_file.Open(filename, bAsyncMode))
+    {
+        return false;
+    }
+
+    // work is created here, so SubmitThreadpoolWork() can't fail in completion callback
+    this->_resumeWork = CreateThreadpoolWork(ResumeCallback, this, nullptr);
+    if (this->_resumeWork == nullptr || !this->_file.CompletionReadInit(ReadCompleted, this))
+    {
+        this->Close();
+        return false;
+    }
+
+    this->_bufferData = std::string_view(this->_buffer1.ptr, 0);
+    this->_firstBufferIsActive = true;
+    this->_eof = false;
+    this->_finished = false;
+    this->_opened = true;
+
+    if (!this->StartRead(this->_buffer2.ptr + ReadBufferOffset))
+    {
+        this->Close();
+        return false;
+    }
+
+    return true;
+}
+
+void CCoLogReader::Close()
+{
+    assert(this->_readState.load(std::memory_order_relaxed) != EReadState::Waiting && "coroutine is waiting for the reader");
+
+    // waits for completion callback of the read operation in progress
+    this->_file.Close();
+    if (this->_resumeWork != nullptr)
+    {
+        // callbacks are not waited: Close() may be called by the coroutine resumed by this work;
+        // the work object is freed after its running callback returns
+        CloseThreadpoolWork(this->_resumeWork);
+        this->_resumeWork = nullptr;
+    }
+    this->_readState.store(EReadState::Completed, std::memory_order_relaxed);
+    this->_readSucceeded = false;
+    this->_opened = false;
+}
+
+bool CCoLogReader::SetFilter(const char* const filter)
+{
+    if (filter == nullptr)
+    {
+        return false;
+    }
+
+    const size_t patternLen = strlen(filter);
+    if (!this->_pattern.Allocate(patternLen))
+    {
+        return false;
+    }
+
+    memcpy(this->_pattern.ptr, filter, patternLen);
+    return this->_lineMatcher.Compile({ this->_pattern.ptr, this->_pattern.size });
+}
+
+CCoLogReader::ETryResult CCoLogReader::TryGetNextLine(std::string_view& line)
+{
+    while (true)
+    {
+        const ETryResult result = this->TryGetNextRawLine(line);
+        if (result != ETryResult::Line)
+        {
+            return result;
+        }
+
+        std::string_view matchView = line;
+
+        // Ignore CRLF/LF during matching:
+        if (!matchView.empty() && matchView.back() == '\n')
+        {
+            matchView.remove_suffix(1);
+            if (!matchView.empty() && matchView.back() == '\r')
+            {
+                matchView.remove_suffix(1);
+            }
+        }
+
+        if (this->_lineMatcher.Match(matchView))
+        {
+            return ETryResult::Line;
+        }
+    }
+}
+
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+CCoLogReader::ETryResult CCoLogReader::TryGetNextRawLine(std::string_view& line)
+{
+    if (!this->_opened || this->_finished)
+    {
+        return ETryResult::Finished;
+    }
+
+    while (true)
+    {
+        const char* const eol = CSimdSearch::FindChar(this->_bufferData.data(), this->_bufferData.size(), '\n');
+        if (eol != nullptr)
+        {
+            const size_t foundLineLength = eol - this->_bufferData.data() + 1;
+            if (foundLineLength > MaxLogLineLength)
+            {
+                // Line is too long
+                this->_finished = true;
+                return ETryResult::Finished;
+            }
+
+            line = this->_bufferData.substr(0, foundLineLength);
+            this->_bufferData.remove_prefix(foundLineLength);
+            return ETryResult::Line;
+        }
+
+        if (this->_bufferData.size() > MaxLogLineLength)
+        {
+            // Incomplete line is already too long
+            this->_finished = true;
+            return ETryResult::Finished;
+        }
+
+        if (this->_eof)
+        {
+            this->_finished = true;
+            if (this->_bufferData.empty())
+            {
+                return ETryResult::Finished;
+            }
+
+            // The very last line without LF
+            line = this->_bufferData;
+            this->_bufferData.remove_prefix(this->_bufferData.size());
+            return ETryResult::Line;
+        }
+
+        if (this->_readState.load(std::memory_order_acquire) != EReadState::Completed)
+        {
+            return ETryResult::NeedData;
+        }
+
+        if (!this->_readSucceeded)
+        {
+            this->_finished = true;
+            return ETryResult::Finished;
+        }
+
+        // Move the rest of the current buffer right before the read data:
+        CCharBuffer& currentBuffer = this->_firstBufferIsActive ? this->_buffer1 : this->_buffer2;
+        CCharBuffer& nextBuffer = this->_firstBufferIsActive ? this->_buffer2 : this->_buffer1;
+
+        const size_t prefixLength = this->_bufferData.size();
+        char* const newDataBufferPtr = nextBuffer.ptr + ReadBufferOffset - prefixLength;
+        memcpy(newDataBufferPtr, this->_bufferData.data(), prefixLength);
+
+        const size_t readBytes = this->_readBytes;
+        this->_bufferData = { newDataBufferPtr, prefixLength + readBytes };
+        this->_firstBufferIsActive = !this->_firstBufferIsActive;
+
+        if (readBytes == 0)
+        {
+            this->_eof = true;
+        }
+        else if (!this->StartRead(currentBuffer.ptr + ReadBufferOffset))
+        {
+            this->_finished = true;
+            return ETryResult::Finished;
+        }
+    }
+}
+
+bool CCoLogReader::StartRead(char* const buffer)
+{
+    // state must be set before the start: completion callback may be called before CompletionReadStart() returns
+    this->_readState.store(EReadState::InProgress, std::memory_order_relaxed);
+    if (!this->_file.CompletionReadStart(buffer, ReadChunkSize))
+    {
+        this->_readSucceeded = false;
+        this->_readState.store(EReadState::Completed, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+bool CCoLogReader::Suspend(NextLineAwaiter* const awaiter)
+{
+    this->_awaiter = awaiter;
+    EReadState expected = EReadState::InProgress;
+    // release: awaiter must be visible to completion callback; acquire: read results must be visible if read is completed
+    return this->_readState.compare_exchange_strong(expected, EReadState::Waiting, std::memory_order_acq_rel, std::memory_order_acquire);
+}
+
+void CCoLogReader::ReadCompleted(void* const context, const bool succeeded, const size_t readBytes)
+{
+    CCoLogReader* const that = static_cast<CCoLogReader*>(context);
+    that->_readSucceeded = succeeded;
+    that->_readBytes = readBytes;
+
+    const EReadState previousState = that->_readState.exchange(EReadState::Completed, std::memory_order_acq_rel);
+    if (previousState != EReadState::Waiting)
+    {
+        // consumer will find the data by itself
+        return;
+    }
+
+    // Coroutine is never resumed here: it may start the next read or close the reader,
+    // and it can't be done inside of I/O callback which is waited by CScanFile::CompletionReadClean()
+    SubmitThreadpoolWork(that->_resumeWork);
+}
+
+void CALLBACK CCoLogReader::ResumeCallback(PTP_CALLBACK_INSTANCE /*instance*/, void* context, PTP_WORK /*work*/)
+{
+    NextLineAwaiter* const awaiter = static_cast<CCoLogReader*>(context)->_awaiter;
+
+    // the whole chunk may have no matching lines, then coroutine keeps waiting for the next one
+    awaiter->_result = awaiter->_reader.TryGetNextLine(awaiter->_line);
+    if (awaiter->_result == ETryResult::NeedData && awaiter->WaitForData())
+    {
+        return;
+    }
+
+    awaiter->_handle.resume();
+}
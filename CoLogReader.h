@@ -0,0 +1,139 @@
+#pragma once
+
+#if !defined(__cpp_impl_coroutine)
+#   error "CoLogReader needs C++20 coroutines: compile this file with /std:c++20"
+#endif
+
+#include "CharBuffer.h"
+#include "FnMatch.h"
+#include "ScanFile.h"
+
+#include <atomic>      // this is STL, but it does not need exceptions
+#include <coroutine>   // this is STL, but it does not need exceptions
+#include <new>         // for std::hardware_destructive_interference_size
+#include <optional>    // this is STL, but it does not need exceptions
+#include <string_view> // this is STL, but it does not need exceptions
+
+#include <wchar.h> // for size_t, wchar_t
+
+#include <windows.h>
+
+
+// Log reader for coroutines: `while (const auto line = co_await reader.Next())`.
+// Data is read with 2 buffers like CAsyncLineReader, but nobody waits for the read operation. When the next chunk is not read yet,
+// the coroutine is suspended and a thread of the system thread pool resumes it on I/O completion. So many concurrent scans
+// are multiplexed on a few threads. Coroutine may continue in a different thread after co_await.
+class CCoLogReader final
+{
+protected:
+    enum class ETryResult
+    {
+        Line,     // next matching line is found
+        Finished, // EOF or error
+        NeedData, // read operation is in progress
+    };
+
+public:
+    class NextLineAwaiter
+    {
+    public:
+        bool await_ready()
+        {
+            this->_result = this->_reader.TryGetNextLine(this->_line);
+            return this->_result != ETryResult::NeedData;
+        }
+
+        bool await_suspend(const std::coroutine_handle<> handle)
+        {
+            this->_handle = handle;
+            return this->WaitForData();
+        }
+
+        // return false on error or EOF
+        std::optional<std::string_view> await_resume() const
+        {
+            if (this->_result != ETryResult::Line)
+            {
+                return {};
+            }
+            return this->_line;
+        }
+
+    protected:
+        friend class CCoLogReader;
+
+        explicit NextLineAwaiter(CCoLogReader& reader)
+            : _reader(reader)
+        {
+        }
+
+        // return false if the result is ready and coroutine must not be suspended
+        bool WaitForData();
+
+    protected:
+        CCoLogReader&           _reader;
+        std::coroutine_handle<> _handle;
+        ETryResult              _result = ETryResult::NeedData;
+        std::string_view        _line;
+    };
+
+public:
+    CCoLogReader();
+    ~CCoLogReader();
+
+    // open file; return false on error. Supported data is the same as for CLogReader.
+    bool Open(const wchar_t* const filename);
+
+    // close file; it must not be called while a coroutine is suspended in co_await Next(), but it may be called by the coroutine
+    void Close();
+
+    // set line filter; return false on error
+    bool SetFilter(const char* const filter);
+
+    // co_await returns the next matching line; line may contain '\0' and may end with CRLF or LF; return false on error or EOF
+    // Line is valid until the next co_await. Only one coroutine may wait for the reader at a time.
+    NextLineAwaiter Next()
+    {
+        return NextLineAwaiter(*this);
+    }
+
+protected:
+    enum class EReadState
+    {
+        InProgress,
+        Completed,
+        Waiting,   // coroutine is suspended until read operation is completed
+    };
+
+    ETryResult TryGetNextLine(std::string_view& line);
+    ETryResult TryGetNextRawLine(std::string_view& line);
+    bool StartRead(char* const buffer);
+    bool Suspend(NextLineAwaiter* const awaiter);
+
+    static void ReadCompleted(void* const context, const bool succeeded, const size_t readBytes);
+    static void CALLBACK ResumeCallback(PTP_CALLBACK_INSTANCE instance, void* context, PTP_WORK work);
+
+protected:
+    CScanFile        _file;
+    CCharBuffer      _pattern;
+    CFnMatch         _lineMatcher; // compiled _pattern
+    // Buffer structure: [    rest_of_previousline|data_read_from_file  ]
+    //                   [ len = MaxLogLineLength | len = ReadChunkSize ]
+    bool             _firstBufferIsActive = true;
+    CCharBuffer      _buffer1;
+    CCharBuffer      _buffer2;
+    std::string_view _bufferData; // filled part of the current buffer
+    bool             _opened   = false;
+    bool             _eof      = false; // the last read operation returned no data
+    bool             _finished = false; // all lines are returned or error happened
+    PTP_WORK         _resumeWork = nullptr; // resumes the coroutine outside of I/O callback, see ReadCompleted()
+
+    // written by completion callback before _readState is set to Completed:
+    bool             _readSucceeded = false;
+    size_t           _readBytes     = 0;
+    // written by consumer before _readState is set to Waiting:
+    NextLineAwaiter* _awaiter       = nullptr;
+
+    alignas(std::hardware_destructive_interference_size)
+    std::atomic<EReadState> _readState = ATOMIC_VAR_INIT(EReadState::Completed);
+};
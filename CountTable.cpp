@@ -0,0 +1,215 @@
+#include "CountTable.h"
+
+#include <string.h>
+
+
+namespace
+{
+    const size_t InitialSlotCount = 1024;
+    const size_t MaxLoadPercent = 70;
+
+    // 8 bytes per step; keys are short (fields of log lines), so there is no vector code
+    uint64_t HashKey(const char* const data, const size_t size)
+    {
+        uint64_t hash = 0x9e3779b97f4a7c15ull ^ size;
+        size_t i = 0;
+        for (; size - i >= 8; i += 8)
+        {
+            uint64_t word = 0;
+            memcpy(&word, data + i, sizeof(word));
+            hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+            hash ^= hash >> 32;
+        }
+        uint64_t tail = 0;
+        memcpy(&tail, data + i, size - i);
+        hash = (hash ^ tail) * 0xc4ceb9fe1a85ec53ull;
+        return hash ^ (hash >> 29);
+    }
+
+    // keep the first usedSize bytes and grow the buffer at least to requiredSize, doubling its size
+    bool Reserve(CCharBuffer& buffer, const size_t usedSize, const size_t requiredSize)
+    {
+        if (requiredSize <= buffer.size)
+        {
+            return true;
+        }
+
+        size_t newSize = buffer.size != 0 ? buffer.size : 4096;
+        while (newSize < requiredSize)
+        {
+            newSize *= 2;
+        }
+        CCharBuffer newBuffer;
+        if (!newBuffer.Allocate(newSize, alignof(uint64_t)))
+        {
+            return false;
+        }
+        if (usedSize != 0)
+        {
+            memcpy(newBuffer.ptr, buffer.ptr, usedSize);
+        }
+
+        // CCharBuffer has no move, so the pointers are swapped
+        char* const ptr = buffer.ptr;
+        const size_t size = buffer.size;
+        buffer.ptr = newBuffer.ptr;
+        buffer.size = newBuffer.size;
+        newBuffer.ptr = ptr;
+        newBuffer.size = size;
+        return true;
+    }
+}
+
+
+bool CCountTable::Add(const std::string_view key, const uint64_t count)
+{
+    if (this->_slots.ptr == nullptr && !this->Rehash(InitialSlotCount))
+    {
+        return false;
+    }
+
+    const uint64_t hash = HashKey(key.data(), key.size());
+    const uint32_t tag = static_cast<uint32_t>(hash >> 32);
+    Slot* const slots = reinterpret_cast<Slot*>(this->_slots.ptr);
+    Entry* const entries = reinterpret_cast<Entry*>(this->_entries.ptr);
+    size_t slot = static_cast<size_t>(hash) & this->_slotMask;
+    for (; slots[slot].entry != 0; slot = (slot + 1) & this->_slotMask)
+    {
+        Entry& entry = entries[slots[slot].entry - 1];
+        if (slots[slot].tag == tag && entry.keySize == key.size() && memcmp(this->_keys.ptr + entry.keyOffset, key.data(), key.size()) == 0)
+        {
+            entry.count += count;
+            return true;
+        }
+    }
+
+    // new key
+    if (this->_entryCount == MaxKeys || key.size() > MaxKeysSize - this->_keysSize ||
+        !Reserve(this->_entries, this->_entryCount * sizeof(Entry), (this->_entryCount + 1) * sizeof(Entry)) ||
+        !Reserve(this->_keys, this->_keysSize, this->_keysSize + key.size()))
+    {
+        return false;
+    }
+    Entry& entry = reinterpret_cast<Entry*>(this->_entries.ptr)[this->_entryCount];
+    entry.hash = hash;
+    entry.count = count;
+    entry.keyOffset = static_cast<uint32_t>(this->_keysSize);
+    entry.keySize = static_cast<uint32_t>(key.size());
+    if (!key.empty())
+    {
+        memcpy(this->_keys.ptr + this->_keysSize, key.data(), key.size());
+    }
+    this->_keysSize += key.size();
+    ++this->_entryCount;
+    slots[slot].tag = tag;
+    slots[slot].entry = static_cast<uint32_t>(this->_entryCount);
+
+    // the table is rebuilt from the stored hashes: keys are not touched
+    if (this->_entryCount * 100 > (this->_slotMask + 1) * MaxLoadPercent)
+    {
+        return this->Rehash((this->_slotMask + 1) * 2);
+    }
+    return true;
+}
+
+void CCountTable::Clear()
+{
+    this->_slots.Free();
+    this->_slotMask = 0;
+    this->_entryCount = 0;
+    this->_keysSize = 0;
+}
+
+bool CCountTable::Rehash(const size_t slotCount)
+{
+    CCharBuffer newSlots;
+    if (!newSlots.Allocate(slotCount * sizeof(Slot), alignof(Slot)))
+    {
+        return false;
+    }
+    memset(newSlots.ptr, 0, slotCount * sizeof(Slot));
+
+    Slot* const slots = reinterpret_cast<Slot*>(newSlots.ptr);
+    const Entry* const entries = this->GetEntries();
+    const size_t slotMask = slotCount - 1;
+    for (size_t i = 0; i < this->_entryCount; ++i)
+    {
+        size_t slot = static_cast<size_t>(entries[i].hash) & slotMask;
+        while (slots[slot].entry != 0)
+        {
+            slot = (slot + 1) & slotMask;
+        }
+        slots[slot].tag = static_cast<uint32_t>(entries[i].hash >> 32);
+        slots[slot].entry = static_cast<uint32_t>(i + 1);
+    }
+
+    this->_slots.Free();
+    this->_slots.ptr = newSlots.ptr;
+    this->_slots.size = newSlots.size;
+    newSlots.ptr = nullptr;
+    newSlots.size = 0;
+    this->_slotMask = slotMask;
+    return true;
+}
+
+size_t CCountTable::GetTop(const size_t k, uint32_t* const indices) const
+{
+    // min-heap of the best k entries: the root is the worst of them
+    const Entry* const entries = this->GetEntries();
+    const auto isWorse = [entries](const uint32_t left, const uint32_t right)
+    {
+        return entries[left].count != entries[right].count ? entries[left].count < entries[right].count : left > right;
+    };
+    const auto siftDown = [&isWorse, indices](size_t pos, const size_t size)
+    {
+        while (true)
+        {
+            const size_t left = 2 * pos + 1;
+            const size_t right = left + 1;
+            size_t worst = pos;
+            worst = left < size && isWorse(indices[left], indices[worst]) ? left : worst;
+            worst = right < size && isWorse(indices[right], indices[worst]) ? right : worst;
+            if (worst == pos)
+            {
+                return;
+            }
+            const uint32_t index = indices[pos];
+            indices[pos] = indices[worst];
+            indices[worst] = index;
+            pos = worst;
+        }
+    };
+
+    size_t size = 0;
+    for (uint32_t i = 0; i < this->_entryCount && k != 0; ++i)
+    {
+        if (size < k)
+        {
+            // sift up
+            size_t pos = size++;
+            indices[pos] = i;
+            while (pos > 0 && isWorse(indices[pos], indices[(pos - 1) / 2]))
+            {
+                const uint32_t index = indices[pos];
+                indices[pos] = indices[(pos - 1) / 2];
+                indices[(pos - 1) / 2] = index;
+                pos = (pos - 1) / 2;
+            }
+        }
+        else if (isWorse(indices[0], i))
+        {
+            indices[0] = i;
+            siftDown(0, size);
+        }
+    }
+
+    // heap sort: the worst entry goes to the end
+    for (size_t heapSize = size; heapSize > 1; --heapSize)
+    {
+        const uint32_t index = indices[0];
+        indices[0] = indices[heapSize - 1];
+        indices[heapSize - 1] = index;
+        siftDown(0, heapSize - 1);
+    }
+    return size;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "CharBuffer.h"
+
+#include <string_view> // this is STL, but it does not need exceptions
+
+#include <stdint.h>
+#include <wchar.h> // for size_t
+
+
+// Counters of string keys: open addressing hash table with linear probing.
+// Slots hold 8 bytes (a hash tag and an entry index), so probing touches few cache lines and compares keys only
+// for equal tags. Entries are kept dense in the order of insertion, key bytes are copied to one growing arena.
+class CCountTable
+{
+public:
+    static const size_t MaxKeys = UINT32_MAX - 1;
+    static const size_t MaxKeysSize = UINT32_MAX; // sum of key sizes
+
+public:
+    // add count to the key, the key is copied on the first occurrence; return false when memory can't be allocated
+    bool Add(const std::string_view key, const uint64_t count = 1);
+
+    void Clear();
+
+    // number of different keys
+    size_t GetSize() const
+    {
+        return this->_entryCount;
+    }
+
+    // entries are indexed in the order of the first occurrence of their keys; key is valid until the next Add()
+    std::string_view GetKey(const size_t index) const
+    {
+        const Entry& entry = this->GetEntries()[index];
+        return { this->_keys.ptr + entry.keyOffset, entry.keySize };
+    }
+
+    uint64_t GetCount(const size_t index) const
+    {
+        return this->GetEntries()[index].count;
+    }
+
+    // indices of up to k entries with the biggest counts from the biggest one; equal counts are ordered by the first occurrence
+    size_t GetTop(const size_t k, uint32_t* const indices) const;
+
+protected:
+    struct Slot
+    {
+        uint32_t tag;   // high bits of the hash
+        uint32_t entry; // index + 1, 0 for an empty slot
+    };
+
+    struct Entry
+    {
+        uint64_t hash;
+        uint64_t count;
+        uint32_t keyOffset; // in _keys
+        uint32_t keySize;
+    };
+
+    const Entry* GetEntries() const
+    {
+        return reinterpret_cast<const Entry*>(this->_entries.ptr);
+    }
+
+    bool Rehash(const size_t slotCount);
+
+protected:
+    CCharBuffer _slots;      // Slot[_slotMask + 1]
+    size_t      _slotMask = 0;
+    CCharBuffer _entries;    // Entry[]
+    size_t      _entryCount = 0;
+    CCharBuffer _keys;       // arena of key bytes
+    size_t      _keysSize = 0;
+};
@@ -0,0 +1,142 @@
+#include "CpuTopology.h"
+
+#include "CharBuffer.h"
+
+
+namespace
+{
+    // the lowest logical processor of the mask
+    GROUP_AFFINITY GetFirstProcessor(const GROUP_AFFINITY& affinity)
+    {
+        GROUP_AFFINITY result = {};
+        result.Group = affinity.Group;
+        result.Mask = affinity.Mask & (~affinity.Mask + 1);
+        return result;
+    }
+}
+
+
+bool CCpuTopology::Init()
+{
+    const bool numaNodesOk = this->InitNumaNodes();
+    const bool coresOk = this->InitCores();
+    return numaNodesOk && coresOk;
+}
+
+bool CCpuTopology::InitNumaNodes()
+{
+    this->_numaNodeCount = 0;
+
+    ULONG highestNodeNumber = 0;
+    if (!GetNumaHighestNodeNumber(&highestNodeNumber))
+    {
+        return false;
+    }
+
+    for (ULONG node = 0; node <= highestNodeNumber && this->_numaNodeCount < MaxNumaNodes; ++node)
+    {
+        GROUP_AFFINITY affinity = {};
+        const USHORT nodeNumber = static_cast<USHORT>(node);
+        if (!GetNumaNodeProcessorMaskEx(nodeNumber, &affinity) || affinity.Mask == 0)
+        {
+            // node numbers may have gaps; nodes without processors (memory only) are skipped
+            continue;
+        }
+
+        NumaNode& numaNode = this->_numaNodes[this->_numaNodeCount++];
+        numaNode.nodeNumber = nodeNumber;
+        numaNode.affinity = affinity;
+    }
+
+    return this->_numaNodeCount != 0;
+}
+
+bool CCpuTopology::InitCores()
+{
+    this->_coreCount = 0;
+
+    // The first call gets required buffer size
+    DWORD bufferLength = 0;
+    if (GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &bufferLength) || GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+    {
+        return false;
+    }
+
+    CCharBuffer buffer;
+    if (!buffer.Allocate(bufferLength))
+    {
+        return false;
+    }
+
+    auto* const info = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.ptr);
+    if (!GetLogicalProcessorInformationEx(RelationProcessorCore, info, &bufferLength))
+    {
+        return false;
+    }
+
+    // Records have variable size
+    for (DWORD offset = 0; offset < bufferLength && this->_coreCount < MaxCores; )
+    {
+        const auto* const record = reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.ptr + offset);
+        offset += record->Size;
+
+        if (record->Relationship != RelationProcessorCore || record->Processor.GroupCount == 0)
+        {
+            continue;
+        }
+
+        Core& core = this->_cores[this->_coreCount++];
+        core.affinity = record->Processor.GroupMask[0]; // a core is always inside of a single group
+        core.smt = (record->Processor.Flags & LTP_PC_SMT) != 0;
+    }
+
+    return this->_coreCount != 0;
+}
+
+bool CCpuTopology::GetThreadPairAffinity(const EThreadPlacement placement, GROUP_AFFINITY& first, GROUP_AFFINITY& second) const
+{
+    if (placement == EThreadPlacement::SmtSiblings)
+    {
+        for (size_t i = 0; i < this->_coreCount; ++i)
+        {
+            const GROUP_AFFINITY& affinity = this->_cores[i].affinity;
+            if (!this->_cores[i].smt || (affinity.Mask & (affinity.Mask - 1)) == 0)
+            {
+                continue;
+            }
+
+            first = GetFirstProcessor(affinity);
+            GROUP_AFFINITY rest = affinity;
+            rest.Mask &= ~first.Mask;
+            second = GetFirstProcessor(rest);
+            return true;
+        }
+        return false;
+    }
+
+    if (placement == EThreadPlacement::SeparateCores)
+    {
+        // Threads in different groups can't share a cache anyway, so only cores of the same group are paired
+        for (size_t i = 0; i < this->_coreCount; ++i)
+        {
+            for (size_t j = i + 1; j < this->_coreCount; ++j)
+            {
+                if (this->_cores[i].affinity.Group == this->_cores[j].affinity.Group)
+                {
+                    first = GetFirstProcessor(this->_cores[i].affinity);
+                    second = GetFirstProcessor(this->_cores[j].affinity);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    return false;
+}
+
+bool CCpuTopology::SetCurrentThreadAffinity(const GROUP_AFFINITY& affinity)
+{
+    GROUP_AFFINITY usedAffinity = affinity;
+    return !!SetThreadGroupAffinity(GetCurrentThread(), &usedAffinity, nullptr);
+}
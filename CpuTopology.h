@@ -0,0 +1,75 @@
+#pragma once
+
+#include <wchar.h> // for size_t
+
+#include <windows.h>
+
+
+// Placement of two threads handing data over to each other
+enum class EThreadPlacement
+{
+    Default,       // the system schedules threads
+    SmtSiblings,   // logical processors of the same physical core: shared L1/L2 cache, but shared execution units too
+    SeparateCores, // different physical cores of the same processor group
+};
+
+// Processor topology of the machine: NUMA nodes, physical cores and their logical processors.
+// Processors of a node or a core may be only in a single processor group, so their affinity is a GROUP_AFFINITY.
+class CCpuTopology
+{
+public:
+    static const size_t MaxNumaNodes = 64;
+    static const size_t MaxCores = 1024;
+
+    struct NumaNode
+    {
+        USHORT         nodeNumber = 0;
+        GROUP_AFFINITY affinity   = {};
+    };
+
+    struct Core
+    {
+        GROUP_AFFINITY affinity = {}; // logical processors of the core
+        bool           smt      = false; // core has more than one logical processor
+    };
+
+public:
+    // probe nodes having processors and physical cores; return false on error
+    bool Init();
+
+    size_t GetNumaNodeCount() const
+    {
+        return this->_numaNodeCount;
+    }
+
+    const NumaNode& GetNumaNode(const size_t index) const
+    {
+        return this->_numaNodes[index];
+    }
+
+    size_t GetCoreCount() const
+    {
+        return this->_coreCount;
+    }
+
+    const Core& GetCore(const size_t index) const
+    {
+        return this->_cores[index];
+    }
+
+    // choose a single logical processor for each of two threads; return false if placement is impossible on this machine
+    bool GetThreadPairAffinity(const EThreadPlacement placement, GROUP_AFFINITY& first, GROUP_AFFINITY& second) const;
+
+    // bind current thread to processors of the affinity; the system chooses a processor inside of the affinity mask
+    static bool SetCurrentThreadAffinity(const GROUP_AFFINITY& affinity);
+
+protected:
+    bool InitNumaNodes();
+    bool InitCores();
+
+protected:
+    size_t   _numaNodeCount = 0;
+    NumaNode _numaNodes[MaxNumaNodes];
+    size_t   _coreCount = 0;
+    Core     _cores[MaxCores];
+};
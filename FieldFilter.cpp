@@ -0,0 +1,222 @@
+#include "FieldFilter.h"
+
+
+namespace
+{
+    bool IsSpace(const char ch)
+    {
+        return ch == ' ' || ch == '\t';
+    }
+}
+
+
+bool CFieldFilter::Compile(const std::string_view filter, const Layout& layout, const CByteFrequency& frequency)
+{
+    this->_layout = layout;
+    this->_conditionCount = 0;
+
+    // unquoted patterns are never longer than the filter
+    if (!this->_patternText.Allocate(filter.size()))
+    {
+        return false;
+    }
+
+    size_t textSize = 0;
+    size_t pos = 0;
+    while (true)
+    {
+        while (pos < filter.size() && IsSpace(filter[pos]))
+        {
+            ++pos;
+        }
+        if (pos == filter.size())
+        {
+            break;
+        }
+        if (this->_conditionCount == MaxConditions || filter[pos] != '$')
+        {
+            return false;
+        }
+
+        // field number
+        size_t field = 0;
+        for (++pos; pos < filter.size() && filter[pos] >= '0' && filter[pos] <= '9'; ++pos)
+        {
+            field = field * 10 + (filter[pos] - '0');
+            if (field > MaxField)
+            {
+                return false;
+            }
+        }
+        if (field == 0 || pos == filter.size() || filter[pos] != '=')
+        {
+            return false;
+        }
+        ++pos;
+
+        // pattern up to a space or in quotes
+        char* const patternStart = this->_patternText.ptr + textSize;
+        if (pos < filter.size() && filter[pos] == '"')
+        {
+            ++pos;
+            while (true)
+            {
+                if (pos == filter.size())
+                {
+                    // no closing quote
+                    return false;
+                }
+                const char ch = filter[pos++];
+                if (ch == '"')
+                {
+                    if (pos == filter.size() || filter[pos] != '"')
+                    {
+                        break;
+                    }
+                    ++pos;
+                }
+                this->_patternText.ptr[textSize++] = ch;
+            }
+            if (pos < filter.size() && !IsSpace(filter[pos]))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            for (; pos < filter.size() && !IsSpace(filter[pos]); ++pos)
+            {
+                this->_patternText.ptr[textSize++] = filter[pos];
+            }
+        }
+
+        const std::string_view pattern(patternStart, this->_patternText.ptr + textSize - patternStart);
+        const size_t matcher = this->_conditionCount;
+        if (!this->_matchers[matcher].Compile(pattern, frequency))
+        {
+            return false;
+        }
+
+        // insertion sort by field; conditions of the same field keep the order of the filter
+        size_t i = this->_conditionCount++;
+        while (i > 0 && this->_conditions[i - 1].field > field)
+        {
+            this->_conditions[i] = this->_conditions[i - 1];
+            --i;
+        }
+        this->_conditions[i].field = field;
+        this->_conditions[i].matcher = matcher;
+    }
+    return this->_conditionCount != 0;
+}
+
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+bool CFieldFilter::Match(const std::string_view text) const
+{
+    const char* p = text.data();
+    const char* const pEnd = p + text.size();
+    size_t field = 1; // field at p
+    for (size_t i = 0; i < this->_conditionCount; ++i)
+    {
+        const Condition& condition = this->_conditions[i];
+        p = SkipFields(p, pEnd, this->_layout, condition.field - field);
+        if (p == nullptr)
+        {
+            return false;
+        }
+        field = condition.field;
+
+        std::string_view value;
+        const char* const next = ReadField(p, pEnd, this->_layout, value);
+        if (!this->_matchers[condition.matcher].Match(value))
+        {
+            return false;
+        }
+
+        const bool sameField = i + 1 < this->_conditionCount && this->_conditions[i + 1].field == field;
+        if (!sameField && i + 1 < this->_conditionCount)
+        {
+            if (next == nullptr)
+            {
+                return false;
+            }
+            p = next;
+            ++field;
+        }
+    }
+    return true;
+}
+
+bool CFieldFilter::GetField(const std::string_view text, const Layout& layout, const size_t field, std::string_view& value)
+{
+    const char* const pEnd = text.data() + text.size();
+    const char* const p = field != 0 ? SkipFields(text.data(), pEnd, layout, field - 1) : nullptr;
+    if (p == nullptr)
+    {
+        return false;
+    }
+    ReadField(p, pEnd, layout, value);
+    return true;
+}
+
+const char* CFieldFilter::ReadField(const char* const p, const char* const pEnd, const Layout& layout, std::string_view& value)
+{
+    // '\0' of a disabled quote must not match '\0' in the line
+    const bool quoted = p < pEnd && layout.quote != '\0' && *p == layout.quote;
+    const bool bracketed = p < pEnd && layout.openBracket != '\0' && *p == layout.openBracket;
+    if (quoted || bracketed)
+    {
+        const char close = quoted ? layout.quote : layout.closeBracket;
+        const char* q = p + 1;
+        while (true)
+        {
+            q = CSimdSearch::FindChar(q, pEnd - q, close);
+            if (q == nullptr)
+            {
+                // not closed: it is a usual field
+                break;
+            }
+            ++q;
+            if (q == pEnd || *q == layout.delimiter)
+            {
+                value = std::string_view(p + 1, q - 1 - (p + 1));
+                return q != pEnd ? q + 1 : nullptr;
+            }
+        }
+    }
+
+    const char* const delimiter = CSimdSearch::FindChar(p, pEnd - p, layout.delimiter);
+    value = std::string_view(p, (delimiter != nullptr ? delimiter : pEnd) - p);
+    return delimiter != nullptr ? delimiter + 1 : nullptr;
+}
+
+const char* CFieldFilter::SkipFields(const char* p, const char* const pEnd, const Layout& layout, size_t count)
+{
+    if (count == 0)
+    {
+        return p;
+    }
+
+    // Fast path: the count-th delimiter is found at vector speed. It is the end of skipped fields when none of them
+    // is quoted, which is always true without quotes and brackets in the layout.
+    // Quoted fields only hide delimiters, so the line without count delimiters has fewer fields in any case.
+    const char* const delimiter = CSimdSearch::FindNthChar(p, pEnd - p, layout.delimiter, count);
+    if (delimiter == nullptr)
+    {
+        return nullptr;
+    }
+    const size_t skippedSize = delimiter - p;
+    if ((layout.quote == '\0' || CSimdSearch::FindChar(p, skippedSize, layout.quote) == nullptr) &&
+        (layout.openBracket == '\0' || CSimdSearch::FindChar(p, skippedSize, layout.openBracket) == nullptr))
+    {
+        return delimiter + 1;
+    }
+
+    // field by field
+    for (; count != 0 && p != nullptr; --count)
+    {
+        std::string_view value;
+        p = ReadField(p, pEnd, layout, value);
+    }
+    return p;
+}
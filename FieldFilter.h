@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CharBuffer.h"
+#include "FnMatch.h"
+#include "SimdSearch.h"
+
+#include <string_view> // this is STL, but it does not need exceptions
+
+#include <wchar.h> // for size_t
+
+
+// Wildcard patterns applied to fields of delimited log lines, e.g. to the access log line
+//   127.0.0.1 - - [10/Oct/2000:13:55:36 -0700] "GET /api/users HTTP/1.0" 500 2326
+// filter $4="10/Oct/2000:13:55:*" $5="GET /api/*" $6=500 matches the time, the request and the status only,
+// so "500" in the size field or in the URL is not a false positive.
+// Fields are split only up to the last one referenced by the filter, a line is rejected by the first failed field.
+class CFieldFilter
+{
+public:
+    // Quoted and bracketed fields may contain delimiters; they are recognized at the start of a field only and
+    // end by the closing character followed by the delimiter or the end of the line. Their value has no quotes or brackets.
+    struct Layout
+    {
+        char delimiter = ' ';
+        char quote = '"';       // '\0' disables quoted fields
+        char openBracket = '[';  // '\0' disables bracketed fields
+        char closeBracket = ']';
+    };
+
+    static const size_t MaxConditions = 16;
+    static const size_t MaxField = 100000;
+
+public:
+    // filter is a list of conditions "$<field>=<pattern>" separated by spaces, fields are numbered from 1 like in awk;
+    // pattern with spaces is in double quotes, a quote inside of it is doubled; return false on error
+    bool Compile(const std::string_view filter, const Layout& layout, const CByteFrequency& frequency = CByteFrequency::GetDefault());
+
+    bool Match(const std::string_view text) const;
+
+    // value of the field; return false when the line has fewer fields
+    static bool GetField(const std::string_view text, const Layout& layout, const size_t field, std::string_view& value);
+
+    size_t GetConditionCount() const
+    {
+        return this->_conditionCount;
+    }
+
+protected:
+    struct Condition
+    {
+        size_t field = 0;
+        size_t matcher = 0; // index in _matchers
+    };
+
+    // value of the field at p and the start of the next field or nullptr when it is the last one
+    static const char* ReadField(const char* const p, const char* const pEnd, const Layout& layout, std::string_view& value);
+
+    // start of the field which is count fields after the field at p or nullptr when there are fewer fields
+    static const char* SkipFields(const char* p, const char* const pEnd, const Layout& layout, size_t count);
+
+protected:
+    Layout      _layout;
+    CCharBuffer _patternText; // unquoted patterns one after another
+    CFnMatch    _matchers[MaxConditions];
+    Condition   _conditions[MaxConditions]; // sorted by field
+    size_t      _conditionCount = 0;
+};
@@ -0,0 +1,487 @@
+#include "FilterExpression.h"
+
+#include <assert.h>
+
+
+namespace
+{
+    const size_t MinPrefilterLiteralLength = 2; // the same as in LogReader.cpp: single characters give too many candidates
+    const double MatcherCallCost = 4.0;         // CFnMatch::Match() of a prefiltered line compared to checking its literal bits
+
+    bool IsSpace(const char ch)
+    {
+        return ch == ' ' || ch == '\t';
+    }
+
+    bool IsDelimiter(const char ch)
+    {
+        return IsSpace(ch) || ch == '(' || ch == ')' || ch == '"';
+    }
+}
+
+
+// Recursive descent parser; nodes are appended to the expression, unquoted patterns are appended to _patternText
+class CFilterExpression::CParser
+{
+public:
+    CParser(CFilterExpression& expression, const std::string_view filter, const CByteFrequency& frequency)
+        : _expression(expression)
+        , _filter(filter)
+        , _frequency(frequency)
+    {
+    }
+
+    // root node or NoNode on error
+    size_t Parse()
+    {
+        const size_t root = this->ParseOr(0);
+        this->SkipSpaces();
+        return this->_pos == this->_filter.size() ? root : NoNode;
+    }
+
+protected:
+    enum class EToken
+    {
+        End,
+        Word,
+        Quote,
+        Open,
+        Close,
+    };
+
+    size_t ParseOr(const size_t depth)
+    {
+        return this->ParseList(depth, EOperator::Or, "OR");
+    }
+
+    size_t ParseAnd(const size_t depth)
+    {
+        return this->ParseList(depth, EOperator::And, "AND");
+    }
+
+    // operands separated by the operator keyword; a single operand is returned as is
+    size_t ParseList(const size_t depth, const EOperator op, const std::string_view keyword)
+    {
+        const size_t first = op == EOperator::Or ? this->ParseAnd(depth) : this->ParseUnary(depth);
+        if (first == NoNode || !this->SkipKeyword(keyword))
+        {
+            return first;
+        }
+
+        const size_t list = this->NewNode(op);
+        if (list == NoNode)
+        {
+            return NoNode;
+        }
+        this->_expression._nodes[list].firstChild = first;
+        size_t last = first;
+        do
+        {
+            const size_t next = op == EOperator::Or ? this->ParseAnd(depth) : this->ParseUnary(depth);
+            if (next == NoNode)
+            {
+                return NoNode;
+            }
+            this->_expression._nodes[last].nextSibling = next;
+            last = next;
+        } while (this->SkipKeyword(keyword));
+        return list;
+    }
+
+    size_t ParseUnary(const size_t depth)
+    {
+        if (depth >= MaxDepth)
+        {
+            return NoNode;
+        }
+
+        if (this->SkipKeyword("NOT"))
+        {
+            const size_t operand = this->ParseUnary(depth + 1);
+            if (operand != NoNode && this->_expression._nodes[operand].op == EOperator::Not)
+            {
+                // NOT NOT is dropped, see MaxNodes; NOT node is the last one, it is created after its operand
+                assert(operand + 1 == this->_expression._nodeCount);
+                --this->_expression._nodeCount;
+                return this->_expression._nodes[operand].firstChild;
+            }
+            const size_t node = operand != NoNode ? this->NewNode(EOperator::Not) : NoNode;
+            if (node != NoNode)
+            {
+                this->_expression._nodes[node].firstChild = operand;
+            }
+            return node;
+        }
+
+        switch (this->PeekToken())
+        {
+        case EToken::Open:
+        {
+            ++this->_pos;
+            const size_t node = this->ParseOr(depth + 1);
+            if (node == NoNode || this->PeekToken() != EToken::Close)
+            {
+                return NoNode;
+            }
+            ++this->_pos;
+            return node;
+        }
+        case EToken::Quote:
+            return this->ParsePattern();
+        default:
+            return NoNode;
+        }
+    }
+
+    size_t ParsePattern()
+    {
+        CFilterExpression& expression = this->_expression;
+        if (expression._patternCount == MaxPatterns)
+        {
+            return NoNode;
+        }
+
+        // "" inside of quotes is a quote character
+        char* const patternStart = expression._patternText.ptr + this->_textSize;
+        ++this->_pos;
+        while (true)
+        {
+            if (this->_pos == this->_filter.size())
+            {
+                // no closing quote
+                return NoNode;
+            }
+            const char ch = this->_filter[this->_pos++];
+            if (ch == '"')
+            {
+                if (this->_pos == this->_filter.size() || this->_filter[this->_pos] != '"')
+                {
+                    break;
+                }
+                ++this->_pos;
+            }
+            expression._patternText.ptr[this->_textSize++] = ch;
+        }
+
+        const std::string_view pattern(patternStart, expression._patternText.ptr + this->_textSize - patternStart);
+        const size_t node = this->NewNode(EOperator::Pattern);
+        if (node == NoNode || !expression._patterns[expression._patternCount].Compile(pattern, this->_frequency))
+        {
+            return NoNode;
+        }
+        expression._nodes[node].pattern = expression._patternCount++;
+        expression.AddLiterals(expression._nodes[node], pattern);
+        return node;
+    }
+
+    size_t NewNode(const EOperator op)
+    {
+        if (this->_expression._nodeCount == MaxNodes)
+        {
+            return NoNode;
+        }
+        const size_t node = this->_expression._nodeCount++;
+        this->_expression._nodes[node] = Node();
+        this->_expression._nodes[node].op = op;
+        return node;
+    }
+
+    void SkipSpaces()
+    {
+        while (this->_pos < this->_filter.size() && IsSpace(this->_filter[this->_pos]))
+        {
+            ++this->_pos;
+        }
+    }
+
+    EToken PeekToken()
+    {
+        this->SkipSpaces();
+        if (this->_pos == this->_filter.size())
+        {
+            return EToken::End;
+        }
+        switch (this->_filter[this->_pos])
+        {
+        case '"':
+            return EToken::Quote;
+        case '(':
+            return EToken::Open;
+        case ')':
+            return EToken::Close;
+        default:
+            return EToken::Word;
+        }
+    }
+
+    // keywords are case sensitive and are delimited by spaces, quotes or parentheses
+    bool SkipKeyword(const std::string_view keyword)
+    {
+        if (this->PeekToken() != EToken::Word)
+        {
+            return false;
+        }
+        const std::string_view rest = this->_filter.substr(this->_pos);
+        if (rest.substr(0, keyword.size()) != keyword || (rest.size() > keyword.size() && !IsDelimiter(rest[keyword.size()])))
+        {
+            return false;
+        }
+        this->_pos += keyword.size();
+        return true;
+    }
+
+protected:
+    CFilterExpression&     _expression;
+    const std::string_view _filter;
+    const CByteFrequency&  _frequency;
+    size_t                 _pos = 0;
+    size_t                 _textSize = 0; // used part of _patternText
+};
+
+
+bool CFilterExpression::IsExpression(const std::string_view filter)
+{
+    // the first token after leading NOTs is a quote or a parenthesis, and there is an operator outside of quotes:
+    // "NOT FOUND*" is a plain pattern, its NOT is not followed by an operand
+    size_t pos = 0;
+    bool leadingNot = false;
+    while (true)
+    {
+        while (pos < filter.size() && IsSpace(filter[pos]))
+        {
+            ++pos;
+        }
+        const std::string_view rest = filter.substr(pos);
+        if (rest.substr(0, 3) != "NOT" || (rest.size() > 3 && !IsDelimiter(rest[3])))
+        {
+            break;
+        }
+        pos += 3;
+        leadingNot = true;
+    }
+    if (pos == filter.size() || (filter[pos] != '"' && filter[pos] != '('))
+    {
+        return false;
+    }
+    if (leadingNot)
+    {
+        return true;
+    }
+
+    bool quoted = false;
+    for (size_t i = pos; i < filter.size(); ++i)
+    {
+        if (filter[i] == '"')
+        {
+            quoted = !quoted;
+            continue;
+        }
+        if (quoted || (i != 0 && !IsDelimiter(filter[i - 1])))
+        {
+            continue;
+        }
+        for (const std::string_view keyword : { std::string_view("NOT"), std::string_view("AND"), std::string_view("OR") })
+        {
+            const std::string_view rest = filter.substr(i);
+            if (rest.substr(0, keyword.size()) == keyword && (rest.size() == keyword.size() || IsDelimiter(rest[keyword.size()])))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool CFilterExpression::Compile(const std::string_view filter, const CByteFrequency& frequency)
+{
+    this->_patternCount = 0;
+    this->_nodeCount = 0;
+    this->_root = NoNode;
+    this->_literalSet = CSimdSearch::LiteralSet();
+
+    // unquoted patterns are never longer than the filter
+    if (!IsExpression(filter) || !this->_patternText.Allocate(filter.size()))
+    {
+        return false;
+    }
+
+    CParser parser(*this, filter, frequency);
+    this->_root = parser.Parse();
+    return this->_root != NoNode;
+}
+
+bool CFilterExpression::Evaluate(const size_t nodeIndex, const std::string_view text, const uint32_t foundLiterals) const
+{
+    const Node& node = this->_nodes[nodeIndex];
+    switch (node.op)
+    {
+    case EOperator::Pattern:
+        // pattern can't match without its literals
+        return (foundLiterals & node.requiredLiterals) == node.requiredLiterals && this->_patterns[node.pattern].Match(text);
+    case EOperator::Not:
+        return !this->Evaluate(node.firstChild, text, foundLiterals);
+    case EOperator::And:
+        for (size_t child = node.firstChild; child != NoNode; child = this->_nodes[child].nextSibling)
+        {
+            if (!this->Evaluate(child, text, foundLiterals))
+            {
+                return false;
+            }
+        }
+        return true;
+    case EOperator::Or:
+        for (size_t child = node.firstChild; child != NoNode; child = this->_nodes[child].nextSibling)
+        {
+            if (this->Evaluate(child, text, foundLiterals))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    return false;
+}
+
+bool CFilterExpression::MatchSample(const std::string_view text)
+{
+    if (this->_root == NoNode)
+    {
+        return false;
+    }
+    const uint32_t foundLiterals = this->_literalSet.count != 0 ?
+        CSimdSearch::FindAllLiterals(text.data(), text.size(), this->_literalSet) : 0;
+    return this->EvaluateSample(this->_root, text, foundLiterals);
+}
+
+// every operand is evaluated, so statistics do not depend on the current order of operands
+bool CFilterExpression::EvaluateSample(const size_t nodeIndex, const std::string_view text, const uint32_t foundLiterals)
+{
+    Node& node = this->_nodes[nodeIndex];
+    bool result = false;
+    switch (node.op)
+    {
+    case EOperator::Pattern:
+        if ((foundLiterals & node.requiredLiterals) == node.requiredLiterals)
+        {
+            ++node.sampleMatcherCalls;
+            result = this->_patterns[node.pattern].Match(text);
+        }
+        break;
+    case EOperator::Not:
+        result = !this->EvaluateSample(node.firstChild, text, foundLiterals);
+        break;
+    case EOperator::And:
+    case EOperator::Or:
+        result = node.op == EOperator::And;
+        for (size_t child = node.firstChild; child != NoNode; child = this->_nodes[child].nextSibling)
+        {
+            const bool childResult = this->EvaluateSample(child, text, foundLiterals);
+            result = node.op == EOperator::And ? result && childResult : result || childResult;
+        }
+        break;
+    }
+    ++node.sampleCalls;
+    node.sampleTrue += result;
+    return result;
+}
+
+// average cost of the full evaluation of the node for a sampled line
+double CFilterExpression::GetSampleCost(const size_t nodeIndex) const
+{
+    const Node& node = this->_nodes[nodeIndex];
+    if (node.op == EOperator::Pattern)
+    {
+        return 1.0 + (node.sampleCalls != 0 ? MatcherCallCost * node.sampleMatcherCalls / node.sampleCalls : MatcherCallCost);
+    }
+    double cost = 0.0;
+    for (size_t child = node.firstChild; child != NoNode; child = this->_nodes[child].nextSibling)
+    {
+        cost += this->GetSampleCost(child);
+    }
+    return cost;
+}
+
+void CFilterExpression::Optimize()
+{
+    if (this->_root != NoNode)
+    {
+        this->OptimizeNode(this->_root);
+    }
+}
+
+void CFilterExpression::OptimizeNode(const size_t nodeIndex)
+{
+    Node& node = this->_nodes[nodeIndex];
+    if (node.op == EOperator::Pattern)
+    {
+        return;
+    }
+
+    size_t children[MaxNodes];
+    double keys[MaxNodes];
+    size_t count = 0;
+    for (size_t child = node.firstChild; child != NoNode; child = this->_nodes[child].nextSibling)
+    {
+        this->OptimizeNode(child);
+
+        // AND stops at the first false operand, OR at the first true one: the expected cost of the list is the lowest
+        // when operands are sorted by cost divided by probability to stop (probability is smoothed for small samples)
+        const Node& childNode = this->_nodes[child];
+        const double trueProbability = (childNode.sampleTrue + 1.0) / (childNode.sampleCalls + 2.0);
+        const double stopProbability = node.op == EOperator::And ? 1.0 - trueProbability : trueProbability;
+        const double key = this->GetSampleCost(child) / stopProbability;
+
+        // insertion sort: there are few operands; equal keys keep the order of the filter
+        size_t pos = count;
+        while (pos > 0 && keys[pos - 1] > key)
+        {
+            children[pos] = children[pos - 1];
+            keys[pos] = keys[pos - 1];
+            --pos;
+        }
+        children[pos] = child;
+        keys[pos] = key;
+        ++count;
+    }
+
+    if (node.op == EOperator::Not || count == 0)
+    {
+        return;
+    }
+    node.firstChild = children[0];
+    for (size_t i = 0; i < count; ++i)
+    {
+        this->_nodes[children[i]].nextSibling = i + 1 < count ? children[i + 1] : NoNode;
+    }
+}
+
+// literal parts of the pattern go to the shared prefilter; the same literal of several patterns is searched once
+void CFilterExpression::AddLiterals(Node& node, const std::string_view pattern)
+{
+    size_t literalStart = 0;
+    for (size_t i = 0; i <= pattern.size(); ++i)
+    {
+        if (i < pattern.size() && pattern[i] != '*' && pattern[i] != '?')
+        {
+            continue;
+        }
+        const std::string_view literal = pattern.substr(literalStart, i - literalStart);
+        literalStart = i + 1;
+        if (literal.size() < MinPrefilterLiteralLength)
+        {
+            continue;
+        }
+
+        size_t index = 0;
+        while (index < this->_literalSet.count &&
+            std::string_view(this->_literalSet.literals[index], this->_literalSet.sizes[index]) != literal)
+        {
+            ++index;
+        }
+        // the set may be full: the literal is not required then, the pattern matcher checks it anyway
+        if (index < this->_literalSet.count || CSimdSearch::AddLiteral(this->_literalSet, literal.data(), literal.size()))
+        {
+            node.requiredLiterals |= 1u << index;
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "CharBuffer.h"
+#include "FnMatch.h"
+#include "SimdSearch.h"
+
+#include <string_view> // this is STL, but it does not need exceptions
+
+#include <stdint.h>
+#include <wchar.h> // for size_t
+
+
+// Boolean expression over wildcard patterns: "*ERROR*" AND NOT ("*healthcheck*" OR "*/ping *").
+// Patterns are in double quotes, a quote inside of a pattern is doubled: "*say ""hi""*".
+// Operators are NOT, AND, OR (from the highest priority to the lowest) and parentheses.
+// Literals of all patterns are searched in one pass over the line by a shared Teddy prefilter (CSimdSearch::LiteralSet),
+// then operands are evaluated with short-circuiting: a pattern with a missing literal is false without CFnMatch::Match().
+class CFilterExpression
+{
+public:
+    static const size_t MaxPatterns = 32;
+    // AND and OR have at least 2 operands and NOT NOT is dropped, so every pattern and every list has at most one NOT:
+    // 2 * (MaxPatterns + MaxPatterns - 1) nodes are enough for any expression of MaxPatterns
+    static const size_t MaxNodes = 4 * MaxPatterns;
+    static const size_t MaxDepth = 16; // nesting of parentheses and NOT
+
+public:
+    // Filter is an expression when it starts with a quote or a parenthesis, maybe after NOT, and has an operator outside of quotes.
+    // Other filters are plain patterns, so patterns like "*a AND b*" and "NOT FOUND*" keep their meaning.
+    static bool IsExpression(const std::string_view filter);
+
+    // return false when filter is not an expression or it is malformed
+    bool Compile(const std::string_view filter, const CByteFrequency& frequency = CByteFrequency::GetDefault());
+
+    bool Match(const std::string_view text) const
+    {
+        const uint32_t foundLiterals = this->_literalSet.count != 0 ?
+            CSimdSearch::FindAllLiterals(text.data(), text.size(), this->_literalSet) : 0;
+        return this->Evaluate(this->_root, text, foundLiterals);
+    }
+
+    // The same as Match(), but statistics of every operand are collected for Optimize(); call it for sampled lines
+    bool MatchSample(const std::string_view text);
+
+    // Order operands of AND and OR by sampled selectivity and cost: an operand which decides the result most cheaply goes first
+    void Optimize();
+
+    size_t GetPatternCount() const
+    {
+        return this->_patternCount;
+    }
+
+protected:
+    enum class EOperator : unsigned char
+    {
+        Pattern,
+        Not,
+        And,
+        Or,
+    };
+
+    static const size_t NoNode = SIZE_MAX;
+
+    struct Node
+    {
+        EOperator op = EOperator::Pattern;
+        size_t    pattern = 0;          // index of the pattern for EOperator::Pattern
+        size_t    firstChild = NoNode;  // operands are linked by nextSibling
+        size_t    nextSibling = NoNode;
+        uint32_t  requiredLiterals = 0; // bits of _literalSet which must be found for the pattern to match
+
+        // collected by MatchSample()
+        size_t    sampleCalls = 0;        // evaluations
+        size_t    sampleTrue = 0;         // evaluations with true result
+        size_t    sampleMatcherCalls = 0; // CFnMatch::Match() calls of the pattern
+    };
+
+    class CParser;
+
+    bool Evaluate(const size_t nodeIndex, const std::string_view text, const uint32_t foundLiterals) const;
+    bool EvaluateSample(const size_t nodeIndex, const std::string_view text, const uint32_t foundLiterals);
+    double GetSampleCost(const size_t nodeIndex) const;
+    void OptimizeNode(const size_t nodeIndex);
+    void AddLiterals(Node& node, const std::string_view pattern);
+
+protected:
+    CCharBuffer             _patternText; // unquoted patterns one after another
+    CFnMatch                _patterns[MaxPatterns];
+    size_t                  _patternCount = 0;
+    Node                    _nodes[MaxNodes];
+    size_t                  _nodeCount = 0;
+    size_t                  _root = NoNode;
+    CSimdSearch::LiteralSet _literalSet; // literals of all patterns, the same literal of several patterns is added once
+};
@@ -1,10 +1,60 @@
 #pragma once
 
+#include "CharBuffer.h"
+#include "SimdSearch.h"
+
 #include <string_view> // this is STL, but it does not need exceptions
 
+#include <wchar.h> // for size_t
+
 
 class CFnMatch
 {
 public:
+    // Cheap structural facts about a pattern; they are used to choose the scan strategy
+    struct PatternInfo
+    {
+        std::string_view longestLiteral; // longest part without '*' and '?'; every matching text contains it
+        bool             anchoredStart = true; // pattern does not start with '*'
+        bool             anchoredEnd = true;   // pattern does not end with '*'
+        size_t           asterisks = 0;
+        size_t           questionMarks = 0;
+        double           wildcardDensity = 0.0; // share of '*' and '?' in the pattern
+    };
+
+public:
+    // Prepare the pattern for Match(text): the literal after every '*' is searched by its two rarest bytes.
+    // Pattern is not copied, it must outlive the matcher or the next Compile().
+    bool Compile(const std::string_view pattern, const CByteFrequency& frequency = CByteFrequency::GetDefault());
+
+    // match the compiled pattern; the same result as Match(text, pattern)
+    bool Match(const std::string_view text) const;
+
+    // The same as Match(text), but the text matched by every wildcard of the pattern is stored to captures in the order
+    // of the pattern; a run of '*' is one wildcard. captures has GetCaptureCount() elements, they point into text.
+    // Spans are recorded in the same pass and they are valid only when the result is true.
+    bool Match(const std::string_view text, std::string_view* const captures) const;
+
+    size_t GetCaptureCount() const
+    {
+        return this->_captureCount;
+    }
+
+    std::string_view GetPattern() const
+    {
+        return this->_pattern;
+    }
+
     static bool Match(const std::string_view text, const std::string_view pattern);
+
+    // original naive implementation; it is slow, but obviously correct, so it is kept as a reference for tests
+    static bool MatchReference(const std::string_view text, const std::string_view pattern);
+
+    // longestLiteral points into the pattern
+    static PatternInfo Analyze(const std::string_view pattern);
+
+protected:
+    std::string_view _pattern;
+    CCharBuffer      _needles; // CSimdSearch::Needle for every group of '*' in the pattern
+    size_t           _captureCount = 0;
 };
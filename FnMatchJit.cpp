@@ -0,0 +1,564 @@
+#include "FnMatchJit.h"
+
+#include "CharBuffer.h"
+#include "SimdSearch.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <windows.h>
+
+
+namespace
+{
+    // Minimal x64 assembler for the generated matcher. Jumps are always rel32, labels are resolved by Finish().
+    // Any overflow of the buffers is reported by Finish(), so emitting code needs no checks.
+    class CAssembler
+    {
+    public:
+        static const size_t Unbound = SIZE_MAX;
+
+        bool Init(const size_t codeCapacity, const size_t labelCapacity, const size_t jumpCapacity)
+        {
+            return this->_code.Allocate(codeCapacity) &&
+                this->_labels.Allocate(labelCapacity * sizeof(size_t)) &&
+                this->_jumps.Allocate(jumpCapacity * sizeof(Jump));
+        }
+
+        void Emit(const unsigned char byte)
+        {
+            if (this->_size < this->_code.size)
+            {
+                this->_code.ptr[this->_size] = static_cast<char>(byte);
+            }
+            ++this->_size;
+        }
+
+        void Emit(const unsigned char* const bytes, const size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                this->Emit(bytes[i]);
+            }
+        }
+
+        void Emit32(const uint32_t value)
+        {
+            for (size_t i = 0; i < 4; ++i)
+            {
+                this->Emit(static_cast<unsigned char>(value >> (8 * i)));
+            }
+        }
+
+        size_t NewLabel()
+        {
+            size_t* const labels = reinterpret_cast<size_t*>(this->_labels.ptr);
+            if (this->_labelCount < this->_labels.size / sizeof(size_t))
+            {
+                labels[this->_labelCount] = Unbound;
+            }
+            return this->_labelCount++;
+        }
+
+        void Bind(const size_t label)
+        {
+            if (label < this->_labels.size / sizeof(size_t))
+            {
+                reinterpret_cast<size_t*>(this->_labels.ptr)[label] = this->_size;
+            }
+        }
+
+        // opcode is 0x80 + condition code for Jcc or 0 for JMP
+        void JumpTo(const unsigned char opcode, const size_t label)
+        {
+            if (opcode == 0)
+            {
+                this->Emit(0xe9);
+            }
+            else
+            {
+                this->Emit(0x0f);
+                this->Emit(opcode);
+            }
+            if (this->_jumpCount < this->_jumps.size / sizeof(Jump))
+            {
+                reinterpret_cast<Jump*>(this->_jumps.ptr)[this->_jumpCount] = { this->_size, label };
+            }
+            ++this->_jumpCount;
+            this->Emit32(0);
+        }
+
+        // patch jumps; return false on overflow or unbound label
+        bool Finish()
+        {
+            if (this->_size > this->_code.size || this->_labelCount > this->_labels.size / sizeof(size_t) ||
+                this->_jumpCount > this->_jumps.size / sizeof(Jump))
+            {
+                return false;
+            }
+            const size_t* const labels = reinterpret_cast<const size_t*>(this->_labels.ptr);
+            const Jump* const jumps = reinterpret_cast<const Jump*>(this->_jumps.ptr);
+            for (size_t i = 0; i < this->_jumpCount; ++i)
+            {
+                const size_t target = labels[jumps[i].label];
+                if (target == Unbound)
+                {
+                    return false;
+                }
+                // rel32 counts from the end of the instruction
+                const uint32_t rel = static_cast<uint32_t>(target - (jumps[i].offset + 4));
+                memcpy(this->_code.ptr + jumps[i].offset, &rel, sizeof(rel));
+            }
+            return true;
+        }
+
+        const char* GetCode() const
+        {
+            return this->_code.ptr;
+        }
+
+        size_t GetSize() const
+        {
+            return this->_size;
+        }
+
+    protected:
+        struct Jump
+        {
+            size_t offset; // of rel32
+            size_t label;
+        };
+
+        CCharBuffer _code;
+        size_t      _size = 0;
+        CCharBuffer _labels; // code offsets
+        size_t      _labelCount = 0;
+        CCharBuffer _jumps;
+        size_t      _jumpCount = 0;
+    };
+
+    const unsigned char Jmp = 0;
+    const unsigned char Jb = 0x82;
+    const unsigned char Jz = 0x84;
+    const unsigned char Jnz = 0x85;
+
+    // Register usage; all of them are volatile in Windows x64 calling convention, so there is no prologue:
+    //   rcx: text position (the first argument), rdx: text end (the second argument is size),
+    //   r8: candidate position, r10, r11, rax: scratch, xmm0/ymm0 and xmm2/ymm2: broadcast rare bytes, xmm1/ymm1, xmm3/ymm3: scratch
+    enum class EBase
+    {
+        Rcx,
+        R8,
+    };
+
+    class CPatternCompiler
+    {
+    public:
+        CPatternCompiler(CAssembler& assembler, const std::string_view pattern, const bool avx2)
+            : _assembler(assembler)
+            , _pattern(pattern)
+            , _avx2(avx2)
+        {
+        }
+
+        void Compile()
+        {
+            this->_fail = this->_assembler.NewLabel();
+            this->_success = this->_assembler.NewLabel();
+
+            static const unsigned char leaRdxRcxRdx[] = { 0x48, 0x8d, 0x14, 0x11 }; // lea rdx, [rcx + rdx]
+            this->_assembler.Emit(leaRdxRcxRdx, sizeof(leaRdxRcxRdx));
+
+            // the first segment is anchored at the start of the text
+            const size_t firstEnd = this->GetSegmentEnd(0);
+            if (firstEnd == this->_pattern.size())
+            {
+                // no '*': the whole text is compared
+                this->EmitRemainingSize();
+                this->EmitCmpRax(firstEnd);
+                this->_assembler.JumpTo(Jnz, this->_fail);
+                this->EmitSegmentCompare(EBase::Rcx, 0, firstEnd, this->_fail);
+                this->_assembler.JumpTo(Jmp, this->_success);
+            }
+            else
+            {
+                if (firstEnd != 0)
+                {
+                    this->EmitRemainingSize();
+                    this->EmitCmpRax(firstEnd);
+                    this->_assembler.JumpTo(Jb, this->_fail);
+                    this->EmitSegmentCompare(EBase::Rcx, 0, firstEnd, this->_fail);
+                    this->EmitAddRcx(firstEnd);
+                }
+                this->EmitAfterAsterisk(firstEnd);
+            }
+
+            // upper halves of YMM registers are cleared to avoid AVX-SSE transition penalty in the caller
+            static const unsigned char vzeroupper[] = { 0xc5, 0xf8, 0x77 };
+            this->_assembler.Bind(this->_success);
+            if (this->_avx2)
+            {
+                this->_assembler.Emit(vzeroupper, sizeof(vzeroupper));
+            }
+            static const unsigned char returnTrue[] = { 0xb8, 0x01, 0x00, 0x00, 0x00, 0xc3 }; // mov eax, 1; ret
+            this->_assembler.Emit(returnTrue, sizeof(returnTrue));
+            this->_assembler.Bind(this->_fail);
+            if (this->_avx2)
+            {
+                this->_assembler.Emit(vzeroupper, sizeof(vzeroupper));
+            }
+            static const unsigned char returnFalse[] = { 0x31, 0xc0, 0xc3 }; // xor eax, eax; ret
+            this->_assembler.Emit(returnFalse, sizeof(returnFalse));
+        }
+
+    protected:
+        size_t GetSegmentEnd(size_t pos) const
+        {
+            while (pos < this->_pattern.size() && this->_pattern[pos] != '*')
+            {
+                ++pos;
+            }
+            return pos;
+        }
+
+        // segments after every '*' up to the end of the pattern
+        void EmitAfterAsterisk(size_t pos)
+        {
+            while (true)
+            {
+                while (pos < this->_pattern.size() && this->_pattern[pos] == '*')
+                {
+                    ++pos;
+                }
+                if (pos == this->_pattern.size())
+                {
+                    this->_assembler.JumpTo(Jmp, this->_success);
+                    return;
+                }
+
+                const size_t end = this->GetSegmentEnd(pos);
+                if (end == this->_pattern.size())
+                {
+                    this->EmitLastSegment(pos, end);
+                    return;
+                }
+                this->EmitMiddleSegment(pos, end);
+                pos = end;
+            }
+        }
+
+        // the last segment is anchored at the end of the text
+        void EmitLastSegment(const size_t begin, const size_t end)
+        {
+            const size_t size = end - begin;
+            this->EmitRemainingSize();
+            this->EmitCmpRax(size);
+            this->_assembler.JumpTo(Jb, this->_fail);
+            static const unsigned char leaR8Rdx[] = { 0x4c, 0x8d, 0x82 }; // lea r8, [rdx + disp32]
+            this->_assembler.Emit(leaR8Rdx, sizeof(leaR8Rdx));
+            this->_assembler.Emit32(static_cast<uint32_t>(0 - size));
+            this->EmitSegmentCompare(EBase::R8, begin, end, this->_fail);
+            this->_assembler.JumpTo(Jmp, this->_success);
+        }
+
+        // leftmost placement of the segment; rcx is moved after it
+        void EmitMiddleSegment(const size_t begin, const size_t end)
+        {
+            const size_t size = end - begin;
+
+            // two rarest literal bytes give candidates; a segment of '?' only is placed right here
+            size_t rareOffset1 = size;
+            size_t rareOffset2 = size;
+            this->FindRareOffsets(begin, end, rareOffset1, rareOffset2);
+            if (rareOffset1 == size)
+            {
+                this->EmitRemainingSize();
+                this->EmitCmpRax(size);
+                this->_assembler.JumpTo(Jb, this->_fail);
+                this->EmitAddRcx(size);
+                return;
+            }
+
+            const size_t vectorLoop = this->_assembler.NewLabel();
+            const size_t nextCandidate = this->_assembler.NewLabel();
+            const size_t nextBlock = this->_assembler.NewLabel();
+            const size_t tailLoop = this->_assembler.NewLabel();
+            const size_t tailNext = this->_assembler.NewLabel();
+            const size_t found = this->_assembler.NewLabel();
+
+            // xmm0/ymm0 = the rarest byte in all lanes, xmm2/ymm2 = the second one
+            const size_t vectorSize = this->_avx2 ? 32 : 16;
+            this->_assembler.Emit(0xb8); // mov eax, imm32
+            this->_assembler.Emit32(static_cast<unsigned char>(this->_pattern[begin + rareOffset1]) * 0x01010101u);
+            static const unsigned char broadcastSse0[] = {
+                0x66, 0x0f, 0x6e, 0xc0,      // movd xmm0, eax
+                0x66, 0x0f, 0x70, 0xc0, 0x00 // pshufd xmm0, xmm0, 0
+            };
+            static const unsigned char broadcastAvx0[] = {
+                0xc5, 0xf9, 0x6e, 0xc0,      // vmovd xmm0, eax
+                0xc4, 0xe2, 0x7d, 0x78, 0xc0 // vpbroadcastb ymm0, xmm0
+            };
+            this->_assembler.Emit(this->_avx2 ? broadcastAvx0 : broadcastSse0, sizeof(broadcastSse0));
+            this->_assembler.Emit(0xb8); // mov eax, imm32
+            this->_assembler.Emit32(static_cast<unsigned char>(this->_pattern[begin + rareOffset2]) * 0x01010101u);
+            static const unsigned char broadcastSse2[] = {
+                0x66, 0x0f, 0x6e, 0xd0,      // movd xmm2, eax
+                0x66, 0x0f, 0x70, 0xd2, 0x00 // pshufd xmm2, xmm2, 0
+            };
+            static const unsigned char broadcastAvx2[] = {
+                0xc5, 0xf9, 0x6e, 0xd0,      // vmovd xmm2, eax
+                0xc4, 0xe2, 0x7d, 0x78, 0xd2 // vpbroadcastb ymm2, xmm2
+            };
+            this->_assembler.Emit(this->_avx2 ? broadcastAvx2 : broadcastSse2, sizeof(broadcastSse2));
+
+            // a vector of candidates per iteration while the segment at the last of them fits into the text
+            this->_assembler.Bind(vectorLoop);
+            this->EmitRemainingSize();
+            this->EmitCmpRax(size + vectorSize - 1);
+            this->_assembler.JumpTo(Jb, tailLoop);
+            static const unsigned char loadSse1[] = { 0xf3, 0x0f, 0x6f, 0x89 }; // movdqu xmm1, [rcx + disp32]
+            static const unsigned char loadAvx1[] = { 0xc5, 0xfe, 0x6f, 0x89 }; // vmovdqu ymm1, [rcx + disp32]
+            this->_assembler.Emit(this->_avx2 ? loadAvx1 : loadSse1, sizeof(loadSse1));
+            this->_assembler.Emit32(static_cast<uint32_t>(rareOffset1));
+            static const unsigned char loadSse3[] = { 0xf3, 0x0f, 0x6f, 0x99 }; // movdqu xmm3, [rcx + disp32]
+            static const unsigned char loadAvx3[] = { 0xc5, 0xfe, 0x6f, 0x99 }; // vmovdqu ymm3, [rcx + disp32]
+            this->_assembler.Emit(this->_avx2 ? loadAvx3 : loadSse3, sizeof(loadSse3));
+            this->_assembler.Emit32(static_cast<uint32_t>(rareOffset2));
+            static const unsigned char compareSse[] = {
+                0x66, 0x0f, 0x74, 0xc8,      // pcmpeqb xmm1, xmm0
+                0x66, 0x0f, 0x74, 0xda,      // pcmpeqb xmm3, xmm2
+                0x66, 0x0f, 0xdb, 0xcb,      // pand xmm1, xmm3
+                0x66, 0x44, 0x0f, 0xd7, 0xd9 // pmovmskb r11d, xmm1
+            };
+            static const unsigned char compareAvx[] = {
+                0xc5, 0xf5, 0x74, 0xc8, // vpcmpeqb ymm1, ymm1, ymm0
+                0xc5, 0xe5, 0x74, 0xda, // vpcmpeqb ymm3, ymm3, ymm2
+                0xc5, 0xf5, 0xdb, 0xcb, // vpand ymm1, ymm1, ymm3
+                0xc5, 0x7d, 0xd7, 0xd9  // vpmovmskb r11d, ymm1
+            };
+            if (this->_avx2)
+            {
+                this->_assembler.Emit(compareAvx, sizeof(compareAvx));
+            }
+            else
+            {
+                this->_assembler.Emit(compareSse, sizeof(compareSse));
+            }
+
+            this->_assembler.Bind(nextCandidate);
+            static const unsigned char testMask[] = { 0x45, 0x85, 0xdb }; // test r11d, r11d
+            this->_assembler.Emit(testMask, sizeof(testMask));
+            this->_assembler.JumpTo(Jz, nextBlock);
+            static const unsigned char takeCandidate[] = {
+                0x45, 0x0f, 0xbc, 0xd3, // bsf r10d, r11d
+                0x4e, 0x8d, 0x04, 0x11, // lea r8, [rcx + r10]
+                0x41, 0x8d, 0x43, 0xff, // lea eax, [r11 - 1]
+                0x41, 0x21, 0xc3        // and r11d, eax
+            };
+            this->_assembler.Emit(takeCandidate, sizeof(takeCandidate));
+            this->EmitSegmentCompare(EBase::R8, begin, end, nextCandidate);
+            static const unsigned char leaRcxR8[] = { 0x49, 0x8d, 0x88 }; // lea rcx, [r8 + disp32]
+            this->_assembler.Emit(leaRcxR8, sizeof(leaRcxR8));
+            this->_assembler.Emit32(static_cast<uint32_t>(size));
+            this->_assembler.JumpTo(Jmp, found);
+
+            this->_assembler.Bind(nextBlock);
+            this->EmitAddRcx(vectorSize);
+            this->_assembler.JumpTo(Jmp, vectorLoop);
+
+            // the rest is checked position by position
+            this->_assembler.Bind(tailLoop);
+            this->EmitRemainingSize();
+            this->EmitCmpRax(size);
+            this->_assembler.JumpTo(Jb, this->_fail);
+            this->EmitSegmentCompare(EBase::Rcx, begin, end, tailNext);
+            this->EmitAddRcx(size);
+            this->_assembler.JumpTo(Jmp, found);
+            this->_assembler.Bind(tailNext);
+            static const unsigned char incRcx[] = { 0x48, 0xff, 0xc1 }; // inc rcx
+            this->_assembler.Emit(incRcx, sizeof(incRcx));
+            this->_assembler.JumpTo(Jmp, tailLoop);
+
+            this->_assembler.Bind(found);
+        }
+
+        // offsets in the segment of its two rarest literal bytes like CSimdSearch::MakeNeedle(), '?' is skipped;
+        // the same offset is returned twice for a single literal byte, size is returned for a segment of '?' only
+        void FindRareOffsets(const size_t begin, const size_t end, size_t& rareOffset1, size_t& rareOffset2) const
+        {
+            const CByteFrequency& frequency = CByteFrequency::GetDefault();
+            const size_t size = end - begin;
+            const char* const segment = this->_pattern.data() + begin;
+            rareOffset1 = size;
+            for (size_t i = 0; i < size; ++i)
+            {
+                if (segment[i] != '?' && (rareOffset1 == size || frequency.GetWeight(segment[i]) < frequency.GetWeight(segment[rareOffset1])))
+                {
+                    rareOffset1 = i;
+                }
+            }
+            rareOffset2 = rareOffset1;
+            for (size_t i = 0; i < size && rareOffset1 != size; ++i)
+            {
+                if (segment[i] == '?' || i == rareOffset1)
+                {
+                    continue;
+                }
+                const bool sameByte = segment[i] == segment[rareOffset1];
+                const bool bestIsSameByte = rareOffset2 == rareOffset1 || segment[rareOffset2] == segment[rareOffset1];
+                if (rareOffset2 == rareOffset1 || (bestIsSameByte && !sameByte) ||
+                    (bestIsSameByte == sameByte && frequency.GetWeight(segment[i]) < frequency.GetWeight(segment[rareOffset2])))
+                {
+                    rareOffset2 = i;
+                }
+            }
+        }
+
+        // compare text at base with pattern characters [begin, end); 4 literal characters are compared at once
+        void EmitSegmentCompare(const EBase base, const size_t begin, const size_t end, const size_t mismatch)
+        {
+            size_t i = begin;
+            while (i < end)
+            {
+                if (this->_pattern[i] == '?')
+                {
+                    ++i;
+                    continue;
+                }
+
+                const bool dword = end - i >= 4 && this->_pattern.substr(i, 4).find('?') == std::string_view::npos;
+                if (base == EBase::R8)
+                {
+                    this->_assembler.Emit(0x41); // REX.B
+                }
+                this->_assembler.Emit(dword ? 0x81 : 0x80);                 // cmp r/m, imm
+                this->_assembler.Emit(base == EBase::R8 ? 0xb8 : 0xb9);     // [base + disp32], /7
+                this->_assembler.Emit32(static_cast<uint32_t>(i - begin));
+                if (dword)
+                {
+                    uint32_t value = 0;
+                    memcpy(&value, this->_pattern.data() + i, sizeof(value));
+                    this->_assembler.Emit32(value);
+                }
+                else
+                {
+                    this->_assembler.Emit(static_cast<unsigned char>(this->_pattern[i]));
+                }
+                this->_assembler.JumpTo(Jnz, mismatch);
+                i += dword ? 4 : 1;
+            }
+        }
+
+        // rax = rdx - rcx
+        void EmitRemainingSize()
+        {
+            static const unsigned char remaining[] = {
+                0x48, 0x89, 0xd0, // mov rax, rdx
+                0x48, 0x29, 0xc8  // sub rax, rcx
+            };
+            this->_assembler.Emit(remaining, sizeof(remaining));
+        }
+
+        void EmitCmpRax(const size_t value)
+        {
+            static const unsigned char cmpRax[] = { 0x48, 0x3d }; // cmp rax, imm32
+            this->_assembler.Emit(cmpRax, sizeof(cmpRax));
+            this->_assembler.Emit32(static_cast<uint32_t>(value));
+        }
+
+        void EmitAddRcx(const size_t value)
+        {
+            if (value == 0)
+            {
+                return;
+            }
+            static const unsigned char addRcx[] = { 0x48, 0x81, 0xc1 }; // add rcx, imm32
+            this->_assembler.Emit(addRcx, sizeof(addRcx));
+            this->_assembler.Emit32(static_cast<uint32_t>(value));
+        }
+
+    protected:
+        CAssembler&            _assembler;
+        const std::string_view _pattern;
+        const bool             _avx2; // 32 byte search loops
+        size_t                 _fail = 0;
+        size_t                 _success = 0;
+    };
+}
+
+
+CFnMatchJit::~CFnMatchJit()
+{
+    this->FreeCode();
+}
+
+bool CFnMatchJit::Compile(const std::string_view pattern)
+{
+    this->FreeCode();
+    if (!this->_interpreter.Compile(pattern))
+    {
+        return false;
+    }
+
+    // failed code generation is not an error: the interpreter is used
+    if (pattern.size() <= MaxPatternLength)
+    {
+        this->Generate(pattern);
+    }
+    return true;
+}
+
+bool CFnMatchJit::Generate(const std::string_view pattern)
+{
+#if defined(_M_X64)
+    // generous bounds: the worst pattern "*a*a..." costs about 200 bytes, 6 labels and 9 jumps per 2 characters
+    CAssembler assembler;
+    if (!assembler.Init(256 + 128 * pattern.size(), 8 + 4 * pattern.size(), 8 + 8 * pattern.size()))
+    {
+        return false;
+    }
+    // search loops use AVX2 when CSimdSearch kernels do
+    const bool avx2 = CSimdSearch::GetLevel() >= ESimdLevel::Avx2;
+    CPatternCompiler compiler(assembler, pattern, avx2);
+    compiler.Compile();
+    if (!assembler.Finish())
+    {
+        return false;
+    }
+
+    // code is written to read-write pages, then they are made executable: pages are never writable and executable at once
+    void* const code = VirtualAlloc(nullptr, assembler.GetSize(), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (code == nullptr)
+    {
+        return false;
+    }
+    memcpy(code, assembler.GetCode(), assembler.GetSize());
+    DWORD oldProtection = 0;
+    if (!VirtualProtect(code, assembler.GetSize(), PAGE_EXECUTE_READ, &oldProtection))
+    {
+        VirtualFree(code, 0, MEM_RELEASE);
+        return false;
+    }
+    FlushInstructionCache(GetCurrentProcess(), code, assembler.GetSize());
+
+    this->_code = code;
+    this->_codeSize = assembler.GetSize();
+    this->_function = reinterpret_cast<MatchFunction>(code);
+    return true;
+#else
+    // Windows x64 calling convention and SSE2 are assumed by the generated code
+    (void)pattern;
+    return false;
+#endif
+}
+
+void CFnMatchJit::FreeCode()
+{
+    if (this->_code != nullptr)
+    {
+        VirtualFree(this->_code, 0, MEM_RELEASE);
+    }
+    this->_code = nullptr;
+    this->_codeSize = 0;
+    this->_function = nullptr;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "FnMatch.h"
+
+#include <string_view> // this is STL, but it does not need exceptions
+
+#include <wchar.h> // for size_t
+
+
+// Pattern compiled to x64 machine code: the same semantics as CFnMatch::Match().
+// Segments between '*' become straight-line compares of the pattern bytes, a middle segment is searched by inlined SSE2 or AVX2
+// loop over its two rarest bytes and placed leftmost (no backtracking, like CFnMatchStatic).
+// AVX2 is used when CSimdSearch::GetLevel() allows it at the moment of Compile().
+// Code is not generated for 32-bit builds, for too long patterns or when executable memory can't be allocated:
+// Match() uses the compiled CFnMatch interpreter then.
+class CFnMatchJit
+{
+public:
+    static const size_t MaxPatternLength = 1024; // longer patterns are interpreted
+
+public:
+    CFnMatchJit() = default;
+    CFnMatchJit(const CFnMatchJit&) = delete;
+    CFnMatchJit& operator=(const CFnMatchJit&) = delete;
+    ~CFnMatchJit();
+
+    // pattern is not copied, it must outlive the matcher or the next Compile(); return false on error
+    bool Compile(const std::string_view pattern);
+
+    bool Match(const std::string_view text) const
+    {
+        if (this->_function != nullptr)
+        {
+            return this->_function(text.data(), text.size());
+        }
+        return this->_interpreter.Match(text);
+    }
+
+    // false when the interpreter is used
+    bool IsNative() const
+    {
+        return this->_function != nullptr;
+    }
+
+protected:
+    typedef bool (*MatchFunction)(const char* const text, const size_t size);
+
+    bool Generate(const std::string_view pattern);
+    void FreeCode();
+
+protected:
+    CFnMatch      _interpreter;
+    MatchFunction _function = nullptr;
+    void*         _code = nullptr; // executable pages
+    size_t        _codeSize = 0;
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "SimdSearch.h"
+
+#include <string_view> // this is STL, but it does not need exceptions
+
+#include <wchar.h> // for size_t
+
+
+// Matcher of a pattern known at compile time; the same semantics as CFnMatch::Match().
+// The pattern is split into segments between '*' at compile time. Every segment is a sequence of literal characters and '?',
+// its comparison is unrolled and '?' positions are dropped from it. Leftmost placement of a middle segment never loses a match,
+// so there is no backtracking: the first segment is anchored at the start, the last one at the end of the text.
+// Pattern must be a constexpr array with linkage (C++17 does not accept string literals as template arguments):
+//     static constexpr char ErrorPattern[] = "*error*";
+//     CFnMatchStatic<ErrorPattern>::Match(line);
+template <const char* Pattern>
+class CFnMatchStatic
+{
+public:
+    static bool Match(const std::string_view text)
+    {
+        return MatchFirstSegment(text.data(), text.data() + text.size());
+    }
+
+protected:
+    static constexpr size_t GetLength()
+    {
+        size_t length = 0;
+        while (Pattern[length] != '\0')
+        {
+            ++length;
+        }
+        return length;
+    }
+
+    static constexpr size_t Length = GetLength();
+
+    // the first '*' at or after pos, or the end of the pattern
+    static constexpr size_t GetSegmentEnd(size_t pos)
+    {
+        while (pos < Length && Pattern[pos] != '*')
+        {
+            ++pos;
+        }
+        return pos;
+    }
+
+    // the first not '*' at or after pos
+    static constexpr size_t SkipAsterisks(size_t pos)
+    {
+        while (pos < Length && Pattern[pos] == '*')
+        {
+            ++pos;
+        }
+        return pos;
+    }
+
+    // the first '?' at or after pos before end
+    static constexpr size_t GetLiteralEnd(size_t pos, const size_t end)
+    {
+        while (pos < end && Pattern[pos] != '?')
+        {
+            ++pos;
+        }
+        return pos;
+    }
+
+    // compare text with pattern characters [Begin, End) without '*'; text has enough characters
+    template <size_t Begin, size_t End>
+    static bool SegmentAt(const char* const pText)
+    {
+        if constexpr (Begin == End)
+        {
+            return true;
+        }
+        else if constexpr (Pattern[Begin] == '?')
+        {
+            return SegmentAt<Begin + 1, End>(pText + 1);
+        }
+        else
+        {
+            return *pText == Pattern[Begin] && SegmentAt<Begin + 1, End>(pText + 1);
+        }
+    }
+
+    // leftmost placement of the segment [Begin, End) in the text
+    template <size_t Begin, size_t End>
+    static const char* FindSegment(const char* pText, const char* const pTextEnd)
+    {
+        constexpr size_t SegmentSize = End - Begin;
+        constexpr size_t LiteralSize = GetLiteralEnd(Begin, End) - Begin;
+
+        while (static_cast<size_t>(pTextEnd - pText) >= SegmentSize)
+        {
+            if constexpr (LiteralSize != 0)
+            {
+                // candidates are occurrences of the leading literal with room for the rest of the segment
+                const size_t searchSize = (pTextEnd - pText) - (SegmentSize - LiteralSize);
+                pText = CSimdSearch::FindLiteral(pText, searchSize, Pattern + Begin, LiteralSize);
+                if (pText == nullptr)
+                {
+                    return nullptr;
+                }
+            }
+            if (SegmentAt<Begin + LiteralSize, End>(pText + LiteralSize))
+            {
+                return pText;
+            }
+            ++pText;
+        }
+        return nullptr;
+    }
+
+    // the pattern part after '*' at AsteriskPos
+    template <size_t AsteriskPos>
+    static bool MatchAfterAsterisk(const char* const pText, const char* const pTextEnd)
+    {
+        constexpr size_t Begin = SkipAsterisks(AsteriskPos);
+        constexpr size_t End = GetSegmentEnd(Begin);
+        if constexpr (Begin == Length)
+        {
+            return true;
+        }
+        else if constexpr (End == Length)
+        {
+            // the last segment is anchored at the end of the text
+            return static_cast<size_t>(pTextEnd - pText) >= End - Begin && SegmentAt<Begin, End>(pTextEnd - (End - Begin));
+        }
+        else
+        {
+            const char* const pSegment = FindSegment<Begin, End>(pText, pTextEnd);
+            return pSegment != nullptr && MatchAfterAsterisk<End>(pSegment + (End - Begin), pTextEnd);
+        }
+    }
+
+    static bool MatchFirstSegment(const char* const pText, const char* const pTextEnd)
+    {
+        constexpr size_t End = GetSegmentEnd(0);
+        const size_t textSize = pTextEnd - pText;
+        if constexpr (End == Length)
+        {
+            // no '*': the whole text is compared
+            return textSize == Length && SegmentAt<0, End>(pText);
+        }
+        else
+        {
+            return textSize >= End && SegmentAt<0, End>(pText) && MatchAfterAsterisk<End>(pText + End, pTextEnd);
+        }
+    }
+};
@@ -1,7 +1,11 @@
 #include "LineReader.h"
 
+#include "SimdSearch.h"
+
 #include <assert.h>
 
+#include <algorithm> // for std::clamp()
+
 
 namespace
 {
@@ -16,8 +20,75 @@ namespace
     static_assert(ReadChunkSize >= MaxLogLineLength); // we need this to guarantee there will be no data loss while moving incomplete line to the beginning of the buffer
     static_assert(ReadChunkSize % MaxKnownNtfsClusterSize == 0);
 
-    const size_t ReadBufferSize = MaxLogLineLength + ReadChunkSize;
-    const size_t ReadBufferOffset = MaxLogLineLength;
+    // Data is read to page aligned address (it is cache line aligned too), the rest of previous line is placed right before it.
+    // Page aligned buffers are allocated directly by VirtualAlloc(). Large pages are not used here by default:
+    // each 260 KB buffer would occupy whole 2 MB large page and they need SeLockMemoryPrivilege.
+    const size_t PageSize = 4096;
+    const size_t ReadBufferOffset = (MaxLogLineLength + PageSize - 1) / PageSize * PageSize;
+    const size_t ReadBufferSize = ReadBufferOffset + ReadChunkSize;
+    const CCharBuffer::EAllocationPolicy ReadBufferPolicy = CCharBuffer::EAllocationPolicy::Pages;
+    static_assert(ReadBufferOffset >= MaxLogLineLength);
+
+    // Double buffer readers hold 2 buffers: one is scanned, another one is filled by read operation in progress
+    const size_t ReaderBufferCount = 2;
+
+    // Mapped file is prefetched by windows of this size, few windows ahead of the scan position.
+    // Windows behind the scan position are removed from working set, so a huge file does not bloat process memory.
+    const size_t MappingWindowSize = 4 * 1024 * 1024;
+    const size_t MappingWindowsAhead = 2;
+
+    size_t FindEol(CScanStats& stats, const std::string_view data, const size_t offset = 0)
+    {
+        SCAN_STATS_SCOPE(stats, EScanStage::Split);
+        if (offset >= data.size())
+        {
+            return data.npos;
+        }
+        const char* const eol = CSimdSearch::FindChar(data.data() + offset, data.size() - offset, '\n');
+        return eol != nullptr ? eol - data.data() : data.npos;
+    }
+
+    // Reading mapped memory raises EXCEPTION_IN_PAGE_ERROR if the file was truncated by another process or reading from disk failed.
+    // The function must not have objects with destructors because of __try.
+    bool FindEolInMappedMemory(const char* const data, const size_t length, size_t& eolOffset)
+    {
+        __try
+        {
+            const char* const eol = CSimdSearch::FindChar(data, length, '\n');
+            eolOffset = eol != nullptr ? eol - data : std::string_view::npos;
+        }
+        __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    // the same as FindEolInMappedMemory()
+    bool FindNeedleInMappedMemory(const char* const data, const size_t length, const CSimdSearch::Needle& needle, size_t& offset)
+    {
+        __try
+        {
+            const char* const found = CSimdSearch::FindNeedle(data, length, needle);
+            offset = found != nullptr ? found - data : std::string_view::npos;
+        }
+        __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    std::optional<size_t> FindEolInMappedMemory(CScanStats& stats, const std::string_view data)
+    {
+        SCAN_STATS_SCOPE(stats, EScanStage::Split);
+        size_t eolOffset = 0;
+        if (!FindEolInMappedMemory(data.data(), data.size(), eolOffset))
+        {
+            return {};
+        }
+        return eolOffset;
+    }
 }
 
 
@@ -27,10 +98,10 @@ namespace
 
 CSyncLineReader::CSyncLineReader()
 {
-    this->_buffer.Allocate(ReadBufferSize);
+    this->_buffer.Allocate(ReadBufferSize, PageSize, ReadBufferPolicy);
 }
 
-bool CSyncLineReader::Open(const wchar_t* const filename)
+bool CSyncLineReader::Open(const wchar_t* const filename, const uint64_t startOffset, const bool allowWriters)
 {
     if (this->_buffer.ptr == nullptr || filename == nullptr)
     {
@@ -39,12 +110,20 @@ bool CSyncLineReader::Open(const wchar_t* const filename)
     this->Close();
 
     const bool bAsyncMode = false;
-    const bool succeeded = this->_file.Open(filename, bAsyncMode);
+    const bool bUnbufferedMode = false;
+    const bool succeeded = this->_file.Open(filename, bAsyncMode, bUnbufferedMode, allowWriters);
     if (!succeeded)
     {
         return false;
     }
 
+    if (!this->_file.SetReadOffset(startOffset))
+    {
+        this->_file.Close();
+        return false;
+    }
+    this->_readOffset = startOffset;
+
     this->_bufferData = std::string_view(this->_buffer.ptr, 0);
     return true;
 }
@@ -63,7 +142,7 @@ std::optional<std::string_view> CSyncLineReader::GetNextLine()
     }
 
     // Find EOL:
-    size_t eolOffset = this->_bufferData.find('\n');
+    size_t eolOffset = FindEol(this->_file.Stats(), this->_bufferData);
 
     if (eolOffset == this->_bufferData.npos)
     {
@@ -90,6 +169,7 @@ std::optional<std::string_view> CSyncLineReader::GetNextLine()
             // Reading data failed
             return {};
         }
+        this->_readOffset += readBytes;
 
         this->_bufferData = { newDataBufferPtr, prefixLength + readBytes };
 
@@ -102,7 +182,7 @@ std::optional<std::string_view> CSyncLineReader::GetNextLine()
 
         // Search EOL again after reading additional data:
         // I expect we read either ReadChunkSize bytes or we read the data chunk in file.
-        eolOffset = this->_bufferData.find('\n', prefixLength);
+        eolOffset = FindEol(this->_file.Stats(), this->_bufferData, prefixLength);
         if (eolOffset == this->_bufferData.npos)
         {
             if (this->_bufferData.size() > MaxLogLineLength)
@@ -138,38 +218,53 @@ std::optional<std::string_view> CSyncLineReader::GetNextLine()
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 
-CAsyncLineReader::CAsyncLineReader()
+CAsyncLineReader::CAsyncLineReader(const size_t retainedBufferCount)
+    : _retainedBufferCount(std::min(retainedBufferCount, CBufferPool::MaxBuffers - ReaderBufferCount))
 {
-    this->_buffer1.Allocate(ReadBufferSize);
-    if (this->_buffer1.ptr != nullptr)
-    {
-        this->_buffer2.Allocate(ReadBufferSize);
-    }
+    this->_buffers.Allocate(ReaderBufferCount + this->_retainedBufferCount, ReadBufferSize, PageSize, ReadBufferPolicy);
 }
 
-bool CAsyncLineReader::Open(const wchar_t* const filename)
+CAsyncLineReader::~CAsyncLineReader()
 {
-    if (this->_buffer1.ptr == nullptr || filename == nullptr)
+    // read operation must be finished and buffers must be released before the pool is freed
+    this->Close();
+}
+
+bool CAsyncLineReader::Open(const wchar_t* const filename, const uint64_t startOffset, const bool allowWriters)
+{
+    if (this->_buffers.GetBufferCount() == 0 || filename == nullptr)
     {
         return false;
     }
-    assert(this->_buffer2.ptr != nullptr);
     this->Close();
 
     const bool bAsyncMode = true;
-    const bool succeeded = this->_file.Open(filename, bAsyncMode);
+    const bool bUnbufferedMode = false;
+    const bool succeeded = this->_file.Open(filename, bAsyncMode, bUnbufferedMode, allowWriters);
     if (!succeeded)
     {
         return false;
     }
 
-    this->_bufferData = std::string_view(this->_buffer1.ptr, 0);
-    this->_firstBufferIsActive = true;
+    if (!this->_file.SetReadOffset(startOffset))
+    {
+        this->_file.Close();
+        return false;
+    }
+    this->_readOffset = startOffset;
+
+    // buffers held by lines of the previous file are not reused until they are released
+    if (!this->_buffers.TryAcquire(this->_currentBuffer) || !this->_buffers.TryAcquire(this->_readingBuffer))
+    {
+        this->Close();
+        return false;
+    }
+    this->_bufferData = std::string_view(this->_buffers.GetBuffer(this->_currentBuffer), 0);
 
-    const bool readStartOk = this->_file.AsyncReadStart(this->_buffer2.ptr + ReadBufferOffset, ReadChunkSize);
+    const bool readStartOk = this->_file.AsyncReadStart(this->_buffers.GetBuffer(this->_readingBuffer) + ReadBufferOffset, ReadChunkSize);
     if (!readStartOk)
     {
-        this->_file.Close();
+        this->Close();
         return false;
     }
 
@@ -179,19 +274,44 @@ bool CAsyncLineReader::Open(const wchar_t* const filename)
 void CAsyncLineReader::Close()
 {
     this->_file.Close();
+    this->ReleaseReaderBuffers();
+}
+
+void CAsyncLineReader::ReleaseReaderBuffers()
+{
+    if (this->_currentBuffer != CBufferPool::NoBuffer)
+    {
+        this->_buffers.Release(this->_currentBuffer);
+        this->_currentBuffer = CBufferPool::NoBuffer;
+    }
+    if (this->_readingBuffer != CBufferPool::NoBuffer)
+    {
+        this->_buffers.Release(this->_readingBuffer);
+        this->_readingBuffer = CBufferPool::NoBuffer;
+    }
+    this->_bufferData = {};
 }
 
 __declspec(noinline) // noinline is added to help CPU profiling in release version
 std::optional<std::string_view> CAsyncLineReader::GetNextLine()
 {
-    if (this->_buffer1.ptr == nullptr)
+    if (this->_currentBuffer == CBufferPool::NoBuffer)
     {
         return {};
     }
-    assert(this->_buffer2.ptr != nullptr);
+
+    if (this->_readingBuffer == CBufferPool::NoBuffer)
+    {
+        // Read was not started because all buffers were held by CLineRef, see IsBufferPoolExhausted()
+        if (!this->_buffers.TryAcquire(this->_readingBuffer) ||
+            !this->_file.AsyncReadStart(this->_buffers.GetBuffer(this->_readingBuffer) + ReadBufferOffset, ReadChunkSize))
+        {
+            return {};
+        }
+    }
 
     // Find EOL:
-    size_t eolOffset = this->_bufferData.find('\n');
+    size_t eolOffset = FindEol(this->_file.Stats(), this->_bufferData);
 
     if (eolOffset == this->_bufferData.npos)
     {
@@ -203,12 +323,9 @@ std::optional<std::string_view> CAsyncLineReader::GetNextLine()
             return {};
         }
 
-        CCharBuffer& currentBuffer = this->_firstBufferIsActive ? this->_buffer1 : this->_buffer2;
-        CCharBuffer& nextBuffer = this->_firstBufferIsActive ? this->_buffer2 : this->_buffer1;
-
         const size_t prefixLength = this->_bufferData.size();
         assert(prefixLength <= MaxLogLineLength && "the rest of buffer is too big for moving to beginning");
-        char* const newDataBufferPtr = nextBuffer.ptr + ReadBufferOffset - prefixLength;
+        char* const newDataBufferPtr = this->_buffers.GetBuffer(this->_readingBuffer) + ReadBufferOffset - prefixLength;
 
         // don't need memmove since the whole high level algorithm will fail if buffers overlap
         memcpy(newDataBufferPtr, this->_bufferData.data(), prefixLength);
@@ -220,18 +337,27 @@ std::optional<std::string_view> CAsyncLineReader::GetNextLine()
             // Previous reading failed
             return {};
         }
+        this->_readOffset += readBytes;
+
+        // Scanned buffer is reused for the next read unless its lines are held by CLineRef; the filled one becomes current
+        this->_buffers.Release(this->_currentBuffer);
+        this->_currentBuffer = this->_readingBuffer;
+        this->_readingBuffer = CBufferPool::NoBuffer;
+        this->_bufferData = { newDataBufferPtr, prefixLength + readBytes };
+        if (!this->_buffers.TryAcquire(this->_readingBuffer))
+        {
+            // All buffers are held by CLineRef: next read is started by the call after lines are released
+            return {};
+        }
 
         // Read missing data:
-        const bool readOk = this->_file.AsyncReadStart(currentBuffer.ptr + ReadBufferOffset, ReadChunkSize);
+        const bool readOk = this->_file.AsyncReadStart(this->_buffers.GetBuffer(this->_readingBuffer) + ReadBufferOffset, ReadChunkSize);
         if (!readOk)
         {
             // New reading failed
             return {};
         }
 
-        this->_bufferData = { newDataBufferPtr, prefixLength + readBytes };
-        this->_firstBufferIsActive = !this->_firstBufferIsActive;
-
         if (this->_bufferData.empty())
         {
             assert(readBytes == 0);
@@ -241,7 +367,7 @@ std::optional<std::string_view> CAsyncLineReader::GetNextLine()
 
         // Search EOL again after reading additional data:
         // I expect we read either ReadChunkSize bytes or we read the data chunk in file.
-        eolOffset = this->_bufferData.find('\n', prefixLength);
+        eolOffset = FindEol(this->_file.Stats(), this->_bufferData, prefixLength);
         if (eolOffset == this->_bufferData.npos)
         {
             if (this->_bufferData.size() > MaxLogLineLength)
@@ -252,7 +378,7 @@ std::optional<std::string_view> CAsyncLineReader::GetNextLine()
 
             // Found last line after reading missing data
             const std::string_view result = this->_bufferData;
-            this->_bufferData = { this->_buffer1.ptr, 0 };
+            this->_bufferData = { this->_buffers.GetBuffer(this->_currentBuffer), 0 };
             assert(!result.empty() && "last line without LF should be not empty");
             return result;
         }
@@ -273,11 +399,34 @@ std::optional<std::string_view> CAsyncLineReader::GetNextLine()
     return result;
 }
 
+std::optional<CLineRef> CAsyncLineReader::GetNextLineRef()
+{
+    if (this->_retainedBufferCount == 0)
+    {
+        // consumer can't hold any buffer without stopping the reader
+        return {};
+    }
+
+    const std::optional<std::string_view> line = this->GetNextLine();
+    if (!line)
+    {
+        return {};
+    }
+
+    // returned line is always inside of the current buffer, even if it was started in the previous one
+    return CLineRef(this->_buffers, this->_currentBuffer, *line);
+}
+
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 
-bool CMappingLineReader::Open(const wchar_t* const filename)
+CMappingLineReader::CMappingLineReader(const bool prefetchWindows)
+    : _prefetchWindows(prefetchWindows)
+{
+}
+
+bool CMappingLineReader::Open(const wchar_t* const filename, const uint64_t startOffset, const bool allowWriters)
 {
     if (filename == nullptr)
     {
@@ -286,7 +435,8 @@ bool CMappingLineReader::Open(const wchar_t* const filename)
     this->Close();
 
     const bool bAsyncMode = false;
-    const bool succeeded = this->_file.Open(filename, bAsyncMode);
+    const bool bUnbufferedMode = false;
+    const bool succeeded = this->_file.Open(filename, bAsyncMode, bUnbufferedMode, allowWriters);
     if (!succeeded)
     {
         return false;
@@ -299,8 +449,26 @@ bool CMappingLineReader::Open(const wchar_t* const filename)
         return false;
     }
 
-    this->_bufferData = *fileView;
+    if (startOffset > fileView->size())
+    {
+        this->_file.Close();
+        return false;
+    }
+
+    this->_fileView = *fileView;
+    this->_bufferData = fileView->substr(static_cast<size_t>(startOffset));
     this->_mappedToMemory = true;
+
+    this->_nextWindowPosition = SIZE_MAX;
+    if (this->_prefetchWindows)
+    {
+        // the result is ignored: prefetch is only a hint
+        const size_t startWindowPosition = static_cast<size_t>(startOffset) / MappingWindowSize * MappingWindowSize;
+        this->_file.PrefetchMappedRange(startWindowPosition, MappingWindowSize * MappingWindowsAhead);
+        const size_t nextWindowPosition = startWindowPosition + MappingWindowSize;
+        this->_nextWindowPosition = this->_fileView.size() > nextWindowPosition ? nextWindowPosition : SIZE_MAX;
+    }
+
     return true;
 }
 
@@ -308,6 +476,39 @@ void CMappingLineReader::Close()
 {
     this->_file.Close();
     this->_mappedToMemory = false;
+    this->_fileView = std::string_view();
+    this->_bufferData = std::string_view();
+}
+
+void CMappingLineReader::MoveWindows(const size_t position)
+{
+    // The window right behind the scan position is kept: the last returned line may be still in use
+    while (position >= this->_nextWindowPosition)
+    {
+        const size_t windowIndex = this->_nextWindowPosition / MappingWindowSize;
+        this->_file.PrefetchMappedRange((windowIndex + MappingWindowsAhead - 1) * MappingWindowSize, MappingWindowSize);
+        if (windowIndex >= 2)
+        {
+            this->_file.DiscardMappedRange((windowIndex - 2) * MappingWindowSize, MappingWindowSize);
+        }
+        this->_nextWindowPosition += MappingWindowSize;
+        if (this->_nextWindowPosition >= this->_fileView.size())
+        {
+            // nothing to prefetch anymore
+            this->_nextWindowPosition = SIZE_MAX;
+        }
+    }
+}
+
+std::optional<size_t> CMappingLineReader::FindInBufferedData(const CSimdSearch::Needle& needle, const size_t size)
+{
+    size_t offset = 0;
+    if (!FindNeedleInMappedMemory(this->_bufferData.data(), size, needle, offset))
+    {
+        // File data is not available anymore
+        return {};
+    }
+    return offset;
 }
 
 __declspec(noinline) // noinline is added to help CPU profiling in release version
@@ -318,8 +519,20 @@ std::optional<std::string_view> CMappingLineReader::GetNextLine()
         return {};
     }
 
+    const size_t position = this->_bufferData.data() - this->_fileView.data();
+    if (position >= this->_nextWindowPosition)
+    {
+        this->MoveWindows(position);
+    }
+
     // Find EOL:
-    const size_t eolOffset = this->_bufferData.find('\n');
+    const auto eolFound = FindEolInMappedMemory(this->_file.Stats(), this->_bufferData);
+    if (!eolFound)
+    {
+        // File data is not available anymore
+        return {};
+    }
+    const size_t eolOffset = *eolFound;
 
     if (eolOffset == this->_bufferData.npos)
     {
@@ -338,7 +551,7 @@ std::optional<std::string_view> CMappingLineReader::GetNextLine()
         }
 
         const std::string_view result = this->_bufferData;
-        this->_bufferData = std::string_view();
+        this->_bufferData.remove_prefix(this->_bufferData.size()); // keep pointer inside of the file view
         return result;
     }
 
@@ -361,46 +574,61 @@ std::optional<std::string_view> CMappingLineReader::GetNextLine()
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 
-CSpinlockLineReader::CSpinlockLineReader()
+CSpinlockLineReader::CSpinlockLineReader(const EThreadPlacement placement, const size_t retainedBufferCount)
+    : _placement(placement)
+    , _retainedBufferCount(std::min(retainedBufferCount, CBufferPool::MaxBuffers - ReaderBufferCount))
 {
-    this->_buffer1.Allocate(ReadBufferSize);
-    if (this->_buffer1.ptr != nullptr)
-    {
-        this->_buffer2.Allocate(ReadBufferSize);
-    }
+    this->_buffers.Allocate(ReaderBufferCount + this->_retainedBufferCount, ReadBufferSize, PageSize, ReadBufferPolicy);
 }
 
-bool CSpinlockLineReader::Open(const wchar_t* const filename)
+CSpinlockLineReader::~CSpinlockLineReader()
 {
-    if (this->_buffer1.ptr == nullptr || filename == nullptr)
+    // read operation must be finished and buffers must be released before the pool is freed
+    this->Close();
+}
+
+bool CSpinlockLineReader::Open(const wchar_t* const filename, const uint64_t startOffset, const bool allowWriters)
+{
+    if (this->_buffers.GetBufferCount() == 0 || filename == nullptr)
     {
         return false;
     }
-    assert(this->_buffer2.ptr != nullptr);
     this->Close();
 
     const bool bAsyncMode = false;
-    const bool succeeded = this->_file.Open(filename, bAsyncMode);
+    const bool bUnbufferedMode = false;
+    const bool succeeded = this->_file.Open(filename, bAsyncMode, bUnbufferedMode, allowWriters);
     if (!succeeded)
     {
         return false;
     }
 
-    this->_bufferData = std::string_view(this->_buffer1.ptr, 0);
-    this->_firstBufferIsActive = true;
+    if (!this->_file.SetReadOffset(startOffset))
+    {
+        this->_file.Close();
+        return false;
+    }
+    this->_readOffset = startOffset;
 
-    const bool initSpinlockOk = this->_file.SpinlockInit();
+    // buffers held by lines of the previous file are not reused until they are released
+    if (!this->_buffers.TryAcquire(this->_currentBuffer) || !this->_buffers.TryAcquire(this->_readingBuffer))
+    {
+        this->Close();
+        return false;
+    }
+    this->_bufferData = std::string_view(this->_buffers.GetBuffer(this->_currentBuffer), 0);
+
+    const bool initSpinlockOk = this->_file.SpinlockInit(this->_placement);
     if (!initSpinlockOk)
     {
-        this->_file.Close();
+        this->Close();
         return false;
     }
 
-    const bool readStartOk = this->_file.SpinlockReadStart(this->_buffer2.ptr + ReadBufferOffset, ReadChunkSize);
+    const bool readStartOk = this->_file.SpinlockReadStart(this->_buffers.GetBuffer(this->_readingBuffer) + ReadBufferOffset, ReadChunkSize);
     if (!readStartOk)
     {
-        this->_file.SpinlockClean();
-        this->_file.Close();
+        this->Close();
         return false;
     }
 
@@ -411,19 +639,44 @@ void CSpinlockLineReader::Close()
 {
     this->_file.SpinlockClean();
     this->_file.Close();
+    this->ReleaseReaderBuffers();
+}
+
+void CSpinlockLineReader::ReleaseReaderBuffers()
+{
+    if (this->_currentBuffer != CBufferPool::NoBuffer)
+    {
+        this->_buffers.Release(this->_currentBuffer);
+        this->_currentBuffer = CBufferPool::NoBuffer;
+    }
+    if (this->_readingBuffer != CBufferPool::NoBuffer)
+    {
+        this->_buffers.Release(this->_readingBuffer);
+        this->_readingBuffer = CBufferPool::NoBuffer;
+    }
+    this->_bufferData = {};
 }
 
 __declspec(noinline) // noinline is added to help CPU profiling in release version
 std::optional<std::string_view> CSpinlockLineReader::GetNextLine()
 {
-    if (this->_buffer1.ptr == nullptr)
+    if (this->_currentBuffer == CBufferPool::NoBuffer)
     {
         return {};
     }
-    assert(this->_buffer2.ptr != nullptr);
+
+    if (this->_readingBuffer == CBufferPool::NoBuffer)
+    {
+        // Read was not started because all buffers were held by CLineRef, see IsBufferPoolExhausted()
+        if (!this->_buffers.TryAcquire(this->_readingBuffer) ||
+            !this->_file.SpinlockReadStart(this->_buffers.GetBuffer(this->_readingBuffer) + ReadBufferOffset, ReadChunkSize))
+        {
+            return {};
+        }
+    }
 
     // Find EOL:
-    size_t eolOffset = this->_bufferData.find('\n');
+    size_t eolOffset = FindEol(this->_file.Stats(), this->_bufferData);
 
     if (eolOffset == this->_bufferData.npos)
     {
@@ -435,12 +688,9 @@ std::optional<std::string_view> CSpinlockLineReader::GetNextLine()
             return {};
         }
 
-        CCharBuffer& currentBuffer = this->_firstBufferIsActive ? this->_buffer1 : this->_buffer2;
-        CCharBuffer& nextBuffer = this->_firstBufferIsActive ? this->_buffer2 : this->_buffer1;
-
         const size_t prefixLength = this->_bufferData.size();
         assert(prefixLength <= MaxLogLineLength && "the rest of buffer is too big for moving to beginning");
-        char* const newDataBufferPtr = nextBuffer.ptr + ReadBufferOffset - prefixLength;
+        char* const newDataBufferPtr = this->_buffers.GetBuffer(this->_readingBuffer) + ReadBufferOffset - prefixLength;
 
         // don't need memmove since the whole high level algorithm will fail if buffers overlap
         memcpy(newDataBufferPtr, this->_bufferData.data(), prefixLength);
@@ -452,9 +702,206 @@ std::optional<std::string_view> CSpinlockLineReader::GetNextLine()
             // Previous reading failed
             return {};
         }
+        this->_readOffset += readBytes;
+
+        // Scanned buffer is reused for the next read unless its lines are held by CLineRef; the filled one becomes current
+        this->_buffers.Release(this->_currentBuffer);
+        this->_currentBuffer = this->_readingBuffer;
+        this->_readingBuffer = CBufferPool::NoBuffer;
+        this->_bufferData = { newDataBufferPtr, prefixLength + readBytes };
+        if (!this->_buffers.TryAcquire(this->_readingBuffer))
+        {
+            // All buffers are held by CLineRef: next read is started by the call after lines are released
+            return {};
+        }
 
         // Read missing data:
-        const bool readOk = this->_file.SpinlockReadStart(currentBuffer.ptr + ReadBufferOffset, ReadChunkSize);
+        const bool readOk = this->_file.SpinlockReadStart(this->_buffers.GetBuffer(this->_readingBuffer) + ReadBufferOffset, ReadChunkSize);
+        if (!readOk)
+        {
+            // New reading failed
+            return {};
+        }
+
+        if (this->_bufferData.empty())
+        {
+            assert(readBytes == 0);
+            // The very last line without LF is not counted
+            return {};
+        }
+
+        // Search EOL again after reading additional data:
+        // I expect we read either ReadChunkSize bytes or we read the data chunk in file.
+        eolOffset = FindEol(this->_file.Stats(), this->_bufferData, prefixLength);
+        if (eolOffset == this->_bufferData.npos)
+        {
+            if (this->_bufferData.size() > MaxLogLineLength)
+            {
+                // Incomplete line is too long
+                return {};
+            }
+
+            // Found last line after reading missing data
+            const std::string_view result = this->_bufferData;
+            this->_bufferData = { this->_buffers.GetBuffer(this->_currentBuffer), 0 };
+            assert(!result.empty() && "last line without LF should be not empty");
+            return result;
+        }
+    }
+
+    const size_t foundLineLength = eolOffset + 1;
+
+    if (foundLineLength > MaxLogLineLength)
+    {
+        // Line is too long
+        return {};
+    }
+
+    const std::string_view result = this->_bufferData.substr(0, foundLineLength);
+    this->_bufferData.remove_prefix(foundLineLength);
+
+    assert(foundLineLength > 0 && "result should contain at least LF char");
+    return result;
+}
+
+std::optional<CLineRef> CSpinlockLineReader::GetNextLineRef()
+{
+    if (this->_retainedBufferCount == 0)
+    {
+        // consumer can't hold any buffer without stopping the reader
+        return {};
+    }
+
+    const std::optional<std::string_view> line = this->GetNextLine();
+    if (!line)
+    {
+        return {};
+    }
+
+    // returned line is always inside of the current buffer, even if it was started in the previous one
+    return CLineRef(this->_buffers, this->_currentBuffer, *line);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+
+CUnbufferedLineReader::CUnbufferedLineReader()
+{
+    for (CCharBuffer& buffer : this->_buffers)
+    {
+        if (!buffer.Allocate(ReadBufferSize, PageSize, ReadBufferPolicy))
+        {
+            break;
+        }
+    }
+}
+
+bool CUnbufferedLineReader::Open(const wchar_t* const filename)
+{
+    if (this->_buffers[QueueDepth - 1].ptr == nullptr || filename == nullptr)
+    {
+        return false;
+    }
+    this->Close();
+
+    const bool bAsyncMode = true;
+    const bool bUnbufferedMode = true;
+    this->_unbuffered = this->_file.Open(filename, bAsyncMode, bUnbufferedMode);
+    if (this->_unbuffered)
+    {
+        // Unbuffered reading needs sector aligned buffer address, length and file offset.
+        // Buffers, ReadBufferOffset and ReadChunkSize are page aligned; the last partial sector of the file is handled by the system.
+        const size_t sectorSize = this->_file.GetSectorSize();
+        if (sectorSize == 0 || PageSize % sectorSize != 0)
+        {
+            // Fallback to buffered reading: sector size is unknown or it is too big
+            this->_file.Close();
+            this->_unbuffered = false;
+        }
+    }
+    if (!this->_unbuffered)
+    {
+        const bool succeeded = this->_file.Open(filename, bAsyncMode);
+        if (!succeeded)
+        {
+            return false;
+        }
+    }
+
+    const bool initQueueOk = this->_file.QueuedReadInit();
+    if (!initQueueOk)
+    {
+        this->_file.Close();
+        return false;
+    }
+
+    // the last buffer is active and empty, all the rest are being filled in order
+    this->_activeBuffer = QueueDepth - 1;
+    this->_bufferData = std::string_view(this->_buffers[this->_activeBuffer].ptr, 0);
+
+    for (size_t i = 0; i < QueueDepth - 1; ++i)
+    {
+        const bool readStartOk = this->_file.QueuedReadStart(this->_buffers[i].ptr + ReadBufferOffset, ReadChunkSize);
+        if (!readStartOk)
+        {
+            this->_file.Close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void CUnbufferedLineReader::Close()
+{
+    // CScanFile::Close() waits for all reads in progress, so buffers are not used by the system after it
+    this->_file.Close();
+}
+
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+std::optional<std::string_view> CUnbufferedLineReader::GetNextLine()
+{
+    if (this->_buffers[QueueDepth - 1].ptr == nullptr)
+    {
+        return {};
+    }
+
+    // Find EOL:
+    size_t eolOffset = FindEol(this->_file.Stats(), this->_bufferData);
+
+    if (eolOffset == this->_bufferData.npos)
+    {
+        // EOL was not found. Make a choice between last line case and reading additional data from functor.
+
+        if (this->_bufferData.size() > MaxLogLineLength)
+        {
+            // Incomplete line is already too long
+            return {};
+        }
+
+        const size_t nextBufferIndex = (this->_activeBuffer + 1) % QueueDepth;
+        CCharBuffer& currentBuffer = this->_buffers[this->_activeBuffer];
+        CCharBuffer& nextBuffer = this->_buffers[nextBufferIndex];
+
+        const size_t prefixLength = this->_bufferData.size();
+        assert(prefixLength <= MaxLogLineLength && "the rest of buffer is too big for moving to beginning");
+        char* const newDataBufferPtr = nextBuffer.ptr + ReadBufferOffset - prefixLength;
+
+        // don't need memmove since the whole high level algorithm will fail if buffers overlap
+        memcpy(newDataBufferPtr, this->_bufferData.data(), prefixLength);
+
+        // The oldest reading in the queue fills the next buffer
+        size_t readBytes = 0;
+        const bool readCompleteOk = this->_file.QueuedReadWait(readBytes);
+        if (!readCompleteOk)
+        {
+            // Previous reading failed
+            return {};
+        }
+
+        // Read missing data to the buffer we have just parsed:
+        const bool readOk = this->_file.QueuedReadStart(currentBuffer.ptr + ReadBufferOffset, ReadChunkSize);
         if (!readOk)
         {
             // New reading failed
@@ -462,7 +909,151 @@ std::optional<std::string_view> CSpinlockLineReader::GetNextLine()
         }
 
         this->_bufferData = { newDataBufferPtr, prefixLength + readBytes };
-        this->_firstBufferIsActive = !this->_firstBufferIsActive;
+        this->_activeBuffer = nextBufferIndex;
+
+        if (this->_bufferData.empty())
+        {
+            assert(readBytes == 0);
+            // The very last line without LF is not counted
+            return {};
+        }
+
+        // Search EOL again after reading additional data:
+        // I expect we read either ReadChunkSize bytes or we read the data chunk in file.
+        eolOffset = FindEol(this->_file.Stats(), this->_bufferData, prefixLength);
+        if (eolOffset == this->_bufferData.npos)
+        {
+            if (this->_bufferData.size() > MaxLogLineLength)
+            {
+                // Incomplete line is too long
+                return {};
+            }
+
+            // Found last line after reading missing data
+            const std::string_view result = this->_bufferData;
+            this->_bufferData = { nextBuffer.ptr, 0 };
+            assert(!result.empty() && "last line without LF should be not empty");
+            return result;
+        }
+    }
+
+    const size_t foundLineLength = eolOffset + 1;
+
+    if (foundLineLength > MaxLogLineLength)
+    {
+        // Line is too long
+        return {};
+    }
+
+    const std::string_view result = this->_bufferData.substr(0, foundLineLength);
+    this->_bufferData.remove_prefix(foundLineLength);
+
+    assert(foundLineLength > 0 && "result should contain at least LF char");
+    return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+
+CRingLineReader::CRingLineReader(const size_t ringSize)
+    : _ringSize(std::clamp<size_t>(ringSize, 2, CScanFile::MaxRingSlots))
+{
+    for (size_t i = 0; i < this->_ringSize; ++i)
+    {
+        if (!this->_buffers[i].Allocate(ReadBufferSize, PageSize, ReadBufferPolicy))
+        {
+            break;
+        }
+    }
+}
+
+bool CRingLineReader::Open(const wchar_t* const filename)
+{
+    if (this->_buffers[this->_ringSize - 1].ptr == nullptr || filename == nullptr)
+    {
+        return false;
+    }
+    this->Close();
+
+    const bool bAsyncMode = false;
+    const bool succeeded = this->_file.Open(filename, bAsyncMode);
+    if (!succeeded)
+    {
+        return false;
+    }
+
+    char* readBuffers[CScanFile::MaxRingSlots] = {};
+    for (size_t i = 0; i < this->_ringSize; ++i)
+    {
+        readBuffers[i] = this->_buffers[i].ptr + ReadBufferOffset;
+    }
+
+    const bool initRingOk = this->_file.RingInit(readBuffers, this->_ringSize, ReadChunkSize);
+    if (!initRingOk)
+    {
+        this->_file.Close();
+        return false;
+    }
+
+    this->_bufferData = std::string_view(this->_buffers[0].ptr, 0);
+    this->_slotAcquired = false;
+    return true;
+}
+
+void CRingLineReader::Close()
+{
+    this->_file.RingClean();
+    this->_file.Close();
+}
+
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+std::optional<std::string_view> CRingLineReader::GetNextLine()
+{
+    if (this->_buffers[this->_ringSize - 1].ptr == nullptr)
+    {
+        return {};
+    }
+
+    // Find EOL:
+    size_t eolOffset = FindEol(this->_file.Stats(), this->_bufferData);
+
+    if (eolOffset == this->_bufferData.npos)
+    {
+        // EOL was not found. Make a choice between last line case and reading additional data from functor.
+
+        if (this->_bufferData.size() > MaxLogLineLength)
+        {
+            // Incomplete line is already too long
+            return {};
+        }
+
+        size_t slotIndex = 0;
+        size_t readBytes = 0;
+        const bool readCompleteOk = this->_file.RingAcquire(slotIndex, readBytes);
+        if (!readCompleteOk)
+        {
+            // Reading failed or EOF was already reached
+            return {};
+        }
+
+        CCharBuffer& nextBuffer = this->_buffers[slotIndex];
+
+        const size_t prefixLength = this->_bufferData.size();
+        assert(prefixLength <= MaxLogLineLength && "the rest of buffer is too big for moving to beginning");
+        char* const newDataBufferPtr = nextBuffer.ptr + ReadBufferOffset - prefixLength;
+
+        // don't need memmove since the whole high level algorithm will fail if buffers overlap
+        memcpy(newDataBufferPtr, this->_bufferData.data(), prefixLength);
+
+        // The rest of the current slot is copied, so worker thread can fill it again
+        if (this->_slotAcquired)
+        {
+            this->_file.RingRelease();
+        }
+        this->_slotAcquired = true;
+
+        this->_bufferData = { newDataBufferPtr, prefixLength + readBytes };
 
         if (this->_bufferData.empty())
         {
@@ -473,7 +1064,7 @@ std::optional<std::string_view> CSpinlockLineReader::GetNextLine()
 
         // Search EOL again after reading additional data:
         // I expect we read either ReadChunkSize bytes or we read the data chunk in file.
-        eolOffset = this->_bufferData.find('\n', prefixLength);
+        eolOffset = FindEol(this->_file.Stats(), this->_bufferData, prefixLength);
         if (eolOffset == this->_bufferData.npos)
         {
             if (this->_bufferData.size() > MaxLogLineLength)
@@ -484,7 +1075,7 @@ std::optional<std::string_view> CSpinlockLineReader::GetNextLine()
 
             // Found last line after reading missing data
             const std::string_view result = this->_bufferData;
-            this->_bufferData = { this->_buffer1.ptr, 0 };
+            this->_bufferData = { nextBuffer.ptr, 0 };
             assert(!result.empty() && "last line without LF should be not empty");
             return result;
         }
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "BufferPool.h"
 #include "CharBuffer.h"
 #include "ScanFile.h"
+#include "SimdSearch.h"
 
 #include <optional>    // this is STL, but it does not need exceptions
 #include <string_view> // this is STL, but it does not need exceptions
@@ -17,19 +19,37 @@ class CSyncLineReader
 public:
     CSyncLineReader();
 
-    bool Open(const wchar_t* const filename);
+    // startOffset must be a beginning of a line, see GetOffset(); allowWriters is explained in CScanFile::Open()
+    bool Open(const wchar_t* const filename, const uint64_t startOffset = 0, const bool allowWriters = false);
     void Close();
 
     // request next matching line; line may contain '\0' and may end with '\n'; return false on error or EOF
     // returned line is never empty (it contains at least one '\n' or any other character).
     std::optional<std::string_view> GetNextLine();
 
+    // file offset right after the last returned line
+    uint64_t GetOffset() const
+    {
+        return this->_readOffset - this->_bufferData.size();
+    }
+
+    bool GetFileIdentity(CScanFile::FileIdentity& identity)
+    {
+        return this->_file.GetIdentity(identity);
+    }
+
+    CScanStats& Stats()
+    {
+        return this->_file.Stats();
+    }
+
 protected:
     CScanFile        _file;
     // Buffer structure: [    rest_of_previousline|data_read_from_file  ]
     //                   [ len = MaxLogLineLength | len = ReadChunkSize ]
     CCharBuffer      _buffer;
     std::string_view _bufferData; // filled part of the buffer
+    uint64_t         _readOffset = 0; // file offset right after the data read to buffers
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -38,23 +58,61 @@ protected:
 class CAsyncLineReader
 {
 public:
-    CAsyncLineReader();
+    // retainedBufferCount > 0 enables GetNextLineRef(): consumer may hold lines from up to retainedBufferCount buffers
+    // without stopping the reader. When it holds more, Open() fails, GetNextLine() and GetNextLineRef() fail with
+    // IsBufferPoolExhausted() == true and reading continues after lines are released (e.g. by another thread).
+    CAsyncLineReader(const size_t retainedBufferCount = 0);
+    ~CAsyncLineReader();
 
-    bool Open(const wchar_t* const filename);
+    // startOffset must be a beginning of a line, see GetOffset(); allowWriters is explained in CScanFile::Open()
+    bool Open(const wchar_t* const filename, const uint64_t startOffset = 0, const bool allowWriters = false);
     void Close();
 
     // request next matching line; line may contain '\0' and may end with '\n'; return false on error or EOF
     // returned line is never empty (it contains at least one '\n' or any other character).
     std::optional<std::string_view> GetNextLine();
 
+    // the same as GetNextLine(), but the line stays valid until the reference is released (zero copy);
+    // return false if reader is created without retained buffers
+    std::optional<CLineRef> GetNextLineRef();
+
+    // the last call failed because lines of all retained buffers are held by CLineRef, it is not EOF or read error
+    bool IsBufferPoolExhausted() const
+    {
+        return this->_currentBuffer != CBufferPool::NoBuffer && this->_readingBuffer == CBufferPool::NoBuffer;
+    }
+
+    // file offset right after the last returned line
+    uint64_t GetOffset() const
+    {
+        return this->_readOffset - this->_bufferData.size();
+    }
+
+    bool GetFileIdentity(CScanFile::FileIdentity& identity)
+    {
+        return this->_file.GetIdentity(identity);
+    }
+
+    CScanStats& Stats()
+    {
+        return this->_file.Stats();
+    }
+
+protected:
+    void ReleaseReaderBuffers();
+
 protected:
     CScanFile        _file;
     // Buffer structure: [    rest_of_previousline|data_read_from_file  ]
     //                   [ len = MaxLogLineLength | len = ReadChunkSize ]
-    bool             _firstBufferIsActive = true;
-    CCharBuffer      _buffer1;
-    CCharBuffer      _buffer2;
+    // Reader holds references to the current buffer and the buffer of read operation in progress.
+    // The rest of buffers are free or held by CLineRef.
+    const size_t     _retainedBufferCount;
+    CBufferPool      _buffers;
+    size_t           _currentBuffer = CBufferPool::NoBuffer;
+    size_t           _readingBuffer = CBufferPool::NoBuffer;
     std::string_view _bufferData; // filled part of the current buffer
+    uint64_t         _readOffset = 0; // file offset right after the data read to buffers
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -63,17 +121,66 @@ protected:
 class CMappingLineReader
 {
 public:
-    bool Open(const wchar_t* const filename);
+    // prefetchWindows enables prefetching of windows ahead of the scan position and removing passed windows from working set
+    CMappingLineReader(const bool prefetchWindows = true);
+
+    // startOffset must be a beginning of a line, see GetOffset(); allowWriters is explained in CScanFile::Open()
+    bool Open(const wchar_t* const filename, const uint64_t startOffset = 0, const bool allowWriters = false);
     void Close();
 
     // request next matching line; line may contain '\0' and may end with '\n'; return false on error or EOF
     // returned line is never empty (it contains at least one '\n' or any other character).
     std::optional<std::string_view> GetNextLine();
 
+    // file offset right after the last returned line
+    uint64_t GetOffset() const
+    {
+        return this->_bufferData.data() - this->_fileView.data();
+    }
+
+    // not scanned part of the file view; it starts right after the last returned line
+    std::string_view GetBufferedData() const
+    {
+        return this->_bufferData;
+    }
+
+    // offset of the needle in the first size bytes of buffered data or npos; return false if file data is not available anymore
+    std::optional<size_t> FindInBufferedData(const CSimdSearch::Needle& needle, const size_t size);
+
+    // return the first size bytes of buffered data as one block of lines without searching their EOLs;
+    // size must be right after LF; the block is valid as long as lines returned by GetNextLine()
+    std::string_view SkipBufferedData(const size_t size)
+    {
+        const std::string_view result = this->_bufferData.substr(0, size);
+        this->_bufferData.remove_prefix(size);
+        const size_t position = this->_bufferData.data() - this->_fileView.data();
+        if (position >= this->_nextWindowPosition)
+        {
+            this->MoveWindows(position);
+        }
+        return result;
+    }
+
+    bool GetFileIdentity(CScanFile::FileIdentity& identity)
+    {
+        return this->_file.GetIdentity(identity);
+    }
+
+    CScanStats& Stats()
+    {
+        return this->_file.Stats();
+    }
+
+protected:
+    void MoveWindows(const size_t position);
+
 protected:
     CScanFile        _file;
     bool             _mappedToMemory = false;
-    std::string_view _bufferData; // filled part of the current buffer
+    const bool       _prefetchWindows;
+    size_t           _nextWindowPosition = 0; // MoveWindows() is called when scan position reaches it
+    std::string_view _fileView;
+    std::string_view _bufferData; // not scanned part of the file view
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -82,7 +189,102 @@ protected:
 class CSpinlockLineReader
 {
 public:
-    CSpinlockLineReader();
+    // placement of the parsing thread and the reading thread, see EThreadPlacement
+    // retainedBufferCount > 0 enables GetNextLineRef(); the limit of held lines is the same as in CAsyncLineReader
+    CSpinlockLineReader(const EThreadPlacement placement = EThreadPlacement::Default, const size_t retainedBufferCount = 0);
+    ~CSpinlockLineReader();
+
+    // startOffset must be a beginning of a line, see GetOffset(); allowWriters is explained in CScanFile::Open()
+    bool Open(const wchar_t* const filename, const uint64_t startOffset = 0, const bool allowWriters = false);
+    void Close();
+
+    // request next matching line; line may contain '\0' and may end with '\n'; return false on error or EOF
+    // returned line is never empty (it contains at least one '\n' or any other character).
+    std::optional<std::string_view> GetNextLine();
+
+    // the same as GetNextLine(), but the line stays valid until the reference is released (zero copy);
+    // return false if reader is created without retained buffers
+    std::optional<CLineRef> GetNextLineRef();
+
+    // the last call failed because lines of all retained buffers are held by CLineRef, it is not EOF or read error
+    bool IsBufferPoolExhausted() const
+    {
+        return this->_currentBuffer != CBufferPool::NoBuffer && this->_readingBuffer == CBufferPool::NoBuffer;
+    }
+
+    // actually applied placement; Default if requested placement is impossible on this machine
+    EThreadPlacement GetThreadPlacement() const
+    {
+        return this->_file.GetSpinlockThreadPlacement();
+    }
+
+    // file offset right after the last returned line
+    uint64_t GetOffset() const
+    {
+        return this->_readOffset - this->_bufferData.size();
+    }
+
+    // data of the current buffer after the last returned line; lines which are not complete in it are read by GetNextLine()
+    std::string_view GetBufferedData() const
+    {
+        return this->_bufferData;
+    }
+
+    // offset of the needle in the first size bytes of buffered data or npos
+    std::optional<size_t> FindInBufferedData(const CSimdSearch::Needle& needle, const size_t size)
+    {
+        const char* const found = CSimdSearch::FindNeedle(this->_bufferData.data(), size, needle);
+        return found != nullptr ? found - this->_bufferData.data() : this->_bufferData.npos;
+    }
+
+    // the same as CMappingLineReader::SkipBufferedData()
+    std::string_view SkipBufferedData(const size_t size)
+    {
+        const std::string_view result = this->_bufferData.substr(0, size);
+        this->_bufferData.remove_prefix(size);
+        return result;
+    }
+
+    bool GetFileIdentity(CScanFile::FileIdentity& identity)
+    {
+        return this->_file.GetIdentity(identity);
+    }
+
+    CScanStats& Stats()
+    {
+        return this->_file.Stats();
+    }
+
+protected:
+    void ReleaseReaderBuffers();
+
+protected:
+    const EThreadPlacement _placement;
+    CScanFile        _file;
+    // Buffer structure: [    rest_of_previousline|data_read_from_file  ]
+    //                   [ len = MaxLogLineLength | len = ReadChunkSize ]
+    // Reader holds references to the current buffer and the buffer of read operation in progress.
+    // The rest of buffers are free or held by CLineRef.
+    const size_t     _retainedBufferCount;
+    CBufferPool      _buffers;
+    size_t           _currentBuffer = CBufferPool::NoBuffer;
+    size_t           _readingBuffer = CBufferPool::NoBuffer;
+    std::string_view _bufferData; // filled part of the current buffer
+    uint64_t         _readOffset = 0; // file offset right after the data read to buffers
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+// Implementation with a queue of async calls to ReadFile() on a file opened with FILE_FLAG_NO_BUFFERING.
+// It is intended for cold cache scans of huge files: data bypasses system file cache and does not evict hot pages of other processes.
+class CUnbufferedLineReader
+{
+public:
+    static const size_t QueueDepth = 4; // number of buffers; QueueDepth - 1 reads are in progress while one buffer is parsed
+    static_assert(QueueDepth - 1 <= CScanFile::MaxQueuedReads);
+
+public:
+    CUnbufferedLineReader();
 
     bool Open(const wchar_t* const filename);
     void Close();
@@ -91,13 +293,61 @@ public:
     // returned line is never empty (it contains at least one '\n' or any other character).
     std::optional<std::string_view> GetNextLine();
 
+    // false if file system sector size does not fit buffer alignment and usual buffered reading is used
+    bool IsUnbuffered() const
+    {
+        return this->_unbuffered;
+    }
+
+    CScanStats& Stats()
+    {
+        return this->_file.Stats();
+    }
+
+protected:
+    CScanFile        _file;
+    bool             _unbuffered = false;
+    // Buffer structure: [    rest_of_previousline|data_read_from_file  ]
+    //                   [ len = MaxLogLineLength | len = ReadChunkSize ]
+    // data is read to sector aligned address with sector aligned length and file offset
+    size_t           _activeBuffer = 0;
+    CCharBuffer      _buffers[QueueDepth];
+    std::string_view _bufferData; // filled part of the current buffer
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+// Implementation with a ring of buffers filled by a separate thread; the thread stays up to ringSize - 1 chunks ahead of parsing.
+// Bigger ring smooths slow reads on cold cache; 2 buffers (the same as CSpinlockLineReader) are usually enough on warm cache.
+class CRingLineReader
+{
+public:
+    static const size_t DefaultRingSize = 4;
+
+public:
+    // ringSize is limited to [2, CScanFile::MaxRingSlots]
+    CRingLineReader(const size_t ringSize = DefaultRingSize);
+
+    bool Open(const wchar_t* const filename);
+    void Close();
+
+    // request next matching line; line may contain '\0' and may end with '\n'; return false on error or EOF
+    // returned line is never empty (it contains at least one '\n' or any other character).
+    std::optional<std::string_view> GetNextLine();
+
+    CScanStats& Stats()
+    {
+        return this->_file.Stats();
+    }
+
 protected:
     CScanFile        _file;
     // Buffer structure: [    rest_of_previousline|data_read_from_file  ]
     //                   [ len = MaxLogLineLength | len = ReadChunkSize ]
-    bool             _firstBufferIsActive = true;
-    CCharBuffer      _buffer1;
-    CCharBuffer      _buffer2;
+    // rest of the previous line is copied to the next slot before the current slot is released
+    const size_t     _ringSize;
+    bool             _slotAcquired = false;
+    CCharBuffer      _buffers[CScanFile::MaxRingSlots];
     std::string_view _bufferData; // filled part of the current buffer
 };
 
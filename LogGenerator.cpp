@@ -0,0 +1,386 @@
+#include "LogGenerator.h"
+
+#include "FnMatch.h"
+
+#include <assert.h>
+#include <string.h>
+
+
+namespace
+{
+    const size_t MaxLineLength = 1022; // without EOL, so CRLF line still fits into MaxLogLineLength from LineReader.cpp
+    const size_t LineBufferSize = MaxLineLength + 2;
+    const unsigned MaxAttemptsPerLine = 64;
+
+    const char* const Words[] = {
+        "request", "session", "user", "cache", "miss", "hit", "timeout", "retry", "connection", "pool",
+        "query", "index", "shard", "upstream", "backend", "token", "refresh", "payload", "bytes", "latency",
+        "id", "order", "item", "cart", "checkout", "page", "lang", "en-US", "utm_source", "mobile",
+    };
+    const char* const Methods[] = { "GET", "GET", "GET", "GET", "POST", "POST", "PUT", "DELETE", "HEAD" };
+    const char* const Paths[] = {
+        "/", "/index.html", "/api/v1/items", "/api/v1/users", "/api/v2/orders", "/static/js/app.js",
+        "/static/css/site.css", "/images/logo.png", "/login", "/search", "/favicon.ico",
+    };
+    const unsigned Statuses[] = { 200, 200, 200, 200, 200, 200, 304, 304, 301, 404, 500, 502 };
+    const char* const Agents[] = {
+        "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/96.0.4664.45 Safari/537.36",
+        "Mozilla/5.0 (X11; Linux x86_64; rv:94.0) Gecko/20100101 Firefox/94.0",
+        "Mozilla/5.0 (iPhone; CPU iPhone OS 15_1 like Mac OS X) AppleWebKit/605.1.15 (KHTML, like Gecko) Mobile/15E148",
+        "curl/7.79.1",
+        "Googlebot/2.1 (+http://www.google.com/bot.html)",
+    };
+    const char* const Levels[] = { "DEBUG", "INFO ", "INFO ", "INFO ", "INFO ", "WARN ", "ERROR" };
+    const char* const Components[] = { "http.server", "db.pool", "cache", "scheduler", "auth", "storage", "mailer" };
+    const char* const Months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+    template <size_t N>
+    constexpr size_t CountOf(const char* const (&)[N])
+    {
+        return N;
+    }
+
+    size_t DigitCount(unsigned value)
+    {
+        size_t count = 1;
+        while (value >= 10)
+        {
+            value /= 10;
+            ++count;
+        }
+        return count;
+    }
+
+    // Probability is converted to integer threshold once, so the result does not depend on floating point rounding later
+    bool RateToThreshold(const double rate, uint64_t& threshold)
+    {
+        if (!(rate >= 0.0 && rate <= 1.0))
+        {
+            return false;
+        }
+        threshold = rate >= 1.0 ? UINT64_MAX : static_cast<uint64_t>(rate * 18446744073709551616.0);
+        return true;
+    }
+}
+
+
+bool CLogGenerator::Init(const Options& options)
+{
+    this->_options = options;
+    this->_hasPattern = false;
+    this->_totalWeight = 0;
+
+    if (options.lengthBucketCount == 0 || options.lengthBucketCount > MaxLengthBuckets)
+    {
+        return false;
+    }
+
+    size_t previousMaxLength = 0;
+    for (size_t i = 0; i < options.lengthBucketCount; ++i)
+    {
+        const LineLengthBucket& bucket = options.lengthBuckets[i];
+        if (bucket.maxLength <= previousMaxLength || bucket.maxLength > MaxLineLength)
+        {
+            return false;
+        }
+        previousMaxLength = bucket.maxLength;
+        this->_totalWeight += bucket.weight;
+    }
+    if (this->_totalWeight == 0)
+    {
+        return false;
+    }
+
+    if (!RateToThreshold(options.matchRate, this->_matchThreshold) ||
+        !RateToThreshold(options.crlfRate, this->_crlfThreshold) ||
+        !RateToThreshold(options.nullCharRate, this->_nullCharThreshold))
+    {
+        return false;
+    }
+
+    if (options.matchPattern != nullptr)
+    {
+        const size_t patternLen = strlen(options.matchPattern);
+        size_t fixedLength = 0;
+        for (size_t i = 0; i < patternLen; ++i)
+        {
+            fixedLength += options.matchPattern[i] != '*' ? 1 : 0;
+        }
+        if (fixedLength > MaxLineLength || !this->_pattern.Allocate(patternLen))
+        {
+            return false;
+        }
+        memcpy(this->_pattern.ptr, options.matchPattern, patternLen);
+        this->_hasPattern = true;
+    }
+    this->_options.matchPattern = nullptr; // use own copy only
+
+    if (!this->_line.Allocate(LineBufferSize))
+    {
+        return false;
+    }
+
+    this->_state = options.seed;
+    this->_clockSeconds = 0;
+    this->_generatedLines = 0;
+    this->_matchedLines = 0;
+    this->_lineLength = 0;
+    return true;
+}
+
+std::string_view CLogGenerator::NextLine()
+{
+    if (this->_line.ptr == nullptr)
+    {
+        return {};
+    }
+
+    const std::string_view pattern = { this->_pattern.ptr, this->_pattern.size };
+    const bool shouldMatch = this->_hasPattern && this->NextChance(this->_matchThreshold);
+
+    this->_clockSeconds += this->NextRandom(3) == 0 ? 1 : 0;
+
+    bool generated = false;
+    for (unsigned attempt = 0; attempt < MaxAttemptsPerLine && !generated; ++attempt)
+    {
+        // Timestamp itself can match the pattern (e.g. "*16:01 *" vs "00:16:01 +0000"), so step the clock forward on retry.
+        // Clock never goes back, so timestamps stay monotonic.
+        this->_clockSeconds += attempt != 0 ? 1 : 0;
+
+        const size_t length = this->ChooseLineLength();
+        if (shouldMatch)
+        {
+            this->GeneratePatternLine(length);
+        }
+        else
+        {
+            this->GenerateRegularLine(length);
+        }
+
+        if (this->_lineLength > 0 && this->NextChance(this->_nullCharThreshold))
+        {
+            this->_line.ptr[this->NextRandom(this->_lineLength)] = '\0';
+        }
+
+        generated = !this->_hasPattern || CFnMatch::Match({ this->_line.ptr, this->_lineLength }, pattern) == shouldMatch;
+    }
+
+    if (!generated)
+    {
+        // Pattern makes requested line kind impossible (for example "*" and non-matching line)
+        return {};
+    }
+
+    assert(this->_lineLength <= MaxLineLength);
+    if (this->NextChance(this->_crlfThreshold))
+    {
+        this->_line.ptr[this->_lineLength++] = '\r';
+    }
+    this->_line.ptr[this->_lineLength++] = '\n';
+
+    ++this->_generatedLines;
+    this->_matchedLines += shouldMatch ? 1 : 0;
+    return { this->_line.ptr, this->_lineLength };
+}
+
+uint64_t CLogGenerator::NextRandom()
+{
+    // SplitMix64: tiny, fast and good enough for test data
+    uint64_t z = (this->_state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+size_t CLogGenerator::NextRandom(const size_t bound)
+{
+    assert(bound > 0);
+    return static_cast<size_t>(this->NextRandom() % bound);
+}
+
+bool CLogGenerator::NextChance(const uint64_t threshold)
+{
+    const uint64_t value = this->NextRandom();
+    return threshold == UINT64_MAX || value < threshold;
+}
+
+size_t CLogGenerator::ChooseLineLength()
+{
+    size_t weight = this->NextRandom(this->_totalWeight);
+    size_t minLength = 1;
+    for (size_t i = 0; i < this->_options.lengthBucketCount; ++i)
+    {
+        const LineLengthBucket& bucket = this->_options.lengthBuckets[i];
+        if (weight < bucket.weight)
+        {
+            return minLength + this->NextRandom(bucket.maxLength - minLength + 1);
+        }
+        weight -= bucket.weight;
+        minLength = bucket.maxLength + 1;
+    }
+    assert(false && "weights are validated in Init()");
+    return minLength;
+}
+
+void CLogGenerator::AppendText(const std::string_view text)
+{
+    const size_t length = text.size() < MaxLineLength - this->_lineLength ? text.size() : MaxLineLength - this->_lineLength;
+    memcpy(this->_line.ptr + this->_lineLength, text.data(), length);
+    this->_lineLength += length;
+}
+
+void CLogGenerator::AppendNumber(const unsigned value, const size_t minDigits)
+{
+    char digits[16] = {};
+    size_t count = 0;
+    unsigned rest = value;
+    do
+    {
+        digits[sizeof(digits) - 1 - count++] = static_cast<char>('0' + rest % 10);
+        rest /= 10;
+    } while (rest != 0 || count < minDigits);
+    this->AppendText({ digits + sizeof(digits) - count, count });
+}
+
+void CLogGenerator::AppendFiller(const size_t length)
+{
+    const size_t endLength = this->_lineLength + length < MaxLineLength ? this->_lineLength + length : MaxLineLength;
+    while (this->_lineLength < endLength)
+    {
+        if (this->_lineLength + 1 < endLength)
+        {
+            this->AppendText(" ");
+        }
+        const std::string_view word = Words[this->NextRandom(CountOf(Words))];
+        this->AppendText(word.substr(0, endLength - this->_lineLength));
+    }
+}
+
+void CLogGenerator::GenerateRegularLine(const size_t length)
+{
+    this->_lineLength = 0;
+
+    const unsigned secondOfDay = static_cast<unsigned>(this->_clockSeconds % 86400);
+    const unsigned dayIndex = static_cast<unsigned>(this->_clockSeconds / 86400);
+    const unsigned day = 1 + dayIndex % 28;
+    const unsigned month = (9 + dayIndex / 28) % 12; // start from October
+    const unsigned year = 2021 + (9 + dayIndex / 28) / 12;
+
+    if (this->_options.style == ELogStyle::Access)
+    {
+        // 10.1.2.3 - - [19/Oct/2021:16:01:02 +0000] "GET /api/v1/items?id=42 HTTP/1.1" 200 5123 "-" "curl/7.79.1"
+        this->AppendNumber(10, 1);
+        for (int i = 0; i < 3; ++i)
+        {
+            this->AppendText(".");
+            this->AppendNumber(static_cast<unsigned>(this->NextRandom(256)), 1);
+        }
+        this->AppendText(" - - [");
+        this->AppendNumber(day, 2);
+        this->AppendText("/");
+        this->AppendText(Months[month]);
+        this->AppendText("/");
+        this->AppendNumber(year, 4);
+        this->AppendText(":");
+        this->AppendNumber(secondOfDay / 3600, 2);
+        this->AppendText(":");
+        this->AppendNumber(secondOfDay / 60 % 60, 2);
+        this->AppendText(":");
+        this->AppendNumber(secondOfDay % 60, 2);
+        this->AppendText(" +0000] \"");
+        this->AppendText(Methods[this->NextRandom(CountOf(Methods))]);
+        this->AppendText(" ");
+        this->AppendText(Paths[this->NextRandom(CountOf(Paths))]);
+        this->AppendText("?id=");
+        this->AppendNumber(static_cast<unsigned>(this->NextRandom(100000)), 1);
+
+        // Tail goes after the filler which stretches the query string to requested line length
+        const unsigned status = Statuses[this->NextRandom(sizeof(Statuses) / sizeof(Statuses[0]))];
+        const unsigned size = static_cast<unsigned>(this->NextRandom(200000));
+        const std::string_view agent = Agents[this->NextRandom(CountOf(Agents))];
+        const size_t tailLength = 11 + 3 + 1 + DigitCount(size) + 6 + agent.size() + 1; // ' HTTP/1.1" 200 5123 "-" "agent"'
+
+        while (this->_lineLength + tailLength < length)
+        {
+            this->AppendText("&");
+            this->AppendText(Words[this->NextRandom(CountOf(Words))]);
+            this->AppendText("=");
+            this->AppendNumber(static_cast<unsigned>(this->NextRandom(1000)), 1);
+        }
+
+        this->AppendText(" HTTP/1.1\" ");
+        this->AppendNumber(status, 3);
+        this->AppendText(" ");
+        this->AppendNumber(size, 1);
+        this->AppendText(" \"-\" \"");
+        this->AppendText(agent);
+        this->AppendText("\"");
+    }
+    else
+    {
+        // 2021-10-19 16:01:02.123 INFO  [worker-3] cache: request session miss ...
+        this->AppendNumber(year, 4);
+        this->AppendText("-");
+        this->AppendNumber(month + 1, 2);
+        this->AppendText("-");
+        this->AppendNumber(day, 2);
+        this->AppendText(" ");
+        this->AppendNumber(secondOfDay / 3600, 2);
+        this->AppendText(":");
+        this->AppendNumber(secondOfDay / 60 % 60, 2);
+        this->AppendText(":");
+        this->AppendNumber(secondOfDay % 60, 2);
+        this->AppendText(".");
+        this->AppendNumber(static_cast<unsigned>(this->NextRandom(1000)), 3);
+        this->AppendText(" ");
+        this->AppendText(Levels[this->NextRandom(CountOf(Levels))]);
+        this->AppendText(" [worker-");
+        this->AppendNumber(static_cast<unsigned>(this->NextRandom(16)), 1);
+        this->AppendText("] ");
+        this->AppendText(Components[this->NextRandom(CountOf(Components))]);
+        this->AppendText(":");
+        if (this->_lineLength < length)
+        {
+            this->AppendFiller(length - this->_lineLength);
+        }
+    }
+
+    if (this->_lineLength > length)
+    {
+        this->_lineLength = length;
+    }
+}
+
+void CLogGenerator::GeneratePatternLine(const size_t length)
+{
+    this->_lineLength = 0;
+
+    const std::string_view pattern = { this->_pattern.ptr, this->_pattern.size };
+    size_t asterisks = 0;
+    for (const char ch : pattern)
+    {
+        asterisks += ch == '*' ? 1 : 0;
+    }
+    const size_t fixedLength = pattern.size() - asterisks;
+    size_t fillerLeft = length > fixedLength ? length - fixedLength : 0;
+
+    for (const char ch : pattern)
+    {
+        if (ch == '*')
+        {
+            --asterisks;
+            const size_t filler = asterisks == 0 ? fillerLeft : this->NextRandom(fillerLeft + 1);
+            this->AppendFiller(filler);
+            fillerLeft -= filler;
+        }
+        else if (ch == '?')
+        {
+            const char any = static_cast<char>('a' + this->NextRandom(26));
+            this->AppendText({ &any, 1 });
+        }
+        else
+        {
+            this->AppendText({ &ch, 1 });
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "CharBuffer.h"
+
+#include <string_view> // this is STL, but it does not need exceptions
+
+#include <stdint.h>
+#include <wchar.h> // for size_t
+
+
+// Deterministic generator of synthetic log files for tests and benchmarks.
+// The same options (including seed) always produce byte-to-byte identical output on any machine:
+// own PRNG is used instead of <random> distributions which differ between STL implementations.
+class CLogGenerator
+{
+public:
+    enum class ELogStyle
+    {
+        Access, // web server access log (Apache/nginx "combined" format)
+        App,    // application log: timestamp, level, thread, component, message
+    };
+
+    struct LineLengthBucket
+    {
+        size_t   maxLength; // bucket covers lengths (previous bucket maxLength, maxLength]; EOL is not counted
+        unsigned weight;    // relative probability of the bucket
+    };
+
+    static const size_t MaxLengthBuckets = 16;
+
+    // Default histogram is close to the 2 GB web server log described in docs/implementation-notes-letter.md:
+    // average line length is near to 380 bytes, all lines fit into 1024 bytes including EOL.
+    struct Options
+    {
+        uint64_t         seed = 1;
+        ELogStyle        style = ELogStyle::Access;
+
+        LineLengthBucket lengthBuckets[MaxLengthBuckets] = { {120, 15}, {300, 30}, {500, 37}, {800, 15}, {1022, 3} };
+        size_t           lengthBucketCount = 5;
+
+        // Share of lines matching matchPattern (CFnMatch syntax, EOL is not a part of matched text).
+        // All other lines are guaranteed to not match the pattern. Pattern is copied by Init().
+        const char*      matchPattern = nullptr;
+        double           matchRate = 0.0;
+
+        double           crlfRate = 0.0;     // share of lines ending with CRLF instead of LF
+        double           nullCharRate = 0.0; // share of lines containing single '\0' character
+    };
+
+public:
+    // return false on invalid options
+    bool Init(const Options& options);
+
+    // generate next line including EOL; view is valid until the next call; return empty view on error
+    // error is possible when pattern makes it impossible to generate a matching or non-matching line
+    std::string_view NextLine();
+
+    uint64_t GetGeneratedLines() const
+    {
+        return this->_generatedLines;
+    }
+
+    uint64_t GetMatchedLines() const
+    {
+        return this->_matchedLines;
+    }
+
+protected:
+    uint64_t NextRandom();
+    size_t   NextRandom(const size_t bound); // [0, bound)
+    bool     NextChance(const uint64_t threshold);
+
+    size_t   ChooseLineLength();
+    void     AppendText(const std::string_view text);
+    void     AppendNumber(const unsigned value, const size_t minDigits);
+    void     AppendFiller(const size_t length);
+    void     GenerateRegularLine(const size_t length);
+    void     GeneratePatternLine(const size_t length);
+
+protected:
+    Options     _options;
+    CCharBuffer _pattern;
+    bool        _hasPattern        = false;
+    uint64_t    _matchThreshold    = 0;
+    uint64_t    _crlfThreshold     = 0;
+    uint64_t    _nullCharThreshold = 0;
+    unsigned    _totalWeight       = 0;
+
+    uint64_t    _state             = 0;
+    uint64_t    _clockSeconds      = 0;
+    uint64_t    _generatedLines    = 0;
+    uint64_t    _matchedLines      = 0;
+
+    // Line structure: [ line text | EOL ]; capacity is MaxLineLength + 2
+    CCharBuffer _line;
+    size_t      _lineLength        = 0;
+};
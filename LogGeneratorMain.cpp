@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <wchar.h>
+
+#include <atlcomcli.h>
+
+#include "LogGenerator.h"
+
+
+namespace
+{
+    const size_t OutputBufferSize = 1024 * 1024;
+
+    bool ParseSize(const wchar_t* const text, uint64_t& size)
+    {
+        wchar_t* end = nullptr;
+        const uint64_t value = wcstoull(text, &end, 10);
+        if (end == text)
+        {
+            return false;
+        }
+        uint64_t multiplier = 1;
+        if (*end == L'K' || *end == L'k')
+        {
+            multiplier = 1024ull;
+            ++end;
+        }
+        else if (*end == L'M' || *end == L'm')
+        {
+            multiplier = 1024ull * 1024;
+            ++end;
+        }
+        else if (*end == L'G' || *end == L'g')
+        {
+            multiplier = 1024ull * 1024 * 1024;
+            ++end;
+        }
+        size = value * multiplier;
+        return *end == L'\0';
+    }
+
+    bool ParseRate(const wchar_t* const text, double& rate)
+    {
+        wchar_t* end = nullptr;
+        rate = wcstod(text, &end);
+        return end != text && *end == L'\0' && rate >= 0.0 && rate <= 1.0;
+    }
+
+    // return option value if argument looks like "--name=value"
+    const wchar_t* GetOptionValue(const wchar_t* const arg, const wchar_t* const name)
+    {
+        const size_t nameLen = wcslen(name);
+        if (wcsncmp(arg, name, nameLen) != 0 || arg[nameLen] != L'=')
+        {
+            return nullptr;
+        }
+        return arg + nameLen + 1;
+    }
+
+    void PrintUsage()
+    {
+        fwprintf(stderr, L"Usage:\n");
+        fwprintf(stderr, L"LogGenerator.exe <filename> <size>[K|M|G] [options]\n");
+        fwprintf(stderr, L"Options:\n");
+        fwprintf(stderr, L"  --seed=<number>        PRNG seed, the same seed gives the same file (default: 1)\n");
+        fwprintf(stderr, L"  --style=access|app     web server access log or application log (default: access)\n");
+        fwprintf(stderr, L"  --pattern=<pattern>    pattern to control match rate for\n");
+        fwprintf(stderr, L"  --match-rate=<0..1>    share of lines matching the pattern, the rest never match it\n");
+        fwprintf(stderr, L"  --crlf-rate=<0..1>     share of lines ending with CRLF\n");
+        fwprintf(stderr, L"  --null-rate=<0..1>     share of lines containing '\\0' character\n");
+        fwprintf(stderr, L"Example:\n");
+        fwprintf(stderr, L"LogGenerator.exe 2000m.txt 2000M --pattern=\"*16:01 *\" --match-rate=0.0003\n");
+    }
+}
+
+
+int wmain(const int argc, const wchar_t* const argv[])
+{
+    if (argc <= 2)
+    {
+        fwprintf(stderr, L"Error! Not enough command line arguments!\n");
+        PrintUsage();
+        return 1;
+    }
+
+    const wchar_t* const fileName = argv[1];
+    uint64_t totalSize = 0;
+    if (!ParseSize(argv[2], totalSize))
+    {
+        fwprintf(stderr, L"Error! Invalid size: \"%ws\"\n", argv[2]);
+        return 1;
+    }
+
+    CLogGenerator::Options options;
+    const wchar_t* patternArg = nullptr;
+
+    for (int i = 3; i < argc; ++i)
+    {
+        const wchar_t* const arg = argv[i];
+        const wchar_t* value = nullptr;
+        bool valid = true;
+
+        if ((value = GetOptionValue(arg, L"--seed")) != nullptr)
+        {
+            wchar_t* end = nullptr;
+            options.seed = wcstoull(value, &end, 10);
+            valid = end != value && *end == L'\0';
+        }
+        else if ((value = GetOptionValue(arg, L"--style")) != nullptr)
+        {
+            valid = wcscmp(value, L"access") == 0 || wcscmp(value, L"app") == 0;
+            options.style = wcscmp(value, L"app") == 0 ? CLogGenerator::ELogStyle::App : CLogGenerator::ELogStyle::Access;
+        }
+        else if ((value = GetOptionValue(arg, L"--pattern")) != nullptr)
+        {
+            patternArg = value;
+        }
+        else if ((value = GetOptionValue(arg, L"--match-rate")) != nullptr)
+        {
+            valid = ParseRate(value, options.matchRate);
+        }
+        else if ((value = GetOptionValue(arg, L"--crlf-rate")) != nullptr)
+        {
+            valid = ParseRate(value, options.crlfRate);
+        }
+        else if ((value = GetOptionValue(arg, L"--null-rate")) != nullptr)
+        {
+            valid = ParseRate(value, options.nullCharRate);
+        }
+        else
+        {
+            valid = false;
+        }
+
+        if (!valid)
+        {
+            fwprintf(stderr, L"Error! Invalid option: \"%ws\"\n", arg);
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    const CW2A pattern(patternArg != nullptr ? patternArg : L"");
+    if (patternArg != nullptr)
+    {
+        options.matchPattern = pattern;
+    }
+
+    CLogGenerator generator;
+    if (!generator.Init(options))
+    {
+        fwprintf(stderr, L"Error! Invalid generator options\n");
+        return 1;
+    }
+
+    FILE* file = nullptr;
+    if (_wfopen_s(&file, fileName, L"wb") != 0 || file == nullptr)
+    {
+        fwprintf(stderr, L"Error! Failed to create file: \"%ws\"\n", fileName);
+        return 2;
+    }
+    setvbuf(file, nullptr, _IOFBF, OutputBufferSize);
+
+    uint64_t writtenSize = 0;
+    bool succeeded = true;
+    while (writtenSize < totalSize)
+    {
+        const std::string_view line = generator.NextLine();
+        if (line.empty())
+        {
+            fwprintf(stderr, L"Error! Pattern does not allow to generate requested lines\n");
+            succeeded = false;
+            break;
+        }
+        if (fwrite(line.data(), line.size(), 1, file) != 1)
+        {
+            fwprintf(stderr, L"Error! Failed to write file: \"%ws\"\n", fileName);
+            succeeded = false;
+            break;
+        }
+        writtenSize += line.size();
+    }
+
+    if (fclose(file) != 0)
+    {
+        succeeded = false;
+    }
+    if (!succeeded)
+    {
+        return 2;
+    }
+
+    fwprintf(stderr, L"Generated %llu bytes, %llu lines, %llu matching lines\n",
+        writtenSize, generator.GetGeneratedLines(), generator.GetMatchedLines());
+    return 0;
+}
@@ -1,20 +1,76 @@
 #include "LogReader.h"
 
+#include "SimdSearch.h"
 
-bool CLogReader::Open(const wchar_t* const filename)
+
+namespace
+{
+    const size_t MaxLogLineLength = 1024; // including ending LF/CRLF; the same value as in LineReader.cpp
+    const uint32_t CheckpointTailLength = MaxLogLineLength;
+
+    const size_t MinPrefilterLiteralLength = 2; // Match() searches a literal after '*' by the same kernel, a single character gains nothing
+    const size_t MaxPrefilterHitRatio = 2;      // prefilter is used when at most 1/2 of sampled lines contain the literal
+    const size_t MinRareLiteralRatio = 8;       // literal is rare when at most 1/8 of sampled lines contain it
+    const size_t MinLiteralSetGain = 2;         // all literals prefilter rejects at least 2x more lines than the longest literal one
+    const size_t MaxLineBlockSize = 1024 * 1024;  // block is close to the scan position: mapping windows behind it are discarded
+    const uint64_t MaxMappedFileSize = sizeof(void*) >= 8 ? UINT64_MAX : 512 * 1024 * 1024; // address space of 32-bit process is small
+
+    // FNV-1a; hash of the previous bytes continues the hash
+    uint64_t HashBytes(const char* const data, const size_t size, uint64_t hash = 14695981039346656037ull)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+        }
+        return hash;
+    }
+}
+
+
+bool CLogReader::Open(const wchar_t* const filename, const bool allowWriters)
 {
     this->Close();
 
-    const bool succeeded = this->_lineReader.Open(filename);
+    if (filename == nullptr || !this->_filename.Allocate((wcslen(filename) + 1) * sizeof(wchar_t), alignof(wchar_t)))
+    {
+        return false;
+    }
+    memcpy(this->_filename.ptr, filename, this->_filename.size);
+    this->_allowWriters = allowWriters;
+    this->_incompleteLineLength = 0;
+    this->_plan = ScanPlan();
+
+    // line reader is opened when the filter is known
+    const bool succeeded = this->ReadSample();
+    if (!succeeded)
+    {
+        this->_filename.Free();
+    }
     return succeeded;
 }
 
 void CLogReader::Close()
 {
-    this->_lineReader.Close();
+    // scan plan is kept: it tells which reader has the stats of the last scan
+    this->_mappingReader.Close();
+    this->_pipelinedReader.Close();
+    this->_filename.Free();
 }
 
 bool CLogReader::SetFilter(const char* const filter)
+{
+    this->_fieldMode = false;
+    return this->ApplyFilter(filter);
+}
+
+bool CLogReader::SetFieldFilter(const char* const filter, const CFieldFilter::Layout& layout)
+{
+    this->_fieldMode = true;
+    this->_fieldLayout = layout;
+    return this->ApplyFilter(filter);
+}
+
+bool CLogReader::ApplyFilter(const char* const filter)
 {
     if (filter == nullptr)
     {
@@ -29,24 +85,154 @@ bool CLogReader::SetFilter(const char* const filter)
     }
 
     memcpy(this->_pattern.ptr, filter, patternLen);
+    this->_staticMatch = nullptr;
 
-    return true;
+    if (!this->UpdateScanPlan())
+    {
+        return false;
+    }
+    if (this->_filename.ptr == nullptr || this->_plan.reader != EReader::None)
+    {
+        return true;
+    }
+    return this->OpenLineReader(0);
 }
 
 __declspec(noinline) // noinline is added to help CPU profiling in release version
 std::optional<std::string_view> CLogReader::GetNextLine()
 {
-    const std::string_view pattern = { this->_pattern.ptr, this->_pattern.size };
+    switch (this->_plan.reader)
+    {
+    case EReader::Mapping:
+        return this->GetNextMatchingLine(this->_mappingReader);
+    case EReader::Pipelined:
+        return this->GetNextMatchingLine(this->_pipelinedReader);
+    default:
+        break;
+    }
+
+    // SetFilter() was not called after Open()
+    if (this->_filename.ptr == nullptr)
+    {
+        return {};
+    }
+    if (!this->UpdateScanPlan() || !this->OpenLineReader(0))
+    {
+        return {};
+    }
+    return this->GetNextLine();
+}
+
+bool CLogReader::Aggregate(CAggregator& aggregator)
+{
+    while (true)
+    {
+        const auto line = this->GetNextLine();
+        if (!line)
+        {
+            return true;
+        }
+        if (!aggregator.Add(*line))
+        {
+            return false;
+        }
+    }
+}
+
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+std::optional<std::string_view> CLogReader::GetNextLines()
+{
+    switch (this->_plan.reader)
+    {
+    case EReader::Mapping:
+        return this->GetNextLineBlock(this->_mappingReader);
+    case EReader::Pipelined:
+        return this->GetNextLineBlock(this->_pipelinedReader);
+    default:
+        break;
+    }
+
+    // the line reader is opened by the first line
+    return this->GetNextLine();
+}
+
+template <class TLineReader>
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+std::optional<std::string_view> CLogReader::GetNextLineBlock(TLineReader& lineReader)
+{
+    // longest literal is known only for patterns: lines of expressions and field filters are matched one by one
+    if (!this->_inverted || this->_plan.pattern.longestLiteral.empty())
+    {
+        return this->GetNextMatchingLine(lineReader);
+    }
+
+    // Lines before the line with the literal can't match. Without the literal in the searched data
+    // the block ends with its last complete line.
+    const std::string_view data = lineReader.GetBufferedData();
+    const size_t searchSize = data.size() < MaxLineBlockSize ? data.size() : MaxLineBlockSize;
+    const auto literal = lineReader.FindInBufferedData(this->_literalNeedle, searchSize);
+    if (!literal)
+    {
+        // error
+        return {};
+    }
+    const char* blockEnd = data.data() + (*literal != data.npos ? *literal : searchSize);
+    while (blockEnd != data.data() && blockEnd[-1] != '\n')
+    {
+        --blockEnd;
+    }
+
+    // Lines are checked like GetNextLine() of the line reader checks them: the block ends before a too long line,
+    // so the output does not depend on the path
+    const char* lineStart = data.data();
+    size_t lineCount = 0;
+    while (lineStart != blockEnd)
+    {
+        // never nullptr: the block ends with LF
+        const char* const eol = CSimdSearch::FindChar(lineStart, blockEnd - lineStart, '\n');
+        if (static_cast<size_t>(eol - lineStart) + 1 > MaxLogLineLength)
+        {
+            break;
+        }
+        lineStart = eol + 1;
+        ++lineCount;
+    }
+    blockEnd = lineStart;
+    if (blockEnd == data.data())
+    {
+        // the line with the literal, the line which is not in memory yet or the too long line
+        return this->GetNextMatchingLine(lineReader);
+    }
+
+    SCAN_STATS_ADD(lineReader.Stats(), lines, lineCount);
+    SCAN_STATS_ADD(lineReader.Stats(), matchedLines, lineCount);
+    SCAN_STATS_BYTES(lineReader.Stats(), EScanStage::Split, blockEnd - data.data());
+    this->_incompleteLineLength = 0;
+    return lineReader.SkipBufferedData(blockEnd - data.data());
+}
+
+template <class TLineReader>
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+std::optional<std::string_view> CLogReader::GetNextMatchingLine(TLineReader& lineReader)
+{
+    const EMatcher matcher = this->_plan.matcher;
+    const bool inverted = this->_inverted;
+    const CSimdSearch::Needle& literalNeedle = this->_literalNeedle;
+    const CSimdSearch::LiteralSet& literalSet = this->_literalSet;
+    const uint32_t allLiterals = literalSet.GetAllBits();
 
     while (true)
     {
-        const auto line = this->_lineReader.GetNextLine();
+        const auto line = lineReader.GetNextLine();
         if (!line)
         {
             // error or end of file
             return {};
         }
 
+        SCAN_STATS_ADD(lineReader.Stats(), lines, 1);
+        SCAN_STATS_BYTES(lineReader.Stats(), EScanStage::Split, line->size());
+
         std::string_view matchView = *line;
 
         // Ignore CRLF/LF during matching:
@@ -57,13 +243,411 @@ std::optional<std::string_view> CLogReader::GetNextLine()
             {
                 matchView.remove_suffix(1);
             }
+            this->_incompleteLineLength = 0;
+        }
+        else
+        {
+            // the very last line; the log writer may be still writing it
+            this->_incompleteLineLength = line->size();
         }
 
-        const bool matched = this->_lineMatcher.Match(matchView, pattern);
-        if (matched)
+        if (matcher == EMatcher::LiteralPrefilter && CSimdSearch::FindNeedle(matchView.data(), matchView.size(), literalNeedle) == nullptr)
+        {
+            // line can't match without the literal
+            if (inverted)
+            {
+                SCAN_STATS_ADD(lineReader.Stats(), matchedLines, 1);
+                return line;
+            }
+            continue;
+        }
+        if (matcher == EMatcher::AllLiteralsPrefilter &&
+            CSimdSearch::FindAllLiterals(matchView.data(), matchView.size(), literalSet) != allLiterals)
+        {
+            // line can't match without any of the literals
+            if (inverted)
+            {
+                SCAN_STATS_ADD(lineReader.Stats(), matchedLines, 1);
+                return line;
+            }
+            continue;
+        }
+
+        SCAN_STATS_ADD(lineReader.Stats(), matchCandidates, 1);
+        SCAN_STATS_BYTES(lineReader.Stats(), EScanStage::Match, matchView.size());
+
+        bool matched = false;
+        {
+            SCAN_STATS_SCOPE(lineReader.Stats(), EScanStage::Match);
+            switch (matcher)
+            {
+            case EMatcher::Expression:
+                matched = this->_expression.Match(matchView);
+                break;
+            case EMatcher::Fields:
+                matched = this->_fieldFilter.Match(matchView);
+                break;
+            default:
+                matched = this->_staticMatch != nullptr ? this->_staticMatch(matchView) : this->_lineMatcher.Match(matchView);
+                break;
+            }
+        }
+        if (matched != inverted)
         {
-            // line matched
+            // line matched or it did not match in the inverted mode
+            SCAN_STATS_ADD(lineReader.Stats(), matchedLines, 1);
             return line;
         }
     }
 }
+
+bool CLogReader::ReadSample()
+{
+    CScanFile file;
+    const bool asyncMode = false;
+    const bool unbufferedMode = false;
+    CScanFile::FileIdentity identity;
+    if (!file.Open(reinterpret_cast<const wchar_t*>(this->_filename.ptr), asyncMode, unbufferedMode, this->_allowWriters) ||
+        !file.GetIdentity(identity))
+    {
+        return false;
+    }
+    this->_plan.fileSize = identity.size;
+
+    if (this->_sample.ptr == nullptr && !this->_sample.Allocate(SampleSize))
+    {
+        return false;
+    }
+    return file.Read(this->_sample.ptr, SampleSize, this->_sampleSize);
+}
+
+bool CLogReader::UpdateScanPlan()
+{
+    const std::string_view pattern = { this->_pattern.ptr, this->_pattern.size };
+
+    // literals are searched by their rarest bytes in this file
+    CByteFrequency frequency;
+    frequency.Train(this->_sample.ptr, this->_sampleSize);
+    if (this->_fieldMode)
+    {
+        return this->UpdateFieldPlan(frequency);
+    }
+    if (CFilterExpression::IsExpression(pattern))
+    {
+        return this->UpdateExpressionPlan(frequency);
+    }
+
+    this->_plan.pattern = CFnMatch::Analyze(pattern);
+    const std::string_view literal = this->_plan.pattern.longestLiteral;
+    if (!this->_lineMatcher.Compile(pattern, frequency))
+    {
+        return false;
+    }
+    this->_literalNeedle = CSimdSearch::MakeNeedle(literal.data(), literal.size(), frequency);
+
+    // every literal part of the pattern is in a matching line; single characters give too many candidates
+    this->_literalSet = CSimdSearch::LiteralSet();
+    size_t literalStart = 0;
+    for (size_t i = 0; i <= pattern.size(); ++i)
+    {
+        if (i < pattern.size() && pattern[i] != '*' && pattern[i] != '?')
+        {
+            continue;
+        }
+        if (i - literalStart >= MinPrefilterLiteralLength)
+        {
+            CSimdSearch::AddLiteral(this->_literalSet, pattern.data() + literalStart, i - literalStart);
+        }
+        literalStart = i + 1;
+    }
+    const uint32_t allLiterals = this->_literalSet.GetAllBits();
+
+    // estimate selectivity on the head of the file; the last sampled line is cut unless the whole file is sampled
+    this->_plan.sampleLines = 0;
+    this->_plan.sampleLiteralHits = 0;
+    this->_plan.sampleAllLiteralsHits = 0;
+    this->_plan.sampleMatches = 0;
+    std::string_view sample = { this->_sample.ptr, this->_sampleSize };
+    std::string_view line;
+    while (this->GetNextSampleLine(sample, line))
+    {
+        ++this->_plan.sampleLines;
+        this->_plan.sampleLiteralHits += line.find(literal) != line.npos;
+        this->_plan.sampleAllLiteralsHits += CSimdSearch::FindAllLiterals(line.data(), line.size(), this->_literalSet) == allLiterals;
+        this->_plan.sampleMatches += this->_lineMatcher.Match(line);
+    }
+
+    // Prefilter pays off when most lines do not contain the literal. It is useless for the literal at the beginning
+    // of the anchored pattern: Match() compares it first anyway.
+    const bool literalIsFirst = this->_plan.pattern.anchoredStart && literal.data() == pattern.data();
+    const bool prefilter = literal.size() >= MinPrefilterLiteralLength && !literalIsFirst &&
+        this->_plan.sampleLines != 0 && this->_plan.sampleLiteralHits * MaxPrefilterHitRatio <= this->_plan.sampleLines;
+    this->_plan.matcher = prefilter ? EMatcher::LiteralPrefilter : EMatcher::Direct;
+
+    // Pattern with several literals: one pass over the line finds all of them. It pays off when lines often contain
+    // some literals, but rarely all of them.
+    const bool literalSetPrefilter = this->_literalSet.count >= 2 && this->_plan.sampleLines != 0 &&
+        this->_plan.sampleAllLiteralsHits * MaxPrefilterHitRatio <= this->_plan.sampleLines &&
+        (!prefilter || this->_plan.sampleAllLiteralsHits * MinLiteralSetGain <= this->_plan.sampleLiteralHits);
+    if (literalSetPrefilter)
+    {
+        this->_plan.matcher = EMatcher::AllLiteralsPrefilter;
+    }
+    return true;
+}
+
+// Operands of the expression are ordered by their selectivity on the head of the file.
+// There is no single literal to choose the reader by, so the file size decides.
+bool CLogReader::UpdateExpressionPlan(const CByteFrequency& frequency)
+{
+    const std::string_view filter = { this->_pattern.ptr, this->_pattern.size };
+    this->_plan.pattern = CFnMatch::PatternInfo();
+    this->_plan.pattern.anchoredStart = false;
+    this->_plan.pattern.anchoredEnd = false;
+    if (!this->_expression.Compile(filter, frequency))
+    {
+        return false;
+    }
+
+    this->_plan.matcher = EMatcher::Expression;
+    this->_plan.sampleLines = 0;
+    this->_plan.sampleLiteralHits = 0;
+    this->_plan.sampleAllLiteralsHits = 0;
+    this->_plan.sampleMatches = 0;
+    std::string_view sample = { this->_sample.ptr, this->_sampleSize };
+    std::string_view line;
+    while (this->GetNextSampleLine(sample, line))
+    {
+        ++this->_plan.sampleLines;
+        this->_plan.sampleMatches += this->_expression.MatchSample(line);
+    }
+    this->_expression.Optimize();
+    return true;
+}
+
+// Fields are split only up to the last referenced one, the file size chooses the reader like for expressions
+bool CLogReader::UpdateFieldPlan(const CByteFrequency& frequency)
+{
+    const std::string_view filter = { this->_pattern.ptr, this->_pattern.size };
+    this->_plan.pattern = CFnMatch::PatternInfo();
+    this->_plan.pattern.anchoredStart = false;
+    this->_plan.pattern.anchoredEnd = false;
+    if (!this->_fieldFilter.Compile(filter, this->_fieldLayout, frequency))
+    {
+        return false;
+    }
+
+    this->_plan.matcher = EMatcher::Fields;
+    this->_plan.sampleLines = 0;
+    this->_plan.sampleLiteralHits = 0;
+    this->_plan.sampleAllLiteralsHits = 0;
+    this->_plan.sampleMatches = 0;
+    std::string_view sample = { this->_sample.ptr, this->_sampleSize };
+    std::string_view line;
+    while (this->GetNextSampleLine(sample, line))
+    {
+        ++this->_plan.sampleLines;
+        this->_plan.sampleMatches += this->_fieldFilter.Match(line);
+    }
+    return true;
+}
+
+// the next line of the sample without EOL; the last sampled line is cut unless the whole file is sampled
+bool CLogReader::GetNextSampleLine(std::string_view& sample, std::string_view& line) const
+{
+    const size_t eolOffset = sample.find('\n');
+    if (sample.empty() || (eolOffset == sample.npos && this->_sampleSize < this->_plan.fileSize))
+    {
+        return false;
+    }
+
+    line = sample.substr(0, eolOffset);
+    sample.remove_prefix(eolOffset != sample.npos ? eolOffset + 1 : sample.size());
+    if (!line.empty() && line.back() == '\r')
+    {
+        line.remove_suffix(1);
+    }
+    return true;
+}
+
+// choose line reader by the scan plan unless it is chosen already, and open it
+bool CLogReader::OpenLineReader(const uint64_t startOffset)
+{
+    const wchar_t* const filename = reinterpret_cast<const wchar_t*>(this->_filename.ptr);
+
+    EReader reader = this->_plan.reader;
+    if (reader == EReader::None)
+    {
+        // Rare literal makes the scan bound by memory bandwidth, mapping saves copying of every byte to read buffers.
+        // Otherwise matching dominates and the reading thread of the pipelined reader hides I/O behind it.
+        const bool rareLiteral =
+            (this->_plan.matcher == EMatcher::LiteralPrefilter &&
+                this->_plan.sampleLiteralHits * MinRareLiteralRatio <= this->_plan.sampleLines) ||
+            (this->_plan.matcher == EMatcher::AllLiteralsPrefilter &&
+                this->_plan.sampleAllLiteralsHits * MinRareLiteralRatio <= this->_plan.sampleLines);
+        const bool mapping = (this->_plan.fileSize <= SmallFileSize || rareLiteral) && this->_plan.fileSize <= MaxMappedFileSize;
+        reader = mapping ? EReader::Mapping : EReader::Pipelined;
+    }
+
+    if (reader == EReader::Mapping)
+    {
+        if (this->_mappingReader.Open(filename, startOffset, this->_allowWriters))
+        {
+            this->_plan.reader = EReader::Mapping;
+            return true;
+        }
+        // file may be too big for free address space, try to read it
+    }
+
+    if (this->_pipelinedReader.Open(filename, startOffset, this->_allowWriters))
+    {
+        this->_plan.reader = EReader::Pipelined;
+        return true;
+    }
+    return false;
+}
+
+bool CLogReader::GetLineReaderIdentity(CScanFile::FileIdentity& identity)
+{
+    switch (this->_plan.reader)
+    {
+    case EReader::Mapping:
+        return this->_mappingReader.GetFileIdentity(identity);
+    case EReader::Pipelined:
+        return this->_pipelinedReader.GetFileIdentity(identity);
+    default:
+        return false;
+    }
+}
+
+uint64_t CLogReader::GetLineReaderOffset() const
+{
+    return this->_plan.reader == EReader::Mapping ? this->_mappingReader.GetOffset() : this->_pipelinedReader.GetOffset();
+}
+
+void CLogReader::ScanPlan::Print(FILE* const stream) const
+{
+    const char* const readerNames[] = { "none", "mapping", "pipelined" };
+    const char* const matcherNames[] = { "direct", "literal prefilter", "all literals prefilter", "expression", "fields" };
+
+    fprintf(stream, "Scan plan: reader: %s, matcher: %s\n", readerNames[static_cast<size_t>(this->reader)],
+        matcherNames[static_cast<size_t>(this->matcher)]);
+    fprintf(stream, "pattern: longest literal: \"%.*s\", anchored start: %d, anchored end: %d, wildcard density: %.3f\n",
+        static_cast<int>(this->pattern.longestLiteral.size()), this->pattern.longestLiteral.data(),
+        this->pattern.anchoredStart, this->pattern.anchoredEnd, this->pattern.wildcardDensity);
+    fprintf(stream, "file size: %llu, sampled lines: %zu, literal hits: %zu, all literals hits: %zu, matches: %zu\n",
+        this->fileSize, this->sampleLines, this->sampleLiteralHits, this->sampleAllLiteralsHits, this->sampleMatches);
+}
+
+bool CLogReader::Resume(const Checkpoint& checkpoint)
+{
+    if (checkpoint.version != CheckpointVersion || checkpoint.filterHash != this->GetFilterHash() ||
+        checkpoint.tailLength > CheckpointTailLength || checkpoint.tailLength > checkpoint.offset)
+    {
+        return false;
+    }
+
+    CScanFile::FileIdentity identity;
+    if (!this->GetLineReaderIdentity(identity))
+    {
+        return false;
+    }
+
+    if (identity.volumeSerial != checkpoint.volumeSerial || identity.fileIndex != checkpoint.fileIndex)
+    {
+        // log is rotated: it is a new file at the same path
+        return false;
+    }
+
+    if (identity.size < checkpoint.offset)
+    {
+        // file is truncated
+        return false;
+    }
+
+    uint64_t tailHash = 0;
+    if (!this->GetTailHash(identity, checkpoint.offset, checkpoint.tailLength, tailHash) || tailHash != checkpoint.tailHash)
+    {
+        // file is truncated and written again
+        return false;
+    }
+
+    // the same line reader continues the scan
+    this->_mappingReader.Close();
+    this->_pipelinedReader.Close();
+    this->_incompleteLineLength = 0;
+    return this->OpenLineReader(checkpoint.offset);
+}
+
+bool CLogReader::GetCheckpoint(Checkpoint& checkpoint)
+{
+    CScanFile::FileIdentity identity;
+    if (!this->GetLineReaderIdentity(identity))
+    {
+        return false;
+    }
+
+    const uint64_t offset = this->GetLineReaderOffset() - this->_incompleteLineLength;
+    const uint32_t tailLength = static_cast<uint32_t>(offset < CheckpointTailLength ? offset : CheckpointTailLength);
+
+    Checkpoint result;
+    result.version = CheckpointVersion;
+    result.tailLength = tailLength;
+    result.offset = offset;
+    result.volumeSerial = identity.volumeSerial;
+    result.fileIndex = identity.fileIndex;
+    result.filterHash = this->GetFilterHash();
+    if (!this->GetTailHash(identity, offset, tailLength, result.tailHash))
+    {
+        return false;
+    }
+
+    checkpoint = result;
+    return true;
+}
+
+uint64_t CLogReader::GetFilterHash() const
+{
+    // the inverted filter returns the rest of lines
+    const uint64_t patternHash = HashBytes(this->_pattern.ptr, this->_pattern.size);
+    const uint64_t hash = this->_inverted ? HashBytes("!", 1, patternHash) : patternHash;
+    if (!this->_fieldMode)
+    {
+        return hash;
+    }
+
+    // the same conditions select other lines with another layout
+    const char layout[] = { '$', this->_fieldLayout.delimiter, this->_fieldLayout.quote,
+        this->_fieldLayout.openBracket, this->_fieldLayout.closeBracket };
+    return HashBytes(layout, sizeof(layout), hash);
+}
+
+bool CLogReader::GetTailHash(const CScanFile::FileIdentity& identity, const uint64_t offset, const uint32_t tailLength, uint64_t& hash) const
+{
+    // The tail is read by a separate handle: file pointer and read operations of the line reader must not be touched
+    CScanFile file;
+    const bool asyncMode = false;
+    const bool unbufferedMode = false;
+    const bool allowWriters = true;
+    if (!file.Open(reinterpret_cast<const wchar_t*>(this->_filename.ptr), asyncMode, unbufferedMode, allowWriters))
+    {
+        return false;
+    }
+
+    CScanFile::FileIdentity tailIdentity;
+    if (!file.GetIdentity(tailIdentity) || tailIdentity.volumeSerial != identity.volumeSerial || tailIdentity.fileIndex != identity.fileIndex)
+    {
+        // file is replaced after the line reader opened it
+        return false;
+    }
+
+    char tail[CheckpointTailLength];
+    size_t readBytes = 0;
+    if (!file.SetReadOffset(offset - tailLength) || !file.Read(tail, tailLength, readBytes) || readBytes != tailLength)
+    {
+        return false;
+    }
+
+    hash = HashBytes(tail, tailLength);
+    return true;
+}
@@ -1,33 +1,124 @@
 #pragma once
 
+#include "Aggregator.h"
 #include "CharBuffer.h"
+#include "FieldFilter.h"
+#include "FilterExpression.h"
 #include "FnMatch.h"
+#include "FnMatchStatic.h"
 #include "LineReader.h"
+#include "SimdSearch.h"
 
 #include <optional> // this is STL, but it does not need exceptions
 #include <string_view> // this is STL, but it does not need exceptions
 
+#include <stdint.h>
+#include <stdio.h>
 #include <wchar.h> // for size_t, wchar_t
 
 
 class CLogReader final
 {
+public:
+    // Scan position for incremental scans of a growing log: the next run continues right after the last complete line.
+    // It is a plain structure, so it can be saved to a file as is.
+    struct Checkpoint
+    {
+        uint32_t version      = 0;
+        uint32_t tailLength   = 0; // number of bytes right before offset which are covered by tailHash
+        uint64_t offset       = 0; // file offset right after the last complete line (with LF)
+        uint64_t volumeSerial = 0; // volume serial and file index detect log rotation, see CScanFile::FileIdentity
+        uint64_t fileIndex    = 0;
+        uint64_t filterHash   = 0;
+        uint64_t tailHash     = 0; // detects the file truncated and written again up to the old size
+    };
+    static const uint32_t CheckpointVersion = 1;
+
+    enum class EReader
+    {
+        None,      // not chosen yet: file is not opened or there was no SetFilter() and GetNextLine() after Open()
+        Mapping,   // CMappingLineReader: no copying to read buffers, the best for small files and rare matches
+        Pipelined, // CSpinlockLineReader: reading thread hides I/O behind matching, the best when matching is expensive
+    };
+
+    enum class EMatcher
+    {
+        Direct,               // CFnMatch::Match() for every line
+        LiteralPrefilter,     // lines without the longest pattern literal are rejected before CFnMatch::Match()
+        AllLiteralsPrefilter, // lines missing any pattern literal are rejected, all literals are searched in one pass
+        Expression,           // CFilterExpression: boolean expression over patterns sharing one literal prefilter
+        Fields,               // CFieldFilter: patterns applied to fields of delimited lines
+    };
+
+    // Scan strategy chosen by pattern analysis and by matching lines from the head of the file.
+    // It is exposed for diagnostics; pattern.longestLiteral points into the filter, it is valid until the next SetFilter().
+    struct ScanPlan
+    {
+        EReader               reader = EReader::None;
+        EMatcher              matcher = EMatcher::Direct;
+        CFnMatch::PatternInfo pattern;                   // empty for expression and field filters
+        uint64_t              fileSize = 0;
+        size_t                sampleLines = 0;           // complete lines in the sampled head of the file
+        size_t                sampleLiteralHits = 0;     // sampled lines containing pattern.longestLiteral
+        size_t                sampleAllLiteralsHits = 0; // sampled lines containing all pattern literals of 2+ characters
+        size_t                sampleMatches = 0;         // sampled lines matching the pattern
+
+        void Print(FILE* const stream) const;
+    };
+
+    static const size_t SampleSize = 64 * 1024;
+    static const size_t SmallFileSize = 1024 * 1024; // small file is always mapped: starting reading thread costs more than the scan
+
 public:
     // open file; return false on error
     // Supported encoding for file data: utf-8, any single-byte encodings (with ASCII backward support)
     // Supported line endings: CRLF, LF (\r\n, \n)
     // '\0' is supported inside of log lines. However SetFilter() does not support using it in filter. And one of GetNextLine() methods does not support it too.
-    bool Open(const wchar_t* const filename);
+    // allowWriters lets the log writer keep the file open and append to it during the scan, use it with checkpoints.
+    bool Open(const wchar_t* const filename, const bool allowWriters = false);
 
     // close file
     void Close();
 
-    // set line filter; return false on error
+    // set line filter and update scan plan; return false on error
+    // filter is a pattern or a boolean expression over patterns, see CFilterExpression: "*ERROR*" AND NOT "*healthcheck*"
+    // line reader is chosen by the first SetFilter() after Open(), the next calls change only the matcher strategy
     bool SetFilter(const char* const filter);
 
+    // the same as SetFilter(), but the filter is a list of conditions for fields of delimited lines, see CFieldFilter:
+    // $6=500 $5="GET /api/*"
+    bool SetFieldFilter(const char* const filter, const CFieldFilter::Layout& layout = CFieldFilter::Layout());
+
+    // the same as SetFilter(Pattern), but lines are matched by CFnMatchStatic<Pattern> unrolled at compile time
+    template <const char* Pattern>
+    bool SetStaticFilter()
+    {
+        if (!this->SetFilter(Pattern) || this->_plan.matcher == EMatcher::Expression)
+        {
+            return false;
+        }
+        this->_staticMatch = &CFnMatchStatic<Pattern>::Match;
+        return true;
+    }
+
+    // return lines which don't match the filter instead of matching ones, like grep -v; it is kept by SetFilter()
+    void SetInverted(const bool inverted)
+    {
+        this->_inverted = inverted;
+    }
+
     // request next matching line; line may contain '\0' and may end with CRLF or LF; return false on error or EOF
     std::optional<std::string_view> GetNextLine();
 
+    // the same as GetNextLine(), but consecutive lines may be returned as one block: in the inverted mode lines
+    // between lines with the longest literal of the pattern can't match, so they are returned without splitting
+    std::optional<std::string_view> GetNextLines();
+
+    const ScanPlan& GetScanPlan() const
+    {
+        return this->_plan;
+    }
+
     // NOTE: I would prefer to drop next method because it needs additional memory copy and does not support null characters inside of the line.
     //       I'm keeping the method only for compatibility with original requirements.
     bool GetNextLine(char* buf, const size_t bufsize)
@@ -46,20 +137,61 @@ public:
         return true;
     }
 
+    // count all remaining matching lines by the key of aggregator instead of returning them; return false on error
+    bool Aggregate(CAggregator& aggregator);
+
+    // continue the scan from checkpoint of a previous run; call it after Open() and SetFilter() before the first GetNextLine()
+    // return false if checkpoint does not belong to this file and filter, or file was truncated or rewritten;
+    // the scan starts from the beginning of the file then
+    bool Resume(const Checkpoint& checkpoint);
+
+    // checkpoint of the current position: the last line without LF is not complete yet and it will be returned again on resume
+    bool GetCheckpoint(Checkpoint& checkpoint);
+
+    // per-stage counters of the last scan; they are collected only when ENABLE_SCAN_STATS is set
+    const CScanStats& GetStats()
+    {
+        return this->_plan.reader == EReader::Mapping ? this->_mappingReader.Stats() : this->_pipelinedReader.Stats();
+    }
+
 protected:
-#if 0
-#if 1
-    CSyncLineReader    _lineReader;
-#else
-    CMappingLineReader _lineReader;
-#endif
-#else
-#if 0
-    CAsyncLineReader    _lineReader;
-#else
-    CSpinlockLineReader _lineReader;
-#endif
-#endif
-    CCharBuffer        _pattern;
-    CFnMatch           _lineMatcher;
+    template <class TLineReader>
+    std::optional<std::string_view> GetNextMatchingLine(TLineReader& lineReader);
+    template <class TLineReader>
+    std::optional<std::string_view> GetNextLineBlock(TLineReader& lineReader);
+
+    bool ReadSample();
+    bool UpdateScanPlan();
+    bool ApplyFilter(const char* const filter);
+    bool UpdateExpressionPlan(const CByteFrequency& frequency);
+    bool UpdateFieldPlan(const CByteFrequency& frequency);
+    bool GetNextSampleLine(std::string_view& sample, std::string_view& line) const;
+    bool OpenLineReader(const uint64_t startOffset);
+    bool GetLineReaderIdentity(CScanFile::FileIdentity& identity);
+    uint64_t GetLineReaderOffset() const;
+
+    uint64_t GetFilterHash() const;
+    bool GetTailHash(const CScanFile::FileIdentity& identity, const uint64_t offset, const uint32_t tailLength, uint64_t& hash) const;
+
+protected:
+    CMappingLineReader  _mappingReader;
+    CSpinlockLineReader _pipelinedReader;
+    CCharBuffer         _pattern;
+    CFnMatch            _lineMatcher;   // compiled _pattern
+    CFilterExpression   _expression;    // compiled _pattern when it is an expression
+    CFieldFilter        _fieldFilter;   // compiled _pattern set by SetFieldFilter()
+    bool                _fieldMode = false;
+    bool                _inverted = false;
+    CFieldFilter::Layout _fieldLayout;
+    bool              (*_staticMatch)(const std::string_view text) = nullptr; // set by SetStaticFilter()
+    CSimdSearch::Needle _literalNeedle; // longest literal of _pattern for the prefilter
+    CSimdSearch::LiteralSet _literalSet; // literal parts of _pattern for the all literals prefilter
+    ScanPlan            _plan;
+    CCharBuffer         _sample;         // head of the file
+    size_t              _sampleSize = 0; // filled part of _sample
+
+    // for checkpoints:
+    CCharBuffer         _filename; // '\0' terminated wchar_t string
+    bool                _allowWriters = false;
+    size_t              _incompleteLineLength = 0; // length of the last line without LF
 };
@@ -0,0 +1,124 @@
+#include "LogReaderApi.h"
+
+#include "CharBuffer.h"
+#include "LogReader.h"
+
+#include <new> // for std::nothrow
+
+#include <windows.h>
+
+
+struct LogReaderHandle
+{
+    CLogReader reader;
+};
+
+
+int LOG_READER_CALL LogReaderGetApiVersion(void)
+{
+    return LOG_READER_API_VERSION;
+}
+
+LogReaderHandle* LOG_READER_CALL LogReaderCreate(void)
+{
+    // exceptions are disabled, so allocation failure is reported by nullptr
+    return new (std::nothrow) LogReaderHandle;
+}
+
+void LOG_READER_CALL LogReaderDestroy(LogReaderHandle* reader)
+{
+    delete reader;
+}
+
+LogReaderStatus LOG_READER_CALL LogReaderOpen(LogReaderHandle* reader, const wchar_t* filename)
+{
+    if (reader == nullptr || filename == nullptr)
+    {
+        return LOG_READER_INVALID_ARGUMENT;
+    }
+    return reader->reader.Open(filename) ? LOG_READER_OK : LOG_READER_OPEN_FAILED;
+}
+
+LogReaderStatus LOG_READER_CALL LogReaderOpenUtf8(LogReaderHandle* reader, const char* filename)
+{
+    if (reader == nullptr || filename == nullptr)
+    {
+        return LOG_READER_INVALID_ARGUMENT;
+    }
+
+    // length includes terminating '\0'
+    const int wideLength = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, filename, -1, nullptr, 0);
+    if (wideLength <= 0)
+    {
+        return LOG_READER_INVALID_ARGUMENT;
+    }
+
+    CCharBuffer wideFilename;
+    if (!wideFilename.Allocate(wideLength * sizeof(wchar_t), alignof(wchar_t)))
+    {
+        return LOG_READER_NOT_ENOUGH_MEMORY;
+    }
+
+    wchar_t* const widePtr = reinterpret_cast<wchar_t*>(wideFilename.ptr);
+    if (MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, filename, -1, widePtr, wideLength) != wideLength)
+    {
+        return LOG_READER_INVALID_ARGUMENT;
+    }
+
+    return reader->reader.Open(widePtr) ? LOG_READER_OK : LOG_READER_OPEN_FAILED;
+}
+
+void LOG_READER_CALL LogReaderClose(LogReaderHandle* reader)
+{
+    if (reader != nullptr)
+    {
+        reader->reader.Close();
+    }
+}
+
+LogReaderStatus LOG_READER_CALL LogReaderSetFilter(LogReaderHandle* reader, const char* filter)
+{
+    if (reader == nullptr || filter == nullptr)
+    {
+        return LOG_READER_INVALID_ARGUMENT;
+    }
+    return reader->reader.SetFilter(filter) ? LOG_READER_OK : LOG_READER_FILTER_FAILED;
+}
+
+LogReaderStatus LOG_READER_CALL LogReaderGetNextLine(LogReaderHandle* reader, const char** line, size_t* length)
+{
+    if (reader == nullptr || line == nullptr || length == nullptr)
+    {
+        return LOG_READER_INVALID_ARGUMENT;
+    }
+
+    const auto nextLine = reader->reader.GetNextLine();
+    if (!nextLine)
+    {
+        *line = nullptr;
+        *length = 0;
+        return LOG_READER_END;
+    }
+
+    *line = nextLine->data();
+    *length = nextLine->size();
+    return LOG_READER_OK;
+}
+
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+LogReaderStatus LOG_READER_CALL LogReaderScan(LogReaderHandle* reader, LogReaderLineCallback callback, void* context)
+{
+    if (reader == nullptr || callback == nullptr)
+    {
+        return LOG_READER_INVALID_ARGUMENT;
+    }
+
+    while (const auto line = reader->reader.GetNextLine())
+    {
+        if (callback(context, line->data(), line->size()) != 0)
+        {
+            return LOG_READER_STOPPED;
+        }
+    }
+    return LOG_READER_END;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// C interface of the log reader for other languages (Python ctypes/cffi, Go cgo, etc).
+// It is exported by LogReaderLib.dll. Define LOG_READER_STATIC to use it without the DLL (compiled into the caller).
+//
+// Rules of the interface:
+// - no C++ exceptions and no C++ types cross the boundary, errors are returned as LogReaderStatus;
+// - lines are passed zero-copy: pointer to the line is valid until the next call for the same handle;
+// - line may contain '\0' and may end with CRLF or LF, so the length is always passed with the pointer;
+// - handle is not thread safe, but different handles can be used from different threads at the same time.
+
+#include <stddef.h> // for size_t, wchar_t
+
+#if defined(LOG_READER_STATIC)
+#   define LOG_READER_API
+#elif defined(LOG_READER_EXPORTS)
+#   define LOG_READER_API __declspec(dllexport)
+#else
+#   define LOG_READER_API __declspec(dllimport)
+#endif
+
+#define LOG_READER_CALL __cdecl
+
+// incremented on incompatible changes of this header
+#define LOG_READER_API_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct LogReaderHandle LogReaderHandle; // opaque
+
+typedef enum LogReaderStatus
+{
+    LOG_READER_OK                = 0,
+    LOG_READER_END               = 1,  // no more matching lines: end of file or read error
+    LOG_READER_STOPPED           = 2,  // callback requested to stop the scan
+    LOG_READER_INVALID_ARGUMENT  = -1,
+    LOG_READER_NOT_ENOUGH_MEMORY = -2,
+    LOG_READER_OPEN_FAILED       = -3,
+    LOG_READER_FILTER_FAILED     = -4,
+} LogReaderStatus;
+
+// called for every matching line; return nonzero to stop the scan
+typedef int (LOG_READER_CALL* LogReaderLineCallback)(void* context, const char* line, size_t length);
+
+LOG_READER_API int LOG_READER_CALL LogReaderGetApiVersion(void);
+
+// return NULL if memory can't be allocated
+LOG_READER_API LogReaderHandle* LOG_READER_CALL LogReaderCreate(void);
+LOG_READER_API void LOG_READER_CALL LogReaderDestroy(LogReaderHandle* reader);
+
+LOG_READER_API LogReaderStatus LOG_READER_CALL LogReaderOpen(LogReaderHandle* reader, const wchar_t* filename);
+// filename is UTF-8, it is easier to pass from languages where wchar_t is not native
+LOG_READER_API LogReaderStatus LOG_READER_CALL LogReaderOpenUtf8(LogReaderHandle* reader, const char* filename);
+LOG_READER_API void LOG_READER_CALL LogReaderClose(LogReaderHandle* reader);
+
+// filter is similar to fnmatch and supports symbols '*' and '?'
+LOG_READER_API LogReaderStatus LOG_READER_CALL LogReaderSetFilter(LogReaderHandle* reader, const char* filter);
+
+// pull API: return LOG_READER_OK and the next matching line or LOG_READER_END
+LOG_READER_API LogReaderStatus LOG_READER_CALL LogReaderGetNextLine(LogReaderHandle* reader, const char** line, size_t* length);
+
+// push API: call the callback for every matching line until the end of file or until the callback stops the scan;
+// return LOG_READER_END or LOG_READER_STOPPED. Scan can be continued by the next call after LOG_READER_STOPPED.
+LOG_READER_API LogReaderStatus LOG_READER_CALL LogReaderScan(LogReaderHandle* reader, LogReaderLineCallback callback, void* context);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,77 @@
+#include <fcntl.h>
+#include <io.h>
+#include <stdio.h>
+
+#include <atlcomcli.h>
+
+#include "QueryDaemon.h"
+
+
+namespace
+{
+    CQueryDaemon* g_daemon = nullptr;
+
+    BOOL WINAPI ConsoleCtrlHandler(DWORD /*ctrlType*/)
+    {
+        // Ctrl+C breaks CQueryDaemon::Run(), then the process exits normally
+        g_daemon->Stop();
+        return TRUE;
+    }
+
+    int Serve(const wchar_t* const socketPath)
+    {
+        CQueryDaemon daemon;
+        if (!daemon.Start(socketPath))
+        {
+            fwprintf(stderr, L"Error! Failed to listen on socket: \"%ws\"\n", socketPath);
+            return 2;
+        }
+
+        g_daemon = &daemon;
+        SetConsoleCtrlHandler(ConsoleCtrlHandler, TRUE);
+        fwprintf(stderr, L"Listening on \"%ws\", press Ctrl+C to stop\n", socketPath);
+
+        const bool succeeded = daemon.Run();
+        const CQueryCache::Stats& stats = daemon.GetStats();
+        fwprintf(stderr, L"Queries: %zu, result cache hits: %zu, mapping hits: %zu\n", stats.queries, stats.resultHits, stats.mappingHits);
+        return succeeded ? 0 : 3;
+    }
+
+    int Query(const wchar_t* const socketPath, const wchar_t* const fileName, const wchar_t* const lineFilter)
+    {
+        CCharBuffer result;
+        if (!QueryDaemon(socketPath, fileName, CW2A(lineFilter), result))
+        {
+            fwprintf(stderr, L"Error! Query failed: \"%ws\" \"%ws\"\n", fileName, lineFilter);
+            return 4;
+        }
+
+        // prevent printf from changing LF to CRLF
+        _setmode(_fileno(stdout), O_BINARY);
+        fwrite(result.ptr, result.size, 1, stdout);
+        return 0;
+    }
+}
+
+
+int wmain(const int argc, const wchar_t* const argv[])
+{
+    if (argc != 2 && argc != 4)
+    {
+        fwprintf(stderr, L"Error! Wrong number of command line arguments!\n");
+        fwprintf(stderr, L"Usage:\n");
+        fwprintf(stderr, L"LogReaderDaemon.exe <socket>                      run daemon\n");
+        fwprintf(stderr, L"LogReaderDaemon.exe <socket> <filename> <pattern> query running daemon\n");
+        fwprintf(stderr, L"Output of the query is the same as output of LogReader.exe.\n");
+        fwprintf(stderr, L"Example:\n");
+        fwprintf(stderr, L"LogReaderDaemon.exe %%TEMP%%\\logreader.sock\n");
+        fwprintf(stderr, L"LogReaderDaemon.exe %%TEMP%%\\logreader.sock 20190102.log \"*bbb*\"\n");
+        return 1;
+    }
+
+    if (argc == 2)
+    {
+        return Serve(argv[1]);
+    }
+    return Query(argv[1], argv[2], argv[3]);
+}
@@ -0,0 +1,449 @@
+#include "ParallelLogReader.h"
+
+#include "SimdSearch.h"
+
+#include <assert.h>
+
+#include <algorithm>
+
+
+namespace
+{
+    // the same values as in LineReader.cpp
+    const size_t MaxLogLineLength = 1024; // including ending LF/CRLF;
+    const size_t ReadChunkSize = 65536 * 4;
+    const size_t PageSize = 4096;
+    const size_t ReadBufferOffset = (MaxLogLineLength + PageSize - 1) / PageSize * PageSize;
+    const size_t ReadBufferSize = ReadBufferOffset + ReadChunkSize;
+    static_assert(ReadBufferOffset >= MaxLogLineLength);
+
+    // Matchers may wait for IO for a long time, so they give CPU to other threads after a short spinning
+    const size_t MaxSpinCount = 1000;
+
+    void WaitBackoff(size_t& spinCount)
+    {
+        if (spinCount < MaxSpinCount)
+        {
+            ++spinCount;
+            YieldProcessor();
+        }
+        else
+        {
+            SwitchToThread();
+        }
+    }
+
+    size_t GetDefaultMatcherThreadCount()
+    {
+        SYSTEM_INFO systemInfo = {};
+        GetSystemInfo(&systemInfo);
+        return systemInfo.dwNumberOfProcessors > 1 ? systemInfo.dwNumberOfProcessors - 1 : 1;
+    }
+}
+
+
+CParallelLogReader::CParallelLogReader(const size_t matcherThreadCount, const bool numaPlacement)
+    : _matcherThreadCount(std::clamp<size_t>(matcherThreadCount != 0 ? matcherThreadCount : GetDefaultMatcherThreadCount(), 1, MaxMatcherThreads))
+    , _slotCount(std::min<size_t>(this->_matcherThreadCount * 2 + 2, MaxChunkSlots))
+{
+    if (numaPlacement && this->_topology.Init())
+    {
+        // every node needs at least one matcher
+        this->_numaNodeCount = std::min(this->_topology.GetNumaNodeCount(), this->_matcherThreadCount);
+    }
+
+    for (size_t i = 0; i < this->_matcherThreadCount; ++i)
+    {
+        ++this->_nodeFirstMatcher[this->GetMatcherNode(i) + 1];
+    }
+    for (size_t node = 0; node < this->_numaNodeCount; ++node)
+    {
+        this->_nodeFirstMatcher[node + 1] += this->_nodeFirstMatcher[node];
+    }
+
+    for (size_t i = 0; i < this->_slotCount; ++i)
+    {
+        const unsigned long numaNode = this->_numaNodeCount > 1 ? this->_topology.GetNumaNode(this->GetSlotNode(i)).nodeNumber : CCharBuffer::AnyNumaNode;
+        if (!this->_slots[i].buffer.Allocate(ReadBufferSize, PageSize, CCharBuffer::EAllocationPolicy::Pages, numaNode))
+        {
+            break;
+        }
+    }
+}
+
+CParallelLogReader::~CParallelLogReader()
+{
+    this->Close();
+}
+
+bool CParallelLogReader::Open(const wchar_t* const filename)
+{
+    if (this->_slots[this->_slotCount - 1].buffer.ptr == nullptr || filename == nullptr)
+    {
+        return false;
+    }
+    this->Close();
+
+    const bool bAsyncMode = false;
+    const bool succeeded = this->_file.Open(filename, bAsyncMode);
+    if (!succeeded)
+    {
+        return false;
+    }
+
+    this->_opened = true;
+    return true;
+}
+
+void CParallelLogReader::Close()
+{
+    this->StopThreads();
+    this->_file.Close();
+    this->_opened = false;
+}
+
+bool CParallelLogReader::SetFilter(const char* const filter)
+{
+    if (filter == nullptr || this->_started)
+    {
+        return false;
+    }
+
+    const size_t patternLen = strlen(filter);
+    const bool allocatedOk = this->_pattern.Allocate(patternLen);
+    if (!allocatedOk)
+    {
+        return false;
+    }
+
+    memcpy(this->_pattern.ptr, filter, patternLen);
+
+    return this->_lineMatcher.Compile({ this->_pattern.ptr, this->_pattern.size });
+}
+
+bool CParallelLogReader::StartThreads()
+{
+    assert(!this->_started);
+
+    this->_consumedSequence = 0;
+    this->_slotAcquired = false;
+    this->_finished = false;
+    this->_matchedData = std::string_view();
+    for (size_t i = 0; i < this->_slotCount; ++i)
+    {
+        this->_slots[i].doneSequence.store(0, std::memory_order_relaxed);
+    }
+    this->_finishSpinlock.store(false, std::memory_order_relaxed);
+    this->_readingFinishedSpinlock.store(false, std::memory_order_relaxed);
+    this->_releasedSpinlock.store(0, std::memory_order_relaxed);
+    // no need to synchronize before worker threads are started
+
+    this->_started = true;
+
+    using ThreadProcType = unsigned __stdcall(void*);
+    ThreadProcType* const readerThreadProc = [](void* p) -> unsigned
+    {
+        CParallelLogReader* const that = static_cast<CParallelLogReader*>(p);
+        that->ReaderThreadProc();
+        _endthreadex(0);
+        return 0;
+    };
+    ThreadProcType* const matcherThreadProc = [](void* p) -> unsigned
+    {
+        const MatcherThreadParam* const param = static_cast<const MatcherThreadParam*>(p);
+        param->that->MatcherThreadProc(param->index);
+        _endthreadex(0);
+        return 0;
+    };
+
+    for (size_t i = 0; i < this->_matcherThreadCount; ++i)
+    {
+        this->_matcherParams[i].that = this;
+        this->_matcherParams[i].index = i;
+
+        unsigned threadID = 0;
+        this->_hMatcherThreads[i] = reinterpret_cast<HANDLE>(_beginthreadex(nullptr, 0, matcherThreadProc, &this->_matcherParams[i], 0, &threadID));
+        if (this->_hMatcherThreads[i] == nullptr)
+        {
+            this->StopThreads();
+            return false;
+        }
+    }
+
+    unsigned threadID = 0;
+    this->_hReaderThread = reinterpret_cast<HANDLE>(_beginthreadex(nullptr, 0, readerThreadProc, this, 0, &threadID));
+    if (this->_hReaderThread == nullptr)
+    {
+        this->StopThreads();
+        return false;
+    }
+
+    return true;
+}
+
+void CParallelLogReader::StopThreads()
+{
+    if (!this->_started)
+    {
+        return;
+    }
+
+    this->_finishSpinlock.store(true, std::memory_order_relaxed); // we won't reorder after WaitForSingleObject
+
+    if (this->_hReaderThread != nullptr)
+    {
+        WaitForSingleObject(this->_hReaderThread, INFINITE); // ignore return value in this case
+        CloseHandle(this->_hReaderThread);
+        this->_hReaderThread = nullptr;
+    }
+
+    for (HANDLE& hThread : this->_hMatcherThreads)
+    {
+        if (hThread != nullptr)
+        {
+            WaitForSingleObject(hThread, INFINITE); // ignore return value in this case
+            CloseHandle(hThread);
+            hThread = nullptr;
+        }
+    }
+
+    // Scan may be stopped in the middle, drop chunks which were not matched
+    for (size_t i = 0; i < this->_matcherThreadCount; ++i)
+    {
+        size_t sequence = 0;
+        while (this->_queues[i].TryPop(sequence))
+        {
+        }
+    }
+
+    this->_started = false;
+}
+
+void CParallelLogReader::ReaderThreadProc()
+{
+    const char* carry = nullptr; // rest of the previous chunk without EOL
+    size_t carryLength = 0;
+
+    for (size_t sequence = 0; ; ++sequence)
+    {
+        // Wait for a slot returned by consumer:
+        size_t spinCount = 0;
+        while (sequence - this->_releasedSpinlock.load(std::memory_order_acquire) >= this->_slotCount)
+        {
+            if (this->_finishSpinlock.load(std::memory_order_relaxed))
+            {
+                // thread exit signal is caught
+                return;
+            }
+            WaitBackoff(spinCount);
+        }
+
+        ChunkSlot& slot = this->_slots[sequence % this->_slotCount];
+        slot.data = slot.buffer.ptr + ReadBufferOffset;
+        slot.dataLength = 0;
+        slot.lastChunk = false;
+        slot.readFailed = false;
+
+        size_t readBytes = 0;
+        bool readOk = false;
+        if (carryLength <= MaxLogLineLength)
+        {
+            slot.data -= carryLength;
+            if (carryLength != 0)
+            {
+                // the previous slot is not refilled until this one is filled, so its rest is still here
+                memcpy(slot.data, carry, carryLength);
+            }
+            readOk = this->_file.Read(slot.buffer.ptr + ReadBufferOffset, ReadChunkSize, readBytes);
+        }
+        // else: incomplete line is already too long
+
+        if (!readOk)
+        {
+            slot.readFailed = true;
+            slot.lastChunk = true;
+        }
+        else if (readBytes == 0)
+        {
+            // The very last line without LF
+            slot.dataLength = carryLength;
+            slot.lastChunk = true;
+        }
+        else
+        {
+            const std::string_view data(slot.data, carryLength + readBytes);
+            const size_t lastEolOffset = data.rfind('\n');
+            slot.dataLength = lastEolOffset != data.npos ? lastEolOffset + 1 : 0;
+            carry = slot.data + slot.dataLength;
+            carryLength = data.size() - slot.dataLength;
+        }
+
+        // Chunk goes to a matcher of the buffer's node.
+        // Queue capacity is not less than number of slots, so it can't be full.
+        const size_t slotNode = this->GetSlotNode(sequence % this->_slotCount);
+        const size_t firstMatcher = this->_nodeFirstMatcher[slotNode];
+        const size_t nodeMatcherCount = this->_nodeFirstMatcher[slotNode + 1] - firstMatcher;
+        const bool pushedOk = this->_queues[firstMatcher + sequence % nodeMatcherCount].TryPush(sequence);
+        assert(pushedOk && "chunk queue must not overflow");
+        (void)pushedOk;
+
+        if (slot.lastChunk)
+        {
+            this->_readingFinishedSpinlock.store(true, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+void CParallelLogReader::MatcherThreadProc(const size_t matcherIndex)
+{
+    const size_t node = this->GetMatcherNode(matcherIndex);
+    if (this->_numaNodeCount > 1)
+    {
+        // ignore result: placement is only an optimization
+        CCpuTopology::SetCurrentThreadAffinity(this->_topology.GetNumaNode(node).affinity);
+    }
+
+    size_t spinCount = 0;
+
+    while (!this->_finishSpinlock.load(std::memory_order_relaxed))
+    {
+        // flag is checked before queues: if it is set and queues are empty, there will be no more chunks
+        const bool readingFinished = this->_readingFinishedSpinlock.load(std::memory_order_acquire);
+
+        size_t sequence = 0;
+        bool found = this->_queues[matcherIndex].TryPop(sequence);
+
+        // Own queue is empty, steal a chunk from another matcher: from the same node first, then from other nodes
+        for (size_t pass = 0; !found && pass < 2; ++pass)
+        {
+            const bool sameNodePass = pass == 0;
+            for (size_t i = 1; !found && i < this->_matcherThreadCount; ++i)
+            {
+                const size_t victimIndex = (matcherIndex + i) % this->_matcherThreadCount;
+                if ((this->GetMatcherNode(victimIndex) == node) == sameNodePass)
+                {
+                    found = this->_queues[victimIndex].TryPop(sequence);
+                }
+            }
+        }
+
+        if (!found)
+        {
+            if (readingFinished)
+            {
+                break;
+            }
+            WaitBackoff(spinCount);
+            continue;
+        }
+
+        spinCount = 0;
+        this->MatchChunk(sequence);
+    }
+}
+
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+void CParallelLogReader::MatchChunk(const size_t sequence)
+{
+    ChunkSlot& slot = this->_slots[sequence % this->_slotCount];
+
+    std::string_view data = { slot.data, slot.dataLength };
+    size_t matchedLength = 0;
+    bool matchFailed = false;
+
+    while (!data.empty())
+    {
+        const char* const eol = CSimdSearch::FindChar(data.data(), data.size(), '\n');
+        const size_t lineLength = eol != nullptr ? eol - data.data() + 1 : data.size();
+        if (lineLength > MaxLogLineLength)
+        {
+            // Line is too long
+            matchFailed = true;
+            break;
+        }
+
+        const std::string_view line = data.substr(0, lineLength);
+        data.remove_prefix(lineLength);
+
+        std::string_view matchView = line;
+
+        // Ignore CRLF/LF during matching:
+        if (!matchView.empty() && matchView.back() == '\n')
+        {
+            matchView.remove_suffix(1);
+            if (!matchView.empty() && matchView.back() == '\r')
+            {
+                matchView.remove_suffix(1);
+            }
+        }
+
+        if (this->_lineMatcher.Match(matchView))
+        {
+            // Matched lines are compacted at the beginning of the chunk; ranges may overlap
+            memmove(slot.data + matchedLength, line.data(), lineLength);
+            matchedLength += lineLength;
+        }
+    }
+
+    slot.matchedLength = matchedLength;
+    slot.matchFailed = matchFailed;
+    slot.doneSequence.store(sequence + 1, std::memory_order_release);
+}
+
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+std::optional<std::string_view> CParallelLogReader::GetNextLine()
+{
+    if (!this->_opened)
+    {
+        return {};
+    }
+    if (!this->_started)
+    {
+        const bool startedOk = this->StartThreads();
+        if (!startedOk)
+        {
+            this->_finished = true;
+            return {};
+        }
+    }
+
+    while (this->_matchedData.empty())
+    {
+        if (this->_slotAcquired)
+        {
+            // All matched lines of the chunk are returned, the slot can be filled again
+            const ChunkSlot& slot = this->_slots[this->_consumedSequence % this->_slotCount];
+            this->_finished = slot.lastChunk || slot.readFailed || slot.matchFailed;
+            this->_slotAcquired = false;
+            ++this->_consumedSequence;
+            this->_releasedSpinlock.store(this->_consumedSequence, std::memory_order_release);
+        }
+
+        if (this->_finished)
+        {
+            // error or end of file
+            return {};
+        }
+
+        // Wait for the next chunk in file order:
+        const ChunkSlot& slot = this->_slots[this->_consumedSequence % this->_slotCount];
+        size_t spinCount = 0;
+        while (slot.doneSequence.load(std::memory_order_acquire) != this->_consumedSequence + 1)
+        {
+            WaitBackoff(spinCount);
+        }
+
+        this->_slotAcquired = true;
+        this->_matchedData = { slot.data, slot.matchedLength };
+    }
+
+    const size_t eolOffset = this->_matchedData.find('\n');
+    const size_t lineLength = eolOffset != this->_matchedData.npos ? eolOffset + 1 : this->_matchedData.size();
+
+    const std::string_view result = this->_matchedData.substr(0, lineLength);
+    this->_matchedData.remove_prefix(lineLength);
+
+    assert(!result.empty() && "result should contain at least one char");
+    return result;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "CharBuffer.h"
+#include "FnMatch.h"
+#include "ChunkQueue.h"
+#include "CpuTopology.h"
+#include "ScanFile.h"
+
+#include <atomic>      // this is STL, but it does not need exceptions
+#include <new>         // for std::hardware_destructive_interference_size
+#include <optional>    // this is STL, but it does not need exceptions
+#include <string_view> // this is STL, but it does not need exceptions
+
+#include <wchar.h> // for size_t, wchar_t
+
+#include <windows.h>
+
+
+// Log reader with a pool of matcher threads.
+// Reading thread cuts the file into line aligned chunks and pushes them to per-matcher lock-free queues round robin.
+// Matcher takes chunks from its own queue and steals from the other queues when it is empty, so a region with dense
+// matches does not stall the pipeline while other matchers are idle. Matched lines are returned in file order.
+//
+// NUMA placement: matchers are split between NUMA nodes and bound to processors of their node. Chunk slots are split
+// between nodes by contiguous groups, so every node gets contiguous file ranges in node-local buffers. A chunk is pushed
+// to a matcher of the buffer's node, idle matchers steal inside of their node first.
+class CParallelLogReader final
+{
+public:
+    static const size_t MaxMatcherThreads = 32;
+
+public:
+    // matcherThreadCount == 0 means one matcher per logical CPU except one
+    // numaPlacement has no effect on machines with a single NUMA node
+    CParallelLogReader(const size_t matcherThreadCount = 0, const bool numaPlacement = true);
+    ~CParallelLogReader();
+
+    // open file; return false on error. Supported data is the same as for CLogReader.
+    bool Open(const wchar_t* const filename);
+
+    // close file
+    void Close();
+
+    // set line filter; return false on error
+    // Threads are started by the first GetNextLine() call, filter can't be changed after that until Close().
+    bool SetFilter(const char* const filter);
+
+    // request next matching line; line may contain '\0' and may end with CRLF or LF; return false on error or EOF
+    std::optional<std::string_view> GetNextLine();
+
+    size_t GetMatcherThreadCount() const
+    {
+        return this->_matcherThreadCount;
+    }
+
+    // number of NUMA nodes used for placement; 1 means no placement
+    size_t GetNumaNodeCount() const
+    {
+        return this->_numaNodeCount;
+    }
+
+    // Read stage counters only: match stage counters would be written by many threads at once
+    const CScanStats& GetStats()
+    {
+        return this->_file.Stats();
+    }
+
+protected:
+    bool StartThreads();
+    void StopThreads();
+    void ReaderThreadProc();
+    void MatcherThreadProc(const size_t matcherIndex);
+    void MatchChunk(const size_t sequence);
+
+    size_t GetSlotNode(const size_t slotIndex) const
+    {
+        return slotIndex * this->_numaNodeCount / this->_slotCount;
+    }
+
+    size_t GetMatcherNode(const size_t matcherIndex) const
+    {
+        return matcherIndex * this->_numaNodeCount / this->_matcherThreadCount;
+    }
+
+protected:
+    static const size_t MaxChunkSlots = 64;
+
+    struct ChunkSlot
+    {
+        CCharBuffer         buffer;
+        // written by reading thread before the chunk is pushed to a queue:
+        char*               data       = nullptr; // line aligned data; rest of the previous chunk is copied right before read data
+        size_t              dataLength = 0;
+        bool                lastChunk  = false;   // there are no chunks after this one
+        bool                readFailed = false;
+        // written by matcher thread before doneSequence is set:
+        size_t              matchedLength = 0;     // matched lines are moved to the beginning of data
+        bool                matchFailed   = false; // line is too long, lines before it are matched
+        alignas(std::hardware_destructive_interference_size)
+        std::atomic<size_t> doneSequence = ATOMIC_VAR_INIT(0); // chunk sequence + 1 when it is matched
+    };
+
+    struct MatcherThreadParam
+    {
+        CParallelLogReader* that  = nullptr;
+        size_t              index = 0;
+    };
+
+    const size_t        _matcherThreadCount;
+    const size_t        _slotCount;
+    size_t              _numaNodeCount = 1;
+    CCpuTopology        _topology;
+    size_t              _nodeFirstMatcher[CCpuTopology::MaxNumaNodes + 1] = {}; // matchers of node N are [first[N], first[N + 1])
+
+    CScanFile           _file;
+    CCharBuffer         _pattern;
+    CFnMatch            _lineMatcher; // compiled _pattern, shared by matcher threads
+    bool                _opened  = false;
+    bool                _started = false;
+
+    ChunkSlot           _slots[MaxChunkSlots];
+    CChunkQueue<size_t, MaxChunkSlots> _queues[MaxMatcherThreads]; // chunk sequence numbers
+
+    HANDLE              _hReaderThread = nullptr;
+    HANDLE              _hMatcherThreads[MaxMatcherThreads] = {};
+    MatcherThreadParam  _matcherParams[MaxMatcherThreads];
+
+    // consumer data, not for use in worker threads:
+    size_t              _consumedSequence = 0;
+    bool                _slotAcquired     = false;
+    bool                _finished         = false;
+    std::string_view    _matchedData;     // not returned part of matched lines of the current chunk
+
+    alignas(std::hardware_destructive_interference_size)
+    std::atomic<bool>   _finishSpinlock         = ATOMIC_VAR_INIT(false);
+    alignas(std::hardware_destructive_interference_size)
+    std::atomic<bool>   _readingFinishedSpinlock = ATOMIC_VAR_INIT(false); // the last chunk is pushed
+    alignas(std::hardware_destructive_interference_size)
+    std::atomic<size_t> _releasedSpinlock       = ATOMIC_VAR_INIT(0);     // chunks returned by consumer
+};
@@ -0,0 +1,340 @@
+#include "QueryCache.h"
+
+#include "SimdSearch.h"
+
+#include <string.h>
+
+
+namespace
+{
+    // the same value as in LineReader.cpp
+    const size_t MaxLogLineLength = 1024; // including ending LF/CRLF;
+    const size_t MinScanResultSize = 65536;
+
+    template <typename T, size_t N>
+    T& GetLeastRecentlyUsed(T (&slots)[N])
+    {
+        T* oldest = &slots[0];
+        for (T& slot : slots)
+        {
+            if (slot.lastUse < oldest->lastUse)
+            {
+                oldest = &slot;
+            }
+        }
+        return *oldest;
+    }
+}
+
+
+std::optional<std::string_view> CQueryCache::Execute(const wchar_t* const filename, const char* const pattern)
+{
+    if (filename == nullptr || pattern == nullptr)
+    {
+        return {};
+    }
+    ++this->_stats.queries;
+
+    FileIdentity identity;
+    if (!GetFileIdentity(filename, identity))
+    {
+        return {};
+    }
+
+    const std::string_view patternView = pattern;
+    CachedResult* const cachedResult = this->FindResult(filename, patternView, identity);
+    if (cachedResult != nullptr)
+    {
+        ++this->_stats.resultHits;
+        cachedResult->lastUse = ++this->_clock;
+        return std::string_view(cachedResult->data.ptr, cachedResult->dataSize);
+    }
+
+    MappedFile* const mappedFile = this->GetMappedFile(filename, identity);
+    if (mappedFile == nullptr)
+    {
+        return {};
+    }
+
+    // compiled outside of Scan(): it allocates
+    if (!this->_lineMatcher.Compile(patternView) || !this->Scan(mappedFile->view, this->_lineMatcher))
+    {
+        return {};
+    }
+
+    this->StoreResult(filename, patternView, identity);
+    return this->GetScanResult();
+}
+
+DWORD CQueryCache::UnmapIdleFiles(const DWORD idleMs)
+{
+    const ULONGLONG now = GetTickCount64();
+    DWORD waitMs = INFINITE;
+    for (MappedFile& mappedFile : this->_files)
+    {
+        if (mappedFile.lastUse == 0)
+        {
+            continue;
+        }
+
+        const ULONGLONG idleTime = now - mappedFile.lastUseTime;
+        if (idleTime >= idleMs)
+        {
+            Unmap(mappedFile);
+        }
+        else if (idleMs - idleTime < waitMs)
+        {
+            waitMs = static_cast<DWORD>(idleMs - idleTime);
+        }
+    }
+    return waitMs;
+}
+
+void CQueryCache::Clear()
+{
+    for (MappedFile& mappedFile : this->_files)
+    {
+        Unmap(mappedFile);
+        mappedFile.filename.Free();
+    }
+    for (CachedResult& result : this->_results)
+    {
+        result.filename.Free();
+        result.pattern.Free();
+        result.data.Free();
+        result.dataSize = 0;
+        result.lastUse = 0;
+    }
+}
+
+bool CQueryCache::GetFileIdentity(const wchar_t* const filename, FileIdentity& identity)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data = {};
+    if (!GetFileAttributesExW(filename, GetFileExInfoStandard, &data))
+    {
+        return false;
+    }
+
+    identity.size = (static_cast<ULONGLONG>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    identity.lastWriteTime = (static_cast<ULONGLONG>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
+
+bool CQueryCache::CopyString(CCharBuffer& buffer, const void* const data, const size_t size)
+{
+    if (!buffer.Allocate(size))
+    {
+        return false;
+    }
+    memcpy(buffer.ptr, data, size);
+    return true;
+}
+
+bool CQueryCache::SameFilename(const CCharBuffer& buffer, const wchar_t* const filename)
+{
+    // paths are compared as is: QueryDaemon() sends full paths, so spellings of the same path are the same
+    return buffer.ptr != nullptr && wcscmp(reinterpret_cast<const wchar_t*>(buffer.ptr), filename) == 0;
+}
+
+bool CQueryCache::SamePattern(const CCharBuffer& buffer, const std::string_view pattern)
+{
+    return buffer.size == pattern.size() && memcmp(buffer.ptr, pattern.data(), pattern.size()) == 0;
+}
+
+void CQueryCache::Unmap(MappedFile& mappedFile)
+{
+    mappedFile.file.Close();
+    mappedFile.view = {};
+    mappedFile.lastUse = 0;
+}
+
+CQueryCache::MappedFile* CQueryCache::GetMappedFile(const wchar_t* const filename, const FileIdentity& identity)
+{
+    MappedFile* mappedFile = nullptr;
+    for (MappedFile& slot : this->_files)
+    {
+        if (slot.lastUse != 0 && SameFilename(slot.filename, filename))
+        {
+            mappedFile = &slot;
+            break;
+        }
+    }
+
+    if (mappedFile != nullptr && mappedFile->identity == identity)
+    {
+        ++this->_stats.mappingHits;
+        mappedFile->lastUse = ++this->_clock;
+        mappedFile->lastUseTime = GetTickCount64();
+        return mappedFile;
+    }
+
+    if (mappedFile == nullptr)
+    {
+        mappedFile = &GetLeastRecentlyUsed(this->_files);
+        if (!CopyString(mappedFile->filename, filename, (wcslen(filename) + 1) * sizeof(wchar_t)))
+        {
+            mappedFile->lastUse = 0;
+            return nullptr;
+        }
+    }
+
+    // file is changed or slot is reused: map it again
+    Unmap(*mappedFile);
+
+    const bool asyncMode = false;
+    const bool unbufferedMode = false;
+    const bool allowWriters = true; // log writer must not be blocked by the daemon
+    if (!mappedFile->file.Open(filename, asyncMode, unbufferedMode, allowWriters))
+    {
+        return nullptr;
+    }
+
+    const auto view = mappedFile->file.MapToMemory();
+    if (!view)
+    {
+        mappedFile->file.Close();
+        return nullptr;
+    }
+
+    mappedFile->identity = identity;
+    mappedFile->view = *view;
+    mappedFile->lastUse = ++this->_clock;
+    mappedFile->lastUseTime = GetTickCount64();
+    return mappedFile;
+}
+
+CQueryCache::CachedResult* CQueryCache::FindResult(const wchar_t* const filename, const std::string_view pattern,
+    const FileIdentity& identity)
+{
+    for (CachedResult& result : this->_results)
+    {
+        if (result.lastUse != 0 && result.identity == identity && SamePattern(result.pattern, pattern) &&
+            SameFilename(result.filename, filename))
+        {
+            return &result;
+        }
+    }
+    return nullptr;
+}
+
+void CQueryCache::StoreResult(const wchar_t* const filename, const std::string_view pattern, const FileIdentity& identity)
+{
+    if (this->_scanResultSize > MaxCachedResultSize)
+    {
+        return;
+    }
+
+    // result of the changed file replaces the old one
+    CachedResult* result = nullptr;
+    for (CachedResult& slot : this->_results)
+    {
+        if (slot.lastUse != 0 && SamePattern(slot.pattern, pattern) && SameFilename(slot.filename, filename))
+        {
+            result = &slot;
+            break;
+        }
+    }
+    if (result == nullptr)
+    {
+        result = &GetLeastRecentlyUsed(this->_results);
+    }
+
+    result->lastUse = 0;
+    if (!CopyString(result->filename, filename, (wcslen(filename) + 1) * sizeof(wchar_t)) ||
+        !CopyString(result->pattern, pattern.data(), pattern.size()) ||
+        !CopyString(result->data, this->GetScanResult().data(), this->_scanResultSize))
+    {
+        // result is just not cached
+        return;
+    }
+
+    result->identity = identity;
+    result->dataSize = this->_scanResultSize;
+    result->lastUse = ++this->_clock;
+}
+
+// Reading mapped memory raises EXCEPTION_IN_PAGE_ERROR if reading from disk failed.
+// The function and its callees must not have objects with destructors because of __try.
+// Code generated by CFnMatchJit does not touch the stack, so the exception is unwound through it as through a leaf function.
+bool CQueryCache::Scan(const std::string_view view, const CFnMatchJit& lineMatcher)
+{
+    this->_scanResultSize = 0;
+    __try
+    {
+        return this->ScanLines(view, lineMatcher);
+    }
+    __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+    {
+        return false;
+    }
+}
+
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+bool CQueryCache::ScanLines(const std::string_view view, const CFnMatchJit& lineMatcher)
+{
+    std::string_view rest = view;
+
+    while (!rest.empty())
+    {
+        std::string_view line = rest;
+        const char* const eol = CSimdSearch::FindChar(rest.data(), rest.size(), '\n');
+        if (eol != nullptr)
+        {
+            line = rest.substr(0, eol - rest.data() + 1);
+        }
+        if (line.size() > MaxLogLineLength)
+        {
+            // Line is too long
+            return false;
+        }
+        rest.remove_prefix(line.size());
+
+        std::string_view matchView = line;
+
+        // Ignore CRLF/LF during matching:
+        if (!matchView.empty() && matchView.back() == '\n')
+        {
+            matchView.remove_suffix(1);
+            if (!matchView.empty() && matchView.back() == '\r')
+            {
+                matchView.remove_suffix(1);
+            }
+        }
+
+        if (lineMatcher.Match(matchView) && !this->AppendResult(line))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool CQueryCache::AppendResult(const std::string_view line)
+{
+    const size_t bufferSize = this->_scanBuffers[this->_scanBufferIndex].size;
+    if (this->_scanResultSize + line.size() > bufferSize)
+    {
+        size_t newSize = bufferSize > 0 ? bufferSize : MinScanResultSize;
+        while (newSize < this->_scanResultSize + line.size())
+        {
+            newSize *= 2;
+        }
+
+        // buffers are switched, so no objects with destructors are needed here, see Scan()
+        CCharBuffer& currentBuffer = this->_scanBuffers[this->_scanBufferIndex];
+        CCharBuffer& newBuffer = this->_scanBuffers[1 - this->_scanBufferIndex];
+        if (!newBuffer.Allocate(newSize))
+        {
+            return false;
+        }
+        memcpy(newBuffer.ptr, currentBuffer.ptr, this->_scanResultSize);
+        currentBuffer.Free();
+        this->_scanBufferIndex = 1 - this->_scanBufferIndex;
+    }
+
+    CCharBuffer& buffer = this->_scanBuffers[this->_scanBufferIndex];
+    memcpy(buffer.ptr + this->_scanResultSize, line.data(), line.size());
+    this->_scanResultSize += line.size();
+    return true;
+}
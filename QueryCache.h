@@ -0,0 +1,113 @@
+#pragma once
+
+#include "CharBuffer.h"
+#include "FnMatchJit.h"
+#include "ScanFile.h"
+
+#include <optional>    // this is STL, but it does not need exceptions
+#include <string_view> // this is STL, but it does not need exceptions
+
+#include <wchar.h> // for size_t, wchar_t
+
+#include <windows.h>
+
+
+// Query engine of the daemon: it keeps files mapped to memory between queries and caches query results.
+// Cache entries are checked by (size, last write time) of the file, a changed file is mapped and scanned again.
+// Mapped file can't be truncated, so files are unmapped after MappedFileIdleMs without queries and log rotation can proceed.
+// Not thread safe: daemon serves queries one by one.
+class CQueryCache
+{
+public:
+    static const size_t MaxMappedFiles      = 16;
+    static const size_t MaxCachedResults    = 64;
+    static const size_t MaxCachedResultSize = 16 * 1024 * 1024; // bigger results are returned, but not cached
+    static const DWORD  MappedFileIdleMs    = 1000;
+
+    struct Stats
+    {
+        size_t queries     = 0;
+        size_t resultHits  = 0; // result is taken from cache, file is not scanned
+        size_t mappingHits = 0; // file is scanned without opening and mapping it again
+    };
+
+public:
+    // return all matching lines of the file like CLogReader returns them one by one; return false on error
+    // Result is valid until the next call.
+    std::optional<std::string_view> Execute(const wchar_t* const filename, const char* const pattern);
+
+    // unmap files which are not used for idleMs; results stay cached
+    // return milliseconds until the next mapped file becomes idle or INFINITE when no file is mapped
+    DWORD UnmapIdleFiles(const DWORD idleMs = MappedFileIdleMs);
+
+    // unmap all files and drop all results
+    void Clear();
+
+    const Stats& GetStats() const
+    {
+        return this->_stats;
+    }
+
+protected:
+    struct FileIdentity
+    {
+        ULONGLONG size          = 0;
+        ULONGLONG lastWriteTime = 0;
+
+        bool operator==(const FileIdentity& other) const
+        {
+            return this->size == other.size && this->lastWriteTime == other.lastWriteTime;
+        }
+    };
+
+    struct MappedFile
+    {
+        CCharBuffer      filename; // '\0' terminated wchar_t string
+        FileIdentity     identity;
+        CScanFile        file;
+        std::string_view view;
+        size_t           lastUse = 0; // 0 means empty slot
+        ULONGLONG        lastUseTime = 0; // GetTickCount64()
+    };
+
+    struct CachedResult
+    {
+        CCharBuffer  filename; // '\0' terminated wchar_t string
+        CCharBuffer  pattern;
+        FileIdentity identity;
+        CCharBuffer  data;
+        size_t       dataSize = 0;
+        size_t       lastUse  = 0; // 0 means empty slot
+    };
+
+    static bool GetFileIdentity(const wchar_t* const filename, FileIdentity& identity);
+    static bool CopyString(CCharBuffer& buffer, const void* const data, const size_t size);
+    static bool SameFilename(const CCharBuffer& buffer, const wchar_t* const filename);
+    static bool SamePattern(const CCharBuffer& buffer, const std::string_view pattern);
+    static void Unmap(MappedFile& mappedFile);
+
+    MappedFile* GetMappedFile(const wchar_t* const filename, const FileIdentity& identity);
+    CachedResult* FindResult(const wchar_t* const filename, const std::string_view pattern, const FileIdentity& identity);
+    void StoreResult(const wchar_t* const filename, const std::string_view pattern, const FileIdentity& identity);
+    bool Scan(const std::string_view view, const CFnMatchJit& lineMatcher);
+    bool ScanLines(const std::string_view view, const CFnMatchJit& lineMatcher);
+    bool AppendResult(const std::string_view line);
+
+    std::string_view GetScanResult() const
+    {
+        return { this->_scanBuffers[this->_scanBufferIndex].ptr, this->_scanResultSize };
+    }
+
+protected:
+    MappedFile   _files[MaxMappedFiles];
+    CachedResult _results[MaxCachedResults];
+    size_t       _clock = 0; // source of lastUse values for LRU eviction
+
+    // result of the last scan; growing result is moved to the other buffer
+    CCharBuffer  _scanBuffers[2];
+    size_t       _scanBufferIndex = 0;
+    size_t       _scanResultSize  = 0;
+    CFnMatchJit  _lineMatcher; // pattern of the current query compiled to native code
+
+    Stats        _stats;
+};
@@ -0,0 +1,345 @@
+// winsock2.h must be included before windows.h, otherwise old winsock.h is used
+#include <winsock2.h>
+#include <afunix.h>
+
+#include "QueryDaemon.h"
+
+#include <string.h>
+
+
+namespace
+{
+    const size_t ResponseHeaderSize = sizeof(uint32_t) + sizeof(uint64_t);
+    const DWORD ClientTimeoutMs = 10000; // hung client must not block the daemon forever
+    const size_t MaxSocketChunk = 1024 * 1024 * 1024; // send() and recv() take int length
+
+    static_assert(CQueryDaemon::MaxRequestStringLength < UINT32_MAX);
+
+    bool Utf8ToWide(const char* const text, CCharBuffer& wideText)
+    {
+        // length includes terminating '\0'
+        const int wideLength = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, text, -1, nullptr, 0);
+        if (wideLength <= 0 || !wideText.Allocate(wideLength * sizeof(wchar_t), alignof(wchar_t)))
+        {
+            return false;
+        }
+        return MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, text, -1, reinterpret_cast<wchar_t*>(wideText.ptr), wideLength) == wideLength;
+    }
+
+    // text size does not include terminating '\0'
+    bool WideToUtf8(const wchar_t* const wideText, CCharBuffer& text, size_t& textSize)
+    {
+        // length includes terminating '\0'
+        const int length = WideCharToMultiByte(CP_UTF8, WC_ERR_INVALID_CHARS, wideText, -1, nullptr, 0, nullptr, nullptr);
+        if (length <= 0 || !text.Allocate(length))
+        {
+            return false;
+        }
+        textSize = length - 1;
+        return WideCharToMultiByte(CP_UTF8, WC_ERR_INVALID_CHARS, wideText, -1, text.ptr, length, nullptr, nullptr) == length;
+    }
+
+    // drive letter or UNC path: the daemon does not resolve paths in its own working directory
+    bool IsAbsolutePath(const wchar_t* const path)
+    {
+        const bool driveLetter = ((path[0] >= L'A' && path[0] <= L'Z') || (path[0] >= L'a' && path[0] <= L'z')) &&
+            path[1] == L':' && (path[2] == L'\\' || path[2] == L'/');
+        const bool unc = (path[0] == L'\\' || path[0] == L'/') && (path[1] == L'\\' || path[1] == L'/');
+        return driveLetter || unc;
+    }
+
+    // relative path is resolved in the working directory of the client; it is also the key of the daemon caches,
+    // so different spellings of the same path are one key
+    bool GetFullPath(const wchar_t* const path, CCharBuffer& fullPath)
+    {
+        // length includes terminating '\0'
+        const DWORD length = GetFullPathNameW(path, 0, nullptr, nullptr);
+        if (length == 0 || !fullPath.Allocate(length * sizeof(wchar_t), alignof(wchar_t)))
+        {
+            return false;
+        }
+        return GetFullPathNameW(path, length, reinterpret_cast<wchar_t*>(fullPath.ptr), nullptr) == length - 1;
+    }
+
+    bool GetSocketAddress(const wchar_t* const socketPath, sockaddr_un& address)
+    {
+        CCharBuffer path;
+        size_t pathSize = 0;
+        if (socketPath == nullptr || !WideToUtf8(socketPath, path, pathSize) || pathSize == 0 || pathSize >= sizeof(address.sun_path))
+        {
+            return false;
+        }
+
+        address = {};
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, path.ptr, pathSize);
+        return true;
+    }
+
+    bool SendAll(const SOCKET s, const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            const int sent = send(s, data, static_cast<int>(size < MaxSocketChunk ? size : MaxSocketChunk), 0);
+            if (sent <= 0)
+            {
+                return false;
+            }
+            data += sent;
+            size -= sent;
+        }
+        return true;
+    }
+
+    bool RecvAll(const SOCKET s, char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            const int received = recv(s, data, static_cast<int>(size < MaxSocketChunk ? size : MaxSocketChunk), 0);
+            if (received <= 0)
+            {
+                return false;
+            }
+            data += received;
+            size -= received;
+        }
+        return true;
+    }
+
+    // string is '\0' terminated; embedded '\0' is not allowed because filename and pattern are C strings
+    bool RecvString(const SOCKET s, const uint32_t length, CCharBuffer& text)
+    {
+        if (!text.Allocate(length + 1) || !RecvAll(s, text.ptr, length))
+        {
+            return false;
+        }
+        text.ptr[length] = '\0';
+        return memchr(text.ptr, '\0', length) == nullptr;
+    }
+
+    bool SendResponse(const SOCKET s, const CQueryDaemon::EStatus status, const std::string_view data)
+    {
+        const uint32_t statusValue = static_cast<uint32_t>(status);
+        const uint64_t dataSize = data.size();
+        char header[ResponseHeaderSize] = {};
+        memcpy(header, &statusValue, sizeof(statusValue));
+        memcpy(header + sizeof(statusValue), &dataSize, sizeof(dataSize));
+        return SendAll(s, header, sizeof(header)) && SendAll(s, data.data(), data.size());
+    }
+
+    bool SendQuery(const SOCKET s, const CCharBuffer& filename, const size_t filenameSize, const char* const pattern,
+        CCharBuffer& result)
+    {
+        const size_t patternSize = strlen(pattern);
+        if (filenameSize > CQueryDaemon::MaxRequestStringLength || patternSize > CQueryDaemon::MaxRequestStringLength)
+        {
+            return false;
+        }
+
+        const uint32_t lengths[2] = { static_cast<uint32_t>(filenameSize), static_cast<uint32_t>(patternSize) };
+        if (!SendAll(s, reinterpret_cast<const char*>(lengths), sizeof(lengths)) || !SendAll(s, filename.ptr, filenameSize) ||
+            !SendAll(s, pattern, patternSize))
+        {
+            return false;
+        }
+
+        char header[ResponseHeaderSize] = {};
+        if (!RecvAll(s, header, sizeof(header)))
+        {
+            return false;
+        }
+
+        uint32_t status = 0;
+        uint64_t dataSize = 0;
+        memcpy(&status, header, sizeof(status));
+        memcpy(&dataSize, header + sizeof(status), sizeof(dataSize));
+        if (status != static_cast<uint32_t>(CQueryDaemon::EStatus::Ok) || dataSize > SIZE_MAX)
+        {
+            return false;
+        }
+
+        return result.Allocate(static_cast<size_t>(dataSize)) && RecvAll(s, result.ptr, static_cast<size_t>(dataSize));
+    }
+}
+
+
+CQueryDaemon::~CQueryDaemon()
+{
+    this->Stop();
+    if (this->_winsockStarted)
+    {
+        WSACleanup();
+        this->_winsockStarted = false;
+    }
+}
+
+bool CQueryDaemon::Start(const wchar_t* const socketPath)
+{
+    sockaddr_un address = {};
+    if (this->_listenSocket.load() != NoSocket || !GetSocketAddress(socketPath, address))
+    {
+        return false;
+    }
+
+    if (!this->_winsockStarted)
+    {
+        WSADATA wsaData = {};
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+        {
+            return false;
+        }
+        this->_winsockStarted = true;
+    }
+
+    if (!this->_socketPath.Allocate((wcslen(socketPath) + 1) * sizeof(wchar_t), alignof(wchar_t)))
+    {
+        return false;
+    }
+    memcpy(this->_socketPath.ptr, socketPath, this->_socketPath.size);
+
+    // socket file of the previous run makes bind() fail
+    DeleteFileW(socketPath);
+
+    const SOCKET listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket == INVALID_SOCKET)
+    {
+        return false;
+    }
+
+    if (bind(listenSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenSocket, SOMAXCONN) != 0)
+    {
+        closesocket(listenSocket);
+        DeleteFileW(socketPath);
+        return false;
+    }
+
+    this->_listenSocket.store(listenSocket);
+    return true;
+}
+
+bool CQueryDaemon::Run()
+{
+    if (this->_listenSocket.load() == NoSocket)
+    {
+        return false;
+    }
+
+    while (true)
+    {
+        const SOCKET listenSocket = this->_listenSocket.load();
+        if (listenSocket == NoSocket)
+        {
+            return true;
+        }
+
+        // while files are mapped, clients are awaited with a timeout to unmap idle files: they block truncation by log rotation
+        const DWORD waitMs = this->_cache.UnmapIdleFiles();
+        if (waitMs != INFINITE)
+        {
+            fd_set readSockets;
+            FD_ZERO(&readSockets);
+            FD_SET(listenSocket, &readSockets);
+            const timeval timeout = { static_cast<long>(waitMs / 1000), static_cast<long>(waitMs % 1000 * 1000) };
+            const int ready = select(0, &readSockets, nullptr, nullptr, &timeout);
+            if (ready == SOCKET_ERROR)
+            {
+                return this->_listenSocket.load() == NoSocket;
+            }
+            if (ready == 0)
+            {
+                continue;
+            }
+        }
+
+        const SOCKET clientSocket = accept(listenSocket, nullptr, nullptr);
+        if (clientSocket == INVALID_SOCKET)
+        {
+            // Stop() closes the listening socket to break accept()
+            return this->_listenSocket.load() == NoSocket;
+        }
+
+        setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&ClientTimeoutMs), sizeof(ClientTimeoutMs));
+        setsockopt(clientSocket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&ClientTimeoutMs), sizeof(ClientTimeoutMs));
+
+        // failed client does not stop the daemon
+        this->ServeClient(clientSocket);
+        closesocket(clientSocket);
+    }
+}
+
+void CQueryDaemon::Stop()
+{
+    const SOCKET listenSocket = this->_listenSocket.exchange(NoSocket);
+    if (listenSocket != NoSocket)
+    {
+        closesocket(listenSocket);
+        DeleteFileW(reinterpret_cast<const wchar_t*>(this->_socketPath.ptr));
+    }
+}
+
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+bool CQueryDaemon::ServeClient(const uintptr_t clientSocket)
+{
+    uint32_t lengths[2] = {};
+    if (!RecvAll(clientSocket, reinterpret_cast<char*>(lengths), sizeof(lengths)))
+    {
+        return false;
+    }
+
+    if (lengths[0] == 0 || lengths[0] > MaxRequestStringLength || lengths[1] > MaxRequestStringLength)
+    {
+        SendResponse(clientSocket, EStatus::InvalidRequest, {});
+        return false;
+    }
+
+    CCharBuffer filename;
+    CCharBuffer pattern;
+    CCharBuffer wideFilename;
+    if (!RecvString(clientSocket, lengths[0], filename) || !RecvString(clientSocket, lengths[1], pattern) ||
+        !Utf8ToWide(filename.ptr, wideFilename) || !IsAbsolutePath(reinterpret_cast<const wchar_t*>(wideFilename.ptr)))
+    {
+        SendResponse(clientSocket, EStatus::InvalidRequest, {});
+        return false;
+    }
+
+    const auto result = this->_cache.Execute(reinterpret_cast<const wchar_t*>(wideFilename.ptr), pattern.ptr);
+    if (!result)
+    {
+        SendResponse(clientSocket, EStatus::QueryFailed, {});
+        return false;
+    }
+
+    return SendResponse(clientSocket, EStatus::Ok, *result);
+}
+
+bool QueryDaemon(const wchar_t* const socketPath, const wchar_t* const filename, const char* const pattern, CCharBuffer& result)
+{
+    sockaddr_un address = {};
+    CCharBuffer fullFilename;
+    CCharBuffer utf8Filename;
+    size_t utf8FilenameSize = 0;
+    if (!GetSocketAddress(socketPath, address) || filename == nullptr || pattern == nullptr ||
+        !GetFullPath(filename, fullFilename) || !WideToUtf8(reinterpret_cast<const wchar_t*>(fullFilename.ptr), utf8Filename, utf8FilenameSize))
+    {
+        return false;
+    }
+
+    WSADATA wsaData = {};
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    {
+        return false;
+    }
+
+    bool succeeded = false;
+    const SOCKET s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s != INVALID_SOCKET)
+    {
+        succeeded = connect(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0 &&
+            SendQuery(s, utf8Filename, utf8FilenameSize, pattern, result);
+        closesocket(s);
+    }
+
+    WSACleanup();
+    return succeeded;
+}
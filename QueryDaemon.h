@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CharBuffer.h"
+#include "QueryCache.h"
+
+#include <atomic> // this is STL, but it does not need exceptions
+
+#include <stdint.h>
+#include <wchar.h> // for size_t, wchar_t
+
+
+// Local query daemon: it serves queries of other processes over Unix domain socket (AF_UNIX, Windows 10 1803+).
+// Files stay mapped while they are queried and results stay cached, so repeated queries do not open and scan files again.
+// Protocol, one query per connection, integers are little endian:
+//   request:  uint32 filename length, uint32 pattern length, absolute filename in UTF-8, pattern
+//   response: uint32 status, uint64 data length, data (matching lines as CLogReader returns them)
+class CQueryDaemon
+{
+public:
+    enum class EStatus : uint32_t
+    {
+        Ok             = 0,
+        InvalidRequest = 1, // including relative filename
+        QueryFailed    = 2, // file can't be opened or scanned
+    };
+
+    static const size_t MaxRequestStringLength = 32 * 1024;
+
+public:
+    ~CQueryDaemon();
+
+    // create socket file and listen on it; existing socket file is replaced; return false on error
+    bool Start(const wchar_t* const socketPath);
+
+    // serve queries one by one until Stop() is called; return false on error
+    bool Run();
+
+    // stop listening; it may be called from another thread to break Run()
+    void Stop();
+
+    const CQueryCache::Stats& GetStats() const
+    {
+        return this->_cache.GetStats();
+    }
+
+protected:
+    bool ServeClient(const uintptr_t clientSocket);
+
+protected:
+    static const uintptr_t NoSocket = ~static_cast<uintptr_t>(0); // the same as INVALID_SOCKET
+
+    std::atomic<uintptr_t> _listenSocket   = ATOMIC_VAR_INIT(NoSocket);
+    bool                   _winsockStarted = false;
+    CCharBuffer            _socketPath; // '\0' terminated wchar_t string
+    CQueryCache            _cache;
+};
+
+// send one query to the daemon; relative filename is resolved in the current directory of the caller
+// result receives all matching lines; return false on error
+bool QueryDaemon(const wchar_t* const socketPath, const wchar_t* const filename, const char* const pattern, CCharBuffer& result);
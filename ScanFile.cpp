@@ -1,21 +1,15 @@
 #include "ScanFile.h"
 
 #include <assert.h>
+#include <limits.h> // for LLONG_MAX
 
 #include <algorithm>
 
 
 namespace
 {
-    // This is a dirty hack for speedup inter-thread communication on hyperthreading CPUs
-    // We could choose any other paid of logical CPUs based on the same physical CPU and sharing the same cache
-    // I'm sure it will give no effect in the current task because we are switching too rarely between threads.
-    const int PreferedCpuForMainThread = 0;
-    const int PreferedCpuForWorkerThread = PreferedCpuForMainThread + 1;
-    static_assert(PreferedCpuForMainThread % 2 == 0);
+    // This is a dirty hack for speedup inter-thread communication; thread placement is chosen by SpinlockInit() argument
     const DWORD ThreadPriority = THREAD_PRIORITY_TIME_CRITICAL;
-#   define ENABLE_THREAD_PREFERRED_AFFINITY 0
-#   define ENABLE_THREAD_FIXED_AFFINITY     0
 #   define ENABLE_THREAD_PRIORITY           0
 }
 
@@ -25,7 +19,7 @@ CScanFile::~CScanFile()
     this->Close();
 }
 
-bool CScanFile::Open(const wchar_t* const filename, const bool asyncMode)
+bool CScanFile::Open(const wchar_t* const filename, const bool asyncMode, const bool unbufferedMode, const bool allowWriters)
 {
     if (filename == nullptr || this->_hFile != nullptr)
     {
@@ -35,12 +29,15 @@ bool CScanFile::Open(const wchar_t* const filename, const bool asyncMode)
 
     const DWORD dwDesiredAccess = FILE_READ_DATA | FILE_READ_ATTRIBUTES; // minimal required rights
     // FILE_READ_ATTRIBUTES is needed to get file size for mapping file to memory
-    const DWORD dwShareMode = FILE_SHARE_READ; // allow parallel reading. And do not allow appending to log. Algorithm will not work correctly in this case.
+    const DWORD dwShareMode = FILE_SHARE_READ | // allow parallel reading. And do not allow appending to log by default. Algorithm will not work correctly in this case.
+        (allowWriters ? FILE_SHARE_WRITE | FILE_SHARE_DELETE : 0); // mapped file still can't be truncated, system fails such attempts; the query daemon unmaps idle files for this reason
     const DWORD dwCreationDisposition = OPEN_EXISTING;
-    const DWORD dwFlagsAndAttributes = FILE_FLAG_SEQUENTIAL_SCAN | (asyncMode ? FILE_FLAG_OVERLAPPED : 0); // read the comment below
+    const DWORD dwFlagsAndAttributes = FILE_FLAG_SEQUENTIAL_SCAN | (asyncMode ? FILE_FLAG_OVERLAPPED : 0) |
+        (unbufferedMode ? FILE_FLAG_NO_BUFFERING : 0); // read the comment below
 
     // FILE_FLAG_SEQUENTIAL_SCAN gives a cache speed optimization for pattern when file is read once from the beginning to the end
     // According to my tests FILE_FLAG_SEQUENTIAL_SCAN does no measurable impact but I would prefer to keep it here.
+    // FILE_FLAG_NO_BUFFERING disables system file cache for this handle, so FILE_FLAG_SEQUENTIAL_SCAN has no effect with it.
 
     this->_hFile = CreateFileW(filename, dwDesiredAccess, dwShareMode, nullptr, dwCreationDisposition, dwFlagsAndAttributes, nullptr);
 
@@ -64,17 +61,23 @@ bool CScanFile::Open(const wchar_t* const filename, const bool asyncMode)
     this->_asyncFileOffset.QuadPart = 0;
     this->_asyncOperationInProgress = false;
 
+    this->_stats.Reset();
+
     return true;
 }
 
 void CScanFile::Close()
 {
     this->SpinlockClean();
+    this->RingClean();
+    this->QueuedReadClean();
+    this->CompletionReadClean();
 
     if (this->_pViewOfFile != nullptr)
     {
         UnmapViewOfFile(this->_pViewOfFile);
         this->_pViewOfFile = nullptr;
+        this->_viewSize = 0;
     }
 
     if (this->_hFileMapping != nullptr)
@@ -98,6 +101,58 @@ void CScanFile::Close()
     this->_asyncOperationInProgress = false;
 }
 
+size_t CScanFile::GetSectorSize()
+{
+    if (this->_hFile == nullptr)
+    {
+        return 0;
+    }
+
+    // FileStorageInfo is supported since Windows 8
+    FILE_STORAGE_INFO storageInfo = {};
+    const bool gotInfoOk = !!GetFileInformationByHandleEx(this->_hFile, FileStorageInfo, &storageInfo, sizeof(storageInfo));
+    if (!gotInfoOk)
+    {
+        return 0;
+    }
+
+    return storageInfo.LogicalBytesPerSector;
+}
+
+bool CScanFile::GetIdentity(FileIdentity& identity)
+{
+    if (this->_hFile == nullptr)
+    {
+        return false;
+    }
+
+    BY_HANDLE_FILE_INFORMATION info = {};
+    const bool gotInfoOk = !!GetFileInformationByHandle(this->_hFile, &info);
+    if (!gotInfoOk)
+    {
+        return false;
+    }
+
+    identity.volumeSerial = info.dwVolumeSerialNumber;
+    identity.fileIndex = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    identity.size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    return true;
+}
+
+bool CScanFile::SetReadOffset(const uint64_t offset)
+{
+    if (this->_hFile == nullptr || this->_asyncOperationInProgress || this->_threadOperationInProgress || offset > LLONG_MAX)
+    {
+        return false;
+    }
+
+    // async reads take offset from OVERLAPPED, sync reads use file pointer of the handle
+    this->_asyncFileOffset.QuadPart = static_cast<LONGLONG>(offset);
+    LARGE_INTEGER distance = {};
+    distance.QuadPart = static_cast<LONGLONG>(offset);
+    return !!SetFilePointerEx(this->_hFile, distance, nullptr, FILE_BEGIN);
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// Implementation of mapping file to memory
 //////////////////////////////////////////////////////////////////////////
@@ -137,6 +192,8 @@ std::optional<std::string_view> CScanFile::MapToMemory()
         return {};
     }
 
+    // Large pages can't be used here: SEC_LARGE_PAGES and FILE_MAP_LARGE_PAGES are supported only for mappings backed by paging file.
+    // So file view is always mapped with normal 4 KB pages; see CCharBuffer::EAllocationPolicy for large page buffers.
     this->_pViewOfFile = MapViewOfFile(this->_hFileMapping, FILE_MAP_READ, 0, 0, fileSizeAsSizeT);
     if (this->_pViewOfFile == nullptr)
     {
@@ -144,10 +201,38 @@ std::optional<std::string_view> CScanFile::MapToMemory()
         this->_hFileMapping = nullptr;
         return {};
     }
+    this->_viewSize = fileSizeAsSizeT;
 
     return std::string_view(static_cast<const char*>(this->_pViewOfFile), fileSizeAsSizeT);
 }
 
+bool CScanFile::PrefetchMappedRange(const size_t offset, const size_t length)
+{
+    if (this->_pViewOfFile == nullptr || offset >= this->_viewSize)
+    {
+        return false;
+    }
+
+    // PrefetchVirtualMemory() is supported since Windows 8
+    WIN32_MEMORY_RANGE_ENTRY range = {};
+    range.VirtualAddress = static_cast<char*>(this->_pViewOfFile) + offset;
+    range.NumberOfBytes = min(length, this->_viewSize - offset);
+    return !!PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+bool CScanFile::DiscardMappedRange(const size_t offset, const size_t length)
+{
+    if (this->_pViewOfFile == nullptr || offset >= this->_viewSize)
+    {
+        return false;
+    }
+
+    // MSDN: Calling VirtualUnlock on a range of memory that is not locked releases the pages from the process's working set.
+    // It fails with ERROR_NOT_LOCKED in this case, so the result is ignored.
+    VirtualUnlock(static_cast<char*>(this->_pViewOfFile) + offset, min(length, this->_viewSize - offset));
+    return true;
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// Implementation of synchronous file API
 //////////////////////////////////////////////////////////////////////////
@@ -166,11 +251,14 @@ bool CScanFile::Read(char* const buffer, const size_t bufferLength, size_t& read
         return true;
     }
 
+    SCAN_STATS_SCOPE(this->_stats, EScanStage::Read);
+
     const DWORD usedBufferLength = static_cast<DWORD>(min(bufferLength, MAXDWORD));
     DWORD numberOfBytesRead = 0;
 
     const bool succeeded = !!ReadFile(this->_hFile, buffer, usedBufferLength, &numberOfBytesRead, nullptr);
     readBytes = numberOfBytesRead;
+    SCAN_STATS_BYTES(this->_stats, EScanStage::Read, numberOfBytesRead);
 
     return !!succeeded;
 }
@@ -214,6 +302,8 @@ bool CScanFile::AsyncReadWait(size_t& readBytes)
     assert(this->_hFile != nullptr);
     assert(this->_hAsyncEvent != nullptr);
 
+    SCAN_STATS_SCOPE(this->_stats, EScanStage::ReadWait);
+
     DWORD numberOfBytesRead = 0;
 
     const bool overlappedOk = !!GetOverlappedResult(this->_hFile, &this->_asyncOverlapped, &numberOfBytesRead, TRUE);
@@ -234,15 +324,240 @@ bool CScanFile::AsyncReadWait(size_t& readBytes)
     this->_asyncOperationInProgress = false;
 
     readBytes = numberOfBytesRead;
+    SCAN_STATS_BYTES(this->_stats, EScanStage::ReadWait, numberOfBytesRead);
+
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// Implementation of Asynchronous file API with a queue of operations in progress
+//////////////////////////////////////////////////////////////////////////
+
+bool CScanFile::QueuedReadInit()
+{
+    if (this->_hFile == nullptr || this->_hQueuedEvents[0] != nullptr)
+    {
+        return false;
+    }
+
+    for (HANDLE& hEvent : this->_hQueuedEvents)
+    {
+        hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        if (hEvent == nullptr)
+        {
+            this->QueuedReadClean();
+            return false;
+        }
+    }
+
+    this->_queuedFileOffset.QuadPart = 0;
+    this->_queuedFirst = 0;
+    this->_queuedCount = 0;
+
+    return true;
+}
+
+void CScanFile::QueuedReadClean()
+{
+    // Caller is going to free buffers, so all operations in progress must be finished before return
+    for (; this->_queuedCount != 0; --this->_queuedCount)
+    {
+        const size_t index = this->_queuedFirst;
+        this->_queuedFirst = (index + 1) % MaxQueuedReads;
+        if (this->_queuedAtEof[index])
+        {
+            continue;
+        }
+
+        OVERLAPPED& overlapped = this->_queuedOverlapped[index];
+        CancelIoEx(this->_hFile, &overlapped);
+        DWORD numberOfBytesRead = 0;
+        GetOverlappedResult(this->_hFile, &overlapped, &numberOfBytesRead, TRUE); // ignore result, operation is cancelled or completed
+    }
+
+    for (HANDLE& hEvent : this->_hQueuedEvents)
+    {
+        if (hEvent != nullptr)
+        {
+            CloseHandle(hEvent);
+            hEvent = nullptr;
+        }
+    }
+}
+
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+bool CScanFile::QueuedReadStart(char* const buffer, const size_t bufferLength)
+{
+    if (this->_hFile == nullptr || buffer == nullptr || this->_hQueuedEvents[0] == nullptr || this->_queuedCount == MaxQueuedReads)
+    {
+        return false;
+    }
+
+    const size_t index = (this->_queuedFirst + this->_queuedCount) % MaxQueuedReads;
+    const DWORD usedBufferLength = static_cast<DWORD>(min(bufferLength, MAXDWORD));
+
+    OVERLAPPED& overlapped = this->_queuedOverlapped[index];
+    overlapped = {};
+    overlapped.hEvent = this->_hQueuedEvents[index];
+    overlapped.Offset = this->_queuedFileOffset.LowPart;
+    overlapped.OffsetHigh = this->_queuedFileOffset.HighPart;
+    this->_queuedAtEof[index] = false;
+
+    const bool readOk = !!ReadFile(this->_hFile, buffer, usedBufferLength, nullptr, &overlapped);
+    if (!readOk)
+    {
+        const DWORD error = GetLastError();
+        if (error == ERROR_HANDLE_EOF)
+        {
+            // Operation failed immediately without completion; QueuedReadWait() will report zero bytes read
+            this->_queuedAtEof[index] = true;
+        }
+        else if (error != ERROR_IO_PENDING)
+        {
+            return false;
+        }
+    }
+
+    this->_queuedFileOffset.QuadPart += usedBufferLength;
+    ++this->_queuedCount;
+
+    return true;
+}
+
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+bool CScanFile::QueuedReadWait(size_t& readBytes)
+{
+    if (this->_queuedCount == 0)
+    {
+        return false;
+    }
+    assert(this->_hFile != nullptr);
+
+    SCAN_STATS_SCOPE(this->_stats, EScanStage::ReadWait);
+
+    const size_t index = this->_queuedFirst;
+    this->_queuedFirst = (index + 1) % MaxQueuedReads;
+    --this->_queuedCount;
+
+    if (this->_queuedAtEof[index])
+    {
+        readBytes = 0;
+        return true;
+    }
+
+    DWORD numberOfBytesRead = 0;
+    const bool overlappedOk = !!GetOverlappedResult(this->_hFile, &this->_queuedOverlapped[index], &numberOfBytesRead, TRUE);
+    if (!overlappedOk)
+    {
+        if (GetLastError() == ERROR_HANDLE_EOF)
+        {
+            // Emulate usual ReadFile() logic when reading at the end succeeds with zero bytes read
+            readBytes = 0;
+            return true;
+        }
+        return false;
+    }
+
+    readBytes = numberOfBytesRead;
+    SCAN_STATS_BYTES(this->_stats, EScanStage::ReadWait, numberOfBytesRead);
+
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// Implementation of Asynchronous file API with completion callback in system thread pool
+//////////////////////////////////////////////////////////////////////////
+
+bool CScanFile::CompletionReadInit(ReadCompletionCallback* const callback, void* const context)
+{
+    if (this->_hFile == nullptr || callback == nullptr || this->_completionIo != nullptr)
+    {
+        return false;
+    }
+
+    this->_completionIo = CreateThreadpoolIo(this->_hFile, CompletionIoCallback, this, nullptr);
+    if (this->_completionIo == nullptr)
+    {
+        return false;
+    }
+
+    this->_completionCallback = callback;
+    this->_completionContext = context;
+    this->_completionFileOffset.QuadPart = 0;
+    return true;
+}
+
+void CScanFile::CompletionReadClean()
+{
+    if (this->_completionIo == nullptr)
+    {
+        return;
+    }
+
+    // Caller is going to free the buffer, so operation in progress must be finished and its callback must be completed
+    CancelIoEx(this->_hFile, &this->_completionOverlapped); // ignore result, there may be no operation in progress
+    WaitForThreadpoolIoCallbacks(this->_completionIo, FALSE);
+    CloseThreadpoolIo(this->_completionIo);
+    this->_completionIo = nullptr;
+    this->_completionCallback = nullptr;
+    this->_completionContext = nullptr;
+}
+
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+bool CScanFile::CompletionReadStart(char* const buffer, const size_t bufferLength)
+{
+    if (this->_completionIo == nullptr || buffer == nullptr)
+    {
+        return false;
+    }
+
+    const DWORD usedBufferLength = static_cast<DWORD>(min(bufferLength, MAXDWORD));
+
+    this->_completionOverlapped = {};
+    this->_completionOverlapped.Offset = this->_completionFileOffset.LowPart;
+    this->_completionOverlapped.OffsetHigh = this->_completionFileOffset.HighPart;
+
+    // StartThreadpoolIo() must be called before every operation, otherwise thread pool ignores its completion
+    StartThreadpoolIo(this->_completionIo);
+    const bool readOk = !!ReadFile(this->_hFile, buffer, usedBufferLength, nullptr, &this->_completionOverlapped);
+    if (!readOk)
+    {
+        const DWORD error = GetLastError();
+        if (error != ERROR_IO_PENDING)
+        {
+            // operation failed immediately, so there will be no completion
+            CancelThreadpoolIo(this->_completionIo);
+            if (error != ERROR_HANDLE_EOF)
+            {
+                return false;
+            }
+            this->_completionCallback(this->_completionContext, true, 0);
+        }
+    }
+    // Operation completed synchronously is reported by thread pool too: handle has no FILE_SKIP_COMPLETION_PORT_ON_SUCCESS flag
 
     return true;
 }
 
+void CALLBACK CScanFile::CompletionIoCallback(PTP_CALLBACK_INSTANCE /*instance*/, void* context, void* /*overlapped*/, ULONG ioResult,
+    ULONG_PTR numberOfBytesTransferred, PTP_IO /*io*/)
+{
+    CScanFile* const that = static_cast<CScanFile*>(context);
+
+    // reading at the end of file is not an error, it is the same as reading of zero bytes
+    const bool succeeded = ioResult == NO_ERROR || ioResult == ERROR_HANDLE_EOF;
+    const size_t readBytes = succeeded ? static_cast<size_t>(numberOfBytesTransferred) : 0;
+    that->_completionFileOffset.QuadPart += readBytes;
+    SCAN_STATS_BYTES(that->_stats, EScanStage::Read, readBytes);
+
+    that->_completionCallback(that->_completionContext, succeeded, readBytes);
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// Implementation of file API executed in a separate thread with the help of spinlocks
 //////////////////////////////////////////////////////////////////////////
 
-bool CScanFile::SpinlockInit()
+bool CScanFile::SpinlockInit(const EThreadPlacement placement)
 {
     if (this->_hThread != nullptr)
     {
@@ -258,13 +573,20 @@ bool CScanFile::SpinlockInit()
     this->_threadReadSucceeded     = false;
     // no need to synchronize before worker thread is started
 
-    // This is a dirty hack for speedup inter-thread communication on hyperthreading CPUs
-#if ENABLE_THREAD_PREFERRED_AFFINITY
-    SetThreadIdealProcessor(GetCurrentThread(), PreferedCpuForMainThread);
-#endif
-#if ENABLE_THREAD_FIXED_AFFINITY
-    SetThreadAffinityMask(GetCurrentThread(), 1 << PreferedCpuForMainThread);
-#endif
+    // Current thread and worker thread are bound to a pair of logical processors chosen by topology.
+    // Placement is only an optimization: threads are not bound if it is impossible on this machine.
+    this->_threadPlacement = EThreadPlacement::Default;
+    if (placement != EThreadPlacement::Default)
+    {
+        CCpuTopology topology;
+        GROUP_AFFINITY mainThreadAffinity = {};
+        if (topology.Init() && topology.GetThreadPairAffinity(placement, mainThreadAffinity, this->_workerThreadAffinity) &&
+            SetThreadGroupAffinity(GetCurrentThread(), &mainThreadAffinity, &this->_mainThreadPreviousAffinity))
+        {
+            this->_threadPlacement = placement;
+        }
+    }
+
 #if ENABLE_THREAD_PRIORITY
     SetThreadPriority(GetCurrentThread(), ThreadPriority);
 #endif
@@ -272,18 +594,16 @@ bool CScanFile::SpinlockInit()
     using ThreadProcType = unsigned __stdcall(void*);
     ThreadProcType* const threadProc = [](void* p) -> unsigned
     {
-        // This is a dirty hack for speedup inter-thread communication on hyperthreading CPUs
-#if ENABLE_THREAD_PREFERRED_AFFINITY
-        SetThreadIdealProcessor(GetCurrentThread(), PreferedCpuForWorkerThread);
-#endif
-#if ENABLE_THREAD_FIXED_AFFINITY
-        SetThreadAffinityMask(GetCurrentThread(), 1 << PreferedCpuForWorkerThread);
-#endif
+        CScanFile* const that = static_cast<CScanFile*>(p);
+
+        if (that->_threadPlacement != EThreadPlacement::Default)
+        {
+            CCpuTopology::SetCurrentThreadAffinity(that->_workerThreadAffinity); // ignore result, placement is only an optimization
+        }
 #if ENABLE_THREAD_PRIORITY
         SetThreadPriority(GetCurrentThread(), ThreadPriority);
 #endif
 
-        CScanFile* const that = static_cast<CScanFile*>(p);
         that->SpinlockThreadProc();
         _endthreadex(0);
         return 0;
@@ -293,6 +613,12 @@ bool CScanFile::SpinlockInit()
     this->_hThread = reinterpret_cast<HANDLE>(_beginthreadex(nullptr, 0, threadProc, this, 0, &threadID));
     if (this->_hThread == nullptr)
     {
+        if (this->_threadPlacement != EThreadPlacement::Default)
+        {
+            // the calling thread must not stay bound after failed open
+            SetThreadGroupAffinity(GetCurrentThread(), &this->_mainThreadPreviousAffinity, nullptr);
+            this->_threadPlacement = EThreadPlacement::Default;
+        }
         return false;
     }
 
@@ -305,7 +631,16 @@ void CScanFile::SpinlockClean()
     {
         this->_threadFinishSpinlock.store(true, std::memory_order_relaxed); // we won't reorder after WaitForSingleObject
         WaitForSingleObject(this->_hThread, INFINITE); // ignore return value in this case
+        CloseHandle(this->_hThread);
         this->_hThread = nullptr;
+        this->_threadOperationInProgress = false; // started read is abandoned, the file may be reopened
+
+        if (this->_threadPlacement != EThreadPlacement::Default)
+        {
+            // SpinlockInit() bound the thread we are called from
+            SetThreadGroupAffinity(GetCurrentThread(), &this->_mainThreadPreviousAffinity, nullptr);
+            this->_threadPlacement = EThreadPlacement::Default;
+        }
     }
 }
 
@@ -340,6 +675,8 @@ bool CScanFile::SpinlockReadWait(size_t& readBytes)
     }
     this->_threadOperationInProgress = false;
 
+    SCAN_STATS_SCOPE(this->_stats, EScanStage::ReadWait);
+
     // Wait for _threadOperationReadCompletedSpinlock == True and reset it:
     while (true)
     {
@@ -355,6 +692,7 @@ bool CScanFile::SpinlockReadWait(size_t& readBytes)
     {
         return false;
     }
+    SCAN_STATS_BYTES(this->_stats, EScanStage::ReadWait, readBytes);
 
     return true;
 }
@@ -388,3 +726,160 @@ void CScanFile::SpinlockThreadProc()
 }
 
 //////////////////////////////////////////////////////////////////////////
+/// Implementation of file API executed in a separate thread filling a ring of buffers
+//////////////////////////////////////////////////////////////////////////
+
+bool CScanFile::RingInit(char* const* const buffers, const size_t slotCount, const size_t bufferLength)
+{
+    if (this->_hFile == nullptr || this->_hRingThread != nullptr || buffers == nullptr || slotCount < 2 || slotCount > MaxRingSlots)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < slotCount; ++i)
+    {
+        if (buffers[i] == nullptr)
+        {
+            return false;
+        }
+        this->_ringBuffers[i] = buffers[i];
+        this->_ringReadBytes[i] = 0;
+        this->_ringReadSucceeded[i] = false;
+    }
+    this->_ringSlotCount = slotCount;
+    this->_ringBufferLength = bufferLength;
+
+    this->_ringAcquiredCount = 0;
+    this->_ringReleasedCount = 0;
+    this->_ringEof = false;
+    this->_ringFinishSpinlock.store(false, std::memory_order_relaxed);
+    this->_ringFilledSpinlock.store(0, std::memory_order_relaxed);
+    this->_ringReleasedSpinlock.store(0, std::memory_order_relaxed);
+    // no need to synchronize before worker thread is started
+
+    using ThreadProcType = unsigned __stdcall(void*);
+    ThreadProcType* const threadProc = [](void* p) -> unsigned
+    {
+        CScanFile* const that = static_cast<CScanFile*>(p);
+        that->RingThreadProc();
+        _endthreadex(0);
+        return 0;
+    };
+
+    unsigned threadID = 0;
+    this->_hRingThread = reinterpret_cast<HANDLE>(_beginthreadex(nullptr, 0, threadProc, this, 0, &threadID));
+    if (this->_hRingThread == nullptr)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+void CScanFile::RingClean()
+{
+    if (this->_hRingThread != nullptr)
+    {
+        this->_ringFinishSpinlock.store(true, std::memory_order_relaxed); // we won't reorder after WaitForSingleObject
+        WaitForSingleObject(this->_hRingThread, INFINITE); // ignore return value in this case
+        CloseHandle(this->_hRingThread);
+        this->_hRingThread = nullptr;
+    }
+}
+
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+bool CScanFile::RingAcquire(size_t& slotIndex, size_t& readBytes)
+{
+    if (this->_hRingThread == nullptr || this->_ringEof)
+    {
+        return false;
+    }
+    if (this->_ringAcquiredCount - this->_ringReleasedCount == this->_ringSlotCount)
+    {
+        // all slots are held by consumer, worker thread would never fill the next one
+        return false;
+    }
+
+    SCAN_STATS_SCOPE(this->_stats, EScanStage::ReadWait);
+
+    // Wait for the worker thread to fill the next slot:
+    while (this->_ringFilledSpinlock.load(std::memory_order_acquire) == this->_ringAcquiredCount)
+    {
+        YieldProcessor();
+    }
+
+    slotIndex = this->_ringAcquiredCount % this->_ringSlotCount;
+    ++this->_ringAcquiredCount;
+
+    readBytes = this->_ringReadBytes[slotIndex];
+    if (!this->_ringReadSucceeded[slotIndex])
+    {
+        this->_ringEof = true;
+        return false;
+    }
+    if (readBytes == 0)
+    {
+        this->_ringEof = true;
+    }
+    SCAN_STATS_BYTES(this->_stats, EScanStage::ReadWait, readBytes);
+
+    return true;
+}
+
+__declspec(noinline) // noinline is added to help CPU profiling in release version
+bool CScanFile::RingRelease()
+{
+    if (this->_hRingThread == nullptr || this->_ringReleasedCount == this->_ringAcquiredCount)
+    {
+        return false;
+    }
+
+    ++this->_ringReleasedCount;
+    // release order: consumer has finished reading the slot before worker thread overwrites it
+    this->_ringReleasedSpinlock.store(this->_ringReleasedCount, std::memory_order_release);
+
+    return true;
+}
+
+void CScanFile::RingThreadProc()
+{
+    size_t filledCount = 0;
+
+    while (true)
+    {
+        if (this->_ringFinishSpinlock.load(std::memory_order_relaxed))
+        {
+            // thread exit signal is caught
+            break;
+        }
+
+        if (filledCount - this->_ringReleasedSpinlock.load(std::memory_order_acquire) == this->_ringSlotCount)
+        {
+            // ring is full, wait for consumer
+            YieldProcessor();
+            continue;
+        }
+
+        const size_t slotIndex = filledCount % this->_ringSlotCount;
+        size_t readBytes = 0;
+        const bool readOk = this->Read(this->_ringBuffers[slotIndex], this->_ringBufferLength, readBytes);
+
+        this->_ringReadBytes[slotIndex] = readBytes;
+        this->_ringReadSucceeded[slotIndex] = readOk;
+
+        ++filledCount;
+        this->_ringFilledSpinlock.store(filledCount, std::memory_order_release);
+
+        if (!readOk || readBytes == 0)
+        {
+            // EOF or error: there is nothing to read anymore, just wait for exit signal
+            while (!this->_ringFinishSpinlock.load(std::memory_order_relaxed))
+            {
+                YieldProcessor();
+            }
+            break;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
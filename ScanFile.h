@@ -1,11 +1,15 @@
 #pragma once
 
+#include "CpuTopology.h"
+#include "ScanStats.h"
+
 #include <atomic>      // this is STL, but it does not need exceptions
 #include <mutex>       // this is STL, but it does not need exceptions
 #include <new> // for std::hardware_constructive_interference_size
 #include <optional>    // this is STL, but it does not need exceptions
 #include <string_view> // this is STL, but it does not need exceptions
 
+#include <stdint.h>
 #include <wchar.h> // for size_t, wchar_t
 
 #include <windows.h>
@@ -13,14 +17,40 @@
 
 class CScanFile
 {
+public:
+    // Volume serial number and file index identify the file while it is open: a rotated log is a different file at the same path
+    struct FileIdentity
+    {
+        uint64_t volumeSerial = 0;
+        uint64_t fileIndex    = 0;
+        uint64_t size         = 0;
+    };
+
 public:
     ~CScanFile();
 
-    bool Open(const wchar_t* const filename, const bool asyncMode);
+    // unbufferedMode opens file with FILE_FLAG_NO_BUFFERING: data bypasses system file cache, so a huge scan does not evict
+    // hot cache of other processes. Reads must use sector aligned buffers, lengths and offsets then, see GetSectorSize().
+    // allowWriters lets other processes append to the file while it is open; caller must detect changes by itself.
+    bool Open(const wchar_t* const filename, const bool asyncMode, const bool unbufferedMode = false, const bool allowWriters = false);
     void Close();
 
+    // sector size required for unbuffered IO alignment; return 0 on error
+    size_t GetSectorSize();
+
+    bool GetIdentity(FileIdentity& identity);
+
+    // file offset of the next Read(), AsyncReadStart() or SpinlockReadStart(); set it before reading is started
+    bool SetReadOffset(const uint64_t offset);
+
     std::optional<std::string_view> MapToMemory();
 
+    // Hints for the view returned by MapToMemory(); offset is relative to the beginning of the view, range is clipped by view size.
+    // Prefetch reads the range with big IO requests instead of page fault per page; it returns without waiting for the data.
+    bool PrefetchMappedRange(const size_t offset, const size_t length);
+    // Remove the range from process working set. Pages stay in system file cache, so the range is still readable.
+    bool DiscardMappedRange(const size_t offset, const size_t length);
+
     bool Read(char* const buffer, const size_t bufferLength, size_t& readBytes);
 
     // Current limitation: only one async operation can be in progress.
@@ -28,13 +58,56 @@ public:
     bool AsyncReadStart(char* const buffer, const size_t bufferLength);
     bool AsyncReadWait(size_t& readBytes);
 
+    // Up to MaxQueuedReads async operations can be in progress. File offsets are assigned sequentially on start,
+    // QueuedReadWait() waits for the oldest operation. File must be opened in async mode.
+    static const size_t MaxQueuedReads = 8;
+    bool QueuedReadInit();
+    void QueuedReadClean(); // cancel and wait for all operations in progress
+    bool QueuedReadStart(char* const buffer, const size_t bufferLength);
+    bool QueuedReadWait(size_t& readBytes);
+
+    // Completion of async read is reported by a callback in a thread of the system thread pool, nobody waits for it.
+    // File must be opened in async mode. Only one operation can be in progress, readBytes == 0 means EOF.
+    // Callback may be called from the calling thread before CompletionReadStart() returns (EOF is reported immediately).
+    using ReadCompletionCallback = void(void* const context, const bool succeeded, const size_t readBytes);
+    bool CompletionReadInit(ReadCompletionCallback* const callback, void* const context);
+    void CompletionReadClean(); // cancel operation in progress and wait for its callback
+    bool CompletionReadStart(char* const buffer, const size_t bufferLength); // callback is not called if start failed
+
     // Current limitation: only one async operation can be in progress.
-    bool SpinlockInit();
+    // placement binds the calling thread and worker thread to a pair of logical processors; call SpinlockClean() from the same thread.
+    bool SpinlockInit(const EThreadPlacement placement = EThreadPlacement::Default);
     void SpinlockClean();
     bool SpinlockReadStart(char* const buffer, const size_t bufferLength);
     bool SpinlockReadWait(size_t& readBytes);
     void SpinlockThreadProc();
 
+    // actually applied placement; Default if requested placement is impossible on this machine
+    EThreadPlacement GetSpinlockThreadPlacement() const
+    {
+        return this->_threadPlacement;
+    }
+
+    // Separate thread fills a ring of buffers in file order; it stays up to slotCount - 1 chunks ahead of the consumer.
+    // Ring is single producer, single consumer and lock free. Consumer acquires filled slots in order and releases them in the same order.
+    // Data is written to buffers[i] .. buffers[i] + bufferLength, memory before buffers[i] can be used by consumer.
+    static const size_t MaxRingSlots = 16;
+    bool RingInit(char* const* const buffers, const size_t slotCount, const size_t bufferLength);
+    void RingClean();
+    bool RingAcquire(size_t& slotIndex, size_t& readBytes); // wait for the next filled slot; readBytes == 0 means EOF
+    bool RingRelease(); // give the oldest acquired slot back to the worker thread
+    void RingThreadProc();
+
+    // Hot path counters; they are collected only when ENABLE_SCAN_STATS is set
+    CScanStats& Stats()
+    {
+        return this->_stats;
+    }
+
+protected:
+    static void CALLBACK CompletionIoCallback(PTP_CALLBACK_INSTANCE instance, void* context, void* overlapped, ULONG ioResult,
+        ULONG_PTR numberOfBytesTransferred, PTP_IO io);
+
 protected:
     alignas(std::hardware_constructive_interference_size) // small speedup to get a bunch of variables into single cache line
     HANDLE              _hFile           = nullptr;
@@ -42,6 +115,7 @@ protected:
     // For memory mapping:
     HANDLE              _hFileMapping    = nullptr;
     void*               _pViewOfFile     = nullptr;
+    size_t              _viewSize        = 0;
 
     // For async IO:
     HANDLE              _hAsyncEvent     = nullptr;
@@ -49,8 +123,26 @@ protected:
     OVERLAPPED          _asyncOverlapped = {};
     bool                _asyncOperationInProgress = false;
 
+    // For queued async IO:
+    HANDLE              _hQueuedEvents[MaxQueuedReads]    = {};
+    OVERLAPPED          _queuedOverlapped[MaxQueuedReads] = {};
+    bool                _queuedAtEof[MaxQueuedReads]      = {}; // ReadFile() may fail immediately at EOF without completion
+    LARGE_INTEGER       _queuedFileOffset = {};
+    size_t              _queuedFirst      = 0; // index of the oldest operation in progress
+    size_t              _queuedCount      = 0; // number of operations in progress
+
+    // For async IO with completion callback:
+    PTP_IO                  _completionIo         = nullptr;
+    ReadCompletionCallback* _completionCallback   = nullptr;
+    void*                   _completionContext    = nullptr;
+    OVERLAPPED              _completionOverlapped = {};
+    LARGE_INTEGER           _completionFileOffset = {}; // updated by thread pool callback before ReadCompletionCallback is called
+
     // Separate thread + spin locks:
     HANDLE              _hThread         = nullptr;
+    EThreadPlacement    _threadPlacement = EThreadPlacement::Default;
+    GROUP_AFFINITY      _workerThreadAffinity       = {};
+    GROUP_AFFINITY      _mainThreadPreviousAffinity = {};
 
     // for protection against wrong API usage, not for use in a worker thread, no memory protection:
     // this is not about synchronization, but about correct class method call sequence
@@ -71,4 +163,29 @@ protected:
     std::atomic<bool>   _threadOperationReadStartSpinlock     = ATOMIC_VAR_INIT(false);
     alignas(std::hardware_destructive_interference_size)
     std::atomic<bool>   _threadOperationReadCompletedSpinlock = ATOMIC_VAR_INIT(false);
+
+    // Separate thread + ring of buffers:
+    HANDLE              _hRingThread       = nullptr;
+    char*               _ringBuffers[MaxRingSlots] = {};
+    size_t              _ringSlotCount     = 0;
+    size_t              _ringBufferLength  = 0;
+
+    // slot results are written by worker thread before _ringFilledCount is increased
+    size_t              _ringReadBytes[MaxRingSlots]     = {};
+    bool                _ringReadSucceeded[MaxRingSlots] = {};
+
+    // consumer data, not for use in a worker thread:
+    size_t              _ringAcquiredCount = 0;
+    size_t              _ringReleasedCount = 0;
+    bool                _ringEof           = false; // EOF or error is acquired, worker thread does not read anymore
+
+    // Counters are growing all the time, slot index is counter % _ringSlotCount
+    alignas(std::hardware_destructive_interference_size)
+    std::atomic<bool>   _ringFinishSpinlock      = ATOMIC_VAR_INIT(false);
+    alignas(std::hardware_destructive_interference_size)
+    std::atomic<size_t> _ringFilledSpinlock      = ATOMIC_VAR_INIT(0); // written by worker thread
+    alignas(std::hardware_destructive_interference_size)
+    std::atomic<size_t> _ringReleasedSpinlock    = ATOMIC_VAR_INIT(0); // written by consumer
+
+    CScanStats          _stats;
 };
@@ -0,0 +1,29 @@
+#include "ScanStats.h"
+
+
+void CScanStats::Reset()
+{
+    for (StageCounters& counters : this->stages)
+    {
+        counters = StageCounters();
+    }
+    this->lines = 0;
+    this->matchCandidates = 0;
+    this->matchedLines = 0;
+}
+
+void CScanStats::Print(FILE* const stream) const
+{
+    const char* const stageNames[] = { "read", "read wait", "split", "match" };
+    static_assert(sizeof(stageNames) / sizeof(stageNames[0]) == static_cast<size_t>(EScanStage::Count));
+
+    fprintf(stream, "Scan statistics (cycles are TSC ticks):\n");
+    fprintf(stream, "%-10s %14s %20s %16s %12s\n", "stage", "calls", "cycles", "bytes", "cycles/byte");
+    for (size_t i = 0; i < static_cast<size_t>(EScanStage::Count); ++i)
+    {
+        const StageCounters& counters = this->stages[i];
+        const double cyclesPerByte = counters.bytes != 0 ? static_cast<double>(counters.cycles) / counters.bytes : 0.0;
+        fprintf(stream, "%-10s %14llu %20llu %16llu %12.3f\n", stageNames[i], counters.calls, counters.cycles, counters.bytes, cyclesPerByte);
+    }
+    fprintf(stream, "lines: %llu, match candidates: %llu, matched lines: %llu\n", this->lines, this->matchCandidates, this->matchedLines);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <new> // for std::hardware_destructive_interference_size
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <intrin.h> // for __rdtsc()
+
+
+// Per-stage hot path counters. They answer the question whether a slow scan is I/O-bound, split-bound or match-bound
+// without attaching a profiler. Set ENABLE_SCAN_STATS to 1 (here or via compiler /D option) to collect them.
+// With 0 all SCAN_STATS_* hooks compile to nothing and the hot path is not affected at all.
+#ifndef ENABLE_SCAN_STATS
+#   define ENABLE_SCAN_STATS 0
+#endif
+
+
+enum class EScanStage
+{
+    Read,     // CScanFile::Read(); executed in a worker thread by CSpinlockLineReader
+    ReadWait, // consumer waits for data in AsyncReadWait() / SpinlockReadWait()
+    Split,    // EOL search in buffered data
+    Match,    // CFnMatch::Match() call
+    Count
+};
+
+class CScanStats
+{
+public:
+    // every stage gets its own cache line: Read stage is updated by a worker thread
+    struct alignas(std::hardware_destructive_interference_size) StageCounters
+    {
+        uint64_t cycles = 0;
+        uint64_t calls  = 0;
+        uint64_t bytes  = 0;
+    };
+
+    void Reset();
+
+    // Print summary table. Call it when scan is stopped (after Close() or EOF), worker thread writes counters during scan.
+    void Print(FILE* const stream) const;
+
+public:
+    StageCounters stages[static_cast<size_t>(EScanStage::Count)];
+    uint64_t      lines           = 0; // lines returned by line reader
+    uint64_t      matchCandidates = 0; // lines passed to the matcher
+    uint64_t      matchedLines    = 0; // lines returned to the caller
+};
+
+// Adds CPU cycles (TSC) spent in the scope to the stage counters
+class CScanStatsScope
+{
+public:
+    CScanStatsScope(CScanStats& stats, const EScanStage stage)
+        : _counters(stats.stages[static_cast<size_t>(stage)])
+        , _startCycles(__rdtsc())
+    {
+    }
+
+    ~CScanStatsScope()
+    {
+        this->_counters.cycles += __rdtsc() - this->_startCycles;
+        ++this->_counters.calls;
+    }
+
+protected:
+    CScanStats::StageCounters& _counters;
+    const uint64_t             _startCycles;
+};
+
+
+#if ENABLE_SCAN_STATS
+#   define SCAN_STATS_SCOPE(stats, stage)        const CScanStatsScope scanStatsScope((stats), (stage))
+#   define SCAN_STATS_BYTES(stats, stage, count) ((stats).stages[static_cast<size_t>(stage)].bytes += (count))
+#   define SCAN_STATS_ADD(stats, counter, value) ((stats).counter += (value))
+#else
+#   define SCAN_STATS_SCOPE(stats, stage)        ((void)0)
+#   define SCAN_STATS_BYTES(stats, stage, count) ((void)0)
+#   define SCAN_STATS_ADD(stats, counter, value) ((void)0)
+#endif
@@ -0,0 +1,874 @@
+#include "SimdSearch.h"
+
+#include <string.h>
+
+#include <intrin.h>
+
+
+namespace
+{
+    size_t LowestBit(const unsigned long mask)
+    {
+        unsigned long index = 0;
+        _BitScanForward(&index, mask);
+        return index;
+    }
+
+#if defined(_M_X64)
+    size_t LowestBit64(const unsigned long long mask)
+    {
+        unsigned long index = 0;
+        _BitScanForward64(&index, mask);
+        return index;
+    }
+#endif
+
+    ESimdLevel DetectLevel()
+    {
+        int info[4] = {};
+        __cpuidex(info, 0, 0);
+        const int maxLeaf = info[0];
+        if (maxLeaf < 1)
+        {
+            return ESimdLevel::Scalar;
+        }
+
+        __cpuidex(info, 1, 0);
+        const bool sse42 = (info[2] & (1 << 20)) != 0;
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (!sse42)
+        {
+            return ESimdLevel::Scalar;
+        }
+        if (!osxsave || !avx || maxLeaf < 7)
+        {
+            return ESimdLevel::Sse42;
+        }
+
+        // OS must save vector registers on context switch: XMM and YMM state bits of XCR0
+        const unsigned long long xcr0 = _xgetbv(0);
+        if ((xcr0 & 0x6) != 0x6)
+        {
+            return ESimdLevel::Sse42;
+        }
+
+        __cpuidex(info, 7, 0);
+        const bool avx2 = (info[1] & (1 << 5)) != 0;
+        const bool avx512f = (info[1] & (1 << 16)) != 0;
+        const bool avx512bw = (info[1] & (1 << 30)) != 0;
+        if (!avx2)
+        {
+            return ESimdLevel::Sse42;
+        }
+
+#if defined(_M_X64)
+        // opmask, upper halves of ZMM0-15 and ZMM16-31 state bits of XCR0
+        if (avx512f && avx512bw && (xcr0 & 0xe0) == 0xe0)
+        {
+            return ESimdLevel::Avx512Bw;
+        }
+#else
+        (void)avx512f;
+        (void)avx512bw;
+#endif
+        return ESimdLevel::Avx2;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    const char* FindCharScalar(const char* const data, const size_t size, const char ch)
+    {
+        return static_cast<const char*>(memchr(data, ch, size));
+    }
+
+    const char* FindNthCharScalar(const char* const data, const size_t size, const char ch, size_t count)
+    {
+        if (count == 0)
+        {
+            return data;
+        }
+        const char* p = data;
+        const char* const pEnd = data + size;
+        while (true)
+        {
+            p = static_cast<const char*>(memchr(p, ch, pEnd - p));
+            if (p == nullptr || --count == 0)
+            {
+                return p;
+            }
+            ++p;
+        }
+    }
+
+    bool EqualScalar(const char* const left, const char* const right, const size_t size)
+    {
+        return memcmp(left, right, size) == 0;
+    }
+
+    const char* FindLiteralScalar(const char* const data, const size_t size, const char* const literal, const size_t literalSize)
+    {
+        if (literalSize == 0)
+        {
+            return data;
+        }
+
+        const char* p = data;
+        const char* const pEnd = data + size;
+        while (static_cast<size_t>(pEnd - p) >= literalSize)
+        {
+            // the first character of the last possible occurrence is the last candidate
+            p = static_cast<const char*>(memchr(p, literal[0], (pEnd - p) - literalSize + 1));
+            if (p == nullptr)
+            {
+                return nullptr;
+            }
+            if (memcmp(p + 1, literal + 1, literalSize - 1) == 0)
+            {
+                return p;
+            }
+            ++p;
+        }
+        return nullptr;
+    }
+
+    const char* FindNeedleScalar(const char* const data, const size_t size, const CSimdSearch::Needle& needle)
+    {
+        if (needle.size == 0)
+        {
+            return data;
+        }
+        if (size < needle.size)
+        {
+            return nullptr;
+        }
+
+        // p runs over positions of the rarest byte
+        const char rare1 = needle.literal[needle.rareOffset1];
+        const char rare2 = needle.literal[needle.rareOffset2];
+        const char* p = data + needle.rareOffset1;
+        const char* const pLast = data + (size - needle.size) + needle.rareOffset1;
+        while (p <= pLast)
+        {
+            p = static_cast<const char*>(memchr(p, rare1, pLast - p + 1));
+            if (p == nullptr)
+            {
+                return nullptr;
+            }
+            const char* const candidate = p - needle.rareOffset1;
+            if (candidate[needle.rareOffset2] == rare2 && memcmp(candidate, needle.literal, needle.size) == 0)
+            {
+                return candidate;
+            }
+            ++p;
+        }
+        return nullptr;
+    }
+
+    // state of a literal set scan; kernels find candidate positions and pass them to Verify()
+    struct LiteralSetScan
+    {
+        const CSimdSearch::LiteralSet& set;
+        const char* const data;
+        const size_t      size;
+        const bool        stopAtFirst;   // FindAnyLiteral() stops at the first occurrence, FindAllLiterals() when all are found
+        uint32_t          notFound;      // bits of literals not found yet
+        uint32_t          found = 0;
+        const char*       first = nullptr;
+        size_t            firstIndex = 0;
+
+        // check literals of candidate buckets at the position; return true when the scan is done
+        bool Verify(const size_t position, const unsigned buckets)
+        {
+            for (size_t i = 0; i < this->set.count; ++i)
+            {
+                const uint32_t bit = 1u << i;
+                if ((this->notFound & bit) == 0 || (buckets & (1u << (i % CSimdSearch::LiteralSet::BucketCount))) == 0 ||
+                    this->size - position < this->set.sizes[i] ||
+                    memcmp(this->data + position, this->set.literals[i], this->set.sizes[i]) != 0)
+                {
+                    continue;
+                }
+                if (this->stopAtFirst)
+                {
+                    this->first = this->data + position;
+                    this->firstIndex = i;
+                    return true;
+                }
+                this->found |= bit;
+                this->notFound &= ~bit;
+                if (this->notFound == 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    // return true when the scan is done
+    bool ScanLiteralSetScalar(LiteralSetScan& scan, const size_t start)
+    {
+        const CSimdSearch::LiteralSet& set = scan.set;
+        for (size_t position = start; position + set.fingerprintSize <= scan.size; ++position)
+        {
+            unsigned buckets = 0xff;
+            for (size_t j = 0; j < set.fingerprintSize; ++j)
+            {
+                const unsigned char ch = static_cast<unsigned char>(scan.data[position + j]);
+                buckets &= set.lowNibbleMasks[j][ch & 0xf] & set.highNibbleMasks[j][ch >> 4];
+            }
+            if (buckets != 0 && scan.Verify(position, buckets))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    const char* FindCharSse42(const char* const data, const size_t size, const char ch)
+    {
+        const __m128i needle = _mm_set1_epi8(ch);
+        size_t i = 0;
+        for (; size - i >= 16; i += 16)
+        {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            const unsigned long mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+            if (mask != 0)
+            {
+                return data + i + LowestBit(mask);
+            }
+        }
+        return FindCharScalar(data + i, size - i, ch);
+    }
+
+    // occurrences in a vector are counted by clearing the lowest bit of its mask: there is one load per vector, not per occurrence
+    const char* FindNthCharSse42(const char* const data, const size_t size, const char ch, size_t count)
+    {
+        if (count == 0)
+        {
+            return data;
+        }
+        const __m128i needle = _mm_set1_epi8(ch);
+        size_t i = 0;
+        for (; size - i >= 16; i += 16)
+        {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            for (unsigned long mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)); mask != 0; mask &= mask - 1)
+            {
+                if (--count == 0)
+                {
+                    return data + i + LowestBit(mask);
+                }
+            }
+        }
+        return FindNthCharScalar(data + i, size - i, ch, count);
+    }
+
+    bool EqualSse42(const char* const left, const char* const right, const size_t size)
+    {
+        size_t i = 0;
+        for (; size - i >= 16; i += 16)
+        {
+            const __m128i leftBlock = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+            const __m128i rightBlock = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(leftBlock, rightBlock)) != 0xffff)
+            {
+                return false;
+            }
+        }
+        return EqualScalar(left + i, right + i, size - i);
+    }
+
+    const char* FindLiteralSse42(const char* const data, const size_t size, const char* const literal, const size_t literalSize)
+    {
+        if (literalSize == 0)
+        {
+            return data;
+        }
+
+        // PCMPESTRI finds the first 16 bytes of the literal, including a prefix of them at the end of the block
+        const size_t prefixSize = literalSize < 16 ? literalSize : 16;
+        char prefixBytes[16] = {};
+        memcpy(prefixBytes, literal, prefixSize);
+        const __m128i prefix = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prefixBytes));
+
+        size_t i = 0;
+        while (size - i >= 16)
+        {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            const int index = _mm_cmpestri(prefix, static_cast<int>(prefixSize), block, 16,
+                _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ORDERED | _SIDD_LEAST_SIGNIFICANT);
+            if (index == 16)
+            {
+                i += 16;
+                continue;
+            }
+
+            const size_t position = i + index;
+            if (size - position < literalSize)
+            {
+                // no room for the literal here and further
+                return nullptr;
+            }
+            if (EqualSse42(data + position, literal, literalSize))
+            {
+                return data + position;
+            }
+            i = position + 1;
+        }
+        return FindLiteralScalar(data + i, size - i, literal, literalSize);
+    }
+
+    const char* FindNeedleSse42(const char* const data, const size_t size, const CSimdSearch::Needle& needle)
+    {
+        if (needle.size < 2)
+        {
+            return needle.size == 0 ? data : FindCharSse42(data, size, needle.literal[0]);
+        }
+
+        const __m128i rare1 = _mm_set1_epi8(needle.literal[needle.rareOffset1]);
+        const __m128i rare2 = _mm_set1_epi8(needle.literal[needle.rareOffset2]);
+        size_t i = 0;
+        for (; i + needle.size + 15 <= size; i += 16)
+        {
+            const __m128i block1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + needle.rareOffset1));
+            const __m128i block2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + needle.rareOffset2));
+            unsigned long mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block1, rare1), _mm_cmpeq_epi8(block2, rare2)));
+            while (mask != 0)
+            {
+                const size_t position = i + LowestBit(mask);
+                if (EqualSse42(data + position, needle.literal, needle.size))
+                {
+                    return data + position;
+                }
+                mask &= mask - 1;
+            }
+        }
+        return FindNeedleScalar(data + i, size - i, needle);
+    }
+
+    // PSHUFB is SSSE3, every SSE4.2 CPU has it
+    bool ScanLiteralSetSse42(LiteralSetScan& scan, const size_t start)
+    {
+        const CSimdSearch::LiteralSet& set = scan.set;
+        __m128i lowTables[CSimdSearch::LiteralSet::MaxFingerprint];
+        __m128i highTables[CSimdSearch::LiteralSet::MaxFingerprint];
+        for (size_t j = 0; j < set.fingerprintSize; ++j)
+        {
+            lowTables[j] = _mm_load_si128(reinterpret_cast<const __m128i*>(set.lowNibbleMasks[j]));
+            highTables[j] = _mm_load_si128(reinterpret_cast<const __m128i*>(set.highNibbleMasks[j]));
+        }
+        const __m128i nibbleMask = _mm_set1_epi8(0xf);
+
+        size_t i = start;
+        for (; i + set.fingerprintSize + 15 <= scan.size; i += 16)
+        {
+            // lane k keeps buckets whose fingerprint matches the bytes starting at i + k
+            __m128i buckets = _mm_set1_epi8(-1);
+            for (size_t j = 0; j < set.fingerprintSize; ++j)
+            {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(scan.data + i + j));
+                const __m128i low = _mm_shuffle_epi8(lowTables[j], _mm_and_si128(block, nibbleMask));
+                const __m128i high = _mm_shuffle_epi8(highTables[j], _mm_and_si128(_mm_srli_epi16(block, 4), nibbleMask));
+                buckets = _mm_and_si128(buckets, _mm_and_si128(low, high));
+            }
+
+            unsigned long mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(buckets, _mm_setzero_si128())) & 0xffff;
+            if (mask == 0)
+            {
+                continue;
+            }
+            alignas(16) unsigned char laneBuckets[16];
+            _mm_store_si128(reinterpret_cast<__m128i*>(laneBuckets), buckets);
+            while (mask != 0)
+            {
+                const size_t lane = LowestBit(mask);
+                if (scan.Verify(i + lane, laneBuckets[lane]))
+                {
+                    return true;
+                }
+                mask &= mask - 1;
+            }
+        }
+        return ScanLiteralSetScalar(scan, i);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    const char* FindCharAvx2(const char* const data, const size_t size, const char ch)
+    {
+        const __m256i needle = _mm256_set1_epi8(ch);
+        size_t i = 0;
+        for (; size - i >= 32; i += 32)
+        {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            const unsigned long mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+            if (mask != 0)
+            {
+                return data + i + LowestBit(mask);
+            }
+        }
+        return FindCharSse42(data + i, size - i, ch);
+    }
+
+    const char* FindNthCharAvx2(const char* const data, const size_t size, const char ch, size_t count)
+    {
+        if (count == 0)
+        {
+            return data;
+        }
+        const __m256i needle = _mm256_set1_epi8(ch);
+        size_t i = 0;
+        for (; size - i >= 32; i += 32)
+        {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            unsigned long mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+            for (; mask != 0; mask &= mask - 1)
+            {
+                if (--count == 0)
+                {
+                    return data + i + LowestBit(mask);
+                }
+            }
+        }
+        return FindNthCharSse42(data + i, size - i, ch, count);
+    }
+
+    bool EqualAvx2(const char* const left, const char* const right, const size_t size)
+    {
+        size_t i = 0;
+        for (; size - i >= 32; i += 32)
+        {
+            const __m256i leftBlock = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + i));
+            const __m256i rightBlock = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(right + i));
+            if (static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(leftBlock, rightBlock))) != 0xffffffff)
+            {
+                return false;
+            }
+        }
+        return EqualSse42(left + i, right + i, size - i);
+    }
+
+    const char* FindNeedleAvx2(const char* const data, const size_t size, const CSimdSearch::Needle& needle)
+    {
+        if (needle.size < 2)
+        {
+            return needle.size == 0 ? data : FindCharAvx2(data, size, needle.literal[0]);
+        }
+
+        const __m256i rare1 = _mm256_set1_epi8(needle.literal[needle.rareOffset1]);
+        const __m256i rare2 = _mm256_set1_epi8(needle.literal[needle.rareOffset2]);
+        size_t i = 0;
+        for (; i + needle.size + 31 <= size; i += 32)
+        {
+            const __m256i block1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + needle.rareOffset1));
+            const __m256i block2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + needle.rareOffset2));
+            const __m256i candidates = _mm256_and_si256(_mm256_cmpeq_epi8(block1, rare1), _mm256_cmpeq_epi8(block2, rare2));
+            unsigned long mask = static_cast<unsigned>(_mm256_movemask_epi8(candidates));
+            while (mask != 0)
+            {
+                const size_t position = i + LowestBit(mask);
+                if (EqualAvx2(data + position, needle.literal, needle.size))
+                {
+                    return data + position;
+                }
+                mask &= mask - 1;
+            }
+        }
+        return FindNeedleSse42(data + i, size - i, needle);
+    }
+
+    // candidates are positions where both the first and the last characters of the literal match
+    const char* FindLiteralAvx2(const char* const data, const size_t size, const char* const literal, const size_t literalSize)
+    {
+        const CSimdSearch::Needle needle = { literal, literalSize, 0, literalSize != 0 ? literalSize - 1 : 0 };
+        return FindNeedleAvx2(data, size, needle);
+    }
+
+    bool ScanLiteralSetAvx2(LiteralSetScan& scan, const size_t start)
+    {
+        const CSimdSearch::LiteralSet& set = scan.set;
+        __m256i lowTables[CSimdSearch::LiteralSet::MaxFingerprint];
+        __m256i highTables[CSimdSearch::LiteralSet::MaxFingerprint];
+        for (size_t j = 0; j < set.fingerprintSize; ++j)
+        {
+            // VPSHUFB looks up in each 128-bit lane separately, so both lanes get the same table
+            lowTables[j] = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(set.lowNibbleMasks[j])));
+            highTables[j] = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(set.highNibbleMasks[j])));
+        }
+        const __m256i nibbleMask = _mm256_set1_epi8(0xf);
+
+        size_t i = start;
+        for (; i + set.fingerprintSize + 31 <= scan.size; i += 32)
+        {
+            __m256i buckets = _mm256_set1_epi8(-1);
+            for (size_t j = 0; j < set.fingerprintSize; ++j)
+            {
+                const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(scan.data + i + j));
+                const __m256i low = _mm256_shuffle_epi8(lowTables[j], _mm256_and_si256(block, nibbleMask));
+                const __m256i high = _mm256_shuffle_epi8(highTables[j], _mm256_and_si256(_mm256_srli_epi16(block, 4), nibbleMask));
+                buckets = _mm256_and_si256(buckets, _mm256_and_si256(low, high));
+            }
+
+            unsigned long mask = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(buckets, _mm256_setzero_si256())));
+            if (mask == 0)
+            {
+                continue;
+            }
+            alignas(32) unsigned char laneBuckets[32];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(laneBuckets), buckets);
+            while (mask != 0)
+            {
+                const size_t lane = LowestBit(mask);
+                if (scan.Verify(i + lane, laneBuckets[lane]))
+                {
+                    return true;
+                }
+                mask &= mask - 1;
+            }
+        }
+        return ScanLiteralSetSse42(scan, i);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+#if defined(_M_X64)
+    // masked load does not touch memory of masked out bytes, so the tail is read without crossing the end of data
+    __mmask64 TailMask(const size_t size)
+    {
+        return ~0ull >> (64 - size);
+    }
+
+    const char* FindCharAvx512Bw(const char* const data, const size_t size, const char ch)
+    {
+        const __m512i needle = _mm512_set1_epi8(ch);
+        size_t i = 0;
+        for (; size - i >= 64; i += 64)
+        {
+            const __mmask64 mask = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(data + i), needle);
+            if (mask != 0)
+            {
+                return data + i + LowestBit64(mask);
+            }
+        }
+
+        if (i < size)
+        {
+            const __mmask64 tailMask = TailMask(size - i);
+            const __mmask64 mask = _mm512_mask_cmpeq_epi8_mask(tailMask, _mm512_maskz_loadu_epi8(tailMask, data + i), needle);
+            if (mask != 0)
+            {
+                return data + i + LowestBit64(mask);
+            }
+        }
+        return nullptr;
+    }
+
+    const char* FindNthCharAvx512Bw(const char* const data, const size_t size, const char ch, size_t count)
+    {
+        if (count == 0)
+        {
+            return data;
+        }
+        const __m512i needle = _mm512_set1_epi8(ch);
+        for (size_t i = 0; i < size; i += 64)
+        {
+            const __mmask64 tailMask = size - i >= 64 ? ~0ull : TailMask(size - i);
+            __mmask64 mask = _mm512_mask_cmpeq_epi8_mask(tailMask, _mm512_maskz_loadu_epi8(tailMask, data + i), needle);
+            for (; mask != 0; mask &= mask - 1)
+            {
+                if (--count == 0)
+                {
+                    return data + i + LowestBit64(mask);
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    bool EqualAvx512Bw(const char* const left, const char* const right, const size_t size)
+    {
+        size_t i = 0;
+        for (; size - i >= 64; i += 64)
+        {
+            if (_mm512_cmpneq_epi8_mask(_mm512_loadu_si512(left + i), _mm512_loadu_si512(right + i)) != 0)
+            {
+                return false;
+            }
+        }
+
+        if (i < size)
+        {
+            const __mmask64 tailMask = TailMask(size - i);
+            const __m512i leftBlock = _mm512_maskz_loadu_epi8(tailMask, left + i);
+            const __m512i rightBlock = _mm512_maskz_loadu_epi8(tailMask, right + i);
+            return _mm512_mask_cmpneq_epi8_mask(tailMask, leftBlock, rightBlock) == 0;
+        }
+        return true;
+    }
+
+    const char* FindNeedleAvx512Bw(const char* const data, const size_t size, const CSimdSearch::Needle& needle)
+    {
+        if (needle.size < 2)
+        {
+            return needle.size == 0 ? data : FindCharAvx512Bw(data, size, needle.literal[0]);
+        }
+
+        const __m512i rare1 = _mm512_set1_epi8(needle.literal[needle.rareOffset1]);
+        const __m512i rare2 = _mm512_set1_epi8(needle.literal[needle.rareOffset2]);
+        size_t i = 0;
+        for (; i + needle.size + 63 <= size; i += 64)
+        {
+            const __mmask64 mask1 = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(data + i + needle.rareOffset1), rare1);
+            __mmask64 mask = _mm512_mask_cmpeq_epi8_mask(mask1, _mm512_loadu_si512(data + i + needle.rareOffset2), rare2);
+            while (mask != 0)
+            {
+                const size_t position = i + LowestBit64(mask);
+                if (EqualAvx512Bw(data + position, needle.literal, needle.size))
+                {
+                    return data + position;
+                }
+                mask &= mask - 1;
+            }
+        }
+        return FindNeedleAvx2(data + i, size - i, needle);
+    }
+
+    const char* FindLiteralAvx512Bw(const char* const data, const size_t size, const char* const literal, const size_t literalSize)
+    {
+        const CSimdSearch::Needle needle = { literal, literalSize, 0, literalSize != 0 ? literalSize - 1 : 0 };
+        return FindNeedleAvx512Bw(data, size, needle);
+    }
+#endif
+
+    //////////////////////////////////////////////////////////////////////////
+
+    struct Kernels
+    {
+        const char* (*findChar)(const char* const data, const size_t size, const char ch);
+        const char* (*findNthChar)(const char* const data, const size_t size, const char ch, size_t count);
+        const char* (*findLiteral)(const char* const data, const size_t size, const char* const literal, const size_t literalSize);
+        const char* (*findNeedle)(const char* const data, const size_t size, const CSimdSearch::Needle& needle);
+        bool (*scanLiteralSet)(LiteralSetScan& scan, const size_t start);
+        bool (*equal)(const char* const left, const char* const right, const size_t size);
+    };
+
+    const Kernels KernelsByLevel[] =
+    {
+        { FindCharScalar, FindNthCharScalar, FindLiteralScalar, FindNeedleScalar, ScanLiteralSetScalar, EqualScalar },
+        { FindCharSse42, FindNthCharSse42, FindLiteralSse42, FindNeedleSse42, ScanLiteralSetSse42, EqualSse42 },
+        { FindCharAvx2, FindNthCharAvx2, FindLiteralAvx2, FindNeedleAvx2, ScanLiteralSetAvx2, EqualAvx2 },
+#if defined(_M_X64)
+        // literal set scan is verification bound, 64 byte lookups gain nothing over AVX2
+        { FindCharAvx512Bw, FindNthCharAvx512Bw, FindLiteralAvx512Bw, FindNeedleAvx512Bw, ScanLiteralSetAvx2, EqualAvx512Bw },
+#else
+        // never used: DetectLevel() does not report AVX-512 for 32-bit code
+        { FindCharAvx2, FindNthCharAvx2, FindLiteralAvx2, FindNeedleAvx2, ScanLiteralSetAvx2, EqualAvx2 },
+#endif
+    };
+    static_assert(sizeof(KernelsByLevel) / sizeof(KernelsByLevel[0]) == static_cast<size_t>(ESimdLevel::Count));
+
+    // typical bytes of access and application logs, from the most frequent one
+    const char CommonLogBytes[] = " 0123456789.:/-etaoinsrhlcdu\"GETPOSTHmpgfw_=[]()y,bkvAIMNCDLRx+jqzUBFVWKYXQZJ&?%;'!#@$*<>{}|\\^`~\r\n\t";
+
+    // Constant initialized: static initializers of other files may search before the dynamic initializers of this file,
+    // then they get scalar kernels. The supported level is chosen by the dynamic initializer below unless SetLevel() was called.
+    ESimdLevel     g_level = ESimdLevel::Scalar;
+    const Kernels* g_kernels = &KernelsByLevel[static_cast<size_t>(ESimdLevel::Scalar)];
+    bool           g_levelIsSet = false;
+
+    const bool g_defaultLevelIsSet = g_levelIsSet || (CSimdSearch::SetLevel(CSimdSearch::GetSupportedLevel()), true);
+}
+
+
+CByteFrequency::CByteFrequency()
+{
+    for (uint64_t& weight : this->_weights)
+    {
+        weight = 0;
+    }
+
+    // the first listed byte gets the biggest weight; bytes which are not listed are rare
+    const size_t commonCount = sizeof(CommonLogBytes) - 1;
+    for (size_t i = 0; i < commonCount; ++i)
+    {
+        uint64_t& weight = this->_weights[static_cast<unsigned char>(CommonLogBytes[i])];
+        if (weight == 0)
+        {
+            weight = commonCount - i;
+        }
+    }
+}
+
+void CByteFrequency::Train(const char* const data, const size_t size)
+{
+    const CByteFrequency defaultFrequency;
+    uint64_t counts[256] = {};
+    for (size_t i = 0; i < size; ++i)
+    {
+        ++counts[static_cast<unsigned char>(data[i])];
+    }
+
+    // default weights are less than 256, they only order bytes with the same count
+    for (size_t i = 0; i < 256; ++i)
+    {
+        this->_weights[i] = (counts[i] << 8) | defaultFrequency._weights[i];
+    }
+}
+
+const CByteFrequency& CByteFrequency::GetDefault()
+{
+    // function-local static: it is constructed by the first call, even from a static initializer of another file
+    static const CByteFrequency defaultFrequency;
+    return defaultFrequency;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+ESimdLevel CSimdSearch::GetSupportedLevel()
+{
+    static const ESimdLevel supportedLevel = DetectLevel();
+    return supportedLevel;
+}
+
+ESimdLevel CSimdSearch::GetLevel()
+{
+    return g_level;
+}
+
+ESimdLevel CSimdSearch::SetLevel(const ESimdLevel level)
+{
+    const ESimdLevel supportedLevel = GetSupportedLevel();
+    g_level = level < supportedLevel ? level : supportedLevel;
+    g_kernels = &KernelsByLevel[static_cast<size_t>(g_level)];
+    g_levelIsSet = true;
+    return g_level;
+}
+
+const char* CSimdSearch::FindChar(const char* const data, const size_t size, const char ch)
+{
+    return g_kernels->findChar(data, size, ch);
+}
+
+const char* CSimdSearch::FindNthChar(const char* const data, const size_t size, const char ch, const size_t count)
+{
+    return g_kernels->findNthChar(data, size, ch, count);
+}
+
+const char* CSimdSearch::FindLiteral(const char* const data, const size_t size, const char* const literal, const size_t literalSize)
+{
+    return g_kernels->findLiteral(data, size, literal, literalSize);
+}
+
+CSimdSearch::Needle CSimdSearch::MakeNeedle(const char* const literal, const size_t literalSize, const CByteFrequency& frequency)
+{
+    Needle needle;
+    needle.literal = literal;
+    needle.size = literalSize;
+    if (literalSize < 2)
+    {
+        return needle;
+    }
+
+    size_t rareOffset1 = 0;
+    for (size_t i = 1; i < literalSize; ++i)
+    {
+        if (frequency.GetWeight(literal[i]) < frequency.GetWeight(literal[rareOffset1]))
+        {
+            rareOffset1 = i;
+        }
+    }
+
+    // the same byte at another offset filters candidates too, but a different byte is preferred
+    size_t rareOffset2 = rareOffset1 == 0 ? 1 : 0;
+    for (size_t i = 0; i < literalSize; ++i)
+    {
+        if (i == rareOffset1)
+        {
+            continue;
+        }
+        const bool sameByte = literal[i] == literal[rareOffset1];
+        const bool bestIsSameByte = literal[rareOffset2] == literal[rareOffset1];
+        if ((bestIsSameByte && !sameByte) ||
+            (bestIsSameByte == sameByte && frequency.GetWeight(literal[i]) < frequency.GetWeight(literal[rareOffset2])))
+        {
+            rareOffset2 = i;
+        }
+    }
+
+    needle.rareOffset1 = rareOffset1;
+    needle.rareOffset2 = rareOffset2;
+    return needle;
+}
+
+const char* CSimdSearch::FindNeedle(const char* const data, const size_t size, const Needle& needle)
+{
+    return g_kernels->findNeedle(data, size, needle);
+}
+
+bool CSimdSearch::AddLiteral(LiteralSet& set, const char* const literal, const size_t literalSize)
+{
+    static_assert(LiteralSet::MaxLiterals <= 32, "bits of literals are returned in uint32_t");
+    static_assert(LiteralSet::BucketCount <= 8, "bucket bits are bytes of the tables");
+    if (literalSize == 0 || set.count == LiteralSet::MaxLiterals)
+    {
+        return false;
+    }
+
+    set.literals[set.count] = literal;
+    set.sizes[set.count] = literalSize;
+    ++set.count;
+
+    // tables are rebuilt: the new literal may be the shortest one
+    set.fingerprintSize = LiteralSet::MaxFingerprint;
+    for (size_t i = 0; i < set.count; ++i)
+    {
+        set.fingerprintSize = set.sizes[i] < set.fingerprintSize ? set.sizes[i] : set.fingerprintSize;
+    }
+    memset(set.lowNibbleMasks, 0, sizeof(set.lowNibbleMasks));
+    memset(set.highNibbleMasks, 0, sizeof(set.highNibbleMasks));
+    for (size_t i = 0; i < set.count; ++i)
+    {
+        const unsigned char bucketBit = static_cast<unsigned char>(1u << (i % LiteralSet::BucketCount));
+        for (size_t j = 0; j < set.fingerprintSize; ++j)
+        {
+            const unsigned char ch = static_cast<unsigned char>(set.literals[i][j]);
+            set.lowNibbleMasks[j][ch & 0xf] |= bucketBit;
+            set.highNibbleMasks[j][ch >> 4] |= bucketBit;
+        }
+    }
+    return true;
+}
+
+const char* CSimdSearch::FindAnyLiteral(const char* const data, const size_t size, const LiteralSet& set, size_t& literalIndex)
+{
+    if (set.count == 0)
+    {
+        return nullptr;
+    }
+    const bool stopAtFirst = true;
+    LiteralSetScan scan = { set, data, size, stopAtFirst, UINT32_MAX };
+    g_kernels->scanLiteralSet(scan, 0);
+    literalIndex = scan.firstIndex;
+    return scan.first;
+}
+
+uint32_t CSimdSearch::FindAllLiterals(const char* const data, const size_t size, const LiteralSet& set)
+{
+    if (set.count == 0)
+    {
+        return 0;
+    }
+    const bool stopAtFirst = false;
+    LiteralSetScan scan = { set, data, size, stopAtFirst, set.GetAllBits() };
+    g_kernels->scanLiteralSet(scan, 0);
+    return scan.found;
+}
+
+bool CSimdSearch::Equal(const char* const left, const char* const right, const size_t size)
+{
+    return g_kernels->equal(left, right, size);
+}
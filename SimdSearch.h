@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+#include <wchar.h> // for size_t
+
+
+// Instruction set levels of CSimdSearch kernels; every level uses instructions of all lower levels too
+enum class ESimdLevel
+{
+    Scalar,   // C library functions
+    Sse42,    // 16 byte vectors, PCMPESTRI for literal search
+    Avx2,     // 32 byte vectors
+    Avx512Bw, // 64 byte vectors and masked loads; x64 only
+    Count
+};
+
+// Relative frequency of byte values in log data. Literal search looks for its rarest bytes: they give fewer false candidates.
+class CByteFrequency
+{
+public:
+    // default table of typical text logs: spaces, digits, punctuation of dates and paths, lowercase letters are common
+    CByteFrequency();
+
+    // count bytes of sample data (e.g. head of the scanned file); default table orders bytes with equal counts
+    void Train(const char* const data, const size_t size);
+
+    // bigger weight means more frequent byte
+    uint64_t GetWeight(const char ch) const
+    {
+        return this->_weights[static_cast<unsigned char>(ch)];
+    }
+
+    static const CByteFrequency& GetDefault();
+
+protected:
+    uint64_t _weights[256];
+};
+
+// Hand-vectorized kernels for the hot path: line splitting and literal search of CFnMatch and CLogReader.
+// The best level supported by CPU and OS is chosen once at startup via cpuid.
+// Vector loads never cross the end of data (tails are handled by scalar code or masked loads),
+// so kernels are safe for data at the very end of mapped file.
+class CSimdSearch
+{
+public:
+    // Literal prepared for search: candidates are positions where its two rarest bytes match, the rest is compared then
+    struct Needle
+    {
+        const char* literal = nullptr;
+        size_t      size = 0;
+        size_t      rareOffset1 = 0; // offset of the rarest byte
+        size_t      rareOffset2 = 0; // offset of the second rarest byte; the same as rareOffset1 only for 1 byte literal
+    };
+
+    // Several literals searched in one pass (Teddy algorithm): PSHUFB looks up bucket bits of low and high nibbles
+    // of the first bytes of every position in 16 entry tables; positions where all bits of a bucket survive are verified.
+    struct LiteralSet
+    {
+        static const size_t MaxLiterals = 32;
+        static const size_t BucketCount = 8;    // literal i belongs to bucket i % BucketCount
+        static const size_t MaxFingerprint = 3; // leading bytes of literals in the tables
+
+        const char*   literals[MaxLiterals] = {};
+        size_t        sizes[MaxLiterals] = {};
+        size_t        count = 0;
+        size_t        fingerprintSize = 0; // the shortest literal limits it
+        alignas(16) unsigned char lowNibbleMasks[MaxFingerprint][16] = {};
+        alignas(16) unsigned char highNibbleMasks[MaxFingerprint][16] = {};
+
+        // FindAllLiterals() returns it when every literal is found
+        uint32_t GetAllBits() const
+        {
+            return this->count == MaxLiterals ? UINT32_MAX : (1u << this->count) - 1;
+        }
+    };
+
+public:
+    // the best level supported by CPU and OS
+    static ESimdLevel GetSupportedLevel();
+
+    // level of kernels in use; static initializers of other files may run before the supported level is chosen
+    // and get Scalar
+    static ESimdLevel GetLevel();
+
+    // use kernels of lower level (for tests and benchmarks); level above the supported one is clipped to it;
+    // it is not thread safe: call it when no scan is running; return actually set level
+    static ESimdLevel SetLevel(const ESimdLevel level);
+
+    // the same as memchr()
+    static const char* FindChar(const char* const data, const size_t size, const char ch);
+
+    // count-th occurrence of ch (count 1 is the first one) or nullptr when there are fewer; count 0 is found at data
+    static const char* FindNthChar(const char* const data, const size_t size, const char ch, const size_t count);
+
+    // first occurrence of literal or nullptr; empty literal is found at data
+    static const char* FindLiteral(const char* const data, const size_t size, const char* const literal, const size_t literalSize);
+
+    // needle points to the literal, literal must outlive it
+    static Needle MakeNeedle(const char* const literal, const size_t literalSize, const CByteFrequency& frequency = CByteFrequency::GetDefault());
+
+    // first occurrence of the needle literal or nullptr; empty literal is found at data
+    static const char* FindNeedle(const char* const data, const size_t size, const Needle& needle);
+
+    // literal is not copied, it must outlive the set; return false for empty literal or when the set is full
+    static bool AddLiteral(LiteralSet& set, const char* const literal, const size_t literalSize);
+
+    // leftmost occurrence of any literal of the set or nullptr; the lowest index is reported for literals at the same position
+    static const char* FindAnyLiteral(const char* const data, const size_t size, const LiteralSet& set, size_t& literalIndex);
+
+    // bit i is set when literal i occurs in data; the scan stops when all literals are found
+    static uint32_t FindAllLiterals(const char* const data, const size_t size, const LiteralSet& set);
+
+    // the same as memcmp() == 0
+    static bool Equal(const char* const left, const char* const right, const size_t size);
+};
@@ -0,0 +1,90 @@
+#include "Aggregator.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+
+TEST(CAggregator, GetMinute)
+{
+    std::string_view minute;
+    EXPECT_TRUE(CAggregator::GetMinute("19/Oct/2021:16:01:02 +0000", minute));
+    EXPECT_EQ(minute, "19/Oct/2021:16:01");
+    EXPECT_TRUE(CAggregator::GetMinute("16:01:02.123", minute));
+    EXPECT_EQ(minute, "16:01");
+    EXPECT_TRUE(CAggregator::GetMinute("2021-10-19T16:01:02Z", minute));
+    EXPECT_EQ(minute, "2021-10-19T16:01");
+    EXPECT_FALSE(CAggregator::GetMinute("2021-10-19", minute));
+    EXPECT_FALSE(CAggregator::GetMinute("16:01", minute));
+    EXPECT_FALSE(CAggregator::GetMinute("", minute));
+}
+
+TEST(CAggregator, Add)
+{
+    CAggregator::Options options;
+    options.keyField = 4;
+    options.timeField = 2;
+    CAggregator aggregator;
+    ASSERT_TRUE(aggregator.Init(options));
+    EXPECT_TRUE(aggregator.Add("2021-10-19 16:01:02.123 INFO  [worker-3] cache: hit\n"));
+    EXPECT_TRUE(aggregator.Add("2021-10-19 16:01:59.999 WARN [worker-1] db: slow\r\n"));
+    EXPECT_TRUE(aggregator.Add("2021-10-19 16:02:00.000 INFO [worker-3] cache: miss"));
+    EXPECT_TRUE(aggregator.Add("2021-10-19 16:02:01.000 INFO\n"));
+    EXPECT_TRUE(aggregator.Add("no time here\n"));
+
+    // "INFO  [worker-3]" has an empty 4th field
+    const CCountTable& keys = aggregator.GetKeys();
+    EXPECT_EQ(aggregator.GetLineCount(), 5u);
+    EXPECT_EQ(aggregator.GetMissingKeyCount(), 2u);
+    ASSERT_EQ(keys.GetSize(), 3u);
+    EXPECT_EQ(keys.GetKey(0), "");
+    EXPECT_EQ(keys.GetKey(1), "worker-1");
+    EXPECT_EQ(keys.GetKey(2), "worker-3");
+
+    const CCountTable& minutes = aggregator.GetMinutes();
+    ASSERT_EQ(minutes.GetSize(), 2u);
+    EXPECT_EQ(minutes.GetKey(0), "16:01");
+    EXPECT_EQ(minutes.GetCount(0), 2u);
+    EXPECT_EQ(minutes.GetKey(1), "16:02");
+    EXPECT_EQ(minutes.GetCount(1), 2u);
+
+    // whole lines without EOL are keys by default
+    ASSERT_TRUE(aggregator.Init(CAggregator::Options()));
+    EXPECT_TRUE(aggregator.Add("a\r\n"));
+    EXPECT_TRUE(aggregator.Add("a"));
+    EXPECT_TRUE(aggregator.Add("b\n"));
+    ASSERT_EQ(aggregator.GetKeys().GetSize(), 2u);
+    EXPECT_EQ(aggregator.GetKeys().GetCount(0), 2u);
+    EXPECT_EQ(aggregator.GetMinutes().GetSize(), 0u);
+
+    options.topCount = 0;
+    EXPECT_FALSE(aggregator.Init(options));
+}
+
+TEST(CAggregator, KeyPattern)
+{
+    // the pattern is copied: the key is the text matched by its second wildcard
+    std::string pattern = "*\"GET /api/* HTTP/1.?\" * *";
+    CAggregator::Options options;
+    options.keyPattern = pattern;
+    options.keyWildcard = 2;
+    CAggregator aggregator;
+    ASSERT_TRUE(aggregator.Init(options));
+    pattern.clear();
+    EXPECT_TRUE(aggregator.Add("127.0.0.1 - - \"GET /api/users?id=1 HTTP/1.1\" 500 2326\n"));
+    EXPECT_TRUE(aggregator.Add("127.0.0.1 - - \"GET /api/items HTTP/1.0\" 200 10\n"));
+    EXPECT_TRUE(aggregator.Add("127.0.0.1 - - \"POST /api/items HTTP/1.0\" 200 10\n"));
+    EXPECT_TRUE(aggregator.Add("10.0.0.1 - - \"GET /api/users?id=1 HTTP/1.1\" 200 7\n"));
+
+    const CCountTable& keys = aggregator.GetKeys();
+    EXPECT_EQ(aggregator.GetMissingKeyCount(), 1u);
+    ASSERT_EQ(keys.GetSize(), 2u);
+    EXPECT_EQ(keys.GetKey(0), "users?id=1");
+    EXPECT_EQ(keys.GetCount(0), 2u);
+    EXPECT_EQ(keys.GetKey(1), "items");
+
+    options.keyWildcard = 6;
+    EXPECT_FALSE(aggregator.Init(options));
+    options.keyWildcard = 0;
+    EXPECT_FALSE(aggregator.Init(options));
+}
@@ -0,0 +1,195 @@
+// Benchmarks are disabled by default. Run them with the Release build:
+//   tests.exe --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+
+#include "CharBuffer.h"
+#include "FnMatch.h"
+#include "FnMatchJit.h"
+#include "LineReader.h"
+
+#include "TestHelpers.h"
+
+#include <chrono>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gtest/gtest.h"
+
+
+namespace
+{
+    const char* GetPolicyName(const CCharBuffer::EAllocationPolicy policy)
+    {
+        switch (policy)
+        {
+        case CCharBuffer::EAllocationPolicy::Heap:       return "heap";
+        case CCharBuffer::EAllocationPolicy::Pages:      return "pages";
+        case CCharBuffer::EAllocationPolicy::LargePages: return "large pages";
+        }
+        return "unknown";
+    }
+
+    const char* GetPlacementName(const EThreadPlacement placement)
+    {
+        switch (placement)
+        {
+        case EThreadPlacement::Default:       return "default";
+        case EThreadPlacement::SmtSiblings:   return "SMT siblings";
+        case EThreadPlacement::SeparateCores: return "separate cores";
+        }
+        return "unknown";
+    }
+}
+
+
+TEST(CCharBuffer, DISABLED_BenchmarkAllocationPolicy)
+{
+    // Random reads over 1 GB buffer are dominated by TLB misses with 4 KB pages:
+    // one 2 MB large page covers 512 times more memory per TLB entry.
+    const size_t bufferSize = 1024 * 1024 * 1024;
+    const size_t accessCount = 20 * 1000 * 1000;
+
+    const CCharBuffer::EAllocationPolicy policies[] = {
+        CCharBuffer::EAllocationPolicy::Heap,
+        CCharBuffer::EAllocationPolicy::Pages,
+        CCharBuffer::EAllocationPolicy::LargePages,
+    };
+
+    for (const CCharBuffer::EAllocationPolicy policy : policies)
+    {
+        CCharBuffer buffer;
+        ASSERT_TRUE(buffer.Allocate(bufferSize, 4096, policy));
+        memset(buffer.ptr, 1, buffer.size);
+
+        uint64_t state = 88172645463325252ull;
+        uint64_t sum = 0;
+        const auto randomStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < accessCount; ++i)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            sum += static_cast<unsigned char>(buffer.ptr[state % bufferSize]);
+        }
+        const auto randomEnd = std::chrono::steady_clock::now();
+
+        const auto sequentialStart = std::chrono::steady_clock::now();
+        const void* const found = memchr(buffer.ptr, 0, buffer.size);
+        const auto sequentialEnd = std::chrono::steady_clock::now();
+
+        EXPECT_EQ(sum, accessCount);
+        EXPECT_EQ(found, nullptr);
+
+        const double randomNs = std::chrono::duration<double, std::nano>(randomEnd - randomStart).count() / accessCount;
+        const double sequentialMs = std::chrono::duration<double, std::milli>(sequentialEnd - sequentialStart).count();
+        printf("requested: %-11s used: %-11s random read: %6.2f ns, sequential scan of 1 GB: %7.2f ms\n",
+            GetPolicyName(policy), GetPolicyName(buffer.policy), randomNs, sequentialMs);
+    }
+}
+
+TEST(CRingLineReader, DISABLED_BenchmarkRingSize)
+{
+    // File is read right after it is written, so this is a warm cache scan.
+    // For cold cache numbers flush system file cache (or reboot) and run the benchmark with a single ring size.
+    CLogGenerator::Options options;
+    const std::string data = GenerateLogData(options, 512 * 1024 * 1024);
+    TempFile file(data);
+
+    for (const size_t ringSize : { 2, 3, 4, 8, 16 })
+    {
+        CRingLineReader reader(ringSize);
+        ASSERT_TRUE(reader.Open(file.GetFilename().c_str()));
+
+        size_t readSize = 0;
+        const auto start = std::chrono::steady_clock::now();
+        while (const auto line = reader.GetNextLine())
+        {
+            readSize += line->size();
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        EXPECT_EQ(readSize, data.size());
+
+        const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        printf("ring size: %2zu, scan of 512 MB: %8.2f ms\n", ringSize, ms);
+    }
+}
+
+TEST(CSpinlockLineReader, DISABLED_BenchmarkThreadPlacement)
+{
+    // SMT siblings share L1/L2 cache, so handed over buffers are hot for the consumer, but siblings share execution units too.
+    // ReadWait cycles are collected with ENABLE_SCAN_STATS only, they show how long the consumer waits for the reading thread.
+    CLogGenerator::Options options;
+    const std::string data = GenerateLogData(options, 512 * 1024 * 1024);
+    TempFile file(data);
+
+    for (const EThreadPlacement placement : { EThreadPlacement::Default, EThreadPlacement::SmtSiblings, EThreadPlacement::SeparateCores })
+    {
+        CSpinlockLineReader reader(placement);
+        ASSERT_TRUE(reader.Open(file.GetFilename().c_str()));
+        reader.Stats().Reset();
+
+        size_t readSize = 0;
+        const auto start = std::chrono::steady_clock::now();
+        while (const auto line = reader.GetNextLine())
+        {
+            readSize += line->size();
+        }
+        const auto end = std::chrono::steady_clock::now();
+        const EThreadPlacement usedPlacement = reader.GetThreadPlacement();
+        reader.Close();
+
+        EXPECT_EQ(readSize, data.size());
+
+        const CScanStats::StageCounters& readWait = reader.Stats().stages[static_cast<size_t>(EScanStage::ReadWait)];
+        const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        printf("requested: %-14s used: %-14s scan of 512 MB: %8.2f ms, read wait: %10.0f cycles/call\n",
+            GetPlacementName(placement), GetPlacementName(usedPlacement), ms,
+            readWait.calls != 0 ? static_cast<double>(readWait.cycles) / readWait.calls : 0.0);
+    }
+}
+
+TEST(CFnMatchJit, DISABLED_BenchmarkMatch)
+{
+    // Lines are split in advance, so only matching is measured. Every matcher must find the same lines.
+    CLogGenerator::Options options;
+    options.matchPattern = "*GET*/api/*500*";
+    options.matchRate = 0.01;
+    const std::string data = GenerateLogData(options, 64 * 1024 * 1024);
+    std::vector<std::string_view> lines;
+    for (size_t start = 0; start < data.size();)
+    {
+        const size_t eol = data.find('\n', start);
+        const size_t end = eol != std::string::npos ? eol : data.size();
+        lines.push_back(std::string_view(data).substr(start, end - start));
+        start = end + 1;
+    }
+
+    for (const char* const pattern : { "*GET*/api/*500*", "*connection reset*", "2019-??-?? *ERROR*" })
+    {
+        CFnMatch compiled;
+        CFnMatchJit jit;
+        ASSERT_TRUE(compiled.Compile(pattern));
+        ASSERT_TRUE(jit.Compile(pattern));
+
+        size_t matched[3] = {};
+        double ns[3] = {};
+        for (size_t matcher = 0; matcher < 3; ++matcher)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (const std::string_view line : lines)
+            {
+                matched[matcher] += matcher == 0 ? CFnMatch::Match(line, pattern) : matcher == 1 ? compiled.Match(line) : jit.Match(line);
+            }
+            const auto end = std::chrono::steady_clock::now();
+            ns[matcher] = std::chrono::duration<double, std::nano>(end - start).count();
+        }
+
+        EXPECT_EQ(matched[1], matched[0]);
+        EXPECT_EQ(matched[2], matched[0]);
+        printf("%-20s matched: %8zu, per byte: Match(): %.3f ns, compiled: %.3f ns, JIT%s: %.3f ns\n", pattern, matched[0],
+            ns[0] / data.size(), ns[1] / data.size(), jit.IsNative() ? "" : " (interpreted)", ns[2] / data.size());
+    }
+}
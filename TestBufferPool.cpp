@@ -0,0 +1,89 @@
+#include "BufferPool.h"
+
+#include <thread>
+#include <utility>
+
+#include "gtest/gtest.h"
+
+
+TEST(CBufferPool, AcquireRelease)
+{
+    CBufferPool pool;
+    ASSERT_TRUE(pool.Allocate(2, 100));
+    EXPECT_EQ(pool.GetBufferCount(), 2u);
+
+    size_t first = CBufferPool::NoBuffer;
+    size_t second = CBufferPool::NoBuffer;
+    size_t third = CBufferPool::NoBuffer;
+    EXPECT_TRUE(pool.TryAcquire(first));
+    EXPECT_TRUE(pool.TryAcquire(second));
+    EXPECT_NE(first, second);
+    EXPECT_FALSE(pool.TryAcquire(third));
+
+    pool.AddRef(first);
+    EXPECT_EQ(pool.GetRefCount(first), 2u);
+    pool.Release(first);
+    EXPECT_FALSE(pool.TryAcquire(third));
+    pool.Release(first);
+    EXPECT_EQ(pool.GetRefCount(first), 0u);
+
+    EXPECT_TRUE(pool.TryAcquire(third));
+    EXPECT_EQ(third, first);
+    pool.Release(second);
+    pool.Release(third);
+}
+
+TEST(CBufferPool, WrongSize)
+{
+    CBufferPool pool;
+    EXPECT_FALSE(pool.Allocate(0, 100));
+    EXPECT_FALSE(pool.Allocate(CBufferPool::MaxBuffers + 1, 100));
+    EXPECT_EQ(pool.GetBufferCount(), 0u);
+}
+
+TEST(CLineRef, HoldsBuffer)
+{
+    CBufferPool pool;
+    ASSERT_TRUE(pool.Allocate(1, 100));
+    size_t index = CBufferPool::NoBuffer;
+    ASSERT_TRUE(pool.TryAcquire(index));
+    const std::string_view line(pool.GetBuffer(index), 10);
+
+    CLineRef ref(pool, index, line);
+    pool.Release(index);
+    EXPECT_EQ(pool.GetRefCount(index), 1u);
+    EXPECT_EQ(ref.Line().data(), line.data());
+
+    CLineRef moved(std::move(ref));
+    EXPECT_TRUE(ref.Line().empty());
+    EXPECT_EQ(moved.Line().data(), line.data());
+    EXPECT_EQ(pool.GetRefCount(index), 1u);
+
+    CLineRef assigned;
+    assigned = std::move(moved);
+    EXPECT_EQ(pool.GetRefCount(index), 1u);
+
+    assigned.Release();
+    EXPECT_TRUE(assigned.Line().empty());
+    EXPECT_EQ(pool.GetRefCount(index), 0u);
+}
+
+TEST(CBufferPool, ReleasedByAnotherThread)
+{
+    CBufferPool pool;
+    ASSERT_TRUE(pool.Allocate(1, 100));
+    size_t index = CBufferPool::NoBuffer;
+    ASSERT_TRUE(pool.TryAcquire(index));
+
+    // line is released by another thread, like by downstream processing
+    CLineRef ref(pool, index, std::string_view(pool.GetBuffer(index), 1));
+    pool.Release(index);
+    size_t reused = CBufferPool::NoBuffer;
+    EXPECT_FALSE(pool.TryAcquire(reused));
+    std::thread consumer([&ref]() { ref.Release(); });
+    consumer.join();
+
+    ASSERT_TRUE(pool.TryAcquire(reused));
+    EXPECT_EQ(reused, index);
+    pool.Release(reused);
+}
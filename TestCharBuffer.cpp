@@ -0,0 +1,84 @@
+#include "CharBuffer.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "gtest/gtest.h"
+
+
+namespace
+{
+    bool IsAligned(const void* const ptr, const size_t alignment)
+    {
+        return reinterpret_cast<uintptr_t>(ptr) % alignment == 0;
+    }
+}
+
+
+TEST(CCharBuffer, Empty)
+{
+    CCharBuffer buffer;
+    EXPECT_TRUE(buffer.Allocate(0));
+    EXPECT_NE(buffer.ptr, nullptr);
+    EXPECT_EQ(buffer.size, 0u);
+    buffer.Free();
+    EXPECT_EQ(buffer.ptr, nullptr);
+}
+
+TEST(CCharBuffer, InvalidAlignment)
+{
+    CCharBuffer buffer;
+    EXPECT_FALSE(buffer.Allocate(100, 3));
+    EXPECT_EQ(buffer.ptr, nullptr);
+    EXPECT_FALSE(buffer.Allocate(100, 1024 * 1024, CCharBuffer::EAllocationPolicy::Pages));
+    EXPECT_EQ(buffer.ptr, nullptr);
+}
+
+TEST(CCharBuffer, AlignedHeap)
+{
+    CCharBuffer buffer;
+    ASSERT_TRUE(buffer.Allocate(1000, 64));
+    EXPECT_EQ(buffer.size, 1000u);
+    EXPECT_EQ(buffer.policy, CCharBuffer::EAllocationPolicy::Heap);
+    EXPECT_TRUE(IsAligned(buffer.ptr, 64));
+    memset(buffer.ptr, 'x', buffer.size);
+
+    ASSERT_TRUE(buffer.Allocate(1000, 4096));
+    EXPECT_TRUE(IsAligned(buffer.ptr, 4096));
+    memset(buffer.ptr, 'x', buffer.size);
+}
+
+TEST(CCharBuffer, Pages)
+{
+    CCharBuffer buffer;
+    ASSERT_TRUE(buffer.Allocate(300000, 4096, CCharBuffer::EAllocationPolicy::Pages));
+    EXPECT_EQ(buffer.size, 300000u);
+    EXPECT_EQ(buffer.policy, CCharBuffer::EAllocationPolicy::Pages);
+    EXPECT_TRUE(IsAligned(buffer.ptr, 4096));
+    memset(buffer.ptr, 'x', buffer.size);
+}
+
+TEST(CCharBuffer, LargePagesOrFallback)
+{
+    // Large pages need SeLockMemoryPrivilege; without it allocation falls back to normal pages
+    CCharBuffer buffer;
+    ASSERT_TRUE(buffer.Allocate(300000, 4096, CCharBuffer::EAllocationPolicy::LargePages));
+    EXPECT_EQ(buffer.size, 300000u);
+    EXPECT_NE(buffer.policy, CCharBuffer::EAllocationPolicy::Heap);
+    EXPECT_TRUE(IsAligned(buffer.ptr, 4096));
+    memset(buffer.ptr, 'x', buffer.size);
+
+    // Reallocation with another policy frees previous memory the right way
+    ASSERT_TRUE(buffer.Allocate(10));
+    EXPECT_EQ(buffer.policy, CCharBuffer::EAllocationPolicy::Heap);
+}
+
+TEST(CCharBuffer, NumaNode)
+{
+    // node 0 exists on every machine, non-NUMA machines have just this node
+    CCharBuffer buffer;
+    ASSERT_TRUE(buffer.Allocate(100000, 4096, CCharBuffer::EAllocationPolicy::Pages, 0));
+    EXPECT_EQ(buffer.policy, CCharBuffer::EAllocationPolicy::Pages);
+    EXPECT_TRUE(IsAligned(buffer.ptr, 4096));
+    memset(buffer.ptr, 1, buffer.size);
+}
@@ -0,0 +1,112 @@
+#include "ChunkQueue.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+
+TEST(CChunkQueue, Empty)
+{
+    CChunkQueue<size_t, 4> queue;
+    size_t value = 0;
+    EXPECT_FALSE(queue.TryPop(value));
+}
+
+TEST(CChunkQueue, FifoOrder)
+{
+    CChunkQueue<size_t, 4> queue;
+    EXPECT_TRUE(queue.TryPush(1));
+    EXPECT_TRUE(queue.TryPush(2));
+    EXPECT_TRUE(queue.TryPush(3));
+
+    size_t value = 0;
+    EXPECT_TRUE(queue.TryPop(value));
+    EXPECT_EQ(value, 1u);
+    EXPECT_TRUE(queue.TryPop(value));
+    EXPECT_EQ(value, 2u);
+    EXPECT_TRUE(queue.TryPop(value));
+    EXPECT_EQ(value, 3u);
+    EXPECT_FALSE(queue.TryPop(value));
+}
+
+TEST(CChunkQueue, Full)
+{
+    CChunkQueue<size_t, 4> queue;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(queue.TryPush(i));
+    }
+    EXPECT_FALSE(queue.TryPush(4));
+
+    size_t value = 0;
+    EXPECT_TRUE(queue.TryPop(value));
+    EXPECT_EQ(value, 0u);
+    EXPECT_TRUE(queue.TryPush(4));
+    EXPECT_FALSE(queue.TryPush(5));
+}
+
+TEST(CChunkQueue, Wraparound)
+{
+    CChunkQueue<size_t, 2> queue;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        ASSERT_TRUE(queue.TryPush(i));
+        ASSERT_TRUE(queue.TryPush(i + 1));
+        size_t value = 0;
+        ASSERT_TRUE(queue.TryPop(value));
+        ASSERT_EQ(value, i);
+        ASSERT_TRUE(queue.TryPop(value));
+        ASSERT_EQ(value, i + 1);
+    }
+}
+
+TEST(CChunkQueue, ManyProducersManyConsumers)
+{
+    // Every value must be popped exactly once
+    const size_t threadCount = 4;
+    const size_t valuesPerProducer = 100000;
+    CChunkQueue<size_t, 64> queue;
+    std::atomic<size_t> poppedCount = 0;
+    std::atomic<uint64_t> poppedSum = 0;
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&queue, t]()
+        {
+            for (size_t i = 0; i < valuesPerProducer; ++i)
+            {
+                while (!queue.TryPush(t * valuesPerProducer + i))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        threads.emplace_back([&queue, &poppedCount, &poppedSum]()
+        {
+            while (poppedCount.load() < threadCount * valuesPerProducer)
+            {
+                size_t value = 0;
+                if (queue.TryPop(value))
+                {
+                    poppedSum += value;
+                    ++poppedCount;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    const uint64_t totalCount = threadCount * valuesPerProducer;
+    EXPECT_EQ(poppedCount.load(), totalCount);
+    EXPECT_EQ(poppedSum.load(), totalCount * (totalCount - 1) / 2);
+}
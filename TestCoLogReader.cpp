@@ -0,0 +1,189 @@
+#include "CoLogReader.h"
+
+#include "TestHelpers.h"
+
+#include <atomic>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+
+namespace
+{
+    // Coroutine which is started immediately and destroys itself at the end
+    struct DetachedTask
+    {
+        struct promise_type
+        {
+            DetachedTask get_return_object()
+            {
+                return {};
+            }
+            std::suspend_never initial_suspend() noexcept
+            {
+                return {};
+            }
+            std::suspend_never final_suspend() noexcept
+            {
+                return {};
+            }
+            void return_void()
+            {
+            }
+            void unhandled_exception()
+            {
+                std::terminate();
+            }
+        };
+    };
+
+    struct ScanResult
+    {
+        std::string       data;
+        size_t            lines = 0;
+        std::atomic<bool> finished = false;
+    };
+
+    DetachedTask ScanAll(CCoLogReader& reader, ScanResult& result)
+    {
+        while (const auto line = co_await reader.Next())
+        {
+            result.data += *line;
+            ++result.lines;
+        }
+        result.finished.store(true, std::memory_order_release);
+    }
+
+    // reader is closed by the coroutine resumed after I/O completion
+    DetachedTask ReadFirstAndClose(CCoLogReader& reader, ScanResult& result)
+    {
+        if (const auto line = co_await reader.Next())
+        {
+            result.data += *line;
+            ++result.lines;
+        }
+        reader.Close();
+        result.finished.store(true, std::memory_order_release);
+    }
+
+    void WaitFor(const ScanResult& result)
+    {
+        while (!result.finished.load(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+
+TEST(CCoLogReader, MissedOpen)
+{
+    CCoLogReader reader;
+    ScanResult result;
+    ScanAll(reader, result);
+    WaitFor(result);
+    EXPECT_EQ(result.lines, 0u);
+}
+
+TEST(CCoLogReader, EmptyFile)
+{
+    TempFile file("");
+    CCoLogReader reader;
+    ASSERT_TRUE(reader.Open(file.GetFilename().c_str()));
+    ASSERT_TRUE(reader.SetFilter("*"));
+
+    ScanResult result;
+    ScanAll(reader, result);
+    WaitFor(result);
+    EXPECT_EQ(result.lines, 0u);
+}
+
+TEST(CCoLogReader, Filter)
+{
+    TempFile file(std::string("first\nsecond\r\nthird\0line\nlast", 29));
+    CCoLogReader reader;
+    ASSERT_TRUE(reader.Open(file.GetFilename().c_str()));
+    ASSERT_TRUE(reader.SetFilter("*i*"));
+
+    ScanResult result;
+    ScanAll(reader, result);
+    WaitFor(result);
+    EXPECT_EQ(result.lines, 2u);
+    EXPECT_EQ(result.data, std::string("first\nthird\0line\n", 17));
+}
+
+TEST(CCoLogReader, RareMatches)
+{
+    // most of chunks have no matching lines, so coroutine is resumed only few times
+    CLogGenerator::Options options;
+    options.seed = 37;
+    const std::string data = GenerateLogData(options, 3 * 1024 * 1024) + "the only matching line\n";
+    TempFile file(data);
+
+    CCoLogReader reader;
+    ASSERT_TRUE(reader.Open(file.GetFilename().c_str()));
+    ASSERT_TRUE(reader.SetFilter("the only matching line"));
+
+    ScanResult result;
+    ScanAll(reader, result);
+    WaitFor(result);
+    EXPECT_EQ(result.lines, 1u);
+    EXPECT_EQ(result.data, "the only matching line\n");
+}
+
+TEST(CCoLogReader, CloseInCoroutine)
+{
+    // the line is in the last chunk, so the coroutine is resumed by the thread pool before it closes the reader
+    CLogGenerator::Options options;
+    options.seed = 38;
+    const std::string data = GenerateLogData(options, 1024 * 1024) + "the only matching line\n";
+    TempFile file(data);
+
+    CCoLogReader reader;
+    ASSERT_TRUE(reader.Open(file.GetFilename().c_str()));
+    ASSERT_TRUE(reader.SetFilter("the only matching line"));
+
+    ScanResult result;
+    ReadFirstAndClose(reader, result);
+    WaitFor(result);
+    EXPECT_EQ(result.lines, 1u);
+    EXPECT_EQ(result.data, "the only matching line\n");
+
+    // the reader is usable after Close() in the coroutine
+    ASSERT_TRUE(reader.Open(file.GetFilename().c_str()));
+    ScanResult secondResult;
+    ScanAll(reader, secondResult);
+    WaitFor(secondResult);
+    EXPECT_EQ(secondResult.lines, 1u);
+}
+
+TEST(CCoLogReader, ConcurrentScans)
+{
+    // all scans are started from one thread and are continued by thread pool threads
+    const size_t scanCount = 16;
+    CLogGenerator::Options options;
+    options.seed = 37;
+    options.crlfRate = 0.5;
+    size_t lineCount = 0;
+    const std::string data = GenerateLogData(options, 2 * 1024 * 1024, &lineCount);
+    TempFile file(data);
+
+    std::vector<CCoLogReader> readers(scanCount);
+    std::vector<ScanResult> results(scanCount);
+    for (size_t i = 0; i < scanCount; ++i)
+    {
+        ASSERT_TRUE(readers[i].Open(file.GetFilename().c_str()));
+        ASSERT_TRUE(readers[i].SetFilter("*"));
+        ScanAll(readers[i], results[i]);
+    }
+
+    for (size_t i = 0; i < scanCount; ++i)
+    {
+        WaitFor(results[i]);
+        EXPECT_EQ(results[i].lines, lineCount);
+        EXPECT_TRUE(results[i].data == data);
+    }
+}
@@ -0,0 +1,78 @@
+#include "CountTable.h"
+
+#include <map>
+#include <random>
+#include <string>
+
+#include "gtest/gtest.h"
+
+
+TEST(CCountTable, Add)
+{
+    CCountTable table;
+    EXPECT_EQ(table.GetSize(), 0u);
+    EXPECT_TRUE(table.Add("b"));
+    EXPECT_TRUE(table.Add("a", 5));
+    EXPECT_TRUE(table.Add("b"));
+    EXPECT_TRUE(table.Add(""));
+    EXPECT_TRUE(table.Add(std::string_view("a\0c", 3)));
+
+    // entries are in the order of the first occurrence
+    ASSERT_EQ(table.GetSize(), 4u);
+    EXPECT_EQ(table.GetKey(0), "b");
+    EXPECT_EQ(table.GetCount(0), 2u);
+    EXPECT_EQ(table.GetKey(1), "a");
+    EXPECT_EQ(table.GetCount(1), 5u);
+    EXPECT_EQ(table.GetKey(2), "");
+    EXPECT_EQ(table.GetKey(3), std::string_view("a\0c", 3));
+
+    table.Clear();
+    EXPECT_EQ(table.GetSize(), 0u);
+    EXPECT_TRUE(table.Add("a"));
+    EXPECT_EQ(table.GetCount(0), 1u);
+}
+
+TEST(CCountTable, ManyKeys)
+{
+    // keys of different lengths reach the 8-byte hash loop; the table is rehashed several times
+    std::mt19937 random(48);
+    std::map<std::string, uint64_t> expected;
+    CCountTable table;
+    for (size_t i = 0; i < 100000; ++i)
+    {
+        const std::string key = std::to_string(random() % 20000) + std::string(random() % 20, 'k');
+        ++expected[key];
+        ASSERT_TRUE(table.Add(key));
+    }
+
+    ASSERT_EQ(table.GetSize(), expected.size());
+    for (size_t i = 0; i < table.GetSize(); ++i)
+    {
+        EXPECT_EQ(table.GetCount(i), expected[std::string(table.GetKey(i))]);
+    }
+}
+
+TEST(CCountTable, GetTop)
+{
+    CCountTable table;
+    const char* const keys[] = { "a", "b", "c", "d", "e", "f" };
+    const uint64_t counts[] = { 3, 7, 1, 7, 5, 3 };
+    for (size_t i = 0; i < 6; ++i)
+    {
+        ASSERT_TRUE(table.Add(keys[i], counts[i]));
+    }
+
+    // equal counts are in the order of the first occurrence
+    uint32_t indices[6] = {};
+    EXPECT_EQ(table.GetTop(6, indices), 6u);
+    const uint32_t expected[] = { 1, 3, 4, 0, 5, 2 };
+    for (size_t i = 0; i < 6; ++i)
+    {
+        EXPECT_EQ(indices[i], expected[i]);
+    }
+    EXPECT_EQ(table.GetTop(3, indices), 3u);
+    EXPECT_EQ(indices[0], 1u);
+    EXPECT_EQ(indices[1], 3u);
+    EXPECT_EQ(indices[2], 4u);
+    EXPECT_EQ(table.GetTop(0, indices), 0u);
+}
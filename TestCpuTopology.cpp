@@ -0,0 +1,83 @@
+#include "CpuTopology.h"
+
+#include "gtest/gtest.h"
+
+
+TEST(CCpuTopology, NumaNodes)
+{
+    // every machine has at least one node with processors
+    CCpuTopology topology;
+    ASSERT_TRUE(topology.Init());
+    ASSERT_GE(topology.GetNumaNodeCount(), 1u);
+
+    for (size_t i = 0; i < topology.GetNumaNodeCount(); ++i)
+    {
+        EXPECT_NE(topology.GetNumaNode(i).affinity.Mask, 0u);
+        if (i != 0)
+        {
+            EXPECT_GT(topology.GetNumaNode(i).nodeNumber, topology.GetNumaNode(i - 1).nodeNumber);
+        }
+    }
+}
+
+TEST(CCpuTopology, SetCurrentThreadAffinity)
+{
+    CCpuTopology topology;
+    ASSERT_TRUE(topology.Init());
+
+    GROUP_AFFINITY previousAffinity = {};
+    ASSERT_TRUE(GetThreadGroupAffinity(GetCurrentThread(), &previousAffinity));
+    EXPECT_TRUE(CCpuTopology::SetCurrentThreadAffinity(topology.GetNumaNode(0).affinity));
+    EXPECT_TRUE(CCpuTopology::SetCurrentThreadAffinity(previousAffinity));
+}
+
+TEST(CCpuTopology, Cores)
+{
+    CCpuTopology topology;
+    ASSERT_TRUE(topology.Init());
+    ASSERT_GE(topology.GetCoreCount(), 1u);
+
+    for (size_t i = 0; i < topology.GetCoreCount(); ++i)
+    {
+        const CCpuTopology::Core& core = topology.GetCore(i);
+        EXPECT_NE(core.affinity.Mask, 0u);
+        // core with SMT has more than one bit in its mask
+        EXPECT_EQ(core.smt, (core.affinity.Mask & (core.affinity.Mask - 1)) != 0);
+    }
+}
+
+TEST(CCpuTopology, ThreadPairAffinity)
+{
+    CCpuTopology topology;
+    ASSERT_TRUE(topology.Init());
+
+    GROUP_AFFINITY first = {};
+    GROUP_AFFINITY second = {};
+    EXPECT_FALSE(topology.GetThreadPairAffinity(EThreadPlacement::Default, first, second));
+
+    for (const EThreadPlacement placement : { EThreadPlacement::SmtSiblings, EThreadPlacement::SeparateCores })
+    {
+        if (!topology.GetThreadPairAffinity(placement, first, second))
+        {
+            continue; // single core or no SMT on this machine
+        }
+        // a single logical processor for every thread, both in the same group
+        EXPECT_EQ(first.Group, second.Group);
+        EXPECT_NE(first.Mask, 0u);
+        EXPECT_NE(second.Mask, 0u);
+        EXPECT_EQ(first.Mask & (first.Mask - 1), 0u);
+        EXPECT_EQ(second.Mask & (second.Mask - 1), 0u);
+        EXPECT_NE(first.Mask, second.Mask);
+
+        bool sameCore = false;
+        for (size_t i = 0; i < topology.GetCoreCount(); ++i)
+        {
+            const CCpuTopology::Core& core = topology.GetCore(i);
+            if (core.affinity.Group == first.Group && (core.affinity.Mask & first.Mask) != 0 && (core.affinity.Mask & second.Mask) != 0)
+            {
+                sameCore = true;
+            }
+        }
+        EXPECT_EQ(sameCore, placement == EThreadPlacement::SmtSiblings);
+    }
+}
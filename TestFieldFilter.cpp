@@ -0,0 +1,170 @@
+#include "FieldFilter.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+
+namespace
+{
+    const char* const AccessLogLine = "127.0.0.1 - - [10/Oct/2000:13:55:36 -0700] \"GET /api/users HTTP/1.0\" 500 2326";
+
+    // naive character by character split by the rules of CFieldFilter::Layout
+    std::vector<std::string> SplitReference(const std::string& text, const CFieldFilter::Layout& layout)
+    {
+        std::vector<std::string> fields;
+        size_t pos = 0;
+        while (true)
+        {
+            const char open = text.size() > pos ? text[pos] : '\0';
+            const bool quoted = open != '\0' && (open == layout.quote || open == layout.openBracket);
+            const char close = open == layout.quote ? layout.quote : layout.closeBracket;
+            size_t closePos = std::string::npos;
+            for (size_t i = pos + 1; quoted && i < text.size(); ++i)
+            {
+                if (text[i] == close && (i + 1 == text.size() || text[i + 1] == layout.delimiter))
+                {
+                    closePos = i;
+                    break;
+                }
+            }
+
+            size_t end = 0;
+            if (closePos != std::string::npos)
+            {
+                fields.push_back(text.substr(pos + 1, closePos - pos - 1));
+                end = closePos + 1;
+            }
+            else
+            {
+                end = text.find(layout.delimiter, pos);
+                fields.push_back(text.substr(pos, end == std::string::npos ? std::string::npos : end - pos));
+            }
+            if (end >= text.size())
+            {
+                return fields;
+            }
+            pos = end + 1;
+        }
+    }
+}
+
+
+TEST(CFieldFilter, Compile)
+{
+    const CFieldFilter::Layout layout;
+    CFieldFilter filter;
+    EXPECT_TRUE(filter.Compile("$6=500", layout));
+    EXPECT_EQ(filter.GetConditionCount(), 1u);
+    EXPECT_TRUE(filter.Compile("  $5=\"GET /api/*\"   $1=127.* $5=*HTTP/1.? ", layout));
+    EXPECT_EQ(filter.GetConditionCount(), 3u);
+    EXPECT_TRUE(filter.Compile("$1=\"say \"\"hi\"\"\" $2=", layout));
+    EXPECT_EQ(filter.GetConditionCount(), 2u);
+
+    EXPECT_FALSE(filter.Compile("", layout));
+    EXPECT_FALSE(filter.Compile("*500*", layout));
+    EXPECT_FALSE(filter.Compile("$0=500", layout));
+    EXPECT_FALSE(filter.Compile("$=500", layout));
+    EXPECT_FALSE(filter.Compile("$6", layout));
+    EXPECT_FALSE(filter.Compile("$6:500", layout));
+    EXPECT_FALSE(filter.Compile("$5=\"GET", layout));
+    EXPECT_FALSE(filter.Compile("$5=\"GET\"x", layout));
+    EXPECT_FALSE(filter.Compile("$1000000=500", layout));
+}
+
+TEST(CFieldFilter, Match)
+{
+    CFieldFilter::Layout layout;
+    CFieldFilter filter;
+    ASSERT_TRUE(filter.Compile("$6=500", layout));
+    EXPECT_TRUE(filter.Match(AccessLogLine));
+    EXPECT_FALSE(filter.Match("127.0.0.1 - - [10/Oct/2000:13:55:36 -0700] \"GET /500 HTTP/1.0\" 200 500"));
+    EXPECT_FALSE(filter.Match("127.0.0.1 - - [10/Oct/2000:13:55:36 -0700] \"GET /api/users HTTP/1.0\""));
+
+    // conditions are checked in the order of fields; the same field may have several conditions
+    ASSERT_TRUE(filter.Compile("$6=5?? $4=10/Oct/2000:13:55:* $5=\"GET /api/*\" $5=*HTTP/1.0 $1=127.0.0.1", layout));
+    EXPECT_TRUE(filter.Match(AccessLogLine));
+    ASSERT_TRUE(filter.Compile("$4=10/Oct/2000:13:56:* $5=\"GET /api/*\"", layout));
+    EXPECT_FALSE(filter.Match(AccessLogLine));
+
+    // empty fields and the empty last field
+    ASSERT_TRUE(filter.Compile("$2= $4=d", layout));
+    EXPECT_TRUE(filter.Match("a  c d"));
+    EXPECT_FALSE(filter.Match("a b c d"));
+    ASSERT_TRUE(filter.Compile("$3=", layout));
+    EXPECT_TRUE(filter.Match("a b "));
+    EXPECT_FALSE(filter.Match("a b"));
+
+    // custom layout without quotes
+    layout.delimiter = ',';
+    layout.quote = '\0';
+    layout.openBracket = '\0';
+    ASSERT_TRUE(filter.Compile("$2=\"[x y]\" $3=\"\"\"z\"\"\"", layout));
+    EXPECT_TRUE(filter.Match("a,[x y],\"z\""));
+    EXPECT_FALSE(filter.Match("a,x y,z"));
+}
+
+TEST(CFieldFilter, GetField)
+{
+    const CFieldFilter::Layout layout;
+    std::string_view value;
+    EXPECT_TRUE(CFieldFilter::GetField(AccessLogLine, layout, 1, value));
+    EXPECT_EQ(value, "127.0.0.1");
+    EXPECT_TRUE(CFieldFilter::GetField(AccessLogLine, layout, 4, value));
+    EXPECT_EQ(value, "10/Oct/2000:13:55:36 -0700");
+    EXPECT_TRUE(CFieldFilter::GetField(AccessLogLine, layout, 5, value));
+    EXPECT_EQ(value, "GET /api/users HTTP/1.0");
+    EXPECT_TRUE(CFieldFilter::GetField(AccessLogLine, layout, 7, value));
+    EXPECT_EQ(value, "2326");
+    EXPECT_FALSE(CFieldFilter::GetField(AccessLogLine, layout, 8, value));
+    EXPECT_FALSE(CFieldFilter::GetField(AccessLogLine, layout, 0, value));
+
+    // quote is closed only before the delimiter, a field without the closing quote is a usual one
+    EXPECT_TRUE(CFieldFilter::GetField("\"a \"b\" c", layout, 1, value));
+    EXPECT_EQ(value, "a \"b");
+    EXPECT_TRUE(CFieldFilter::GetField("\"a b c", layout, 1, value));
+    EXPECT_EQ(value, "\"a");
+    EXPECT_TRUE(CFieldFilter::GetField("[a]b c", layout, 2, value));
+    EXPECT_EQ(value, "c");
+}
+
+TEST(CFieldFilter, RandomLines)
+{
+    // long lines reach the vector loops of the tokenizer
+    std::mt19937 random(47);
+    const CFieldFilter::Layout layout;
+    const char alphabet[] = "ab  \"[]";
+    for (size_t i = 0; i < 2000; ++i)
+    {
+        std::string text;
+        for (size_t length = random() % 200; length > 0; --length)
+        {
+            text += alphabet[random() % (sizeof(alphabet) - 1)];
+        }
+
+        const std::vector<std::string> fields = SplitReference(text, layout);
+        for (size_t field = 1; field <= fields.size() + 1; ++field)
+        {
+            std::string_view value;
+            const bool found = CFieldFilter::GetField(text, layout, field, value);
+            EXPECT_EQ(found, field <= fields.size()) << text << " " << field;
+            if (found && field <= fields.size())
+            {
+                EXPECT_EQ(value, fields[field - 1]) << text << " " << field;
+            }
+        }
+
+        // a condition on a random field with its value in quotes
+        const size_t field = 1 + random() % (fields.size() + 1);
+        std::string quoted;
+        for (const char ch : field <= fields.size() ? fields[field - 1] : std::string("a"))
+        {
+            quoted += ch == '"' ? "\"\"" : std::string(1, ch);
+        }
+        CFieldFilter filter;
+        ASSERT_TRUE(filter.Compile("$" + std::to_string(field) + "=\"" + quoted + "\"", layout));
+        EXPECT_EQ(filter.Match(text), field <= fields.size()) << text << " " << field;
+    }
+}
@@ -0,0 +1,168 @@
+#include "FilterExpression.h"
+
+#include <random>
+#include <string>
+
+#include "gtest/gtest.h"
+
+
+namespace
+{
+    // random expression and its reference result for the text: every operand is matched by CFnMatch::MatchReference()
+    std::string GenerateExpression(std::mt19937& random, const size_t depth, const std::string_view text, bool& result)
+    {
+        const char* const patterns[] = { "*ab*", "*ba*", "a*", "*b", "*abc*", "*a?c*", "*cc*a*", "b??*", "*\"*" };
+        const size_t kind = depth == 0 ? 0 : random() % 4;
+        if (kind == 0)
+        {
+            const char* const pattern = patterns[random() % (sizeof(patterns) / sizeof(patterns[0]))];
+            result = CFnMatch::MatchReference(text, pattern);
+            std::string quoted = "\"";
+            for (const char* p = pattern; *p != '\0'; ++p)
+            {
+                quoted += *p == '"' ? "\"\"" : std::string(1, *p);
+            }
+            return quoted + "\"";
+        }
+        if (kind == 1)
+        {
+            const std::string operand = GenerateExpression(random, depth - 1, text, result);
+            result = !result;
+            return "NOT " + operand;
+        }
+
+        const bool isAnd = kind == 2;
+        std::string expression = "(";
+        result = isAnd;
+        const size_t count = 2 + random() % 3;
+        for (size_t i = 0; i < count; ++i)
+        {
+            bool operandResult = false;
+            expression += (i == 0 ? "" : isAnd ? " AND " : " OR ") + GenerateExpression(random, depth - 1, text, operandResult);
+            result = isAnd ? result && operandResult : result || operandResult;
+        }
+        return expression + ")";
+    }
+}
+
+
+TEST(CFilterExpression, IsExpression)
+{
+    EXPECT_TRUE(CFilterExpression::IsExpression("\"*ERROR*\" AND NOT \"*healthcheck*\""));
+    EXPECT_TRUE(CFilterExpression::IsExpression("NOT \"*debug*\""));
+    EXPECT_TRUE(CFilterExpression::IsExpression("  (\"*a*\" OR \"*b*\")"));
+    EXPECT_TRUE(CFilterExpression::IsExpression("\"*a*\"OR\"*b*\""));
+    EXPECT_TRUE(CFilterExpression::IsExpression("NOT NOT(\"*a*\")"));
+
+    // plain patterns keep their meaning
+    EXPECT_FALSE(CFilterExpression::IsExpression(""));
+    EXPECT_FALSE(CFilterExpression::IsExpression("*ERROR* AND NOT *healthcheck*"));
+    EXPECT_FALSE(CFilterExpression::IsExpression("\"*a AND b*\""));
+    EXPECT_FALSE(CFilterExpression::IsExpression("(*a*)"));
+    EXPECT_FALSE(CFilterExpression::IsExpression("NOTE*"));
+    EXPECT_FALSE(CFilterExpression::IsExpression("\"*a*\" ANDROID"));
+    EXPECT_FALSE(CFilterExpression::IsExpression("NOT FOUND*"));
+    EXPECT_FALSE(CFilterExpression::IsExpression("NOT READY *"));
+    EXPECT_FALSE(CFilterExpression::IsExpression("NOT NOT *a*"));
+    EXPECT_FALSE(CFilterExpression::IsExpression("NOT"));
+}
+
+TEST(CFilterExpression, Compile)
+{
+    CFilterExpression expression;
+    EXPECT_TRUE(expression.Compile("\"*ERROR*\" AND NOT \"*healthcheck*\""));
+    EXPECT_EQ(expression.GetPatternCount(), 2u);
+    EXPECT_TRUE(expression.Compile("NOT NOT (\"a\" OR (\"b\" AND \"c\"))"));
+    EXPECT_EQ(expression.GetPatternCount(), 3u);
+
+    EXPECT_FALSE(expression.Compile("*a*"));
+    EXPECT_FALSE(expression.Compile("\"*a*\" AND"));
+    EXPECT_FALSE(expression.Compile("\"*a*\" AND \"*b*"));
+    EXPECT_FALSE(expression.Compile("(\"*a*\" OR \"*b*\""));
+    EXPECT_FALSE(expression.Compile("\"*a*\" OR \"*b*\")"));
+    EXPECT_FALSE(expression.Compile("\"*a*\" AND *b*"));
+    EXPECT_FALSE(expression.Compile("\"*a*\" XOR \"*b*\" OR \"*c*\""));
+    EXPECT_FALSE(expression.Compile("NOT"));
+
+    // limits
+    std::string deep = "\"a\"";
+    for (size_t i = 0; i < CFilterExpression::MaxDepth; ++i)
+    {
+        deep = "NOT " + deep;
+    }
+    EXPECT_FALSE(expression.Compile(deep));
+    std::string wide = "\"a\"";
+    for (size_t i = 1; i < CFilterExpression::MaxPatterns; ++i)
+    {
+        wide += " OR \"" + std::to_string(i) + "\"";
+    }
+    EXPECT_TRUE(expression.Compile(wide));
+    EXPECT_FALSE(expression.Compile(wide + " OR \"b\""));
+
+    // every operand and the list are negated
+    std::string negated = "NOT \"*0*\"";
+    for (size_t i = 1; i < CFilterExpression::MaxPatterns; ++i)
+    {
+        negated += " AND NOT NOT NOT \"*" + std::to_string(i) + "*\"";
+    }
+    ASSERT_TRUE(expression.Compile("NOT (" + negated + ")"));
+    EXPECT_TRUE(expression.GetPatternCount() == CFilterExpression::MaxPatterns);
+    EXPECT_FALSE(expression.Match("abc"));
+    EXPECT_TRUE(expression.Match("a31"));
+    EXPECT_FALSE(expression.Compile("NOT (" + negated + " AND NOT \"b\")"));
+}
+
+TEST(CFilterExpression, Match)
+{
+    CFilterExpression expression;
+    ASSERT_TRUE(expression.Compile("\"*ERROR*\" AND NOT \"*healthcheck*\""));
+    EXPECT_TRUE(expression.Match("12:00 ERROR disk is full"));
+    EXPECT_FALSE(expression.Match("12:00 ERROR healthcheck failed"));
+    EXPECT_FALSE(expression.Match("12:00 INFO disk is fine"));
+
+    // AND binds stronger than OR; quotes are doubled inside of patterns
+    ASSERT_TRUE(expression.Compile("\"*say \"\"hi\"\"*\" OR \"*a*\" AND \"*b*\""));
+    EXPECT_TRUE(expression.Match("they say \"hi\""));
+    EXPECT_FALSE(expression.Match("they say hi"));
+    EXPECT_TRUE(expression.Match("ab"));
+    EXPECT_FALSE(expression.Match("a"));
+
+    // the same literal of several patterns is shared by the prefilter
+    ASSERT_TRUE(expression.Compile("(\"*GET*/api*\" OR \"*POST*/api*\") AND NOT \"*/api/health*\""));
+    EXPECT_TRUE(expression.Match("GET /api/users"));
+    EXPECT_TRUE(expression.Match("POST /api/users"));
+    EXPECT_FALSE(expression.Match("GET /api/health"));
+    EXPECT_FALSE(expression.Match("PUT /api/users"));
+}
+
+TEST(CFilterExpression, RandomExpressions)
+{
+    std::mt19937 random(46);
+    const char alphabet[] = "abc\"";
+    for (size_t i = 0; i < 2000; ++i)
+    {
+        std::string text;
+        for (size_t length = random() % 12; length > 0; --length)
+        {
+            text += alphabet[random() % (sizeof(alphabet) - 1)];
+        }
+
+        bool expected = false;
+        const std::string filter = GenerateExpression(random, 1 + random() % 3, text, expected);
+        if (!CFilterExpression::IsExpression(filter))
+        {
+            // a single pattern without operators
+            continue;
+        }
+
+        CFilterExpression expression;
+        ASSERT_TRUE(expression.Compile(filter)) << filter;
+        EXPECT_EQ(expression.Match(text), expected) << filter << " " << text;
+
+        // reordered operands give the same result
+        EXPECT_EQ(expression.MatchSample(text), expected) << filter << " " << text;
+        EXPECT_EQ(expression.MatchSample(text + "x"), expression.Match(text + "x")) << filter << " " << text;
+        expression.Optimize();
+        EXPECT_EQ(expression.Match(text), expected) << filter << " " << text;
+    }
+}
@@ -1,8 +1,44 @@
 #include "FnMatch.h"
 
+#include <regex>
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 
+namespace
+{
+    // Every run of '*' is a lazy group and every '?' is a group of one character: earlier wildcards match
+    // as little as possible, that is the result of backtracking only the last '*'. Literals must not be special characters.
+    std::vector<std::string> CaptureReference(const std::string& text, const std::string& pattern, bool& matched)
+    {
+        std::string expression = "^";
+        for (size_t i = 0; i < pattern.size(); ++i)
+        {
+            if (pattern[i] == '*')
+            {
+                expression += i == 0 || pattern[i - 1] != '*' ? "([\\s\\S]*?)" : "";
+            }
+            else
+            {
+                expression += pattern[i] == '?' ? std::string("([\\s\\S])") : std::string(1, pattern[i]);
+            }
+        }
+        expression += "$";
+
+        std::smatch match;
+        matched = std::regex_match(text, match, std::regex(expression));
+        std::vector<std::string> captures;
+        for (size_t i = 1; matched && i < match.size(); ++i)
+        {
+            captures.push_back(match[i].str());
+        }
+        return captures;
+    }
+}
+
+
 TEST(CFnMatch, MatchEmpty)
 {
     CFnMatch match;
@@ -127,3 +163,128 @@ TEST(CFnMatch, MatchSpeedTest2)
     const char* const pattern = "*a*a*a*a*a*a*a*a*a*a*a*a*a*a*";
     EXPECT_TRUE(match.Match("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", pattern));
 }
+
+TEST(CFnMatch, MatchReference)
+{
+    // both implementations must agree on all combinations of short texts and patterns
+    const char* const patterns[] = { "", "*", "?", "a", "a*", "*a", "*a*", "a?b", "*ab*b*", "??*", "*?a?*", "a*b*a", "**b**",
+        "*bc*?", "*cab*" };
+    const char alphabet[] = { 'a', 'b', 'c' };
+    for (const char* const pattern : patterns)
+    {
+        CFnMatch compiled;
+        ASSERT_TRUE(compiled.Compile(pattern));
+        EXPECT_EQ(compiled.GetPattern(), pattern);
+        for (size_t length = 0; length <= 5; ++length)
+        {
+            size_t combinations = 1;
+            for (size_t i = 0; i < length; ++i)
+            {
+                combinations *= sizeof(alphabet);
+            }
+            for (size_t n = 0; n < combinations; ++n)
+            {
+                char text[5] = {};
+                for (size_t i = 0, rest = n; i < length; ++i, rest /= sizeof(alphabet))
+                {
+                    text[i] = alphabet[rest % sizeof(alphabet)];
+                }
+                const std::string_view textView(text, length);
+                EXPECT_EQ(CFnMatch::Match(textView, pattern), CFnMatch::MatchReference(textView, pattern)) << pattern << " " << textView;
+                EXPECT_EQ(compiled.Match(textView), CFnMatch::MatchReference(textView, pattern)) << pattern << " " << textView;
+            }
+        }
+    }
+}
+
+TEST(CFnMatch, MatchCaptures)
+{
+    CFnMatch match;
+    ASSERT_TRUE(match.Compile("*\"GET /api/* HTTP/1.?\" * *"));
+    ASSERT_EQ(match.GetCaptureCount(), 5u);
+    std::string_view captures[5];
+    const std::string_view text = "127.0.0.1 - - \"GET /api/users?id=1 HTTP/1.1\" 500 2326";
+    EXPECT_TRUE(match.Match(text, captures));
+    EXPECT_EQ(captures[0], "127.0.0.1 - - ");
+    EXPECT_EQ(captures[1], "users?id=1");
+    EXPECT_EQ(captures[2], "1");
+    EXPECT_EQ(captures[3], "500");
+    EXPECT_EQ(captures[4], "2326");
+    EXPECT_EQ(captures[1].data(), text.data() + 24);
+    EXPECT_FALSE(match.Match("GET /api/users HTTP/2.0 500", captures));
+
+    // a run of '*' is one wildcard, asterisks after the end of the text are empty
+    ASSERT_TRUE(match.Compile("a**b?***"));
+    ASSERT_EQ(match.GetCaptureCount(), 3u);
+    EXPECT_TRUE(match.Match("axbc", captures));
+    EXPECT_EQ(captures[0], "x");
+    EXPECT_EQ(captures[1], "c");
+    EXPECT_EQ(captures[2], "");
+
+    ASSERT_TRUE(match.Compile("abc"));
+    EXPECT_EQ(match.GetCaptureCount(), 0u);
+    EXPECT_TRUE(match.Match("abc", nullptr));
+}
+
+TEST(CFnMatch, MatchCapturesReference)
+{
+    const char* const patterns[] = { "", "*", "?", "a*", "*a", "*a*", "a?b", "*ab*b*", "??*", "*?a?*", "a*b*a", "**b**",
+        "*bc*?", "*cab*", "*a*?*b" };
+    const char alphabet[] = { 'a', 'b', 'c' };
+    for (const char* const pattern : patterns)
+    {
+        CFnMatch compiled;
+        ASSERT_TRUE(compiled.Compile(pattern));
+        std::string_view captures[8];
+        ASSERT_LE(compiled.GetCaptureCount(), 8u);
+        for (size_t length = 0; length <= 5; ++length)
+        {
+            size_t combinations = 1;
+            for (size_t i = 0; i < length; ++i)
+            {
+                combinations *= sizeof(alphabet);
+            }
+            for (size_t n = 0; n < combinations; ++n)
+            {
+                std::string text;
+                for (size_t i = 0, rest = n; i < length; ++i, rest /= sizeof(alphabet))
+                {
+                    text += alphabet[rest % sizeof(alphabet)];
+                }
+                bool expected = false;
+                const std::vector<std::string> expectedCaptures = CaptureReference(text, pattern, expected);
+                ASSERT_EQ(compiled.Match(text, captures), expected) << pattern << " " << text;
+                for (size_t i = 0; expected && i < expectedCaptures.size(); ++i)
+                {
+                    EXPECT_EQ(captures[i], expectedCaptures[i]) << pattern << " " << text << " " << i;
+                }
+            }
+        }
+    }
+}
+
+TEST(CFnMatch, Analyze)
+{
+    CFnMatch::PatternInfo info = CFnMatch::Analyze("");
+    EXPECT_TRUE(info.longestLiteral.empty());
+    EXPECT_TRUE(info.anchoredStart);
+    EXPECT_TRUE(info.anchoredEnd);
+    EXPECT_EQ(info.wildcardDensity, 0.0);
+
+    info = CFnMatch::Analyze("*ERROR ??? *timeout*");
+    EXPECT_EQ(info.longestLiteral, "timeout");
+    EXPECT_FALSE(info.anchoredStart);
+    EXPECT_FALSE(info.anchoredEnd);
+    EXPECT_EQ(info.asterisks, 3u);
+    EXPECT_EQ(info.questionMarks, 3u);
+    EXPECT_DOUBLE_EQ(info.wildcardDensity, 6.0 / 20);
+
+    info = CFnMatch::Analyze("GET /index.html*");
+    EXPECT_EQ(info.longestLiteral, "GET /index.html");
+    EXPECT_TRUE(info.anchoredStart);
+    EXPECT_FALSE(info.anchoredEnd);
+
+    info = CFnMatch::Analyze("*?*");
+    EXPECT_TRUE(info.longestLiteral.empty());
+    EXPECT_DOUBLE_EQ(info.wildcardDensity, 1.0);
+}
@@ -0,0 +1,143 @@
+#include "FnMatchJit.h"
+
+#include "SimdSearch.h"
+
+#include <random>
+#include <string>
+
+#include <string.h>
+
+#include <windows.h>
+
+#include "gtest/gtest.h"
+
+
+namespace
+{
+    std::string GenerateText(std::mt19937& random, const size_t size, const char* const alphabet)
+    {
+        const size_t alphabetSize = strlen(alphabet);
+        std::string text(size, '\0');
+        for (char& ch : text)
+        {
+            ch = alphabet[random() % alphabetSize];
+        }
+        return text;
+    }
+
+    // restores the default level of CSimdSearch
+    class CLevelGuard
+    {
+    public:
+        ~CLevelGuard()
+        {
+            CSimdSearch::SetLevel(CSimdSearch::GetSupportedLevel());
+        }
+    };
+
+    bool IsNativeExpected()
+    {
+#if defined(_M_X64)
+        return true;
+#else
+        return false;
+#endif
+    }
+}
+
+
+TEST(CFnMatchJit, MatchReference)
+{
+    // all short texts of a small alphabet; the segment search loops need long texts, see below
+    const char* const patterns[] = { "", "*", "?", "a", "abc", "ab??cd", "a*", "*a", "*a*", "a?b", "*ab*b*", "??*", "*?a?*",
+        "a*b*a", "**b**", "*ab*cd*", "*?b?c*a?", "ab*?", "*abcde*", "*a?cab*" };
+    const char alphabet[] = { 'a', 'b', 'c' };
+    for (const char* const pattern : patterns)
+    {
+        CFnMatchJit jit;
+        ASSERT_TRUE(jit.Compile(pattern));
+        EXPECT_EQ(jit.IsNative(), IsNativeExpected());
+        for (size_t length = 0; length <= 6; ++length)
+        {
+            size_t combinations = 1;
+            for (size_t i = 0; i < length; ++i)
+            {
+                combinations *= sizeof(alphabet);
+            }
+            for (size_t n = 0; n < combinations; ++n)
+            {
+                char text[6] = {};
+                for (size_t i = 0, rest = n; i < length; ++i, rest /= sizeof(alphabet))
+                {
+                    text[i] = alphabet[rest % sizeof(alphabet)];
+                }
+                const std::string_view textView(text, length);
+                EXPECT_EQ(jit.Match(textView), CFnMatch::MatchReference(textView, pattern)) << pattern << " " << textView;
+            }
+        }
+    }
+}
+
+TEST(CFnMatchJit, RandomPatterns)
+{
+    // SSE2 and AVX2 search loops
+    CLevelGuard guard;
+    std::mt19937 random(45);
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        CSimdSearch::SetLevel(i % 2 == 0 ? ESimdLevel::Sse42 : ESimdLevel::Avx2);
+        const std::string pattern = GenerateText(random, random() % 12, "ab*?");
+        CFnMatchJit jit;
+        ASSERT_TRUE(jit.Compile(pattern));
+        for (size_t size = 0; size <= 200; size += 1 + random() % 20)
+        {
+            const std::string text = GenerateText(random, size, size % 2 == 0 ? "ab" : "aaaaaaab");
+            EXPECT_EQ(jit.Match(text), CFnMatch::MatchReference(text, pattern)) << pattern << " " << text;
+        }
+    }
+}
+
+TEST(CFnMatchJit, LongPattern)
+{
+    // too long pattern is interpreted
+    const std::string pattern = "*" + std::string(CFnMatchJit::MaxPatternLength, 'a') + "*";
+    CFnMatchJit jit;
+    ASSERT_TRUE(jit.Compile(pattern));
+    EXPECT_FALSE(jit.IsNative());
+    EXPECT_TRUE(jit.Match("-" + std::string(CFnMatchJit::MaxPatternLength, 'a') + "-"));
+    EXPECT_FALSE(jit.Match(std::string(CFnMatchJit::MaxPatternLength - 1, 'a')));
+
+    // recompiled matcher generates code again
+    ASSERT_TRUE(jit.Compile("*b*"));
+    EXPECT_EQ(jit.IsNative(), IsNativeExpected());
+    EXPECT_TRUE(jit.Match("abc"));
+}
+
+TEST(CFnMatchJit, EndOfReadableMemory)
+{
+    // text ends right before an inaccessible page, like the end of mapped file
+    const size_t pageSize = 4096;
+    char* const pages = static_cast<char*>(VirtualAlloc(nullptr, 2 * pageSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    ASSERT_NE(pages, nullptr);
+    memset(pages, 'a', pageSize);
+    DWORD oldProtection = 0;
+    ASSERT_TRUE(VirtualProtect(pages + pageSize, pageSize, PAGE_NOACCESS, &oldProtection));
+
+    CLevelGuard guard;
+    for (const ESimdLevel level : { ESimdLevel::Sse42, ESimdLevel::Avx2 })
+    {
+        CSimdSearch::SetLevel(level);
+        CFnMatchJit jit1;
+        CFnMatchJit jit2;
+        ASSERT_TRUE(jit1.Compile("*aab*"));
+        ASSERT_TRUE(jit2.Compile("*aaa*a"));
+        for (size_t size = 0; size <= 200; ++size)
+        {
+            const std::string_view text(pages + pageSize - size, size);
+            EXPECT_FALSE(jit1.Match(text));
+            EXPECT_EQ(jit2.Match(text), size >= 4);
+        }
+    }
+
+    VirtualFree(pages, 0, MEM_RELEASE);
+}
@@ -0,0 +1,104 @@
+#include "FnMatchStatic.h"
+
+#include "FnMatch.h"
+
+#include <random>
+#include <string>
+
+#include "gtest/gtest.h"
+
+
+namespace
+{
+    // patterns of TestFnMatch.cpp; template arguments must be arrays with linkage
+    constexpr char PatternEmpty[] = "";
+    constexpr char PatternText[] = "abc";
+    constexpr char PatternQuestionMark1[] = "?";
+    constexpr char PatternQuestionMark2[] = "ab??cd";
+    constexpr char PatternAsterisk1[] = "*";
+    constexpr char PatternAsterisk2[] = "*abc*";
+    constexpr char PatternAsterisk3[] = "*ab*cd*";
+    constexpr char PatternSpeed1[] = "*******************";
+    constexpr char PatternSpeed2[] = "*a*a*a*a*a*a*a*a*a*a*a*a*a*a*";
+    constexpr char PatternA[] = "a*";
+    constexpr char PatternB[] = "*a";
+    constexpr char PatternC[] = "a?b";
+    constexpr char PatternD[] = "*ab*b*";
+    constexpr char PatternE[] = "??*";
+    constexpr char PatternF[] = "*?a?*";
+    constexpr char PatternG[] = "a*b*a";
+    constexpr char PatternH[] = "**b**";
+    constexpr char PatternI[] = "*?b?c*a?";
+    constexpr char PatternJ[] = "ab*?";
+
+    // runtime matcher is the specification: all short texts of a small alphabet and random long ones
+    template <const char* Pattern>
+    void ExpectSameAsRuntime()
+    {
+        const char alphabet[] = { 'a', 'b', 'c' };
+        for (size_t length = 0; length <= 6; ++length)
+        {
+            size_t combinations = 1;
+            for (size_t i = 0; i < length; ++i)
+            {
+                combinations *= sizeof(alphabet);
+            }
+            for (size_t n = 0; n < combinations; ++n)
+            {
+                char text[6] = {};
+                for (size_t i = 0, rest = n; i < length; ++i, rest /= sizeof(alphabet))
+                {
+                    text[i] = alphabet[rest % sizeof(alphabet)];
+                }
+                const std::string_view textView(text, length);
+                EXPECT_EQ(CFnMatchStatic<Pattern>::Match(textView), CFnMatch::Match(textView, Pattern)) << Pattern << " " << textView;
+            }
+        }
+
+        std::mt19937 random(44);
+        for (size_t size = 0; size <= 300; size += 13)
+        {
+            std::string text(size, '\0');
+            for (char& ch : text)
+            {
+                ch = alphabet[random() % 2];
+            }
+            EXPECT_EQ(CFnMatchStatic<Pattern>::Match(text), CFnMatch::Match(text, Pattern)) << Pattern << " " << text;
+        }
+    }
+}
+
+
+TEST(CFnMatchStatic, SameAsRuntime)
+{
+    ExpectSameAsRuntime<PatternEmpty>();
+    ExpectSameAsRuntime<PatternText>();
+    ExpectSameAsRuntime<PatternQuestionMark1>();
+    ExpectSameAsRuntime<PatternQuestionMark2>();
+    ExpectSameAsRuntime<PatternAsterisk1>();
+    ExpectSameAsRuntime<PatternAsterisk2>();
+    ExpectSameAsRuntime<PatternAsterisk3>();
+    ExpectSameAsRuntime<PatternSpeed1>();
+    ExpectSameAsRuntime<PatternSpeed2>();
+    ExpectSameAsRuntime<PatternA>();
+    ExpectSameAsRuntime<PatternB>();
+    ExpectSameAsRuntime<PatternC>();
+    ExpectSameAsRuntime<PatternD>();
+    ExpectSameAsRuntime<PatternE>();
+    ExpectSameAsRuntime<PatternF>();
+    ExpectSameAsRuntime<PatternG>();
+    ExpectSameAsRuntime<PatternH>();
+    ExpectSameAsRuntime<PatternI>();
+    ExpectSameAsRuntime<PatternJ>();
+}
+
+TEST(CFnMatchStatic, Match)
+{
+    EXPECT_TRUE(CFnMatchStatic<PatternAsterisk3>::Match("-=<ab><cd>=-"));
+    EXPECT_FALSE(CFnMatchStatic<PatternAsterisk3>::Match("a b c d"));
+    EXPECT_TRUE(CFnMatchStatic<PatternQuestionMark2>::Match("abXYcd"));
+    EXPECT_FALSE(CFnMatchStatic<PatternQuestionMark2>::Match("abXYZcd"));
+    EXPECT_TRUE(CFnMatchStatic<PatternSpeed2>::Match(std::string(82, 'a')));
+    EXPECT_TRUE(CFnMatchStatic<PatternText>::Match(std::string_view("abc")));
+    EXPECT_FALSE(CFnMatchStatic<PatternText>::Match(std::string_view("abc\0", 4)));
+}
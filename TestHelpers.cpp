@@ -30,3 +30,30 @@ TempFile::~TempFile()
 {
     _wunlink(this->_filename.c_str());
 }
+
+std::string GenerateLogData(const CLogGenerator::Options& options, const size_t totalSize, size_t* const lineCount)
+{
+    CLogGenerator generator;
+    if (!generator.Init(options))
+    {
+        throw std::exception("CLogGenerator::Init failed");
+    }
+
+    std::string data;
+    data.reserve(totalSize + 1024);
+    while (data.size() < totalSize)
+    {
+        const std::string_view line = generator.NextLine();
+        if (line.empty())
+        {
+            throw std::exception("CLogGenerator::NextLine failed");
+        }
+        data += line;
+    }
+
+    if (lineCount != nullptr)
+    {
+        *lineCount = static_cast<size_t>(generator.GetGeneratedLines());
+    }
+    return data;
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "LogGenerator.h"
+
 #include <string>
 
 
@@ -17,3 +19,6 @@ public:
 protected:
     std::wstring _filename;
 };
+
+// generate whole lines with CLogGenerator until data size reaches totalSize
+std::string GenerateLogData(const CLogGenerator::Options& options, const size_t totalSize, size_t* const lineCount = nullptr);
@@ -4,6 +4,7 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -184,3 +185,175 @@ TEST(CLineReader, LineTooLong_2)
     auto line = reader.GetNextLine();
     EXPECT_FALSE(line);
 }
+
+TEST(CLineReader, GeneratedLog)
+{
+    // Several megabytes to cross many read chunk boundaries; lines with CRLF, LF and '\0' inside
+    CLogGenerator::Options options;
+    options.seed = 26;
+    options.crlfRate = 0.5;
+    options.nullCharRate = 0.01;
+    size_t lineCount = 0;
+    const std::string data = GenerateLogData(options, 3 * 1024 * 1024, &lineCount);
+
+    TempFile file(data);
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+
+    std::string readData;
+    readData.reserve(data.size());
+    size_t readLines = 0;
+    while (const auto line = reader.GetNextLine())
+    {
+        ASSERT_FALSE(line->empty());
+        ASSERT_EQ(line->back(), '\n');
+        ASSERT_LE(line->size(), MaxLogLineLength);
+        readData += *line;
+        ++readLines;
+    }
+
+    EXPECT_EQ(readLines, lineCount);
+    EXPECT_TRUE(readData == data);
+}
+
+TEST(CLineReader, StartOffset)
+{
+    TempFile file("first\nsecond\r\nthird");
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str(), 6));
+    EXPECT_EQ(reader.GetOffset(), 6u);
+    auto line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(std::string(*line), "second\r\n");
+    EXPECT_EQ(reader.GetOffset(), 14u);
+    line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(std::string(*line), "third");
+    EXPECT_EQ(reader.GetOffset(), 19u);
+    line = reader.GetNextLine();
+    EXPECT_FALSE(line);
+    EXPECT_EQ(reader.GetOffset(), 19u);
+
+    // offset at the end of file gives no lines
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str(), 19));
+    EXPECT_FALSE(reader.GetNextLine());
+}
+
+TEST(CLineReader, ThreadPlacement)
+{
+    // placement is only an optimization: data must be the same, unsupported placement falls back to Default
+    CLogGenerator::Options options;
+    options.seed = 34;
+    const std::string data = GenerateLogData(options, 1024 * 1024);
+    TempFile file(data);
+
+    for (const EThreadPlacement placement : { EThreadPlacement::Default, EThreadPlacement::SmtSiblings, EThreadPlacement::SeparateCores })
+    {
+        GROUP_AFFINITY affinityBefore = {};
+        ASSERT_TRUE(GetThreadGroupAffinity(GetCurrentThread(), &affinityBefore));
+
+        CLineReader reader(placement);
+        ASSERT_TRUE(reader.Open(file.GetFilename().c_str()));
+        const EThreadPlacement usedPlacement = reader.GetThreadPlacement();
+        EXPECT_TRUE(usedPlacement == placement || usedPlacement == EThreadPlacement::Default);
+
+        std::string readData;
+        while (const auto line = reader.GetNextLine())
+        {
+            readData += *line;
+        }
+        EXPECT_TRUE(readData == data);
+        reader.Close();
+
+        // affinity of the calling thread is restored by Close()
+        GROUP_AFFINITY affinityAfter = {};
+        ASSERT_TRUE(GetThreadGroupAffinity(GetCurrentThread(), &affinityAfter));
+        EXPECT_EQ(affinityAfter.Group, affinityBefore.Group);
+        EXPECT_EQ(affinityAfter.Mask, affinityBefore.Mask);
+        EXPECT_EQ(reader.GetThreadPlacement(), EThreadPlacement::Default);
+    }
+}
+
+TEST(CLineReader, LineRefsStayValid)
+{
+    // Lines of all buffers are held until EOF, so no buffer is reused; lines are compared after Close()
+    CLogGenerator::Options options;
+    options.seed = 35;
+    size_t lineCount = 0;
+    const std::string data = GenerateLogData(options, 3 * 1024 * 1024, &lineCount);
+
+    TempFile file(data);
+    CLineReader reader(EThreadPlacement::Default, CBufferPool::MaxBuffers);
+    ASSERT_TRUE(reader.Open(file.GetFilename().c_str()));
+
+    std::vector<CLineRef> lines;
+    while (auto line = reader.GetNextLineRef())
+    {
+        lines.push_back(std::move(*line));
+    }
+    reader.Close();
+
+    EXPECT_EQ(lines.size(), lineCount);
+    std::string readData;
+    readData.reserve(data.size());
+    for (const CLineRef& line : lines)
+    {
+        readData += line.Line();
+    }
+    EXPECT_TRUE(readData == data);
+}
+
+TEST(CLineReader, LineRefsWithoutRetainedBuffers)
+{
+    TempFile file("line\n");
+    CLineReader reader;
+    ASSERT_TRUE(reader.Open(file.GetFilename().c_str()));
+    EXPECT_FALSE(reader.GetNextLineRef());
+}
+
+TEST(CLineReader, LineRefsExhaustBufferPool)
+{
+    // Consumer holds lines of more buffers than retained: reader fails instead of waiting forever
+    CLogGenerator::Options options;
+    options.seed = 37;
+    const std::string data = GenerateLogData(options, 3 * 1024 * 1024);
+
+    TempFile file(data);
+    CLineReader reader(EThreadPlacement::Default, 1);
+    ASSERT_TRUE(reader.Open(file.GetFilename().c_str()));
+
+    std::vector<CLineRef> lines;
+    while (auto line = reader.GetNextLineRef())
+    {
+        lines.push_back(std::move(*line));
+    }
+    ASSERT_TRUE(reader.IsBufferPoolExhausted());
+
+    std::string readData;
+    for (const CLineRef& line : lines)
+    {
+        readData += line.Line();
+    }
+    ASSERT_LT(readData.size(), data.size());
+    EXPECT_TRUE(data.compare(0, readData.size(), readData) == 0);
+
+    // released lines let the reader continue from the same position
+    lines.clear();
+    while (auto line = reader.GetNextLineRef())
+    {
+        readData += line->Line();
+    }
+    EXPECT_FALSE(reader.IsBufferPoolExhausted());
+    EXPECT_TRUE(readData == data);
+
+    // lines of the previous file hold buffers of the next one
+    ASSERT_TRUE(reader.Open(file.GetFilename().c_str()));
+    while (auto line = reader.GetNextLineRef())
+    {
+        lines.push_back(std::move(*line));
+    }
+    reader.Close();
+    EXPECT_FALSE(reader.Open(file.GetFilename().c_str()));
+    lines.clear();
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+}
@@ -184,3 +184,85 @@ TEST(CLineReader, LineTooLong_2)
     auto line = reader.GetNextLine();
     EXPECT_FALSE(line);
 }
+
+TEST(CLineReader, GeneratedLog)
+{
+    // Several megabytes to cross many read chunk boundaries; lines with CRLF, LF and '\0' inside
+    CLogGenerator::Options options;
+    options.seed = 26;
+    options.crlfRate = 0.5;
+    options.nullCharRate = 0.01;
+    size_t lineCount = 0;
+    const std::string data = GenerateLogData(options, 3 * 1024 * 1024, &lineCount);
+
+    TempFile file(data);
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+
+    std::string readData;
+    readData.reserve(data.size());
+    size_t readLines = 0;
+    while (const auto line = reader.GetNextLine())
+    {
+        ASSERT_FALSE(line->empty());
+        ASSERT_EQ(line->back(), '\n');
+        ASSERT_LE(line->size(), MaxLogLineLength);
+        readData += *line;
+        ++readLines;
+    }
+
+    EXPECT_EQ(readLines, lineCount);
+    EXPECT_TRUE(readData == data);
+}
+
+TEST(CLineReader, StartOffset)
+{
+    TempFile file("first\nsecond\r\nthird");
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str(), 6));
+    EXPECT_EQ(reader.GetOffset(), 6u);
+    auto line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(std::string(*line), "second\r\n");
+    EXPECT_EQ(reader.GetOffset(), 14u);
+    line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(std::string(*line), "third");
+    EXPECT_EQ(reader.GetOffset(), 19u);
+    line = reader.GetNextLine();
+    EXPECT_FALSE(line);
+    EXPECT_EQ(reader.GetOffset(), 19u);
+
+    // offset at the end of file gives no lines
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str(), 19));
+    EXPECT_FALSE(reader.GetNextLine());
+}
+
+TEST(CLineReader, GeneratedLogCrossesMappingWindows)
+{
+    // Data is bigger than few 4 MB prefetch windows; result must not depend on prefetching
+    CLogGenerator::Options options;
+    options.seed = 30;
+    options.crlfRate = 0.5;
+    size_t lineCount = 0;
+    const std::string data = GenerateLogData(options, 13 * 1024 * 1024, &lineCount);
+    TempFile file(data);
+
+    for (const bool prefetchWindows : { true, false })
+    {
+        CLineReader reader(prefetchWindows);
+        EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+
+        size_t readSize = 0;
+        size_t readLines = 0;
+        while (const auto line = reader.GetNextLine())
+        {
+            ASSERT_EQ(*line, std::string_view(data).substr(readSize, line->size()));
+            readSize += line->size();
+            ++readLines;
+        }
+
+        EXPECT_EQ(readLines, lineCount);
+        EXPECT_EQ(readSize, data.size());
+    }
+}
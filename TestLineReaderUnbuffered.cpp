@@ -0,0 +1,216 @@
+#include "LineReader.h"
+
+#include "TestHelpers.h"
+
+#include <algorithm>
+#include <string>
+
+#include "gtest/gtest.h"
+
+
+namespace
+{
+#   define CLineReader CUnbufferedLineReader
+
+    const size_t MaxLogLineLength = 1024; // copy-pasted value from LineReader.cpp
+}
+
+
+TEST(CLineReader, Open)
+{
+    TempFile file("");
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    reader.Close();
+}
+
+TEST(CLineReader, MissedOpen)
+{
+    CLineReader reader;
+    const auto line = reader.GetNextLine();
+    EXPECT_FALSE(line);
+}
+
+TEST(CLineReader, EmptyFile)
+{
+    TempFile file("");
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    const auto line = reader.GetNextLine();
+    EXPECT_FALSE(line);
+}
+
+TEST(CLineReader, OneLineNoLF)
+{
+    TempFile file("ABCD");
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    auto line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(std::string(*line), "ABCD");
+    line = reader.GetNextLine();
+    EXPECT_FALSE(line);
+}
+
+TEST(CLineReader, OneLineCRLF)
+{
+    TempFile file("ABCD\r\n");
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    auto line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(std::string(*line), "ABCD\r\n");
+    line = reader.GetNextLine();
+    EXPECT_FALSE(line);
+}
+
+TEST(CLineReader, OneLineLF)
+{
+    TempFile file("ABCD\n");
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    auto line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(std::string(*line), "ABCD\n");
+    line = reader.GetNextLine();
+    EXPECT_FALSE(line);
+}
+
+TEST(CLineReader, TwoLinesLF_NoLF)
+{
+    TempFile file("abc\nDEFG");
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    auto line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(std::string(*line), "abc\n");
+    line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(std::string(*line), "DEFG");
+    line = reader.GetNextLine();
+    EXPECT_FALSE(line);
+}
+
+TEST(CLineReader, TwoLinesLF_LF)
+{
+    TempFile file("abc\nDEFG\n");
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    auto line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(std::string(*line), "abc\n");
+    line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(std::string(*line), "DEFG\n");
+    line = reader.GetNextLine();
+    EXPECT_FALSE(line);
+}
+
+TEST(CLineReader, EmptyLines)
+{
+    TempFile file("\n\n");
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    auto line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(std::string(*line), "\n");
+    line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(std::string(*line), "\n");
+    line = reader.GetNextLine();
+    EXPECT_FALSE(line);
+}
+
+TEST(CLineReader, ThreeLines)
+{
+    TempFile file("Abcdef\n\n3rd Line");
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    auto line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(std::string(*line), "Abcdef\n");
+    line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(std::string(*line), "\n");
+    line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(std::string(*line), "3rd Line");
+    line = reader.GetNextLine();
+    EXPECT_FALSE(line);
+}
+
+TEST(CLineReader, LineMaxLength_1)
+{
+    const std::string str = std::string(MaxLogLineLength, 'x');
+    TempFile file(str);
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    auto line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(*line, str);
+    line = reader.GetNextLine();
+    EXPECT_FALSE(line);
+}
+
+TEST(CLineReader, LineMaxLength_2)
+{
+    const std::string str = std::string(MaxLogLineLength - 1, 'x');
+    TempFile file(str + "\n");
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    auto line = reader.GetNextLine();
+    ASSERT_TRUE(line);
+    EXPECT_EQ(*line, str + "\n");
+    line = reader.GetNextLine();
+    EXPECT_FALSE(line);
+}
+
+TEST(CLineReader, LineTooLong_1)
+{
+    const std::string str = std::string(MaxLogLineLength + 1, 'x');
+    TempFile file(str);
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    auto line = reader.GetNextLine();
+    EXPECT_FALSE(line);
+}
+
+TEST(CLineReader, LineTooLong_2)
+{
+    const std::string str = std::string(MaxLogLineLength, 'x');
+    TempFile file(str + "\n");
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    auto line = reader.GetNextLine();
+    EXPECT_FALSE(line);
+}
+
+TEST(CLineReader, GeneratedLog)
+{
+    // Several megabytes to cross many read chunk boundaries; lines with CRLF, LF and '\0' inside
+    CLogGenerator::Options options;
+    options.seed = 26;
+    options.crlfRate = 0.5;
+    options.nullCharRate = 0.01;
+    size_t lineCount = 0;
+    const std::string data = GenerateLogData(options, 3 * 1024 * 1024, &lineCount);
+
+    TempFile file(data);
+    CLineReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+
+    std::string readData;
+    readData.reserve(data.size());
+    size_t readLines = 0;
+    while (const auto line = reader.GetNextLine())
+    {
+        ASSERT_FALSE(line->empty());
+        ASSERT_EQ(line->back(), '\n');
+        ASSERT_LE(line->size(), MaxLogLineLength);
+        readData += *line;
+        ++readLines;
+    }
+
+    EXPECT_EQ(readLines, lineCount);
+    EXPECT_TRUE(readData == data);
+}
@@ -0,0 +1,172 @@
+#include "LogGenerator.h"
+
+#include "FnMatch.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+
+namespace
+{
+    std::string_view WithoutEol(std::string_view line)
+    {
+        if (!line.empty() && line.back() == '\n')
+        {
+            line.remove_suffix(1);
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.remove_suffix(1);
+            }
+        }
+        return line;
+    }
+
+    std::string Generate(const CLogGenerator::Options& options, const size_t lineCount)
+    {
+        CLogGenerator generator;
+        EXPECT_TRUE(generator.Init(options));
+        std::string data;
+        for (size_t i = 0; i < lineCount; ++i)
+        {
+            data += generator.NextLine();
+        }
+        return data;
+    }
+}
+
+
+TEST(CLogGenerator, InvalidOptions)
+{
+    CLogGenerator generator;
+    CLogGenerator::Options options;
+    EXPECT_TRUE(generator.Init(options));
+
+    options.matchRate = 1.5;
+    EXPECT_FALSE(generator.Init(options));
+
+    options = {};
+    options.lengthBucketCount = 0;
+    EXPECT_FALSE(generator.Init(options));
+
+    options = {};
+    options.lengthBuckets[0] = { 2000, 1 };
+    options.lengthBucketCount = 1;
+    EXPECT_FALSE(generator.Init(options));
+}
+
+TEST(CLogGenerator, NotInitialized)
+{
+    CLogGenerator generator;
+    EXPECT_TRUE(generator.NextLine().empty());
+}
+
+TEST(CLogGenerator, SameSeedSameData)
+{
+    CLogGenerator::Options options;
+    options.seed = 42;
+    options.crlfRate = 0.3;
+    options.nullCharRate = 0.1;
+    const std::string data1 = Generate(options, 1000);
+    const std::string data2 = Generate(options, 1000);
+    EXPECT_TRUE(data1 == data2);
+
+    options.seed = 43;
+    const std::string data3 = Generate(options, 1000);
+    EXPECT_FALSE(data1 == data3);
+}
+
+TEST(CLogGenerator, LineLengthHistogram)
+{
+    CLogGenerator generator;
+    CLogGenerator::Options options;
+    options.style = CLogGenerator::ELogStyle::App;
+    options.lengthBuckets[0] = { 40, 1 };
+    options.lengthBuckets[1] = { 100, 1 };
+    options.lengthBucketCount = 2;
+    ASSERT_TRUE(generator.Init(options));
+
+    size_t shortLines = 0;
+    size_t longLines = 0;
+    for (int i = 0; i < 1000; ++i)
+    {
+        const std::string_view line = generator.NextLine();
+        ASSERT_FALSE(line.empty());
+        ASSERT_EQ(line.back(), '\n');
+        const size_t length = WithoutEol(line).size();
+        ASSERT_GE(length, 1u);
+        ASSERT_LE(length, 100u);
+        shortLines += length <= 40 ? 1 : 0;
+        longLines += length > 40 ? 1 : 0;
+    }
+    EXPECT_GT(shortLines, 400u);
+    EXPECT_GT(longLines, 400u);
+}
+
+TEST(CLogGenerator, CrlfAndNullChars)
+{
+    CLogGenerator generator;
+    CLogGenerator::Options options;
+    options.crlfRate = 1.0;
+    options.nullCharRate = 1.0;
+    ASSERT_TRUE(generator.Init(options));
+
+    for (int i = 0; i < 100; ++i)
+    {
+        const std::string_view line = generator.NextLine();
+        ASSERT_GE(line.size(), 3u);
+        EXPECT_EQ(line.substr(line.size() - 2), "\r\n");
+        EXPECT_NE(line.find('\0'), line.npos);
+    }
+}
+
+TEST(CLogGenerator, MatchRate)
+{
+    CLogGenerator generator;
+    CLogGenerator::Options options;
+    options.matchPattern = "*16:01 *";
+    options.matchRate = 0.01;
+    options.nullCharRate = 0.05;
+    ASSERT_TRUE(generator.Init(options));
+
+    size_t matched = 0;
+    for (int i = 0; i < 20000; ++i)
+    {
+        const std::string_view line = generator.NextLine();
+        ASSERT_FALSE(line.empty());
+        matched += CFnMatch::Match(WithoutEol(line), options.matchPattern) ? 1 : 0;
+    }
+    EXPECT_EQ(matched, generator.GetMatchedLines());
+    EXPECT_GT(matched, 100u);
+    EXPECT_LT(matched, 300u);
+}
+
+TEST(CLogGenerator, MatchRateAnchoredPattern)
+{
+    CLogGenerator generator;
+    CLogGenerator::Options options;
+    options.matchPattern = "ERROR ??? *timeout*";
+    options.matchRate = 0.5;
+    ASSERT_TRUE(generator.Init(options));
+
+    size_t matched = 0;
+    for (int i = 0; i < 1000; ++i)
+    {
+        const std::string_view line = generator.NextLine();
+        ASSERT_FALSE(line.empty());
+        matched += CFnMatch::Match(WithoutEol(line), options.matchPattern) ? 1 : 0;
+    }
+    EXPECT_EQ(matched, generator.GetMatchedLines());
+    EXPECT_GT(matched, 400u);
+    EXPECT_LT(matched, 600u);
+}
+
+TEST(CLogGenerator, ImpossiblePattern)
+{
+    CLogGenerator generator;
+    CLogGenerator::Options options;
+    options.matchPattern = "*";
+    options.matchRate = 0.0;
+    ASSERT_TRUE(generator.Init(options));
+    EXPECT_TRUE(generator.NextLine().empty());
+}
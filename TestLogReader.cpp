@@ -0,0 +1,499 @@
+#include "LogReader.h"
+
+#include "TestHelpers.h"
+
+#include <fstream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+
+namespace
+{
+    constexpr char StaticPattern[] = "*GET*/api/*500*";
+
+    void WriteFile(const TempFile& file, const std::string& data, const std::ios::openmode mode)
+    {
+        std::ofstream writer(file.GetFilename().c_str(), std::ios::binary | mode);
+        ASSERT_TRUE(writer.is_open());
+        writer << data;
+    }
+
+    // scan the file from checkpoint and update it; resumed is set to result of CLogReader::Resume()
+    std::string ScanIncrementally(const TempFile& file, const char* const filter, CLogReader::Checkpoint& checkpoint, bool& resumed)
+    {
+        CLogReader reader;
+        EXPECT_TRUE(reader.Open(file.GetFilename().c_str(), true));
+        EXPECT_TRUE(reader.SetFilter(filter));
+        resumed = reader.Resume(checkpoint);
+
+        std::string result;
+        while (const auto line = reader.GetNextLine())
+        {
+            result += *line;
+        }
+
+        EXPECT_TRUE(reader.GetCheckpoint(checkpoint));
+        return result;
+    }
+
+    std::string ReadAll(CLogReader& reader)
+    {
+        std::string result;
+        while (const auto line = reader.GetNextLine())
+        {
+            result += *line;
+        }
+        return result;
+    }
+
+    // expected output of CLogReader computed by the reference matcher
+    std::string FilterLines(std::string_view data, const char* const pattern, const bool inverted = false)
+    {
+        std::string result;
+        while (!data.empty())
+        {
+            const size_t eolOffset = data.find('\n');
+            const std::string_view line = data.substr(0, eolOffset != data.npos ? eolOffset + 1 : data.size());
+            data.remove_prefix(line.size());
+
+            std::string_view matchView = line;
+            if (!matchView.empty() && matchView.back() == '\n')
+            {
+                matchView.remove_suffix(1);
+            }
+            if (!matchView.empty() && matchView.back() == '\r')
+            {
+                matchView.remove_suffix(1);
+            }
+            if (CFnMatch::MatchReference(matchView, pattern) != inverted)
+            {
+                result += line;
+            }
+        }
+        return result;
+    }
+
+    std::string ScanWithPlan(const std::string& data, const char* const pattern, CLogReader::ScanPlan& plan)
+    {
+        TempFile file(data);
+        CLogReader reader;
+        EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+        EXPECT_TRUE(reader.SetFilter(pattern));
+        plan = reader.GetScanPlan();
+        return ReadAll(reader);
+    }
+}
+
+
+TEST(CLogReader, CheckpointWithoutOpen)
+{
+    CLogReader reader;
+    CLogReader::Checkpoint checkpoint;
+    EXPECT_FALSE(reader.GetCheckpoint(checkpoint));
+    EXPECT_FALSE(reader.Resume(checkpoint));
+}
+
+TEST(CLogReader, CheckpointAppendedData)
+{
+    TempFile file("first\nsecond\r\nthi");
+    CLogReader::Checkpoint checkpoint;
+    bool resumed = true;
+
+    // empty checkpoint does not match any file
+    EXPECT_EQ(ScanIncrementally(file, "*", checkpoint, resumed), "first\nsecond\r\nthi");
+    EXPECT_FALSE(resumed);
+    EXPECT_TRUE(checkpoint.version == CLogReader::CheckpointVersion);
+    EXPECT_EQ(checkpoint.offset, 14u);
+
+    // incomplete line is returned again when it is completed
+    WriteFile(file, "rd\nfourth\n", std::ios::app);
+    EXPECT_EQ(ScanIncrementally(file, "*", checkpoint, resumed), "third\nfourth\n");
+    EXPECT_TRUE(resumed);
+    EXPECT_EQ(checkpoint.offset, 27u);
+
+    // nothing is appended
+    EXPECT_EQ(ScanIncrementally(file, "*", checkpoint, resumed), "");
+    EXPECT_TRUE(resumed);
+    EXPECT_EQ(checkpoint.offset, 27u);
+}
+
+TEST(CLogReader, CheckpointOfFilteredScan)
+{
+    // lines which do not match the filter are not scanned again too
+    TempFile file("first\nsecond\nthird\n");
+    CLogReader::Checkpoint checkpoint;
+    bool resumed = true;
+    EXPECT_EQ(ScanIncrementally(file, "*i*", checkpoint, resumed), "first\nthird\n");
+    EXPECT_EQ(checkpoint.offset, 19u);
+
+    WriteFile(file, "fourth\nfifth\n", std::ios::app);
+    EXPECT_EQ(ScanIncrementally(file, "*i*", checkpoint, resumed), "fifth\n");
+    EXPECT_TRUE(resumed);
+
+    // checkpoint of another filter is not used
+    EXPECT_EQ(ScanIncrementally(file, "f*", checkpoint, resumed), "first\nfourth\nfifth\n");
+    EXPECT_FALSE(resumed);
+}
+
+TEST(CLogReader, CheckpointOfTruncatedFile)
+{
+    TempFile file("first\nsecond\n");
+    CLogReader::Checkpoint checkpoint;
+    bool resumed = true;
+    ScanIncrementally(file, "*", checkpoint, resumed);
+
+    WriteFile(file, "new\n", std::ios::trunc);
+    EXPECT_EQ(ScanIncrementally(file, "*", checkpoint, resumed), "new\n");
+    EXPECT_FALSE(resumed);
+}
+
+TEST(CLogReader, CheckpointOfRewrittenFile)
+{
+    // file is truncated and written again up to the bigger size: tail hash does not match
+    TempFile file("first\nsecond\n");
+    CLogReader::Checkpoint checkpoint;
+    bool resumed = true;
+    ScanIncrementally(file, "*", checkpoint, resumed);
+
+    WriteFile(file, "FIRST\nSECOND\nTHIRD\n", std::ios::trunc);
+    EXPECT_EQ(ScanIncrementally(file, "*", checkpoint, resumed), "FIRST\nSECOND\nTHIRD\n");
+    EXPECT_FALSE(resumed);
+}
+
+TEST(CLogReader, CheckpointOfRotatedFile)
+{
+    // another file with the same data is a rotated log
+    TempFile file1("first\nsecond\n");
+    TempFile file2("first\nsecond\nthird\n");
+    CLogReader::Checkpoint checkpoint;
+    bool resumed = true;
+    ScanIncrementally(file1, "*", checkpoint, resumed);
+
+    EXPECT_EQ(ScanIncrementally(file2, "*", checkpoint, resumed), "first\nsecond\nthird\n");
+    EXPECT_FALSE(resumed);
+}
+
+TEST(CLogReader, CheckpointOfGeneratedLog)
+{
+    // appended data crosses many read chunks
+    CLogGenerator::Options options;
+    options.seed = 39;
+    options.crlfRate = 0.5;
+    const std::string data = GenerateLogData(options, 2 * 1024 * 1024);
+    const size_t firstPartSize = data.size() / 3 + 17; // middle of a line
+    TempFile file(data.substr(0, firstPartSize));
+
+    CLogReader::Checkpoint checkpoint;
+    bool resumed = true;
+    std::string result = ScanIncrementally(file, "*", checkpoint, resumed);
+    const std::string firstPartResult = result.substr(0, static_cast<size_t>(checkpoint.offset));
+
+    WriteFile(file, data.substr(firstPartSize), std::ios::app);
+    result = firstPartResult + ScanIncrementally(file, "*", checkpoint, resumed);
+    EXPECT_TRUE(resumed);
+    EXPECT_EQ(checkpoint.offset, data.size());
+    EXPECT_TRUE(result == data);
+}
+
+TEST(CLogReader, ScanPlanOfSmallFile)
+{
+    const std::string data = "first line\nsecond line\r\nthird\nlast line with error";
+    CLogReader::ScanPlan plan;
+
+    // small file is mapped; most lines do not contain the literal
+    EXPECT_EQ(ScanWithPlan(data, "*error*", plan), FilterLines(data, "*error*"));
+    EXPECT_EQ(plan.reader, CLogReader::EReader::Mapping);
+    EXPECT_EQ(plan.matcher, CLogReader::EMatcher::LiteralPrefilter);
+    EXPECT_EQ(plan.fileSize, data.size());
+    EXPECT_EQ(plan.sampleLines, 4u);
+    EXPECT_EQ(plan.sampleLiteralHits, 1u);
+    EXPECT_EQ(plan.sampleMatches, 1u);
+
+    // most lines contain the literal
+    EXPECT_EQ(ScanWithPlan(data, "*line*", plan), FilterLines(data, "*line*"));
+    EXPECT_EQ(plan.matcher, CLogReader::EMatcher::Direct);
+
+    // the literal at the beginning of the pattern is compared first by the direct match
+    EXPECT_EQ(ScanWithPlan(data, "last line*", plan), FilterLines(data, "last line*"));
+    EXPECT_EQ(plan.matcher, CLogReader::EMatcher::Direct);
+
+    // no literal
+    EXPECT_EQ(ScanWithPlan(data, "*?*", plan), data);
+    EXPECT_EQ(plan.matcher, CLogReader::EMatcher::Direct);
+
+    EXPECT_EQ(ScanWithPlan("", "*", plan), "");
+    EXPECT_EQ(plan.reader, CLogReader::EReader::Mapping);
+    EXPECT_EQ(plan.sampleLines, 0u);
+}
+
+TEST(CLogReader, ScanPlanOfBigFile)
+{
+    CLogGenerator::Options options;
+    options.seed = 40;
+    options.matchPattern = "*connection reset*";
+    options.crlfRate = 0.1;
+    CLogReader::ScanPlan plan;
+
+    // rare literal: the scan is bound by memory bandwidth
+    options.matchRate = 0.01;
+    std::string data = GenerateLogData(options, 2 * CLogReader::SmallFileSize);
+    EXPECT_TRUE(ScanWithPlan(data, options.matchPattern, plan) == FilterLines(data, options.matchPattern));
+    EXPECT_EQ(plan.reader, CLogReader::EReader::Mapping);
+    EXPECT_EQ(plan.matcher, CLogReader::EMatcher::LiteralPrefilter);
+    EXPECT_GT(plan.sampleLines, 0u);
+    EXPECT_LT(plan.sampleLines, 1024u);
+
+    // frequent literal: the scan is bound by matching
+    options.matchRate = 0.9;
+    data = GenerateLogData(options, 2 * CLogReader::SmallFileSize);
+    EXPECT_TRUE(ScanWithPlan(data, options.matchPattern, plan) == FilterLines(data, options.matchPattern));
+    EXPECT_EQ(plan.reader, CLogReader::EReader::Pipelined);
+    EXPECT_EQ(plan.matcher, CLogReader::EMatcher::Direct);
+    EXPECT_GT(plan.sampleMatches, plan.sampleLines / 2);
+}
+
+TEST(CLogReader, ScanPlanOfSeveralLiterals)
+{
+    // most lines contain some literals of the pattern, few lines contain all of them
+    const char* const lines[] = { "GET /index.html 200\n", "POST /api/users 200\r\n", "GET /api/users 200\n", "PUT /api/x 500\n" };
+    std::string data;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        data += i % 10 == 0 ? "GET /api/users 500\n" : lines[i % 4];
+    }
+
+    const char* const pattern = "*GET*/api/*500*";
+    CLogReader::ScanPlan plan;
+    EXPECT_TRUE(ScanWithPlan(data, pattern, plan) == FilterLines(data, pattern));
+    EXPECT_EQ(plan.matcher, CLogReader::EMatcher::AllLiteralsPrefilter);
+    EXPECT_EQ(plan.sampleLines, 1000u);
+    EXPECT_EQ(plan.sampleAllLiteralsHits, 100u);
+    EXPECT_EQ(plan.sampleMatches, 100u);
+
+    // literals of a single character are not searched
+    EXPECT_TRUE(ScanWithPlan(data, "*G*/api/*5*", plan) == FilterLines(data, "*G*/api/*5*"));
+    EXPECT_EQ(plan.matcher, CLogReader::EMatcher::Direct);
+}
+
+TEST(CLogReader, ExpressionFilter)
+{
+    const char* const lines[] = { "GET /api/users 500\n", "GET /api/health 500\r\n", "POST /api/users 200\n", "GET /index.html 500\n" };
+    std::string data;
+    std::string expected;
+    std::string expectedAny;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        data += lines[i % 4];
+        expected += i % 4 == 0 ? lines[0] : "";
+        expectedAny += i % 4 >= 2 ? lines[i % 4] : "";
+    }
+
+    CLogReader::ScanPlan plan;
+    EXPECT_TRUE(ScanWithPlan(data, "\"*GET*/api/*500*\" AND NOT \"*/health*\"", plan) == expected);
+    EXPECT_EQ(plan.matcher, CLogReader::EMatcher::Expression);
+    EXPECT_EQ(plan.sampleLines, 1000u);
+    EXPECT_EQ(plan.sampleMatches, 250u);
+
+    // result does not depend on the order of operands
+    EXPECT_TRUE(ScanWithPlan(data, "NOT \"*/health*\" AND \"*GET*/api/*500*\"", plan) == expected);
+    EXPECT_TRUE(ScanWithPlan(data, "\"*POST*\" OR \"*index*\"", plan) == expectedAny);
+
+    // malformed expression is an error, a pattern with operator words is not an expression
+    CLogReader reader;
+    EXPECT_FALSE(reader.SetFilter("\"*GET*\" AND"));
+    EXPECT_TRUE(ScanWithPlan(data, "*GET* AND *500*", plan) == FilterLines(data, "*GET* AND *500*"));
+    EXPECT_NE(plan.matcher, CLogReader::EMatcher::Expression);
+
+    const std::string notFound = "NOT FOUND /a\nFOUND /b\nNOT FOUND\n";
+    EXPECT_TRUE(ScanWithPlan(notFound, "NOT FOUND*", plan) == "NOT FOUND /a\nNOT FOUND\n");
+    EXPECT_NE(plan.matcher, CLogReader::EMatcher::Expression);
+}
+
+TEST(CLogReader, FieldFilter)
+{
+    // the status is 500 only in the first line, other lines have 500 in the URL and in the size field
+    const char* const lines[] = {
+        "127.0.0.1 - - [10/Oct/2000:13:55:36 -0700] \"GET /api/users HTTP/1.0\" 500 2326\n",
+        "127.0.0.1 - - [10/Oct/2000:13:55:36 -0700] \"GET /api/500 HTTP/1.0\" 200 2326\r\n",
+        "127.0.0.1 - - [10/Oct/2000:13:55:36 -0700] \"GET /api/users HTTP/1.0\" 200 500\n",
+    };
+    std::string data;
+    std::string expected;
+    for (size_t i = 0; i < 999; ++i)
+    {
+        data += lines[i % 3];
+        expected += i % 3 == 0 ? lines[0] : "";
+    }
+    TempFile file(data);
+
+    CLogReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    EXPECT_TRUE(reader.SetFieldFilter("$6=500 $5=\"GET /api/*\""));
+    EXPECT_EQ(reader.GetScanPlan().matcher, CLogReader::EMatcher::Fields);
+    EXPECT_EQ(reader.GetScanPlan().sampleMatches, 333u);
+    EXPECT_TRUE(ReadAll(reader) == expected);
+
+    // the same conditions with another layout; the plain filter is a pattern again
+    CFieldFilter::Layout layout;
+    layout.delimiter = '/';
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    EXPECT_TRUE(reader.SetFieldFilter("$5=\"500 HTTP*\"", layout));
+    EXPECT_TRUE(ReadAll(reader) == FilterLines(data, "*/api/500 HTTP*"));
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    EXPECT_TRUE(reader.SetFilter("$6=500"));
+    EXPECT_EQ(ReadAll(reader), "");
+    EXPECT_FALSE(reader.SetFieldFilter("*500*"));
+}
+
+TEST(CLogReader, Aggregate)
+{
+    std::string data;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        data += "127.0.0.1 - - [10/Oct/2000:13:5" + std::to_string(i % 2) + ":36 -0700] \"GET /api/" +
+            std::to_string(i % 3) + " HTTP/1.0\" " + (i % 5 == 0 ? "500" : "200") + " 2326\r\n";
+    }
+    TempFile file(data);
+
+    CAggregator::Options options;
+    options.keyField = 5;
+    options.timeField = 4;
+    CAggregator aggregator;
+    ASSERT_TRUE(aggregator.Init(options));
+    CLogReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    EXPECT_TRUE(reader.SetFieldFilter("$6=500"));
+    EXPECT_TRUE(reader.Aggregate(aggregator));
+
+    // lines 0, 5, 10, ...: the request is i % 3, the minute is i % 2
+    const CCountTable& keys = aggregator.GetKeys();
+    EXPECT_EQ(aggregator.GetLineCount(), 200u);
+    ASSERT_EQ(keys.GetSize(), 3u);
+    EXPECT_EQ(keys.GetKey(0), "GET /api/0 HTTP/1.0");
+    EXPECT_EQ(keys.GetCount(0), 67u);
+    EXPECT_EQ(keys.GetKey(2), "GET /api/1 HTTP/1.0");
+    EXPECT_EQ(keys.GetCount(2), 66u);
+    const CCountTable& minutes = aggregator.GetMinutes();
+    ASSERT_EQ(minutes.GetSize(), 2u);
+    EXPECT_EQ(minutes.GetKey(0), "10/Oct/2000:13:50");
+    EXPECT_EQ(minutes.GetCount(0), 100u);
+    EXPECT_EQ(ReadAll(reader), "");
+}
+
+TEST(CLogReader, Inverted)
+{
+    CLogGenerator::Options options;
+    options.seed = 50;
+    options.matchPattern = "*connection reset*";
+    options.crlfRate = 0.1;
+
+    // the rare literal is scanned by the mapping reader, the frequent one by the pipelined reader
+    for (const double matchRate : { 0.01, 0.9 })
+    {
+        options.matchRate = matchRate;
+        size_t lineCount = 0;
+        const std::string data = GenerateLogData(options, 2 * CLogReader::SmallFileSize, &lineCount) + "the last line";
+        const std::string expected = FilterLines(data, options.matchPattern, true);
+        TempFile file(data);
+
+        CLogReader reader;
+        EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+        reader.SetInverted(true);
+        EXPECT_TRUE(reader.SetFilter(options.matchPattern));
+        EXPECT_TRUE(ReadAll(reader) == expected);
+
+        // lines between the lines with the literal are returned as blocks
+        EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+        EXPECT_TRUE(reader.SetFilter(options.matchPattern));
+        std::string result;
+        size_t blocks = 0;
+        while (const auto lines = reader.GetNextLines())
+        {
+            result += *lines;
+            ++blocks;
+        }
+        EXPECT_TRUE(result == expected);
+        if (matchRate < 0.5)
+        {
+            EXPECT_LT(blocks * 10, lineCount);
+        }
+    }
+
+    // a too long line stops the scan: blocks end before it like lines do
+    for (const double matchRate : { 0.01, 0.9 })
+    {
+        options.matchRate = matchRate;
+        const std::string head = GenerateLogData(options, 2 * CLogReader::SmallFileSize);
+        const std::string data = head + std::string(2000, 'x') + "\n" + GenerateLogData(options, 64 * 1024);
+        TempFile file(data);
+
+        CLogReader reader;
+        EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+        reader.SetInverted(true);
+        EXPECT_TRUE(reader.SetFilter(options.matchPattern));
+        const std::string lines = ReadAll(reader);
+        EXPECT_TRUE(lines == FilterLines(head, options.matchPattern, true));
+
+        EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+        EXPECT_TRUE(reader.SetFilter(options.matchPattern));
+        std::string result;
+        while (const auto block = reader.GetNextLines())
+        {
+            result += *block;
+        }
+        EXPECT_TRUE(result == lines);
+    }
+
+    // expressions are inverted line by line
+    TempFile file("a ERROR\nb\nc ERROR healthcheck\n");
+    CLogReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    reader.SetInverted(true);
+    EXPECT_TRUE(reader.SetFilter("\"*ERROR*\" AND NOT \"*healthcheck*\""));
+    std::string result;
+    while (const auto lines = reader.GetNextLines())
+    {
+        result += *lines;
+    }
+    EXPECT_EQ(result, "b\nc ERROR healthcheck\n");
+}
+
+TEST(CLogReader, StaticFilter)
+{
+    CLogGenerator::Options options;
+    options.seed = 44;
+    options.matchPattern = StaticPattern;
+    options.matchRate = 0.1;
+    const std::string data = GenerateLogData(options, 256 * 1024);
+    TempFile file(data);
+
+    CLogReader reader;
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    EXPECT_TRUE(reader.SetStaticFilter<StaticPattern>());
+    EXPECT_TRUE(ReadAll(reader) == FilterLines(data, StaticPattern));
+}
+
+TEST(CLogReader, ScanPlanWithoutFilter)
+{
+    // reader is chosen on the first GetNextLine(); empty pattern matches empty lines only
+    TempFile file("first\n\nthird\n");
+    CLogReader reader;
+    EXPECT_EQ(reader.GetScanPlan().reader, CLogReader::EReader::None);
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    EXPECT_EQ(reader.GetScanPlan().reader, CLogReader::EReader::None);
+    EXPECT_EQ(ReadAll(reader), "\n");
+    EXPECT_EQ(reader.GetScanPlan().reader, CLogReader::EReader::Mapping);
+
+    // filter set before Open() is used too
+    CLogReader reader2;
+    EXPECT_TRUE(reader2.SetFilter("*ir*"));
+    EXPECT_TRUE(reader2.Open(file.GetFilename().c_str()));
+    EXPECT_EQ(ReadAll(reader2), "first\nthird\n");
+
+    // closed reader does not reopen the file
+    reader2.Close();
+    EXPECT_FALSE(reader2.GetNextLine());
+    EXPECT_TRUE(reader2.SetFilter("*"));
+    EXPECT_FALSE(reader2.GetNextLine());
+}
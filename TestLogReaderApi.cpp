@@ -0,0 +1,117 @@
+#include "LogReaderApi.h"
+
+#include "TestHelpers.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+
+namespace
+{
+    struct ScanContext
+    {
+        std::string data;
+        size_t      lines     = 0;
+        size_t      stopAfter = 0; // 0 means never stop
+    };
+
+    int LOG_READER_CALL CollectLine(void* context, const char* line, size_t length)
+    {
+        ScanContext* const scanContext = static_cast<ScanContext*>(context);
+        scanContext->data.append(line, length);
+        ++scanContext->lines;
+        return scanContext->lines == scanContext->stopAfter ? 1 : 0;
+    }
+
+    std::string ToUtf8(const std::wstring& filename)
+    {
+        // temporary file names are ASCII
+        return std::string(filename.begin(), filename.end());
+    }
+}
+
+
+TEST(LogReaderApi, Version)
+{
+    EXPECT_EQ(LogReaderGetApiVersion(), LOG_READER_API_VERSION);
+}
+
+TEST(LogReaderApi, InvalidArguments)
+{
+    const char* line = nullptr;
+    size_t length = 0;
+    EXPECT_EQ(LogReaderOpen(nullptr, L"file"), LOG_READER_INVALID_ARGUMENT);
+    EXPECT_EQ(LogReaderSetFilter(nullptr, "*"), LOG_READER_INVALID_ARGUMENT);
+    EXPECT_EQ(LogReaderGetNextLine(nullptr, &line, &length), LOG_READER_INVALID_ARGUMENT);
+    EXPECT_EQ(LogReaderScan(nullptr, CollectLine, nullptr), LOG_READER_INVALID_ARGUMENT);
+    LogReaderClose(nullptr);
+    LogReaderDestroy(nullptr);
+
+    LogReaderHandle* const reader = LogReaderCreate();
+    ASSERT_NE(reader, nullptr);
+    EXPECT_EQ(LogReaderOpen(reader, nullptr), LOG_READER_INVALID_ARGUMENT);
+    EXPECT_EQ(LogReaderSetFilter(reader, nullptr), LOG_READER_INVALID_ARGUMENT);
+    EXPECT_EQ(LogReaderGetNextLine(reader, nullptr, &length), LOG_READER_INVALID_ARGUMENT);
+    EXPECT_EQ(LogReaderScan(reader, nullptr, nullptr), LOG_READER_INVALID_ARGUMENT);
+    EXPECT_EQ(LogReaderOpenUtf8(reader, "\xff\xfe"), LOG_READER_INVALID_ARGUMENT);
+    LogReaderDestroy(reader);
+}
+
+TEST(LogReaderApi, MissingFile)
+{
+    LogReaderHandle* const reader = LogReaderCreate();
+    ASSERT_NE(reader, nullptr);
+    EXPECT_EQ(LogReaderOpen(reader, L"missing-file-for-log-reader-api-test.log"), LOG_READER_OPEN_FAILED);
+    LogReaderDestroy(reader);
+}
+
+TEST(LogReaderApi, GetNextLine)
+{
+    TempFile file(std::string("first\nsecond\r\nthird\0line\nlast", 29));
+    LogReaderHandle* const reader = LogReaderCreate();
+    ASSERT_NE(reader, nullptr);
+    ASSERT_EQ(LogReaderOpenUtf8(reader, ToUtf8(file.GetFilename()).c_str()), LOG_READER_OK);
+    ASSERT_EQ(LogReaderSetFilter(reader, "*i*"), LOG_READER_OK);
+
+    const char* line = nullptr;
+    size_t length = 0;
+    ASSERT_EQ(LogReaderGetNextLine(reader, &line, &length), LOG_READER_OK);
+    EXPECT_EQ(std::string(line, length), "first\n");
+    ASSERT_EQ(LogReaderGetNextLine(reader, &line, &length), LOG_READER_OK);
+    EXPECT_EQ(std::string(line, length), std::string("third\0line\n", 11));
+    EXPECT_EQ(LogReaderGetNextLine(reader, &line, &length), LOG_READER_END);
+    EXPECT_EQ(line, nullptr);
+    EXPECT_EQ(length, 0u);
+
+    LogReaderClose(reader);
+    LogReaderDestroy(reader);
+}
+
+TEST(LogReaderApi, Scan)
+{
+    CLogGenerator::Options options;
+    options.seed = 36;
+    options.crlfRate = 0.5;
+    size_t lineCount = 0;
+    const std::string data = GenerateLogData(options, 1024 * 1024, &lineCount);
+    TempFile file(data);
+
+    LogReaderHandle* const reader = LogReaderCreate();
+    ASSERT_NE(reader, nullptr);
+    ASSERT_EQ(LogReaderOpen(reader, file.GetFilename().c_str()), LOG_READER_OK);
+    ASSERT_EQ(LogReaderSetFilter(reader, "*"), LOG_READER_OK);
+
+    // stop in the middle and continue with the next call
+    ScanContext context;
+    context.stopAfter = 10;
+    EXPECT_EQ(LogReaderScan(reader, CollectLine, &context), LOG_READER_STOPPED);
+    EXPECT_EQ(context.lines, 10u);
+    context.stopAfter = 0;
+    EXPECT_EQ(LogReaderScan(reader, CollectLine, &context), LOG_READER_END);
+
+    EXPECT_EQ(context.lines, lineCount);
+    EXPECT_TRUE(context.data == data);
+
+    LogReaderDestroy(reader);
+}
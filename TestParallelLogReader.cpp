@@ -0,0 +1,176 @@
+#include "ParallelLogReader.h"
+
+#include "FnMatch.h"
+#include "TestHelpers.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+
+namespace
+{
+    const size_t MaxLogLineLength = 1024; // copy-pasted value from LineReader.cpp
+
+    // single thread reference implementation
+    std::string GetMatchedLines(const std::string& data, const char* const pattern)
+    {
+        std::string result;
+        std::string_view rest = data;
+        while (!rest.empty())
+        {
+            const size_t eolOffset = rest.find('\n');
+            const size_t lineLength = eolOffset != rest.npos ? eolOffset + 1 : rest.size();
+            const std::string_view line = rest.substr(0, lineLength);
+            rest.remove_prefix(lineLength);
+
+            std::string_view matchView = line;
+            if (!matchView.empty() && matchView.back() == '\n')
+            {
+                matchView.remove_suffix(1);
+            }
+            if (!matchView.empty() && matchView.back() == '\r')
+            {
+                matchView.remove_suffix(1);
+            }
+            if (CFnMatch::Match(matchView, pattern))
+            {
+                result += line;
+            }
+        }
+        return result;
+    }
+
+    std::string ReadAll(CParallelLogReader& reader, size_t* const lineCount = nullptr)
+    {
+        std::string result;
+        size_t count = 0;
+        while (const auto line = reader.GetNextLine())
+        {
+            EXPECT_FALSE(line->empty());
+            result += *line;
+            ++count;
+        }
+        if (lineCount != nullptr)
+        {
+            *lineCount = count;
+        }
+        return result;
+    }
+}
+
+
+TEST(CParallelLogReader, MissedOpen)
+{
+    CParallelLogReader reader(2);
+    EXPECT_FALSE(reader.GetNextLine());
+}
+
+TEST(CParallelLogReader, EmptyFile)
+{
+    TempFile file("");
+    CParallelLogReader reader(2);
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    EXPECT_TRUE(reader.SetFilter("*"));
+    EXPECT_FALSE(reader.GetNextLine());
+    EXPECT_FALSE(reader.GetNextLine());
+}
+
+TEST(CParallelLogReader, LastLineNoLF)
+{
+    TempFile file("abc\r\nabd\nxbc");
+    CParallelLogReader reader(2);
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    EXPECT_TRUE(reader.SetFilter("*bc"));
+    EXPECT_EQ(ReadAll(reader), "abc\r\nxbc");
+}
+
+TEST(CParallelLogReader, FilterIsFixedAfterStart)
+{
+    TempFile file("abc\n");
+    CParallelLogReader reader(2);
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    EXPECT_TRUE(reader.SetFilter("*"));
+    EXPECT_TRUE(reader.GetNextLine());
+    EXPECT_FALSE(reader.SetFilter("x"));
+    reader.Close();
+    EXPECT_TRUE(reader.SetFilter("x"));
+}
+
+TEST(CParallelLogReader, LineTooLong)
+{
+    const std::string longLine = std::string(MaxLogLineLength, 'x') + "\n";
+    TempFile file("a1\n" + longLine + "a2\n");
+    CParallelLogReader reader(2);
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    EXPECT_TRUE(reader.SetFilter("*"));
+    EXPECT_EQ(ReadAll(reader), "a1\n");
+}
+
+TEST(CParallelLogReader, SameResultAsSingleThread)
+{
+    // Dense match region is followed by a region without matches: chunks have very different cost
+    const char* const pattern = "*16:01 *";
+    CLogGenerator::Options options;
+    options.seed = 32;
+    options.crlfRate = 0.3;
+    options.nullCharRate = 0.01;
+    options.matchPattern = pattern;
+    options.matchRate = 0.9;
+    std::string data = GenerateLogData(options, 3 * 1024 * 1024);
+    options.seed = 33;
+    options.matchRate = 0.0;
+    data += GenerateLogData(options, 3 * 1024 * 1024);
+    options.seed = 34;
+    options.matchRate = 0.001;
+    data += GenerateLogData(options, 3 * 1024 * 1024);
+
+    const std::string expected = GetMatchedLines(data, pattern);
+    ASSERT_FALSE(expected.empty());
+    TempFile file(data);
+
+    for (const size_t threadCount : { 1, 2, 3, 8 })
+    {
+        CParallelLogReader reader(threadCount);
+        EXPECT_EQ(reader.GetMatcherThreadCount(), threadCount);
+        EXPECT_LE(reader.GetNumaNodeCount(), threadCount);
+        EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+        EXPECT_TRUE(reader.SetFilter(pattern));
+        EXPECT_TRUE(ReadAll(reader) == expected) << "thread count: " << threadCount;
+    }
+}
+
+TEST(CParallelLogReader, ReopenInTheMiddle)
+{
+    CLogGenerator::Options options;
+    options.seed = 35;
+    const std::string data = GenerateLogData(options, 4 * 1024 * 1024);
+    TempFile file(data);
+
+    CParallelLogReader reader(4);
+    EXPECT_TRUE(reader.SetFilter("*"));
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    for (size_t i = 0; i < 100; ++i)
+    {
+        EXPECT_TRUE(reader.GetNextLine());
+    }
+
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    EXPECT_TRUE(ReadAll(reader) == data);
+}
+
+TEST(CParallelLogReader, WithoutNumaPlacement)
+{
+    CLogGenerator::Options options;
+    options.seed = 33;
+    const std::string data = GenerateLogData(options, 2 * 1024 * 1024);
+    TempFile file(data);
+
+    const bool numaPlacement = false;
+    CParallelLogReader reader(4, numaPlacement);
+    EXPECT_EQ(reader.GetNumaNodeCount(), 1u);
+    EXPECT_TRUE(reader.Open(file.GetFilename().c_str()));
+    EXPECT_TRUE(reader.SetFilter("*"));
+    EXPECT_TRUE(ReadAll(reader) == data);
+}
@@ -0,0 +1,159 @@
+#include "QueryCache.h"
+
+#include "TestHelpers.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+
+namespace
+{
+    std::string Execute(CQueryCache& cache, const TempFile& file, const char* const pattern)
+    {
+        const auto result = cache.Execute(file.GetFilename().c_str(), pattern);
+        EXPECT_TRUE(result.has_value());
+        return result ? std::string(*result) : std::string();
+    }
+}
+
+
+TEST(CQueryCache, MissingFile)
+{
+    CQueryCache cache;
+    EXPECT_FALSE(cache.Execute(L"missing-file-for-query-cache-test.log", "*"));
+    EXPECT_FALSE(cache.Execute(nullptr, "*"));
+}
+
+TEST(CQueryCache, EmptyFile)
+{
+    TempFile file("");
+    CQueryCache cache;
+    EXPECT_EQ(Execute(cache, file, "*"), "");
+}
+
+TEST(CQueryCache, Filter)
+{
+    TempFile file(std::string("first\nsecond\r\nthird\0line\nlast", 29));
+    CQueryCache cache;
+    EXPECT_EQ(Execute(cache, file, "*i*"), std::string("first\nthird\0line\n", 17));
+    EXPECT_EQ(Execute(cache, file, "*"), std::string("first\nsecond\r\nthird\0line\nlast", 29));
+    EXPECT_EQ(Execute(cache, file, "last"), "last");
+}
+
+TEST(CQueryCache, TooLongLine)
+{
+    TempFile file("short line\n" + std::string(2000, 'x') + "\n");
+    CQueryCache cache;
+    EXPECT_FALSE(cache.Execute(file.GetFilename().c_str(), "*"));
+}
+
+TEST(CQueryCache, Hits)
+{
+    TempFile file("first\nsecond\nthird\n");
+    CQueryCache cache;
+
+    EXPECT_EQ(Execute(cache, file, "*i*"), "first\nthird\n");
+    EXPECT_EQ(cache.GetStats().resultHits, 0u);
+    EXPECT_EQ(cache.GetStats().mappingHits, 0u);
+
+    // the same query is answered from the result cache
+    EXPECT_EQ(Execute(cache, file, "*i*"), "first\nthird\n");
+    EXPECT_EQ(cache.GetStats().resultHits, 1u);
+    EXPECT_EQ(cache.GetStats().mappingHits, 0u);
+
+    // new pattern scans the file mapped by the previous query
+    EXPECT_EQ(Execute(cache, file, "s*"), "second\n");
+    EXPECT_EQ(cache.GetStats().resultHits, 1u);
+    EXPECT_EQ(cache.GetStats().mappingHits, 1u);
+    EXPECT_EQ(cache.GetStats().queries, 3u);
+
+    cache.Clear();
+    EXPECT_EQ(Execute(cache, file, "s*"), "second\n");
+    EXPECT_EQ(cache.GetStats().resultHits, 1u);
+    EXPECT_EQ(cache.GetStats().mappingHits, 1u);
+}
+
+TEST(CQueryCache, ChangedFile)
+{
+    TempFile file("first\nsecond\n");
+    CQueryCache cache;
+    EXPECT_EQ(Execute(cache, file, "*"), "first\nsecond\n");
+
+    // writer is not blocked by the mapped file
+    {
+        std::ofstream writer(file.GetFilename().c_str(), std::ios::binary | std::ios::app);
+        ASSERT_TRUE(writer.is_open());
+        writer << "third\n";
+    }
+
+    EXPECT_EQ(Execute(cache, file, "*"), "first\nsecond\nthird\n");
+    EXPECT_EQ(cache.GetStats().resultHits, 0u);
+    EXPECT_EQ(cache.GetStats().mappingHits, 0u);
+    EXPECT_EQ(Execute(cache, file, "*"), "first\nsecond\nthird\n");
+    EXPECT_EQ(cache.GetStats().resultHits, 1u);
+}
+
+TEST(CQueryCache, IdleFileIsUnmapped)
+{
+    TempFile file("first\nsecond\n");
+    CQueryCache cache;
+    EXPECT_EQ(Execute(cache, file, "s*"), "second\n");
+    EXPECT_LE(cache.UnmapIdleFiles(), CQueryCache::MappedFileIdleMs);
+
+    // system fails truncation of the mapped file
+    {
+        std::ofstream writer(file.GetFilename().c_str(), std::ios::binary | std::ios::trunc);
+        EXPECT_FALSE(writer.is_open());
+    }
+
+    EXPECT_EQ(cache.UnmapIdleFiles(0), INFINITE);
+    {
+        std::ofstream writer(file.GetFilename().c_str(), std::ios::binary | std::ios::trunc);
+        ASSERT_TRUE(writer.is_open());
+        writer << "third\n";
+    }
+
+    // the cached result of the old file is not used
+    EXPECT_EQ(Execute(cache, file, "*"), "third\n");
+    EXPECT_EQ(Execute(cache, file, "s*"), "");
+    EXPECT_EQ(cache.GetStats().resultHits, 0u);
+}
+
+TEST(CQueryCache, ManyFiles)
+{
+    // more files than mapping slots: old mappings and results are evicted
+    const size_t fileCount = CQueryCache::MaxMappedFiles + 4;
+    std::vector<std::unique_ptr<TempFile>> files;
+    for (size_t i = 0; i < fileCount; ++i)
+    {
+        files.push_back(std::make_unique<TempFile>("file " + std::to_string(i) + "\n"));
+    }
+
+    CQueryCache cache;
+    for (size_t round = 0; round < 2; ++round)
+    {
+        for (size_t i = 0; i < fileCount; ++i)
+        {
+            EXPECT_EQ(Execute(cache, *files[i], "file*"), "file " + std::to_string(i) + "\n");
+        }
+    }
+    EXPECT_EQ(cache.GetStats().resultHits, fileCount);
+}
+
+TEST(CQueryCache, BigResultIsNotCached)
+{
+    CLogGenerator::Options options;
+    options.seed = 38;
+    const std::string data = GenerateLogData(options, CQueryCache::MaxCachedResultSize + 1024);
+    TempFile file(data);
+
+    CQueryCache cache;
+    EXPECT_TRUE(Execute(cache, file, "*") == data);
+    EXPECT_TRUE(Execute(cache, file, "*") == data);
+    EXPECT_EQ(cache.GetStats().resultHits, 0u);
+    EXPECT_EQ(cache.GetStats().mappingHits, 1u);
+}
@@ -0,0 +1,161 @@
+// winsock2.h must be included before windows.h, otherwise old winsock.h is used
+#include <winsock2.h>
+#include <afunix.h>
+
+#include "QueryDaemon.h"
+
+#include "TestHelpers.h"
+
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <atlcomcli.h>
+
+#include "gtest/gtest.h"
+
+
+namespace
+{
+    std::string Query(const TempFile& socketFile, const TempFile& file, const char* const pattern)
+    {
+        CCharBuffer result;
+        EXPECT_TRUE(QueryDaemon(socketFile.GetFilename().c_str(), file.GetFilename().c_str(), pattern, result));
+        return std::string(result.ptr != nullptr ? result.ptr : "", result.size);
+    }
+
+    // send the request as is, without resolving the filename; return the status of the response
+    uint32_t SendRawRequest(const TempFile& socketFile, const std::string& filename, const std::string& pattern)
+    {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        const std::string socketPath(CW2A(socketFile.GetFilename().c_str(), CP_UTF8));
+        memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+        WSADATA wsaData = {};
+        EXPECT_EQ(WSAStartup(MAKEWORD(2, 2), &wsaData), 0);
+        const SOCKET s = socket(AF_UNIX, SOCK_STREAM, 0);
+        EXPECT_NE(s, INVALID_SOCKET);
+        EXPECT_EQ(connect(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+
+        const uint32_t lengths[2] = { static_cast<uint32_t>(filename.size()), static_cast<uint32_t>(pattern.size()) };
+        const std::string request = std::string(reinterpret_cast<const char*>(lengths), sizeof(lengths)) + filename + pattern;
+        EXPECT_EQ(send(s, request.data(), static_cast<int>(request.size()), 0), static_cast<int>(request.size()));
+
+        uint32_t status = ~0u;
+        EXPECT_EQ(recv(s, reinterpret_cast<char*>(&status), sizeof(status), MSG_WAITALL), static_cast<int>(sizeof(status)));
+        closesocket(s);
+        WSACleanup();
+        return status;
+    }
+}
+
+
+TEST(CQueryDaemon, NotStarted)
+{
+    CQueryDaemon daemon;
+    EXPECT_FALSE(daemon.Run());
+    daemon.Stop();
+
+    TempFile socketFile("");
+    TempFile file("line\n");
+    CCharBuffer result;
+    EXPECT_FALSE(QueryDaemon(socketFile.GetFilename().c_str(), file.GetFilename().c_str(), "*", result));
+}
+
+TEST(CQueryDaemon, Queries)
+{
+    // daemon replaces the temporary file with its socket
+    TempFile socketFile("");
+    CQueryDaemon daemon;
+    ASSERT_TRUE(daemon.Start(socketFile.GetFilename().c_str()));
+
+    bool runSucceeded = false;
+    std::thread thread([&daemon, &runSucceeded]() { runSucceeded = daemon.Run(); });
+
+    TempFile file(std::string("first\nsecond\r\nthird\0line\nlast", 29));
+    EXPECT_EQ(Query(socketFile, file, "*i*"), std::string("first\nthird\0line\n", 17));
+    EXPECT_EQ(Query(socketFile, file, "*i*"), std::string("first\nthird\0line\n", 17));
+    EXPECT_EQ(Query(socketFile, file, "nothing"), "");
+
+    // failed query does not stop the daemon
+    CCharBuffer result;
+    EXPECT_FALSE(QueryDaemon(socketFile.GetFilename().c_str(), L"missing-file-for-query-daemon-test.log", "*", result));
+    EXPECT_EQ(Query(socketFile, file, "last"), "last");
+
+    daemon.Stop();
+    thread.join();
+    EXPECT_TRUE(runSucceeded);
+    EXPECT_EQ(daemon.GetStats().queries, 5u);
+    EXPECT_EQ(daemon.GetStats().resultHits, 1u);
+    EXPECT_EQ(daemon.GetStats().mappingHits, 2u);
+}
+
+TEST(CQueryDaemon, IdleFileIsUnmapped)
+{
+    TempFile socketFile("");
+    CQueryDaemon daemon;
+    ASSERT_TRUE(daemon.Start(socketFile.GetFilename().c_str()));
+
+    bool runSucceeded = false;
+    std::thread thread([&daemon, &runSucceeded]() { runSucceeded = daemon.Run(); });
+
+    TempFile file("first\nsecond\n");
+    EXPECT_EQ(Query(socketFile, file, "s*"), "second\n");
+
+    // log rotation can truncate the file when the daemon does not get queries
+    bool truncated = false;
+    for (int i = 0; i < 50 && !truncated; ++i)
+    {
+        Sleep(100);
+        std::ofstream writer(file.GetFilename().c_str(), std::ios::binary | std::ios::trunc);
+        truncated = writer.is_open();
+    }
+    EXPECT_TRUE(truncated);
+    EXPECT_EQ(Query(socketFile, file, "s*"), "");
+
+    daemon.Stop();
+    thread.join();
+    EXPECT_TRUE(runSucceeded);
+}
+
+TEST(CQueryDaemon, RelativeFilename)
+{
+    TempFile socketFile("");
+    CQueryDaemon daemon;
+    ASSERT_TRUE(daemon.Start(socketFile.GetFilename().c_str()));
+
+    bool runSucceeded = false;
+    std::thread thread([&daemon, &runSucceeded]() { runSucceeded = daemon.Run(); });
+
+    TempFile file("first\nsecond\n");
+    const std::wstring& path = file.GetFilename();
+    const size_t separator = path.find_last_of(L"\\/");
+    ASSERT_NE(separator, std::wstring::npos);
+    const std::wstring name = path.substr(separator + 1);
+
+    // the client resolves the name in its own working directory, the daemon does not guess
+    wchar_t oldDirectory[MAX_PATH] = L"";
+    ASSERT_NE(GetCurrentDirectoryW(MAX_PATH, oldDirectory), 0u);
+    ASSERT_TRUE(SetCurrentDirectoryW(path.substr(0, separator).c_str()));
+
+    CCharBuffer result;
+    EXPECT_TRUE(QueryDaemon(socketFile.GetFilename().c_str(), name.c_str(), "s*", result));
+    EXPECT_EQ(std::string(result.ptr != nullptr ? result.ptr : "", result.size), "second\n");
+
+    // another spelling of the same file is the same cache key
+    EXPECT_TRUE(QueryDaemon(socketFile.GetFilename().c_str(), (L".\\" + name).c_str(), "s*", result));
+    EXPECT_EQ(std::string(result.ptr != nullptr ? result.ptr : "", result.size), "second\n");
+
+    EXPECT_TRUE(SetCurrentDirectoryW(oldDirectory));
+
+    // relative filename sent as is is rejected
+    EXPECT_EQ(SendRawRequest(socketFile, std::string(CW2A(name.c_str(), CP_UTF8)), "s*"),
+        static_cast<uint32_t>(CQueryDaemon::EStatus::InvalidRequest));
+
+    daemon.Stop();
+    thread.join();
+    EXPECT_TRUE(runSucceeded);
+    EXPECT_EQ(daemon.GetStats().queries, 2u);
+    EXPECT_EQ(daemon.GetStats().resultHits, 1u);
+}
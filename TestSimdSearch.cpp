@@ -0,0 +1,357 @@
+#include "SimdSearch.h"
+
+#include "FnMatch.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <string.h>
+
+#include <windows.h>
+
+#include "gtest/gtest.h"
+
+
+namespace
+{
+    // restores the default level after the test
+    class CLevelGuard
+    {
+    public:
+        ~CLevelGuard()
+        {
+            CSimdSearch::SetLevel(CSimdSearch::GetSupportedLevel());
+        }
+    };
+
+    // every test runs for all levels supported by this machine
+    std::vector<ESimdLevel> GetTestedLevels()
+    {
+        std::vector<ESimdLevel> levels;
+        for (size_t i = 0; i < static_cast<size_t>(ESimdLevel::Count); ++i)
+        {
+            const ESimdLevel level = static_cast<ESimdLevel>(i);
+            if (level <= CSimdSearch::GetSupportedLevel())
+            {
+                levels.push_back(level);
+            }
+        }
+        return levels;
+    }
+
+    // small alphabet gives many partial matches
+    std::string GenerateText(std::mt19937& random, const size_t size, const char* const alphabet)
+    {
+        const size_t alphabetSize = strlen(alphabet);
+        std::string text(size, '\0');
+        for (char& ch : text)
+        {
+            ch = alphabet[random() % alphabetSize];
+        }
+        return text;
+    }
+}
+
+
+TEST(CSimdSearch, SetLevel)
+{
+    CLevelGuard guard;
+    EXPECT_EQ(CSimdSearch::GetLevel(), CSimdSearch::GetSupportedLevel());
+    EXPECT_EQ(CSimdSearch::SetLevel(ESimdLevel::Scalar), ESimdLevel::Scalar);
+    EXPECT_EQ(CSimdSearch::GetLevel(), ESimdLevel::Scalar);
+    EXPECT_EQ(CSimdSearch::SetLevel(ESimdLevel::Avx512Bw), CSimdSearch::GetSupportedLevel());
+}
+
+TEST(CSimdSearch, FindChar)
+{
+    CLevelGuard guard;
+    std::mt19937 random(41);
+    for (const ESimdLevel level : GetTestedLevels())
+    {
+        CSimdSearch::SetLevel(level);
+        for (size_t size = 0; size <= 300; ++size)
+        {
+            // offset changes alignment of the data
+            const std::string text = GenerateText(random, size + 64, "abcdefghijklmnopqrstuvwxyz\n");
+            const size_t offset = random() % 64;
+            const char* const data = text.data() + offset;
+            EXPECT_EQ(CSimdSearch::FindChar(data, size, '\n'), memchr(data, '\n', size)) << static_cast<int>(level) << " " << size;
+            EXPECT_EQ(CSimdSearch::FindChar(data, size, '#'), nullptr);
+        }
+    }
+}
+
+TEST(CSimdSearch, FindNthChar)
+{
+    CLevelGuard guard;
+    std::mt19937 random(47);
+    for (const ESimdLevel level : GetTestedLevels())
+    {
+        CSimdSearch::SetLevel(level);
+        for (size_t size = 0; size <= 300; ++size)
+        {
+            const std::string text = GenerateText(random, size + 64, "abcd ");
+            const size_t offset = random() % 64;
+            const char* const data = text.data() + offset;
+            EXPECT_EQ(CSimdSearch::FindNthChar(data, size, ' ', 0), data);
+
+            // every occurrence in order, then nothing
+            const char* expected = data;
+            size_t count = 1;
+            for (;; ++count)
+            {
+                expected = static_cast<const char*>(memchr(expected, ' ', data + size - expected));
+                EXPECT_EQ(CSimdSearch::FindNthChar(data, size, ' ', count), expected) << static_cast<int>(level) << " " << size;
+                if (expected == nullptr)
+                {
+                    break;
+                }
+                ++expected;
+            }
+            EXPECT_EQ(CSimdSearch::FindNthChar(data, size, ' ', count + 100), nullptr);
+        }
+    }
+}
+
+TEST(CSimdSearch, FindLiteral)
+{
+    CLevelGuard guard;
+    std::mt19937 random(41);
+    for (const ESimdLevel level : GetTestedLevels())
+    {
+        CSimdSearch::SetLevel(level);
+        for (size_t size = 0; size <= 300; ++size)
+        {
+            const std::string text = GenerateText(random, size, "ab");
+            for (const size_t literalSize : { 0, 1, 2, 3, 5, 8, 15, 16, 17, 31, 33, 64, 70 })
+            {
+                // literal taken from the text is found, the random one is often not found
+                const size_t position = size > literalSize ? random() % (size - literalSize + 1) : 0;
+                const std::string literals[] = { text.substr(position, literalSize), GenerateText(random, literalSize, "ab") };
+                for (const std::string& literal : literals)
+                {
+                    const size_t expected = std::string_view(text).find(literal);
+                    const char* const found = CSimdSearch::FindLiteral(text.data(), text.size(), literal.data(), literal.size());
+                    EXPECT_EQ(found != nullptr ? static_cast<size_t>(found - text.data()) : std::string_view::npos, expected)
+                        << static_cast<int>(level) << " " << text << " " << literal;
+                }
+            }
+        }
+    }
+}
+
+TEST(CSimdSearch, FindNeedle)
+{
+    CLevelGuard guard;
+    std::mt19937 random(42);
+    for (const ESimdLevel level : GetTestedLevels())
+    {
+        CSimdSearch::SetLevel(level);
+        for (size_t size = 0; size <= 300; ++size)
+        {
+            const std::string text = GenerateText(random, size, "abc");
+            for (const size_t literalSize : { 0, 1, 2, 3, 5, 16, 17, 33, 70 })
+            {
+                const size_t position = size > literalSize ? random() % (size - literalSize + 1) : 0;
+                const std::string literals[] = { text.substr(position, literalSize), GenerateText(random, literalSize, "abc") };
+                for (const std::string& literal : literals)
+                {
+                    // random offsets of the rare bytes: any pair must give the same result
+                    CSimdSearch::Needle needle = CSimdSearch::MakeNeedle(literal.data(), literal.size());
+                    if (literal.size() >= 2)
+                    {
+                        needle.rareOffset1 = random() % literal.size();
+                        needle.rareOffset2 = random() % literal.size();
+                    }
+                    const size_t expected = std::string_view(text).find(literal);
+                    const char* const found = CSimdSearch::FindNeedle(text.data(), text.size(), needle);
+                    EXPECT_EQ(found != nullptr ? static_cast<size_t>(found - text.data()) : std::string_view::npos, expected)
+                        << static_cast<int>(level) << " " << text << " " << literal;
+                }
+            }
+        }
+    }
+}
+
+TEST(CSimdSearch, MakeNeedle)
+{
+    // digits, spaces and lowercase letters are common in logs, uppercase letters are rare
+    const char* const literal = "2019-01-02 GET /x";
+    CSimdSearch::Needle needle = CSimdSearch::MakeNeedle(literal, strlen(literal));
+    EXPECT_EQ(needle.literal, literal);
+    EXPECT_EQ(needle.size, strlen(literal));
+    EXPECT_EQ(literal[needle.rareOffset1], 'x');
+    EXPECT_EQ(literal[needle.rareOffset2], 'T');
+
+    // trained table: 'x' and 'G' are frequent in this file
+    const std::string sample = "xxxx GGGG xGxG 2019-01-02 2019-01-02 2019-01-02 GET /";
+    CByteFrequency frequency;
+    frequency.Train(sample.data(), sample.size());
+    needle = CSimdSearch::MakeNeedle(literal, strlen(literal), frequency);
+    EXPECT_EQ(literal[needle.rareOffset1], 'T');
+    EXPECT_EQ(literal[needle.rareOffset2], 'E');
+
+    // the second byte differs from the first one when it is possible
+    needle = CSimdSearch::MakeNeedle("zzzzb", 5);
+    EXPECT_EQ(needle.rareOffset1, 0u);
+    EXPECT_EQ(needle.rareOffset2, 4u);
+    needle = CSimdSearch::MakeNeedle("zz", 2);
+    EXPECT_NE(needle.rareOffset1, needle.rareOffset2);
+    needle = CSimdSearch::MakeNeedle("z", 1);
+    EXPECT_EQ(needle.rareOffset1, 0u);
+    EXPECT_EQ(needle.rareOffset2, 0u);
+}
+
+TEST(CSimdSearch, AddLiteral)
+{
+    CSimdSearch::LiteralSet set;
+    EXPECT_EQ(set.GetAllBits(), 0u);
+    EXPECT_FALSE(CSimdSearch::AddLiteral(set, "", 0));
+    EXPECT_TRUE(CSimdSearch::AddLiteral(set, "abcd", 4));
+    EXPECT_EQ(set.fingerprintSize, 3u);
+    EXPECT_TRUE(CSimdSearch::AddLiteral(set, "xy", 2));
+    EXPECT_EQ(set.fingerprintSize, 2u);
+    EXPECT_EQ(set.GetAllBits(), 3u);
+
+    while (set.count < CSimdSearch::LiteralSet::MaxLiterals)
+    {
+        EXPECT_TRUE(CSimdSearch::AddLiteral(set, "abc", 3));
+    }
+    EXPECT_FALSE(CSimdSearch::AddLiteral(set, "abc", 3));
+    EXPECT_EQ(set.GetAllBits(), UINT32_MAX);
+}
+
+TEST(CSimdSearch, FindLiterals)
+{
+    CLevelGuard guard;
+    std::mt19937 random(43);
+    for (const ESimdLevel level : GetTestedLevels())
+    {
+        CSimdSearch::SetLevel(level);
+        for (size_t size = 0; size <= 300; size += 3)
+        {
+            const std::string text = GenerateText(random, size, "abcd");
+
+            // more literals than buckets; the first ones are often found, the long ones are not
+            std::vector<std::string> literals;
+            CSimdSearch::LiteralSet set;
+            const size_t literalCount = 1 + random() % CSimdSearch::LiteralSet::MaxLiterals;
+            for (size_t i = 0; i < literalCount; ++i)
+            {
+                literals.push_back(GenerateText(random, 1 + random() % (i + 2), "abcd"));
+            }
+            for (const std::string& literal : literals)
+            {
+                ASSERT_TRUE(CSimdSearch::AddLiteral(set, literal.data(), literal.size()));
+            }
+
+            size_t expectedPosition = std::string_view::npos;
+            size_t expectedIndex = 0;
+            uint32_t expectedBits = 0;
+            for (size_t i = 0; i < literals.size(); ++i)
+            {
+                const size_t position = text.find(literals[i]);
+                if (position != std::string::npos)
+                {
+                    expectedBits |= 1u << i;
+                }
+                if (position < expectedPosition)
+                {
+                    expectedPosition = position;
+                    expectedIndex = i;
+                }
+            }
+
+            size_t index = 0;
+            const char* const found = CSimdSearch::FindAnyLiteral(text.data(), text.size(), set, index);
+            ASSERT_EQ(found != nullptr ? static_cast<size_t>(found - text.data()) : std::string_view::npos, expectedPosition)
+                << static_cast<int>(level) << " " << text;
+            if (found != nullptr)
+            {
+                EXPECT_EQ(index, expectedIndex);
+            }
+            EXPECT_EQ(CSimdSearch::FindAllLiterals(text.data(), text.size(), set), expectedBits) << static_cast<int>(level) << " " << text;
+        }
+    }
+}
+
+TEST(CSimdSearch, Equal)
+{
+    CLevelGuard guard;
+    std::mt19937 random(41);
+    for (const ESimdLevel level : GetTestedLevels())
+    {
+        CSimdSearch::SetLevel(level);
+        for (size_t size = 0; size <= 200; ++size)
+        {
+            const std::string left = GenerateText(random, size, "abc");
+            std::string right = left;
+            EXPECT_TRUE(CSimdSearch::Equal(left.data(), right.data(), size));
+            if (size != 0)
+            {
+                right[random() % size] = 'x';
+                EXPECT_FALSE(CSimdSearch::Equal(left.data(), right.data(), size)) << static_cast<int>(level) << " " << size;
+            }
+        }
+    }
+}
+
+TEST(CSimdSearch, EndOfReadableMemory)
+{
+    // data ends right before an inaccessible page, like the end of mapped file: kernels must not touch that page
+    const size_t pageSize = 4096;
+    char* const pages = static_cast<char*>(VirtualAlloc(nullptr, 2 * pageSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    ASSERT_NE(pages, nullptr);
+    memset(pages, 'a', pageSize);
+    DWORD oldProtection = 0;
+    ASSERT_TRUE(VirtualProtect(pages + pageSize, pageSize, PAGE_NOACCESS, &oldProtection));
+
+    CSimdSearch::LiteralSet set;
+    CSimdSearch::AddLiteral(set, "aab", 3);
+    CSimdSearch::AddLiteral(set, "aaa", 3);
+
+    CLevelGuard guard;
+    for (const ESimdLevel level : GetTestedLevels())
+    {
+        CSimdSearch::SetLevel(level);
+        for (size_t size = 0; size <= 200; ++size)
+        {
+            const char* const data = pages + pageSize - size;
+            EXPECT_EQ(CSimdSearch::FindAllLiterals(data, size, set), size >= 3 ? 2u : 0u);
+            EXPECT_EQ(CSimdSearch::FindChar(data, size, '\n'), nullptr);
+            EXPECT_EQ(CSimdSearch::FindNthChar(data, size, 'a', size), size != 0 ? data + size - 1 : data);
+            EXPECT_EQ(CSimdSearch::FindNthChar(data, size, 'a', size + 1), nullptr);
+            EXPECT_EQ(CSimdSearch::FindLiteral(data, size, "ab", 2), nullptr);
+            EXPECT_EQ(CSimdSearch::FindLiteral(data, size, "aaa", 3), size >= 3 ? data : nullptr);
+            EXPECT_EQ(CSimdSearch::FindNeedle(data, size, CSimdSearch::MakeNeedle("aab", 3)), nullptr);
+            EXPECT_TRUE(CSimdSearch::Equal(data, pages, size));
+        }
+    }
+
+    VirtualFree(pages, 0, MEM_RELEASE);
+}
+
+TEST(CSimdSearch, FnMatch)
+{
+    // CFnMatch uses the kernels for literals after '*'; long texts reach the vector loops
+    CLevelGuard guard;
+    std::mt19937 random(41);
+    const char* const patterns[] = { "*ab*", "*abba*b", "a*bab?ab*", "*aaaaaaaaaaaaaaaaaab*", "*?ba*ab*ba?*", "*b" };
+    for (const ESimdLevel level : GetTestedLevels())
+    {
+        CSimdSearch::SetLevel(level);
+        for (size_t size = 0; size <= 300; size += 7)
+        {
+            const std::string text = GenerateText(random, size, size % 2 == 0 ? "ab" : "aaaaaaab");
+            for (const char* const pattern : patterns)
+            {
+                CFnMatch compiled;
+                ASSERT_TRUE(compiled.Compile(pattern));
+                const bool expected = CFnMatch::MatchReference(text, pattern);
+                EXPECT_EQ(CFnMatch::Match(text, pattern), expected) << static_cast<int>(level) << " " << text << " " << pattern;
+                EXPECT_EQ(compiled.Match(text), expected) << static_cast<int>(level) << " " << text << " " << pattern;
+            }
+        }
+    }
+}
@@ -1,22 +1,90 @@
 #include <fcntl.h>
 #include <io.h>
 #include <stdio.h>
+#include <wchar.h>
 
 #include <atlcomcli.h>
 
 #include "LogReader.h"
 
 
+namespace
+{
+    // return option value if argument looks like "--name=value"
+    const wchar_t* GetOptionValue(const wchar_t* const arg, const wchar_t* const name)
+    {
+        const size_t nameLen = wcslen(name);
+        if (wcsncmp(arg, name, nameLen) != 0 || arg[nameLen] != L'=')
+        {
+            return nullptr;
+        }
+        return arg + nameLen + 1;
+    }
+
+    // decimal number without sign
+    bool GetNumber(const wchar_t* const value, size_t& number)
+    {
+        number = 0;
+        for (const wchar_t* p = value; *p != L'\0'; ++p)
+        {
+            if (*p < L'0' || *p > L'9' || number > CFieldFilter::MaxField)
+            {
+                return false;
+            }
+            number = number * 10 + (*p - L'0');
+        }
+        return *value != L'\0';
+    }
+
+    bool LoadCheckpoint(const wchar_t* const filename, CLogReader::Checkpoint& checkpoint)
+    {
+        FILE* file = nullptr;
+        if (_wfopen_s(&file, filename, L"rb") != 0 || file == nullptr)
+        {
+            return false;
+        }
+        const bool succeeded = fread(&checkpoint, sizeof(checkpoint), 1, file) == 1;
+        fclose(file);
+        return succeeded;
+    }
+
+    bool SaveCheckpoint(const wchar_t* const filename, const CLogReader::Checkpoint& checkpoint)
+    {
+        FILE* file = nullptr;
+        if (_wfopen_s(&file, filename, L"wb") != 0 || file == nullptr)
+        {
+            return false;
+        }
+        const bool written = fwrite(&checkpoint, sizeof(checkpoint), 1, file) == 1;
+        const bool closed = fclose(file) == 0;
+        return written && closed;
+    }
+}
+
+
 int wmain(const int argc, const wchar_t* const argv[])
 {
     if (argc <= 2)
     {
         fwprintf(stderr, L"Error! Not enough command line arguments!\n");
         fwprintf(stderr, L"Usage:\n");
-        fwprintf(stderr, L"LogReader.exe <filename> <pattern>\n");
+        fwprintf(stderr, L"LogReader.exe <filename> <pattern> [--checkpoint=<file>] [--fields[=<delimiter>]] [-v]\n");
+        fwprintf(stderr, L"                 [--count[=<field>]] [--key=<pattern>] [--top=<count>] [--per-minute=<field>]\n");
         fwprintf(stderr, L"Pattern is similar to fnmatch and supports symbols '*' and '?'.\n");
+        fwprintf(stderr, L"Patterns in double quotes can be combined by NOT, AND, OR and parentheses.\n");
+        fwprintf(stderr, L"With -v (--invert) lines which don't match the pattern are printed.\n");
+        fwprintf(stderr, L"Checkpoint file keeps the scan position: the next run prints only lines appended after it.\n");
+        fwprintf(stderr, L"With --fields the pattern is a list of conditions for fields: $<field>=<pattern>, fields are numbered from 1.\n");
+        fwprintf(stderr, L"Fields are separated by spaces or by the delimiter, \"quoted\" and [bracketed] fields may contain it.\n");
+        fwprintf(stderr, L"With --count matching lines are not printed: they are counted by the field or by the whole line,\n");
+        fwprintf(stderr, L"the summary has the top keys (10 by default) and the number of lines per minute of the time field.\n");
+        fwprintf(stderr, L"With --key the key is the text matched by the wildcard of the key pattern, --count is its number then.\n");
         fwprintf(stderr, L"Example:\n");
         fwprintf(stderr, L"LogReader.exe 20190102.log \"*bbb*\"\n");
+        fwprintf(stderr, L"LogReader.exe 20190102.log \"\\\"*ERROR*\\\" AND NOT \\\"*healthcheck*\\\"\"\n");
+        fwprintf(stderr, L"LogReader.exe access.log \"$6=500 $5=\\\"GET /api/*\\\"\" --fields\n");
+        fwprintf(stderr, L"LogReader.exe access.log \"*\" --count=5 --top=20 --per-minute=4\n");
+        fwprintf(stderr, L"LogReader.exe access.log \"*\" --key=\"*\\\"GET /api/* *\" --count=2\n");
         return 1;
     }
 
@@ -24,28 +92,119 @@ int wmain(const int argc, const wchar_t* const argv[])
 
     const wchar_t* const fileName = argv[1];
     const wchar_t* const lineFilter = argv[2];
+    const wchar_t* checkpointFileName = nullptr;
+    bool fieldMode = false;
+    bool inverted = false;
+    CFieldFilter::Layout fieldLayout;
+    bool aggregate = false;
+    CAggregator::Options aggregation;
+    const wchar_t* keyPattern = nullptr;
+    for (int i = 3; i < argc; ++i)
+    {
+        const wchar_t* const checkpointValue = GetOptionValue(argv[i], L"--checkpoint");
+        const wchar_t* const delimiterValue = GetOptionValue(argv[i], L"--fields");
+        const wchar_t* const countValue = GetOptionValue(argv[i], L"--count");
+        const wchar_t* const topValue = GetOptionValue(argv[i], L"--top");
+        const wchar_t* const minuteValue = GetOptionValue(argv[i], L"--per-minute");
+        const wchar_t* const keyValue = GetOptionValue(argv[i], L"--key");
+        if (checkpointValue != nullptr)
+        {
+            checkpointFileName = checkpointValue;
+        }
+        else if (wcscmp(argv[i], L"-v") == 0 || wcscmp(argv[i], L"--invert") == 0)
+        {
+            inverted = true;
+        }
+        else if (wcscmp(argv[i], L"--fields") == 0)
+        {
+            fieldMode = true;
+        }
+        else if (delimiterValue != nullptr && (wcslen(delimiterValue) == 1 || wcscmp(delimiterValue, L"\\t") == 0) &&
+            delimiterValue[0] < 0x80)
+        {
+            fieldMode = true;
+            fieldLayout.delimiter = wcslen(delimiterValue) == 1 ? static_cast<char>(delimiterValue[0]) : '\t';
+        }
+        else if (wcscmp(argv[i], L"--count") == 0 || (countValue != nullptr && GetNumber(countValue, aggregation.keyField)))
+        {
+            aggregate = true;
+        }
+        else if (keyValue != nullptr && *keyValue != L'\0')
+        {
+            aggregate = true;
+            keyPattern = keyValue;
+        }
+        else if (topValue != nullptr && GetNumber(topValue, aggregation.topCount))
+        {
+            aggregate = true;
+        }
+        else if (minuteValue != nullptr && GetNumber(minuteValue, aggregation.timeField))
+        {
+            aggregate = true;
+        }
+        else
+        {
+            fwprintf(stderr, L"Error! Unknown option: \"%ws\"\n", argv[i]);
+            return 1;
+        }
+    }
 
-    const bool openedOk = reader.Open(fileName);
+    // fields of the key and of the time are split by the layout of --fields; the key pattern is copied by Init()
+    CAggregator aggregator;
+    aggregation.layout = fieldLayout;
+    const CW2A keyPatternText(keyPattern != nullptr ? keyPattern : L"");
+    if (keyPattern != nullptr)
+    {
+        aggregation.keyPattern = static_cast<const char*>(keyPatternText);
+        aggregation.keyWildcard = aggregation.keyField != 0 ? aggregation.keyField : 1;
+        aggregation.keyField = 0;
+    }
+    if (aggregate && !aggregator.Init(aggregation))
+    {
+        fwprintf(stderr, L"Error! Invalid --count, --key, --top or --per-minute option\n");
+        return 1;
+    }
+
+    // log writer may keep appending to the file during incremental scans
+    const bool allowWriters = checkpointFileName != nullptr;
+    const bool openedOk = reader.Open(fileName, allowWriters);
     if (!openedOk)
     {
         fwprintf(stderr, L"Error! Failed to open file: \"%ws\"\n", fileName);
         return 2;
     }
 
-    const bool filterSetOk = reader.SetFilter(CW2A(lineFilter));
+    reader.SetInverted(inverted);
+    const bool filterSetOk = fieldMode ? reader.SetFieldFilter(CW2A(lineFilter), fieldLayout) : reader.SetFilter(CW2A(lineFilter));
     if (!filterSetOk)
     {
         fwprintf(stderr, L"Error! Failed to set filter: \"%ws\"\n", lineFilter);
         return 3;
     }
 
+    CLogReader::Checkpoint checkpoint;
+    if (checkpointFileName != nullptr && LoadCheckpoint(checkpointFileName, checkpoint) && !reader.Resume(checkpoint))
+    {
+        fwprintf(stderr, L"Checkpoint does not match the file or the filter, the whole file is scanned\n");
+    }
+
     // prevent printf from changing LF to CRLF
     // so we act the same way as grep does
     _setmode(_fileno(stdout), O_BINARY);
 
-    while (true)
+    if (aggregate)
     {
-        const auto line = reader.GetNextLine();
+        if (!reader.Aggregate(aggregator) || !aggregator.Print(stdout))
+        {
+            fwprintf(stderr, L"Error! Not enough memory for the aggregation\n");
+            return 5;
+        }
+    }
+
+    // runs of non-matching lines are written by one call
+    while (!aggregate)
+    {
+        const auto line = reader.GetNextLines();
         if (!line)
         {
             break;
@@ -64,7 +223,21 @@ int wmain(const int argc, const wchar_t* const argv[])
         //}
     }
 
+    if (checkpointFileName != nullptr)
+    {
+        if (!reader.GetCheckpoint(checkpoint) || !SaveCheckpoint(checkpointFileName, checkpoint))
+        {
+            fwprintf(stderr, L"Error! Failed to save checkpoint: \"%ws\"\n", checkpointFileName);
+            return 4;
+        }
+    }
+
     reader.Close();
 
+#if ENABLE_SCAN_STATS
+    reader.GetScanPlan().Print(stderr);
+    reader.GetStats().Print(stderr);
+#endif
+
     return 0;
 }
@@ -2,6 +2,12 @@
 
 file=/d/temp-one-time/logs/2000m.txt
 
+# Benchmark data is generated deterministically, so results are comparable across machines.
+# Parameters are close to the web server log described in docs/implementation-notes-letter.md.
+if [ ! -f "$file" ]; then
+    ./Release-x64/LogGenerator.exe "$file" 2000M --seed=1 --pattern="*16:01 *" --match-rate=0.0003 || exit 1
+fi
+
 
 ts1=$(date +%s%N)
 # ==================================